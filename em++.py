@@ -4,7 +4,13 @@
 # University of Illinois/NCSA Open Source License.  Both these licenses can be
 # found in the LICENSE file.
 
+import os
 import sys
+
+if __name__ == '__main__' and os.environ.get('EMCC_SERVER'):
+  from tools import compile_server
+  compile_server.run_on_server(sys.argv, emxx=True)
+
 import emcc
 
 emcc.run_via_emxx = True
@@ -16,6 +16,7 @@ import argparse
 import logging
 import sys
 
+from tools import building
 from tools import shared
 from tools import system_libs
 import emscripten
@@ -109,6 +110,120 @@ def build_port(port_name, lib_name):
   system_libs.build_port(port_name, shared.Settings)
 
 
+def build_task(what):
+  logger.info('building and verifying ' + what)
+  if what in SYSTEM_LIBRARIES:
+    library = SYSTEM_LIBRARIES[what]
+    if force:
+      library.erase()
+    library.get_path()
+  elif what == 'sysroot':
+    if force:
+      shared.Cache.erase_file('sysroot_install.stamp')
+    system_libs.ensure_sysroot()
+  elif what == 'struct_info':
+    if force:
+      shared.Cache.erase_file('generated_struct_info.json')
+    emscripten.generate_struct_info()
+  elif what == 'icu':
+    build_port('icu', 'libicuuc.a')
+  elif what == 'zlib':
+    shared.Settings.USE_ZLIB = 1
+    build_port('zlib', 'libz.a')
+    shared.Settings.USE_ZLIB = 0
+  elif what == 'bzip2':
+    build_port('bzip2', 'libbz2.a')
+  elif what == 'bullet':
+    build_port('bullet', 'libbullet.a')
+  elif what == 'vorbis':
+    build_port('vorbis', 'libvorbis.a')
+  elif what == 'ogg':
+    build_port('ogg', 'libogg.a')
+  elif what == 'giflib':
+    build_port('giflib', 'libgif.a')
+  elif what == 'libjpeg':
+    build_port('libjpeg', 'libjpeg.a')
+  elif what == 'libpng':
+    build_port('libpng', 'libpng.a')
+  elif what == 'sdl2':
+    build_port('sdl2', 'libSDL2.a')
+  elif what == 'sdl2-mt':
+    shared.Settings.USE_PTHREADS = 1
+    build_port('sdl2', 'libSDL2-mt.a')
+    shared.Settings.USE_PTHREADS = 0
+  elif what == 'sdl2-gfx':
+    build_port('sdl2_gfx', 'libSDL2_gfx.a')
+  elif what == 'sdl2-image':
+    build_port('sdl2_image', 'libSDL2_image.a')
+  elif what == 'sdl2-image-png':
+    shared.Settings.SDL2_IMAGE_FORMATS = ["png"]
+    build_port('sdl2_image', 'libSDL2_image_png.a')
+    shared.Settings.SDL2_IMAGE_FORMATS = []
+  elif what == 'sdl2-image-jpg':
+    shared.Settings.SDL2_IMAGE_FORMATS = ["jpg"]
+    build_port('sdl2_image', 'libSDL2_image_jpg.a')
+    shared.Settings.SDL2_IMAGE_FORMATS = []
+  elif what == 'sdl2-net':
+    build_port('sdl2_net', 'libSDL2_net.a')
+  elif what == 'sdl2-mixer':
+    old_formats = shared.Settings.SDL2_MIXER_FORMATS
+    shared.Settings.SDL2_MIXER_FORMATS = []
+    build_port('sdl2_mixer', 'libSDL2_mixer.a')
+    shared.Settings.SDL2_MIXER_FORMATS = old_formats
+  elif what == 'sdl2-mixer-ogg':
+    old_formats = shared.Settings.SDL2_MIXER_FORMATS
+    shared.Settings.SDL2_MIXER_FORMATS = ["ogg"]
+    build_port('sdl2_mixer', 'libSDL2_mixer_ogg.a')
+    shared.Settings.SDL2_MIXER_FORMATS = old_formats
+  elif what == 'sdl2-mixer-mp3':
+    old_formats = shared.Settings.SDL2_MIXER_FORMATS
+    shared.Settings.SDL2_MIXER_FORMATS = ["mp3"]
+    build_port('sdl2_mixer', 'libSDL2_mixer_mp3.a')
+    shared.Settings.SDL2_MIXER_FORMATS = old_formats
+  elif what == 'freetype':
+    build_port('freetype', 'libfreetype.a')
+  elif what == 'harfbuzz':
+    build_port('harfbuzz', 'libharfbuzz.a')
+  elif what == 'harfbuzz-mt':
+    shared.Settings.USE_PTHREADS = 1
+    build_port('harfbuzz', 'libharfbuzz-mt.a')
+    shared.Settings.USE_PTHREADS = 0
+  elif what == 'sdl2-ttf':
+    build_port('sdl2_ttf', 'libSDL2_ttf.a')
+  elif what == 'cocos2d':
+    build_port('cocos2d', 'libcocos2d.a')
+  elif what == 'regal':
+    build_port('regal', 'libregal.a')
+  elif what == 'regal-mt':
+    shared.Settings.USE_PTHREADS = 1
+    build_port('regal', 'libregal-mt.a')
+    shared.Settings.USE_PTHREADS = 0
+  elif what == 'boost_headers':
+    build_port('boost_headers', 'libboost_headers.a')
+  elif what == 'mpg123':
+    build_port('mpg123', 'libmpg123.a')
+  else:
+    shared.exit_with_error('unfamiliar build target: ' + what)
+
+  logger.info('...success')
+
+
+def build_in_parallel(tasks):
+  """Builds the tasks with a system_libs.BuildGraph, so that the compile commands
+  of all the libraries and ports share one pool of cores."""
+  # Everything else may need these.
+  for what in tasks:
+    if what in ('sysroot', 'struct_info'):
+      build_task(what)
+  libraries = [what for what in tasks if what in SYSTEM_LIBRARIES]
+  others = [what for what in tasks if what not in SYSTEM_LIBRARIES and what not in ('sysroot', 'struct_info')]
+  # Start with the largest libraries, so that the small ones fill the cores at
+  # the end.
+  libraries.sort(key=lambda what: len(SYSTEM_LIBRARIES[what].get_files()), reverse=True)
+  system_libs.BuildGraph().run([(what, lambda what=what: build_task(what)) for what in libraries],
+                               [(what, lambda what=what: build_task(what)) for what in others])
+
+
 def main():
   global force
   parser = argparse.ArgumentParser(description=__doc__,
@@ -163,103 +278,11 @@ def main():
     skip_tasks = ['cocos2d']
     tasks = [x for x in tasks if x not in skip_tasks]
     print('Building targets: %s' % ' '.join(tasks))
-  for what in tasks:
-    logger.info('building and verifying ' + what)
-    if what in SYSTEM_LIBRARIES:
-      library = SYSTEM_LIBRARIES[what]
-      if force:
-        library.erase()
-      library.get_path()
-    elif what == 'sysroot':
-      if force:
-        shared.Cache.erase_file('sysroot_install.stamp')
-      system_libs.ensure_sysroot()
-    elif what == 'struct_info':
-      if force:
-        shared.Cache.erase_file('generated_struct_info.json')
-      emscripten.generate_struct_info()
-    elif what == 'icu':
-      build_port('icu', 'libicuuc.a')
-    elif what == 'zlib':
-      shared.Settings.USE_ZLIB = 1
-      build_port('zlib', 'libz.a')
-      shared.Settings.USE_ZLIB = 0
-    elif what == 'bzip2':
-      build_port('bzip2', 'libbz2.a')
-    elif what == 'bullet':
-      build_port('bullet', 'libbullet.a')
-    elif what == 'vorbis':
-      build_port('vorbis', 'libvorbis.a')
-    elif what == 'ogg':
-      build_port('ogg', 'libogg.a')
-    elif what == 'giflib':
-      build_port('giflib', 'libgif.a')
-    elif what == 'libjpeg':
-      build_port('libjpeg', 'libjpeg.a')
-    elif what == 'libpng':
-      build_port('libpng', 'libpng.a')
-    elif what == 'sdl2':
-      build_port('sdl2', 'libSDL2.a')
-    elif what == 'sdl2-mt':
-      shared.Settings.USE_PTHREADS = 1
-      build_port('sdl2', 'libSDL2-mt.a')
-      shared.Settings.USE_PTHREADS = 0
-    elif what == 'sdl2-gfx':
-      build_port('sdl2_gfx', 'libSDL2_gfx.a')
-    elif what == 'sdl2-image':
-      build_port('sdl2_image', 'libSDL2_image.a')
-    elif what == 'sdl2-image-png':
-      shared.Settings.SDL2_IMAGE_FORMATS = ["png"]
-      build_port('sdl2_image', 'libSDL2_image_png.a')
-      shared.Settings.SDL2_IMAGE_FORMATS = []
-    elif what == 'sdl2-image-jpg':
-      shared.Settings.SDL2_IMAGE_FORMATS = ["jpg"]
-      build_port('sdl2_image', 'libSDL2_image_jpg.a')
-      shared.Settings.SDL2_IMAGE_FORMATS = []
-    elif what == 'sdl2-net':
-      build_port('sdl2_net', 'libSDL2_net.a')
-    elif what == 'sdl2-mixer':
-      old_formats = shared.Settings.SDL2_MIXER_FORMATS
-      shared.Settings.SDL2_MIXER_FORMATS = []
-      build_port('sdl2_mixer', 'libSDL2_mixer.a')
-      shared.Settings.SDL2_MIXER_FORMATS = old_formats
-    elif what == 'sdl2-mixer-ogg':
-      old_formats = shared.Settings.SDL2_MIXER_FORMATS
-      shared.Settings.SDL2_MIXER_FORMATS = ["ogg"]
-      build_port('sdl2_mixer', 'libSDL2_mixer_ogg.a')
-      shared.Settings.SDL2_MIXER_FORMATS = old_formats
-    elif what == 'sdl2-mixer-mp3':
-      old_formats = shared.Settings.SDL2_MIXER_FORMATS
-      shared.Settings.SDL2_MIXER_FORMATS = ["mp3"]
-      build_port('sdl2_mixer', 'libSDL2_mixer_mp3.a')
-      shared.Settings.SDL2_MIXER_FORMATS = old_formats
-    elif what == 'freetype':
-      build_port('freetype', 'libfreetype.a')
-    elif what == 'harfbuzz':
-      build_port('harfbuzz', 'libharfbuzz.a')
-    elif what == 'harfbuzz-mt':
-      shared.Settings.USE_PTHREADS = 1
-      build_port('harfbuzz', 'libharfbuzz-mt.a')
-      shared.Settings.USE_PTHREADS = 0
-    elif what == 'sdl2-ttf':
-      build_port('sdl2_ttf', 'libSDL2_ttf.a')
-    elif what == 'cocos2d':
-      build_port('cocos2d', 'libcocos2d.a')
-    elif what == 'regal':
-      build_port('regal', 'libregal.a')
-    elif what == 'regal-mt':
-      shared.Settings.USE_PTHREADS = 1
-      build_port('regal', 'libregal-mt.a')
-      shared.Settings.USE_PTHREADS = 0
-    elif what == 'boost_headers':
-      build_port('boost_headers', 'libboost_headers.a')
-    elif what == 'mpg123':
-      build_port('mpg123', 'libmpg123.a')
-    else:
-      logger.error('unfamiliar build target: ' + what)
-      return 1
-
-    logger.info('...success')
+  if len(tasks) > 1 and building.get_num_cores() > 1 and not shared.DEBUG:
+    build_in_parallel(tasks)
+  else:
+    for what in tasks:
+      build_task(what)
   return 0
 
 
@@ -21,16 +21,27 @@ emcc can be influenced by a few environment variables:
 
   EMMAKEN_NO_SDK - Will tell emcc *not* to use the emscripten headers. Instead
                    your system headers will be used.
+
+  EMCC_SERVER - The socket of a compile server (see tools/compile_server.py) to
+                run the invocation on, if it is running.
 """
 
 
+import os
+import sys
+
+# Hand the invocation to a compile server if there is one, before the imports
+# below, which are much of the cost it saves.
+if __name__ == '__main__' and os.environ.get('EMCC_SERVER'):
+  from tools import compile_server
+  compile_server.run_on_server(sys.argv, emxx=False)
+
+import hashlib
 import json
 import logging
-import os
 import re
 import shlex
 import stat
-import sys
 import time
 import base64
 from enum import Enum
@@ -1142,6 +1153,9 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
     if shared.Settings.LZ4:
       shared.Settings.EXPORTED_RUNTIME_METHODS += ['LZ4']
 
+    if shared.Settings.LAZY_PACKAGE:
+      shared.Settings.EXPORTED_RUNTIME_METHODS += ['LAZYPACKAGE']
+
     if shared.Settings.WASM2C:
       # wasm2c only makes sense with standalone wasm - there will be no JS,
       # just wasm and then C
@@ -1423,13 +1437,36 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
       shared.Settings.FETCH = 1
       shared.Settings.SYSTEM_JS_LIBRARIES.append((0, shared.path_from_root('src', 'library_asmfs.js')))
 
+    if shared.Settings.NATIVEFS:
+      if shared.Settings.ASMFS or shared.Settings.NODERAWFS:
+        exit_with_error('NATIVEFS cannot be used with another filesystem (ASMFS or NODERAWFS)')
+      if shared.Settings.STANDALONE_WASM:
+        exit_with_error('NATIVEFS is not compatible with STANDALONE_WASM')
+      if shared.Settings.FORCE_FILESYSTEM:
+        exit_with_error('NATIVEFS has no JS FS API, so it cannot be used with FORCE_FILESYSTEM')
+      if final_suffix in EXECUTABLE_ENDINGS:
+        forced_stdlibs.append('libnativefs')
+      shared.Settings.FILESYSTEM = 0
+      shared.Settings.SYSCALLS_REQUIRE_FILESYSTEM = 0
+      shared.Settings.SYSTEM_JS_LIBRARIES.append((0, shared.path_from_root('src', 'library_nativefs.js')))
+
     # Explicitly drop linking in a malloc implementation if program is not using any dynamic allocation calls.
     if not shared.Settings.USES_DYNAMIC_ALLOC:
       shared.Settings.MALLOC = 'none'
 
+    # Without threads there is only one heap anyhow.
+    if shared.Settings.MALLOC == 'dlmalloc-mt' and not shared.Settings.USE_PTHREADS:
+      shared.Settings.MALLOC = 'dlmalloc'
+
     if shared.Settings.MALLOC == 'emmalloc':
       shared.Settings.SYSTEM_JS_LIBRARIES.append((0, shared.path_from_root('src', 'library_emmalloc.js')))
 
+    if shared.Settings.MALLOC_PROFILER:
+      if shared.Settings.MALLOC == 'none':
+        exit_with_error('-s MALLOC_PROFILER requires malloc, and cannot be used with -s MALLOC=none')
+      # The profiler maps the stack traces it captures to wasm functions
+      shared.Settings.USE_OFFSET_CONVERTER = 1
+
     if shared.Settings.FETCH and final_suffix in EXECUTABLE_ENDINGS:
       forced_stdlibs.append('libfetch')
       shared.Settings.SYSTEM_JS_LIBRARIES.append((0, shared.path_from_root('src', 'library_fetch.js')))
@@ -1470,9 +1507,17 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
     if options.use_preload_plugins or len(options.preload_files) or len(options.embed_files):
       if shared.Settings.NODERAWFS:
         exit_with_error('--preload-file and --embed-file cannot be used with NODERAWFS which disables virtual filesystem')
+      if shared.Settings.NATIVEFS:
+        exit_with_error('--preload-file and --embed-file cannot be used with NATIVEFS, which has no JS FS API')
       # if we include any files, or intend to use preload plugins, then we definitely need filesystem support
       shared.Settings.FORCE_FILESYSTEM = 1
 
+    if shared.Settings.LAZY_PACKAGE:
+      if shared.Settings.LZ4:
+        exit_with_error('LAZY_PACKAGE and LZ4 cannot be used together')
+      if options.use_preload_cache or options.use_preload_plugins:
+        exit_with_error('LAZY_PACKAGE cannot be used with --use-preload-cache or --use-preload-plugins')
+
     if options.proxy_to_worker or options.use_preload_plugins:
       shared.Settings.DEFAULT_LIBRARY_FUNCS_TO_INCLUDE += ['$Browser']
 
@@ -1517,6 +1562,8 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
       shared.Settings.TEXTDECODER = 0
       shared.Settings.SYSTEM_JS_LIBRARIES.append((0, shared.path_from_root('src', 'library_pthread.js')))
       newargs += ['-pthread']
+      # -pthread enables the bulk memory feature in clang as well
+      shared.Settings.BULK_MEMORY = 1
       # some pthreads code is in asm.js library functions, which are auto-exported; for the wasm backend, we must
       # manually export them
 
@@ -1629,6 +1676,28 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
       if shared.Settings.PROXY_TO_PTHREAD:
         exit_with_error('-s PROXY_TO_PTHREAD=1 requires -s USE_PTHREADS to work!')
 
+    if shared.Settings.OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER and not (shared.Settings.USE_PTHREADS and shared.Settings.OFFSCREEN_FRAMEBUFFER):
+      exit_with_error('-s OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER requires -s USE_PTHREADS and -s OFFSCREEN_FRAMEBUFFER')
+
+    if shared.Settings.OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER:
+      # Called before synchronous calls of library_html5_webgl.js are proxied
+      shared.Settings.EXPORTED_FUNCTIONS += ['__emscripten_gl_command_buffer_flush']
+
+    if shared.Settings.OFFSCREEN_FRAMEBUFFER_STATE_SHADOW and not (shared.Settings.USE_PTHREADS and shared.Settings.OFFSCREEN_FRAMEBUFFER):
+      exit_with_error('-s OFFSCREEN_FRAMEBUFFER_STATE_SHADOW requires -s USE_PTHREADS and -s OFFSCREEN_FRAMEBUFFER')
+
+    if shared.Settings.GL_STATE_FILTER:
+      if shared.Settings.LEGACY_GL_EMULATION:
+        exit_with_error('-s GL_STATE_FILTER is not compatible with -s LEGACY_GL_EMULATION')
+      # Called from GL.makeContextCurrent() and GL.deleteContext()
+      shared.Settings.EXPORTED_FUNCTIONS += ['_emscripten_gl_state_filter_make_current', '_emscripten_gl_state_filter_forget_context']
+
+    if shared.Settings.WASM_STRING_TRANSCODING:
+      if shared.Settings.MALLOC == 'none':
+        exit_with_error('-s WASM_STRING_TRANSCODING requires malloc, and cannot be used with -s MALLOC=none')
+      # Called from UTF8ToString() and stringToUTF8() for long strings
+      shared.Settings.EXPORTED_FUNCTIONS += ['_emscripten_utf8_to_utf16', '_emscripten_utf16_to_utf8', '_strlen', '_strnlen']
+
     def check_memory_setting(setting):
       if shared.Settings[setting] % webassembly.WASM_PAGE_SIZE != 0:
         exit_with_error(f'{setting} must be a multiple of WebAssembly page size (64KiB), was {shared.Settings[setting]}')
@@ -1847,6 +1916,7 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
        shared.Settings.EMBIND or \
        shared.Settings.FETCH or \
        shared.Settings.PROXY_POSIX_SOCKETS or \
+       shared.Settings.WASM_STRING_TRANSCODING or \
        options.memory_profiler or \
        sanitize:
       shared.Settings.EXPORTED_FUNCTIONS += ['_malloc', '_free']
@@ -2161,6 +2231,76 @@ There is NO warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR P
   return 0
 
 
+class IncrementalLink(object):
+  """Keeps the JS output of a link, and reuses it in the next link of the same
+  target if the metadata, settings and JS inputs are the same
+  (-s INCREMENTAL_LINK)."""
+
+  def __init__(self, options, target):
+    self.options = options
+    self.state_file = unsuffixed(target) + '.link-state.json'
+    self.start_time = time.time()
+    self.key = None
+    # The JS of the previous link, if it can be reused.
+    self.js = None
+    self.previous_time = None
+
+  @staticmethod
+  def unsupported_reason(options):
+    if (shared.Settings.OPT_LEVEL >= 2 and shared.Settings.DEBUG_LEVEL <= 2) or will_metadce():
+      return 'optimizations that change the JS and the wasm together'
+    if options.use_closure_compiler:
+      return 'closure'
+    if shared.Settings.EVAL_CTORS:
+      return 'EVAL_CTORS'
+    if shared.Settings.SINGLE_FILE:
+      return 'SINGLE_FILE'
+    if shared.Settings.WASM2JS or shared.Settings.WASM != 1:
+      return 'WASM2JS'
+    if shared.Settings.RELOCATABLE:
+      return 'dynamic linking'
+    if options.preload_files or options.embed_files:
+      return 'preloaded or embedded files'
+    return None
+
+  def reuse_js(self, metadata):
+    """Called by emscript() once the metadata of the wasm is known. Returns
+    whether the JS of the previous link can be reused."""
+    settings_json = json.dumps(shared.Settings.to_dict(), sort_keys=True)
+    h = hashlib.sha256()
+    h.update(emscripten.get_js_compiler_cache_key(settings_json).encode('utf-8'))
+    h.update(json.dumps(metadata, sort_keys=True).encode('utf-8'))
+    h.update(json.dumps([self.options.pre_js, self.options.post_js, self.options.js_transform]).encode('utf-8'))
+    self.key = h.hexdigest()
+    try:
+      with open(self.state_file) as f:
+        state = json.load(f)
+    except (OSError, ValueError):
+      ToolchainProfiler.record_cache_access('incremental_link', False)
+      return False
+    if state.get('key') != self.key:
+      logger.debug('incremental link: metadata, settings or JS inputs changed, regenerating JS')
+      ToolchainProfiler.record_cache_access('incremental_link', False)
+      return False
+    ToolchainProfiler.record_cache_access('incremental_link', True)
+    self.js = state['js']
+    self.previous_time = state['time']
+    return True
+
+  def save(self, js_file):
+    with open(js_file) as f:
+      js = f.read()
+    temp_file = self.state_file + '.tmp'
+    with open(temp_file, 'w') as f:
+      json.dump({'key': self.key, 'js': js, 'time': time.time() - self.start_time}, f)
+    os.replace(temp_file, self.state_file)
+
+  def report(self):
+    elapsed = time.time() - self.start_time
+    logger.info('incremental link: reused the JS of the previous link, saving %.2fs (%.2fs instead of %.2fs)',
+                self.previous_time - elapsed, elapsed, self.previous_time)
+
+
 def post_link(options, in_wasm, wasm_target, target):
   global final_js
 
@@ -2169,6 +2309,14 @@ def post_link(options, in_wasm, wasm_target, target):
   if options.oformat != OFormat.WASM:
     final_js = in_temp(target_basename + '.js')
 
+  incremental = None
+  if shared.Settings.INCREMENTAL_LINK and final_js:
+    reason = IncrementalLink.unsupported_reason(options)
+    if reason:
+      diagnostics.warning('emcc', 'INCREMENTAL_LINK has no effect with %s', reason)
+    else:
+      incremental = IncrementalLink(options, target)
+
   if shared.Settings.MEM_INIT_IN_WASM:
     memfile = None
   else:
@@ -2185,7 +2333,12 @@ def post_link(options, in_wasm, wasm_target, target):
     if embed_memfile():
       shared.Settings.SUPPORT_BASE64_EMBEDDING = 1
 
-    emscripten.run(in_wasm, wasm_target, final_js, memfile)
+    emscripten.run(in_wasm, wasm_target, final_js, memfile,
+                   reuse_js=incremental.reuse_js if incremental else None)
+    reuse_js = incremental and incremental.js is not None
+    if reuse_js:
+      with open(final_js, 'w') as f:
+        f.write(incremental.js)
     save_intermediate('original')
 
   # exit block 'emscript'
@@ -2209,13 +2362,15 @@ def post_link(options, in_wasm, wasm_target, target):
         file_args.append('--use-preload-cache')
       if shared.Settings.LZ4:
         file_args.append('--lz4')
+      if shared.Settings.LAZY_PACKAGE:
+        file_args.append('--lazy')
       if options.use_preload_plugins:
         file_args.append('--use-preload-plugins')
       file_code = shared.check_call([shared.FILE_PACKAGER, unsuffixed(target) + '.data'] + file_args, stdout=PIPE).stdout
       options.pre_js = js_manipulation.add_files_pre_js(options.pre_js, file_code)
 
     # Apply pre and postjs files
-    if final_js and (options.pre_js or options.post_js):
+    if final_js and (options.pre_js or options.post_js) and not reuse_js:
       logger.debug('applying pre/postjses')
       src = open(final_js).read()
       final_js += '.pp.js'
@@ -2228,7 +2383,7 @@ def post_link(options, in_wasm, wasm_target, target):
       save_intermediate('pre-post')
 
     # Apply a source code transformation, if requested
-    if options.js_transform:
+    if options.js_transform and not reuse_js:
       safe_copy(final_js, final_js + '.tr.js')
       final_js += '.tr.js'
       posix = not shared.WINDOWS
@@ -2239,7 +2394,7 @@ def post_link(options, in_wasm, wasm_target, target):
   # exit block 'source transforms'
   log_time('source transforms')
 
-  if memfile and not shared.Settings.MINIMAL_RUNTIME:
+  if memfile and not shared.Settings.MINIMAL_RUNTIME and not reuse_js:
     # MINIMAL_RUNTIME doesn't use `var memoryInitializer` but instead expects Module['mem'] to
     # be loaded before the module.  See src/postamble_minimal.js.
     with ToolchainProfiler.profile_block('memory initializer'):
@@ -2253,9 +2408,14 @@ def post_link(options, in_wasm, wasm_target, target):
     log_time('memory initializer')
 
   with ToolchainProfiler.profile_block('binaryen'):
-    do_binaryen(target, options, wasm_target)
+    do_binaryen(target, options, wasm_target, reuse_js)
 
   log_time('binaryen')
+
+  if reuse_js:
+    incremental.report()
+  elif incremental:
+    incremental.save(final_js)
   # If we are not emitting any JS then we are all done now
   if options.oformat == OFormat.WASM:
     return
@@ -2628,6 +2788,14 @@ def parse_args(newargs):
       shared.Settings.USE_RTTI = 0
     elif arg == '-frtti':
       shared.Settings.USE_RTTI = 1
+    elif arg == '-msimd128':
+      shared.Settings.WASM_SIMD = 1
+    elif arg == '-mno-simd128':
+      shared.Settings.WASM_SIMD = 0
+    elif arg == '-mbulk-memory':
+      shared.Settings.BULK_MEMORY = 1
+    elif arg == '-mno-bulk-memory':
+      shared.Settings.BULK_MEMORY = 0
     elif arg.startswith('-jsD'):
       key = arg[4:]
       if '=' in key:
@@ -2681,7 +2849,7 @@ def emit_js_source_maps(target, js_transform_tempfiles):
                       '--offset', '0'])
 
 
-def do_binaryen(target, options, wasm_target):
+def do_binaryen(target, options, wasm_target, reuse_js=False):
   global final_js
   logger.debug('using binaryen')
   if shared.Settings.GENERATE_SOURCE_MAP and not shared.Settings.SOURCE_MAP_BASE:
@@ -2732,7 +2900,8 @@ def do_binaryen(target, options, wasm_target):
     diagnostics.warning('deprecated', 'We hope to remove support for EMIT_EMSCRIPTEN_METADATA. See https://github.com/emscripten-core/emscripten/issues/12231')
     webassembly.add_emscripten_metadata(wasm_target)
 
-  if final_js:
+  # When reusing the JS of the previous link it has already been processed.
+  if final_js and not reuse_js:
     # >=2GB heap support requires pointers in JS to be unsigned. rather than
     # require all pointers to be unsigned by default, which increases code size
     # a little, keep them signed, and just unsign them here if we need that.
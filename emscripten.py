@@ -9,9 +9,11 @@ header files (so that the JS compiler can see the constants in those
 headers, for the libc implementation in JS).
 """
 
+import hashlib
 import os
 import json
 import subprocess
+import sys
 import time
 import logging
 import pprint
@@ -19,6 +21,7 @@ import shutil
 from collections import OrderedDict
 
 from tools import building
+from tools import config
 from tools import diagnostics
 from tools import shared
 from tools import gen_struct_info
@@ -154,6 +157,76 @@ def apply_static_code_hooks(forwarded_json, code):
   return code
 
 
+# Number of outputs of the JS compiler to keep in the cache.
+JS_COMPILER_CACHE_ENTRIES = 32
+
+
+def get_js_compiler_cache_key(settings_json):
+  """Hashes everything the JS compiler reads: the settings, which include the
+  set of symbols required from JS, the contents of src/ and the JS libraries
+  and response files named in the settings."""
+  h = hashlib.sha256()
+
+  def add_file(filename):
+    h.update(filename.encode('utf-8') + b'\0')
+    with open(filename, 'rb') as f:
+      h.update(f.read())
+    h.update(b'\0')
+
+  h.update(' '.join(config.NODE_JS).encode('utf-8') + b'\0')
+  h.update(settings_json.encode('utf-8') + b'\0')
+  src_dir = path_from_root('src')
+  for root, dirs, files in os.walk(src_dir):
+    dirs.sort()
+    for name in sorted(files):
+      add_file(os.path.join(root, name))
+  for _, library in shared.Settings.SYSTEM_JS_LIBRARIES:
+    if not library.startswith(src_dir + os.sep) and os.path.isfile(library):
+      add_file(library)
+  for value in shared.Settings.to_dict().values():
+    if isinstance(value, str) and value.startswith('@') and os.path.isfile(value[1:]):
+      add_file(value[1:])
+  return h.hexdigest()
+
+
+def evict_js_compiler_cache(cache_dir):
+  """Deletes all but the most recently used outputs of the JS compiler."""
+  entries = []
+  for name in os.listdir(cache_dir):
+    if name.endswith('.json'):
+      try:
+        entries.append((os.path.getmtime(os.path.join(cache_dir, name)), name))
+      except OSError:
+        # Deleted by another link in the meantime.
+        pass
+  entries.sort(reverse=True)
+  for _, name in entries[JS_COMPILER_CACHE_ENTRIES:]:
+    shared.try_delete(os.path.join(cache_dir, name))
+
+
+def run_js_compiler(settings_json, stderr_file):
+  """Runs the JS compiler, returning its stdout and stderr. stderr is only
+  captured if it is not sent to stderr_file."""
+  # Save settings to a file to work around v8 issue 1579
+  with shared.configuration.get_temp_files().get_file('.txt') as settings_file:
+    with open(settings_file, 'w') as s:
+      s.write(settings_json)
+
+    # Call js compiler
+    env = os.environ.copy()
+    env['EMCC_BUILD_DIR'] = os.getcwd()
+    cmd = config.NODE_JS + [path_from_root('src', 'compiler.js'), settings_file]
+    shared.print_compiler_stage(cmd)
+    proc = shared.run_process(cmd, check=False, stdout=subprocess.PIPE,
+                              stderr=stderr_file or subprocess.PIPE,
+                              cwd=path_from_root('src'), env=env)
+  if proc.stderr:
+    sys.stderr.write(proc.stderr)
+  if proc.returncode:
+    exit_with_error("'%s' failed (%d)", shared.shlex_join(cmd), proc.returncode)
+  return proc.stdout, proc.stderr or ''
+
+
 def compile_settings():
   stderr_file = os.environ.get('EMCC_STDERR_FILE')
   if stderr_file:
@@ -161,17 +234,46 @@ def compile_settings():
     logger.info('logging stderr in js compiler phase into %s' % stderr_file)
     stderr_file = open(stderr_file, 'w')
 
-  # Save settings to a file to work around v8 issue 1579
-  with shared.configuration.get_temp_files().get_file('.txt') as settings_file:
-    with open(settings_file, 'w') as s:
-      json.dump(shared.Settings.to_dict(), s, sort_keys=True)
+  settings_json = json.dumps(shared.Settings.to_dict(), sort_keys=True)
+
+  # The output of the JS compiler is cached by a hash of its inputs, so that
+  # relinking with the same settings and the same set of required symbols does
+  # not need to run it again. stderr is cached along with the output so that
+  # warnings are shown on every link.
+  cache_file = None
+  if not stderr_file and os.environ.get('EMCC_SKIP_JS_COMPILER_CACHE') != '1':
+    cache_dir = shared.Cache.get_path('js_compiler')
+    cache_file = os.path.join(cache_dir, get_js_compiler_cache_key(settings_json) + '.json')
+
+  cached = None
+  if cache_file and os.path.exists(cache_file):
+    try:
+      with open(cache_file) as f:
+        cached = json.load(f)
+      # Mark the entry as recently used, for eviction.
+      os.utime(cache_file, None)
+    except (OSError, ValueError):
+      # Evicted by another link in the meantime.
+      cached = None
+
+  if cached:
+    logger.debug('using cached JS compiler output: %s' % cache_file)
+    out = cached['out']
+    if cached['stderr']:
+      sys.stderr.write(cached['stderr'])
+  else:
+    out, err = run_js_compiler(settings_json, stderr_file)
+    if cache_file and not config.FROZEN_CACHE:
+      # Other links may be reading or writing the same entry concurrently, so
+      # write a temporary file and rename it into place rather than taking the
+      # cache lock.
+      shared.safe_ensure_dirs(cache_dir)
+      temp_file = cache_file + '.%d.tmp' % os.getpid()
+      with open(temp_file, 'w') as f:
+        json.dump({'out': out, 'stderr': err}, f)
+      os.replace(temp_file, cache_file)
+      evict_js_compiler_cache(cache_dir)
 
-    # Call js compiler
-    env = os.environ.copy()
-    env['EMCC_BUILD_DIR'] = os.getcwd()
-    out = shared.run_js_tool(path_from_root('src', 'compiler.js'),
-                             [settings_file], stdout=subprocess.PIPE, stderr=stderr_file,
-                             cwd=path_from_root('src'), env=env)
   assert '//FORWARDED_DATA:' in out, 'Did not receive forwarded data in pre output - process failed?'
   glue, forwarded_data = out.split('//FORWARDED_DATA:')
   return glue, forwarded_data
@@ -267,7 +369,7 @@ def create_named_globals(metadata):
   return '\n'.join(named_globals)
 
 
-def emscript(in_wasm, out_wasm, outfile_js, memfile, DEBUG):
+def emscript(in_wasm, out_wasm, outfile_js, memfile, DEBUG, reuse_js=None):
   # Overview:
   #   * Run wasm-emscripten-finalize to extract metadata and modify the binary
   #     to use emscripten's wasm<->JS ABI
@@ -299,6 +401,10 @@ def emscript(in_wasm, out_wasm, outfile_js, memfile, DEBUG):
     set_memory(static_bump)
     logger.debug('stack_base: %d, stack_max: %d, heap_base: %d', shared.Settings.STACK_BASE, shared.Settings.STACK_MAX, shared.Settings.HEAP_BASE)
 
+  if reuse_js and reuse_js(metadata):
+    logger.debug('emscript: reusing the js glue of the previous link')
+    return
+
   glue, forwarded_data = compile_settings()
   if DEBUG:
     logger.debug('  emscript: glue took %s seconds' % (time.time() - t))
@@ -838,8 +944,8 @@ def generate_struct_info():
   shared.Settings.STRUCT_INFO = shared.Cache.get(generated_struct_info_name, generate_struct_info)
 
 
-def run(in_wasm, out_wasm, outfile_js, memfile):
+def run(in_wasm, out_wasm, outfile_js, memfile, reuse_js=None):
   if not shared.Settings.BOOTSTRAPPING_STRUCT_INFO:
     generate_struct_info()
 
-  emscript(in_wasm, out_wasm, outfile_js, memfile, shared.DEBUG)
+  emscript(in_wasm, out_wasm, outfile_js, memfile, shared.DEBUG, reuse_js)
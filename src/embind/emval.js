@@ -12,9 +12,9 @@
 /*jslint sub:true*/ /* The symbols 'fromWireType' and 'toWireType' must be accessed via array notation to be closure-safe since craftInvokerFunction crafts functions as strings that can't be closured. */
 
 // -- jshint doesn't understand library syntax, so we need to mark the symbols exposed here
-/*global getStringOrSymbol, emval_handle_array, __emval_register, __emval_unregister, requireHandle, count_emval_handles, emval_symbols, emval_free_list, get_first_emval, __emval_decref, emval_newers*/
+/*global getStringOrSymbol, emval_handle_array, __emval_register, __emval_unregister, requireHandle, EMVAL_SCOPED_BASE, count_emval_handles, emval_symbols, emval_free_list, get_first_emval, __emval_decref, emval_newers*/
 /*global craftEmvalAllocator, __emval_addMethodCaller, emval_methodCallers, LibraryManager, mergeInto, __emval_allocateDestructors, global, __emval_lookupTypes, makeLegalFunctionName*/
-/*global emval_get_global*/
+/*global emval_get_global, emval_scope_values, emval_scope_starts, emval_scope_top, __emval_register_unscoped*/
 
 var LibraryEmVal = {
   $emval_handle_array: [{},
@@ -23,6 +23,16 @@ var LibraryEmVal = {
   $emval_free_list: [],
   $emval_symbols: {}, // address -> string
 
+  // Handles registered while a val::scope is open are bump-allocated out of
+  // emval_scope_values instead of emval_handle_array.  They are not reference
+  // counted, and are all released together when the innermost scope exits.
+  // Scoped handle numbers start at EMVAL_SCOPED_BASE (_EMVAL_SCOPED_BASE in
+  // val.h) so that both C++ and JS can tell them apart from refcounted handles.
+  $EMVAL_SCOPED_BASE: 0x40000000,
+  $emval_scope_values: [],
+  $emval_scope_starts: [], // stack of emval_scope_top values, one per open scope
+  $emval_scope_top: 0,
+
   $init_emval__deps: ['$count_emval_handles', '$get_first_emval'],
   $init_emval__postset: 'init_emval();',
   $init_emval: function() {
@@ -66,16 +76,32 @@ var LibraryEmVal = {
     }
   },
 
-  $requireHandle__deps: ['$emval_handle_array', '$throwBindingError'],
+  $requireHandle__deps: ['$emval_handle_array', '$EMVAL_SCOPED_BASE', '$emval_scope_values', '$emval_scope_top', '$throwBindingError'],
   $requireHandle: function(handle) {
     if (!handle) {
         throwBindingError('Cannot use deleted val. handle = ' + handle);
     }
+    if (handle >= EMVAL_SCOPED_BASE) {
+        var index = handle - EMVAL_SCOPED_BASE;
+        if (index >= emval_scope_top) {
+            throwBindingError('Cannot use val from a val::scope that has exited. handle = ' + handle);
+        }
+        return emval_scope_values[index];
+    }
     return emval_handle_array[handle].value;
   },
 
-  _emval_register__deps: ['$emval_free_list', '$emval_handle_array', '$init_emval'],
+  _emval_register__deps: ['_emval_register_unscoped', '$EMVAL_SCOPED_BASE', '$emval_scope_starts', '$emval_scope_values', '$emval_scope_top'],
   _emval_register: function(value) {
+    if (emval_scope_starts.length && value !== undefined && value !== null && value !== true && value !== false) {
+        emval_scope_values[emval_scope_top] = value;
+        return EMVAL_SCOPED_BASE + emval_scope_top++;
+    }
+    return __emval_register_unscoped(value);
+  },
+
+  _emval_register_unscoped__deps: ['$emval_free_list', '$emval_handle_array', '$init_emval'],
+  _emval_register_unscoped: function(value) {
 
     switch(value){
       case undefined :{ return 1; }
@@ -94,29 +120,54 @@ var LibraryEmVal = {
   },
 
   _emval_incref__sig: 'vi',
-  _emval_incref__deps: ['$emval_handle_array'],
+  _emval_incref__deps: ['$emval_handle_array', '$EMVAL_SCOPED_BASE'],
   _emval_incref: function(handle) {
-    if (handle > 4) {
+    if (handle > 4 && handle < EMVAL_SCOPED_BASE) {
         emval_handle_array[handle].refcount += 1;
     }
   },
 
   _emval_decref__sig: 'vi',
-  _emval_decref__deps: ['$emval_free_list', '$emval_handle_array'],
+  _emval_decref__deps: ['$emval_free_list', '$emval_handle_array', '$EMVAL_SCOPED_BASE'],
   _emval_decref: function(handle) {
-    if (handle > 4 && 0 === --emval_handle_array[handle].refcount) {
+    if (handle > 4 && handle < EMVAL_SCOPED_BASE && 0 === --emval_handle_array[handle].refcount) {
         emval_handle_array[handle] = undefined;
         emval_free_list.push(handle);
     }
   },
 
-  _emval_run_destructors__deps: ['_emval_decref', '$emval_handle_array', '$runDestructors'],
+  _emval_run_destructors__deps: ['_emval_decref', '$requireHandle', '$runDestructors'],
   _emval_run_destructors: function(handle) {
-    var destructors = emval_handle_array[handle].value;
+    var destructors = requireHandle(handle);
     runDestructors(destructors);
     __emval_decref(handle);
   },
 
+  _emval_scope_enter__deps: ['$emval_scope_starts', '$emval_scope_top'],
+  _emval_scope_enter: function() {
+    emval_scope_starts.push(emval_scope_top);
+  },
+
+  _emval_scope_exit__deps: ['$emval_scope_starts', '$emval_scope_values', '$emval_scope_top'],
+  _emval_scope_exit: function() {
+    var start = emval_scope_starts.pop();
+    // Drop the references so the values can be collected, but keep the
+    // array's storage around for the next scope.
+    for (var i = start; i < emval_scope_top; ++i) {
+        emval_scope_values[i] = undefined;
+    }
+    emval_scope_top = start;
+  },
+
+  _emval_scope_escape__deps: ['_emval_incref', '_emval_register_unscoped', '$requireHandle', '$EMVAL_SCOPED_BASE'],
+  _emval_scope_escape: function(handle) {
+    if (handle >= EMVAL_SCOPED_BASE) {
+        return __emval_register_unscoped(requireHandle(handle));
+    }
+    __emval_incref(handle);
+    return handle;
+  },
+
   _emval_new_array__deps: ['_emval_register'],
   _emval_new_array: function() {
     return __emval_register([]);
@@ -3315,6 +3315,28 @@ LibraryManager.library = {
     return i;
   },
 
+  // Writes the PCs of up to count frames of the current call stack to buffer, starting
+  // at the caller of the function that calls this one. Used by the malloc profiler (see
+  // system/lib/malloc_profiler.c), which needs deeper stacks than the default
+  // Error.stackTraceLimit of V8 gives.
+  _emscripten_malloc_profiler_unwind__deps: ['_emscripten_save_in_unwind_cache', 'emscripten_generate_pc'],
+  _emscripten_malloc_profiler_unwind: function(buffer, count) {
+    var limit = Error.stackTraceLimit;
+    Error.stackTraceLimit = count + 2;
+    var stack = new Error().stack.split('\n');
+    Error.stackTraceLimit = limit;
+    if (stack[0] == 'Error') {
+      stack.shift();
+    }
+    // Skip this function and its caller.
+    stack = stack.slice(2, count + 2);
+    __emscripten_save_in_unwind_cache(stack);
+    for (var i = 0; i < stack.length; ++i) {
+      {{{ makeSetValue('buffer', 'i*4', '_emscripten_generate_pc(stack[i])', 'i32', 0, true) }}};
+    }
+    return i;
+  },
+
   // Look up the function name from our stack frame cache with our PC representation.
   emscripten_pc_get_function__deps: ['$UNWIND_CACHE', '$withBuiltinMalloc'
 #if MINIMAL_RUNTIME
@@ -574,6 +574,13 @@ function handleWebGLProxying(funcs) {
   targetingOffscreenFramebuffer = true;
 #endif
 
+  // GL calls that the calling thread recorded into its command buffer must
+  // reach the main thread before a synchronous call that is proxied there.
+  var flushCommandBuffer = '';
+#if OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER
+  flushCommandBuffer = '__emscripten_gl_command_buffer_flush(); ';
+#endif
+
   for(var i in funcs) {
     // Is this a function that takes GL context handle as first argument?
     var proxyContextHandle = funcs[i + '__proxy'] == 'sync_on_webgl_context_handle_thread';
@@ -601,13 +608,25 @@ function handleWebGLProxying(funcs) {
       var funcArgsString = funcArgs.join(',');
       var retStatement = funcs[i + '__sig'][0] != 'v' ? 'return' : '';
       var contextCheck = proxyContextHandle ? 'GL.contexts[p0]' : 'GLctx';
-      var funcBody = `${retStatement} ${contextCheck} ? _${i}_calling_thread(${funcArgsString}) : _${i}_main_thread(${funcArgsString});`;
+      var funcBody = `if (${contextCheck}) ${retStatement} _${i}_calling_thread(${funcArgsString}); else { ${flushCommandBuffer}${retStatement} _${i}_main_thread(${funcArgsString}); }`;
       if (funcs[i + '_before_on_calling_thread']) {
         funcs[i + '__deps'].push(i + '_before_on_calling_thread');
         funcBody = `_${i}_before_on_calling_thread(${funcArgsString}); ` + funcBody;
       }
       funcArgs.push(funcBody);
       funcs[i] = new (Function.prototype.bind.apply(Function, [Function].concat(funcArgs)));
+    } else if (targetingOffscreenFramebuffer && flushCommandBuffer) {
+      // Like below, but flush the command buffer of the calling thread before proxying.
+      funcs[i + '_main_thread'] = funcs[i];
+      funcs[i + '_main_thread__proxy'] = 'sync';
+      funcs[i + '_main_thread__sig'] = funcs[i + '__sig'];
+      if (funcs[i + '__deps']) funcs[i + '_main_thread__deps'] = funcs[i + '__deps'];
+      funcs[i + '__deps'] = [i + '_main_thread'];
+      delete funcs[i + '__proxy'];
+      var funcArgs = listOfNFunctionArgs(funcs[i]);
+      var retStatement = funcs[i + '__sig'][0] != 'v' ? 'return' : '';
+      funcArgs.push(`${flushCommandBuffer}${retStatement} _${i}_main_thread(${funcArgs.join(',')});`);
+      funcs[i] = new (Function.prototype.bind.apply(Function, [Function].concat(funcArgs)));
     } else if (targetingOffscreenFramebuffer) {
       // When targeting only OFFSCREEN_FRAMEBUFFER, unconditionally proxy all GL calls to
       // main thread.
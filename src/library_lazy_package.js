@@ -0,0 +1,297 @@
+/**
+ * @license
+ * Copyright 2021 The Emscripten Authors
+ * SPDX-License-Identifier: MIT
+ */
+
+#if LAZY_PACKAGE
+mergeInto(LibraryManager.library, {
+  $LAZYPACKAGE__deps: ['$FS', '$PATH', '$ERRNO_CODES'],
+  $LAZYPACKAGE: {
+    DIR_MODE: {{{ cDefine('S_IFDIR') }}} | 511 /* 0777 */,
+    FILE_MODE: {{{ cDefine('S_IFREG') }}} | 365 /* 0555 */,
+    // A package written by file_packager --lazy starts with the magic 'EMPK',
+    // the format version and the size of the index, as little endian uint32s,
+    // followed by the index (as JSON) and then the data of the files.
+    MAGIC: 0x4b504d45,
+    VERSION: 1,
+    HEADER_SIZE: 12,
+    // The first request for a package is this large, which is usually enough
+    // for the whole index, and for all of a small package.
+    INDEX_REQUEST_SIZE: 64 * 1024,
+    // File data is read from the package, and kept, in chunks of this size.
+    CHUNK_SIZE: 1024 * 1024,
+    // The number of reads from packages so far, for debugging purposes.
+    reads: 0,
+    // Reads the index of the package at url, and creates its files. Their data
+    // is only read when they are first read from.
+    loadPackage: function(url, onload, onerror) {
+      var pack = {
+        url: url,
+        fd: null,
+        // Set if the whole package was read, as happens if the server does not
+        // support range requests.
+        whole: null,
+        dataOffset: 0,
+        size: 0,
+        chunks: [],
+      };
+      LAZYPACKAGE.readAsync(pack, 0, LAZYPACKAGE.INDEX_REQUEST_SIZE, function(bytes) {
+        var view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+        if (bytes.length < LAZYPACKAGE.HEADER_SIZE || view.getUint32(0, true) !== LAZYPACKAGE.MAGIC) {
+          onerror(new Error(url + ' is not a package written by file_packager --lazy'));
+          return;
+        }
+        if (view.getUint32(4, true) !== LAZYPACKAGE.VERSION) {
+          onerror(new Error(url + ' has an unsupported package version ' + view.getUint32(4, true)));
+          return;
+        }
+        pack.dataOffset = LAZYPACKAGE.HEADER_SIZE + view.getUint32(8, true);
+        function withIndex(index) {
+          var metadata = JSON.parse(UTF8ArrayToString(index, 0, index.length));
+          pack.size = metadata['size'];
+          // Keep the chunks that the first request already read.
+          for (var i = 0; (i + 1) * LAZYPACKAGE.CHUNK_SIZE <= pack.size &&
+                          pack.dataOffset + (i + 1) * LAZYPACKAGE.CHUNK_SIZE <= bytes.length; i++) {
+            pack.chunks[i] = bytes.slice(pack.dataOffset + i * LAZYPACKAGE.CHUNK_SIZE, pack.dataOffset + (i + 1) * LAZYPACKAGE.CHUNK_SIZE);
+          }
+          if (pack.dataOffset + pack.size <= bytes.length) {
+            pack.whole = bytes;
+          }
+          metadata['files'].forEach(function(file) {
+            var dir = PATH.dirname(file['filename']);
+            var name = PATH.basename(file['filename']);
+            FS.createPath('', dir, true, true);
+            var parent = FS.analyzePath(dir).object;
+            LAZYPACKAGE.createNode(parent, name, LAZYPACKAGE.FILE_MODE, 0, {
+              pack: pack,
+              start: file['start'],
+              end: file['end'],
+            });
+          });
+          onload();
+        }
+        if (pack.dataOffset <= bytes.length) {
+          withIndex(bytes.subarray(LAZYPACKAGE.HEADER_SIZE, pack.dataOffset));
+        } else {
+          LAZYPACKAGE.readAsync(pack, LAZYPACKAGE.HEADER_SIZE, pack.dataOffset, withIndex, onerror);
+        }
+      }, onerror);
+    },
+    // Reads the bytes [start, end) of a package, or fewer at its end.
+    readAsync: function(pack, start, end, onload, onerror) {
+      LAZYPACKAGE.reads++;
+#if ENVIRONMENT_MAY_BE_NODE
+      if (ENVIRONMENT_IS_NODE) {
+        var fs = require('fs');
+        var read = function() {
+          var bytes = new Uint8Array(end - start);
+          fs.read(pack.fd, bytes, 0, end - start, start, function(error, bytesRead) {
+            if (error) onerror(error);
+            else onload(bytes.subarray(0, bytesRead));
+          });
+        };
+        if (pack.fd !== null) {
+          read();
+        } else {
+          fs.open(pack.url, 'r', function(error, fd) {
+            if (error) {
+              onerror(error);
+            } else {
+              pack.fd = fd;
+              read();
+            }
+          });
+        }
+        return;
+      }
+#endif
+      fetch(pack.url, {
+        headers: { 'Range': 'bytes=' + start + '-' + (end - 1) },
+        credentials: 'same-origin',
+      }).then(function(response) {
+        if (!response.ok) throw new Error(response.status + ' : ' + response.url);
+        return response.arrayBuffer().then(function(buffer) {
+          var bytes = new Uint8Array(buffer);
+          // The server ignored the range, and sent the whole package.
+          if (response.status === 200) {
+            pack.whole = bytes;
+            bytes = bytes.subarray(start, end);
+          }
+          onload(bytes);
+        });
+      }).catch(onerror);
+    },
+    // Reads the bytes [start, end) of a package synchronously, as the reads
+    // of the filesystem are synchronous. On the web this is done with a
+    // synchronous XHR, which on the main thread blocks the page until it is
+    // done.
+    readSync: function(pack, start, end) {
+      LAZYPACKAGE.reads++;
+#if ENVIRONMENT_MAY_BE_NODE
+      if (ENVIRONMENT_IS_NODE) {
+        var bytes = new Uint8Array(end - start);
+        var bytesRead = 0;
+        while (bytesRead < bytes.length) {
+          var n = require('fs').readSync(pack.fd, bytes, bytesRead, bytes.length - bytesRead, start + bytesRead);
+          if (n === 0) throw new FS.ErrnoError(ERRNO_CODES.EIO);
+          bytesRead += n;
+        }
+        return bytes;
+      }
+#endif
+      var xhr = new XMLHttpRequest();
+      xhr.open('GET', pack.url, false);
+      xhr.setRequestHeader('Range', 'bytes=' + start + '-' + (end - 1));
+      // Synchronous XHRs can only have a binary response type in workers.
+      if (ENVIRONMENT_IS_WORKER) {
+        xhr.responseType = 'arraybuffer';
+      } else {
+        xhr.overrideMimeType('text/plain; charset=x-user-defined');
+      }
+      xhr.send(null);
+      if (xhr.status !== 200 && xhr.status !== 206) throw new FS.ErrnoError(ERRNO_CODES.EIO);
+      var bytes;
+      if (ENVIRONMENT_IS_WORKER) {
+        bytes = new Uint8Array(xhr.response);
+      } else {
+        // With x-user-defined, each byte b of the response is one char, which
+        // is b itself below 0x80 and 0xF700 + b above.
+        var text = xhr.responseText;
+        bytes = new Uint8Array(text.length);
+        for (var i = 0; i < text.length; i++) {
+          bytes[i] = text.charCodeAt(i) & 0xff;
+        }
+      }
+      if (xhr.status === 200) {
+        pack.whole = bytes;
+        return pack.whole.subarray(start, end);
+      }
+      if (bytes.length !== end - start) throw new FS.ErrnoError(ERRNO_CODES.EIO);
+      return bytes;
+    },
+    getChunk: function(pack, chunkIndex) {
+      var start = chunkIndex * LAZYPACKAGE.CHUNK_SIZE;
+      var end = Math.min(start + LAZYPACKAGE.CHUNK_SIZE, pack.size);
+      if (pack.whole) {
+        return pack.whole.subarray(pack.dataOffset + start, pack.dataOffset + end);
+      }
+      var chunk = pack.chunks[chunkIndex];
+      if (!chunk) {
+        chunk = pack.chunks[chunkIndex] = LAZYPACKAGE.readSync(pack, pack.dataOffset + start, pack.dataOffset + end);
+      }
+      return chunk;
+    },
+    createNode: function(parent, name, mode, dev, contents, mtime) {
+      var node = FS.createNode(parent, name, mode);
+      node.mode = mode;
+      node.node_ops = LAZYPACKAGE.node_ops;
+      node.stream_ops = LAZYPACKAGE.stream_ops;
+      node.timestamp = (mtime || new Date).getTime();
+      assert(LAZYPACKAGE.FILE_MODE !== LAZYPACKAGE.DIR_MODE);
+      if (mode === LAZYPACKAGE.FILE_MODE) {
+        node.size = contents.end - contents.start;
+        node.contents = contents;
+      } else {
+        node.size = 4096;
+        node.contents = {};
+      }
+      if (parent) {
+        parent.contents[name] = node;
+      }
+      return node;
+    },
+    node_ops: {
+      getattr: function(node) {
+        return {
+          dev: 1,
+          ino: node.id,
+          mode: node.mode,
+          nlink: 1,
+          uid: 0,
+          gid: 0,
+          rdev: undefined,
+          size: node.size,
+          atime: new Date(node.timestamp),
+          mtime: new Date(node.timestamp),
+          ctime: new Date(node.timestamp),
+          blksize: 4096,
+          blocks: Math.ceil(node.size / 4096),
+        };
+      },
+      setattr: function(node, attr) {
+        if (attr.mode !== undefined) {
+          node.mode = attr.mode;
+        }
+        if (attr.timestamp !== undefined) {
+          node.timestamp = attr.timestamp;
+        }
+      },
+      lookup: function(parent, name) {
+        throw new FS.ErrnoError(ERRNO_CODES.ENOENT);
+      },
+      mknod: function(parent, name, mode, dev) {
+        throw new FS.ErrnoError(ERRNO_CODES.EPERM);
+      },
+      rename: function(oldNode, newDir, newName) {
+        throw new FS.ErrnoError(ERRNO_CODES.EPERM);
+      },
+      unlink: function(parent, name) {
+        throw new FS.ErrnoError(ERRNO_CODES.EPERM);
+      },
+      rmdir: function(parent, name) {
+        throw new FS.ErrnoError(ERRNO_CODES.EPERM);
+      },
+      readdir: function(node) {
+        throw new FS.ErrnoError(ERRNO_CODES.EPERM);
+      },
+      symlink: function(parent, newName, oldPath) {
+        throw new FS.ErrnoError(ERRNO_CODES.EPERM);
+      },
+      readlink: function(node) {
+        throw new FS.ErrnoError(ERRNO_CODES.EPERM);
+      },
+    },
+    stream_ops: {
+      read: function(stream, buffer, offset, length, position) {
+        length = Math.min(length, stream.node.size - position);
+        if (length <= 0) return 0;
+        var contents = stream.node.contents;
+        var written = 0;
+        while (written < length) {
+          var start = contents.start + position + written; // offset in the package data
+          var chunkIndex = Math.floor(start / LAZYPACKAGE.CHUNK_SIZE);
+          var chunk = LAZYPACKAGE.getChunk(contents.pack, chunkIndex);
+          var startInChunk = start % LAZYPACKAGE.CHUNK_SIZE;
+          var endInChunk = Math.min(startInChunk + length - written, chunk.length);
+          buffer.set(chunk.subarray(startInChunk, endInChunk), offset + written);
+          written += endInChunk - startInChunk;
+        }
+        return written;
+      },
+      write: function(stream, buffer, offset, length, position) {
+        throw new FS.ErrnoError(ERRNO_CODES.EIO);
+      },
+      llseek: function(stream, offset, whence) {
+        var position = offset;
+        if (whence === {{{ cDefine('SEEK_CUR') }}}) {
+          position += stream.position;
+        } else if (whence === {{{ cDefine('SEEK_END') }}}) {
+          if (FS.isFile(stream.node.mode)) {
+            position += stream.node.size;
+          }
+        }
+        if (position < 0) {
+          throw new FS.ErrnoError(ERRNO_CODES.EINVAL);
+        }
+        return position;
+      },
+    },
+  },
+});
+if (LibraryManager.library['$FS__deps']) {
+  LibraryManager.library['$FS__deps'].push('$LAZYPACKAGE'); // LAZY_PACKAGE=1, so auto-include us
+} else {
+  warn('FS does not seem to be in use (no preloaded files etc.), LAZY_PACKAGE will not do anything');
+}
+#endif
@@ -0,0 +1,26 @@
+/**
+ * @license
+ * Copyright 2021 The Emscripten Authors
+ * SPDX-License-Identifier: MIT
+ */
+
+// The JS side of NATIVEFS (system/lib/nativefs). The filesystem itself lives
+// in the wasm module; all that is left here is printing stdout and stderr,
+// which has to happen on the main thread.
+mergeInto(LibraryManager.library, {
+#if !MINIMAL_RUNTIME || EXIT_RUNTIME
+  _emscripten_nativefs_write_stdio__deps: ['$SYSCALLS', '$flush_NO_FILESYSTEM'],
+  _emscripten_nativefs_write_stdio__postset: function() {
+    addAtExit('flush_NO_FILESYSTEM()');
+  },
+#else
+  _emscripten_nativefs_write_stdio__deps: ['$SYSCALLS'],
+#endif
+  _emscripten_nativefs_write_stdio__proxy: 'sync',
+  _emscripten_nativefs_write_stdio__sig: 'viii',
+  _emscripten_nativefs_write_stdio: function(fd, buf, len) {
+    for (var i = 0; i < len; i++) {
+      SYSCALLS.printChar(fd, HEAPU8[buf + i]);
+    }
+  },
+});
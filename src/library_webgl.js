@@ -14,6 +14,16 @@
     if (MAX_WEBGL_VERSION <= 1) return 'false';
     return 'GL.currentContext.version >= 2';
   }
+
+  // Like makeHEAPView(), but for WebGL 1 entry points that are called every
+  // frame: with GL_HEAP_VIEW_CACHE_SIZE, the view is looked up in a cache
+  // instead of being created anew on each call.
+  global.makeCachedHEAPView = function makeCachedHEAPView(which, start, end) {
+    if (!GL_HEAP_VIEW_CACHE_SIZE) return makeHEAPView(which, start, end);
+    const size = parseInt(which.replace('U', '').replace('F', '')) / 8;
+    const mod = size == 1 ? '' : ('>>' + Math.log2(size));
+    return `GL.getHeapView(HEAP${which}, (${start})${mod}, (${end})${mod})`;
+  }
 }}}
 
 var LibraryGL = {
@@ -237,6 +247,58 @@ var LibraryGL = {
 
     unpackAlignment: 4, // default alignment is 4 bytes
 
+#if GL_HEAP_VIEW_CACHE_SIZE
+    // Views of the heap that were passed to WebGL 1 entry points that have no
+    // srcOffset overload. Laid out as [heap0, Map(begin -> view), heap1, ...],
+    // for the heaps in the current memory buffer.
+    heapViews: [],
+    heapViewsBuffer: null,
+    numHeapViews: 0,
+
+    // Returns heap.subarray(begin, end), reusing a view from an earlier call for
+    // the same range if possible, so that code which uploads the same ranges
+    // every frame does not produce any garbage. When the cache is full, the
+    // least recently used view of the same heap (or of another heap, if this
+    // one has none yet) makes room for the new one.
+    getHeapView: function(heap, begin, end) {
+      var heapViews = GL.heapViews;
+      if (GL.heapViewsBuffer !== heap.buffer) {
+        // After memory growth the views refer to the old buffer, and must not
+        // keep it alive.
+        GL.heapViews = heapViews = [];
+        GL.heapViewsBuffer = heap.buffer;
+        GL.numHeapViews = 0;
+      }
+      var views;
+      for (var i = 0; i < heapViews.length; i += 2) {
+        if (heapViews[i] === heap) {
+          views = heapViews[i+1];
+          break;
+        }
+      }
+      if (!views) heapViews.push(heap, views = new Map());
+      var view = views.get(begin);
+      if (view) {
+        // Maps iterate in insertion order, so moving the view to the end keeps
+        // the views ordered from least to most recently used.
+        views.delete(begin);
+        if (view.length != end - begin) view = heap.subarray(begin, end);
+      } else {
+        if (GL.numHeapViews >= {{{ GL_HEAP_VIEW_CACHE_SIZE }}}) {
+          // Evict from another heap if this one has no views yet.
+          var evictFrom = views;
+          for (var i = 1; !evictFrom.size; i += 2) evictFrom = heapViews[i];
+          evictFrom.delete(evictFrom.keys().next().value);
+        } else {
+          ++GL.numHeapViews;
+        }
+        view = heap.subarray(begin, end);
+      }
+      views.set(begin, view);
+      return view;
+    },
+#endif
+
     // Records a GL error condition that occurred, stored until user calls glGetError() to fetch it. As per GLES2 spec, only the first error
     // is remembered, and subsequent errors are discarded until the user has cleared the stored error by a call to glGetError().
     recordError: function recordError(errorCode) {
@@ -442,9 +504,14 @@ var LibraryGL = {
         var size = GL.calcBufLength(cb.size, cb.type, cb.stride, count);
         var buf = GL.getTempVertexBuffer(size);
         GLctx.bindBuffer(0x8892 /*GL_ARRAY_BUFFER*/, buf);
+#if MAX_WEBGL_VERSION >= 2
+        if ({{{ isCurrentContextWebGL2() }}}) {
+          GLctx.bufferSubData(0x8892 /*GL_ARRAY_BUFFER*/, 0, HEAPU8, cb.ptr, size);
+        } else
+#endif
         GLctx.bufferSubData(0x8892 /*GL_ARRAY_BUFFER*/,
                                  0,
-                                 HEAPU8.subarray(cb.ptr, cb.ptr + size));
+                                 {{{ makeCachedHEAPView('U8', 'cb.ptr', 'cb.ptr + size') }}});
 #if GL_ASSERTIONS
         GL.validateVertexAttribPointer(cb.size, cb.type, cb.stride, 0);
 #endif
@@ -1036,6 +1103,10 @@ var LibraryGL = {
 
       GL.currentContext = GL.contexts[contextHandle]; // Active Emscripten GL layer context object.
       Module.ctx = GLctx = GL.currentContext && GL.currentContext.GLctx; // Active WebGL context object.
+#if GL_STATE_FILTER
+      // The redundant state change filter in libgl keeps separate state for each context.
+      _emscripten_gl_state_filter_make_current(GLctx ? contextHandle : 0);
+#endif
       return !(contextHandle && !GLctx);
     },
 
@@ -1047,6 +1118,9 @@ var LibraryGL = {
       if (GL.currentContext === GL.contexts[contextHandle]) GL.currentContext = null;
       if (typeof JSEvents === 'object') JSEvents.removeAllHandlersOnTarget(GL.contexts[contextHandle].GLctx.canvas); // Release all JS event handlers on the DOM element that the GL context is associated with since the context is now deleted.
       if (GL.contexts[contextHandle] && GL.contexts[contextHandle].GLctx.canvas) GL.contexts[contextHandle].GLctx.canvas.GLctxObject = undefined; // Make sure the canvas object no longer refers to the context object so there are no GC surprises.
+#if GL_STATE_FILTER
+      _emscripten_gl_state_filter_forget_context(contextHandle);
+#endif
 #if USE_PTHREADS
       _free(GL.contexts[contextHandle].handle);
 #endif
@@ -1441,7 +1515,7 @@ var LibraryGL = {
       return;
     }
 #endif
-    GLctx['compressedTexImage2D'](target, level, internalFormat, width, height, border, data ? {{{ makeHEAPView('U8', 'data', 'data+imageSize') }}} : null);
+    GLctx['compressedTexImage2D'](target, level, internalFormat, width, height, border, data ? {{{ makeCachedHEAPView('U8', 'data', 'data+imageSize') }}} : null);
   },
 
 
@@ -1457,7 +1531,7 @@ var LibraryGL = {
       return;
     }
 #endif
-    GLctx['compressedTexSubImage2D'](target, level, xoffset, yoffset, width, height, format, data ? {{{ makeHEAPView('U8', 'data', 'data+imageSize') }}} : null);
+    GLctx['compressedTexSubImage2D'](target, level, xoffset, yoffset, width, height, format, data ? {{{ makeCachedHEAPView('U8', 'data', 'data+imageSize') }}} : null);
   },
 
   $computeUnpackAlignedImageSize: function(width, height, sizePerPixel, alignment) {
@@ -1516,7 +1590,11 @@ var LibraryGL = {
 #if GL_ASSERTIONS
     assert((pixels >> shift) << shift == pixels, 'Pointer to texture data passed to texture get function must be aligned to the byte size of the pixel type!');
 #endif
+#if GL_HEAP_VIEW_CACHE_SIZE
+    return GL.getHeapView(heap, pixels >> shift, pixels + bytes >> shift);
+#else
     return heap.subarray(pixels >> shift, pixels + bytes >> shift);
+#endif
   },
 
   glTexImage2D__sig: 'viiiiiiiii',
@@ -1794,7 +1872,7 @@ var LibraryGL = {
 #endif
       // N.b. here first form specifies a heap subarray, second form an integer size, so the ?: code here is polymorphic. It is advised to avoid
       // randomly mixing both uses in calling code, to avoid any potential JS engine JIT issues.
-      GLctx.bufferData(target, data ? HEAPU8.subarray(data, data+size) : size, usage);
+      GLctx.bufferData(target, data ? {{{ makeCachedHEAPView('U8', 'data', 'data+size') }}} : size, usage);
 #if MAX_WEBGL_VERSION >= 2
     }
 #endif
@@ -1808,7 +1886,7 @@ var LibraryGL = {
       return;
     }
 #endif
-    GLctx.bufferSubData(target, offset, HEAPU8.subarray(data, data+size));
+    GLctx.bufferSubData(target, offset, {{{ makeCachedHEAPView('U8', 'data', 'data+size') }}});
   },
 
   // Queries EXT
@@ -2243,7 +2321,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('32', 'value', 'value+count*4') }}};
+      var view = {{{ makeCachedHEAPView('32', 'value', 'value+count*4') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Int32Array(view);
 #endif
@@ -2287,7 +2365,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('32', 'value', 'value+count*8') }}};
+      var view = {{{ makeCachedHEAPView('32', 'value', 'value+count*8') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Int32Array(view);
 #endif
@@ -2332,7 +2410,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('32', 'value', 'value+count*12') }}};
+      var view = {{{ makeCachedHEAPView('32', 'value', 'value+count*12') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Int32Array(view);
 #endif
@@ -2378,7 +2456,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('32', 'value', 'value+count*16') }}};
+      var view = {{{ makeCachedHEAPView('32', 'value', 'value+count*16') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Int32Array(view);
 #endif
@@ -2421,7 +2499,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('F32', 'value', 'value+count*4') }}};
+      var view = {{{ makeCachedHEAPView('F32', 'value', 'value+count*4') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Float32Array(view);
 #endif
@@ -2465,7 +2543,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('F32', 'value', 'value+count*8') }}};
+      var view = {{{ makeCachedHEAPView('F32', 'value', 'value+count*8') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Float32Array(view);
 #endif
@@ -2510,7 +2588,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('F32', 'value', 'value+count*12') }}};
+      var view = {{{ makeCachedHEAPView('F32', 'value', 'value+count*12') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Float32Array(view);
 #endif
@@ -2560,7 +2638,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('F32', 'value', 'value+count*16') }}};
+      var view = {{{ makeCachedHEAPView('F32', 'value', 'value+count*16') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Float32Array(view);
 #endif
@@ -2606,7 +2684,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('F32', 'value', 'value+count*16') }}};
+      var view = {{{ makeCachedHEAPView('F32', 'value', 'value+count*16') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Float32Array(view);
 #endif
@@ -2657,7 +2735,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('F32', 'value', 'value+count*36') }}};
+      var view = {{{ makeCachedHEAPView('F32', 'value', 'value+count*36') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Float32Array(view);
 #endif
@@ -2719,7 +2797,7 @@ var LibraryGL = {
     } else
 #endif
     {
-      var view = {{{ makeHEAPView('F32', 'value', 'value+count*64') }}};
+      var view = {{{ makeCachedHEAPView('F32', 'value', 'value+count*64') }}};
 #if WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG
       if (GL.currentContext.cannotHandleOffsetsInUniformArrayViews) view = new Float32Array(view);
 #endif
@@ -3490,9 +3568,14 @@ var LibraryGL = {
       var size = GL.calcBufLength(1, type, 0, count);
       buf = GL.getTempIndexBuffer(size);
       GLctx.bindBuffer(0x8893 /*GL_ELEMENT_ARRAY_BUFFER*/, buf);
+#if MAX_WEBGL_VERSION >= 2
+      if ({{{ isCurrentContextWebGL2() }}}) {
+        GLctx.bufferSubData(0x8893 /*GL_ELEMENT_ARRAY_BUFFER*/, 0, HEAPU8, indices, size);
+      } else
+#endif
       GLctx.bufferSubData(0x8893 /*GL_ELEMENT_ARRAY_BUFFER*/,
                                0,
-                               HEAPU8.subarray(indices, indices + size));
+                               {{{ makeCachedHEAPView('U8', 'indices', 'indices + size') }}});
       // the index is now 0
       indices = 0;
     }
@@ -3781,10 +3864,14 @@ var LibraryGL = {
       return;
     }
 
-    GLctx.bufferSubData(
-      target,
-      mapping.offset,
-      HEAPU8.subarray(mapping.mem + offset, mapping.mem + offset + length));
+    if ({{{ isCurrentContextWebGL2() }}}) { // WebGL 2 provides new garbage-free entry points to call to WebGL. Use those always when possible.
+      GLctx.bufferSubData(target, mapping.offset, HEAPU8, mapping.mem + offset, length);
+    } else {
+      GLctx.bufferSubData(
+        target,
+        mapping.offset,
+        HEAPU8.subarray(mapping.mem + offset, mapping.mem + offset + length));
+    }
   },
 
   glUnmapBuffer__sig: 'ii',
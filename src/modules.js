@@ -151,6 +151,10 @@ var LibraryManager = {
       libraries.push('library_lz4.js');
     }
 
+    if (LAZY_PACKAGE) {
+      libraries.push('library_lazy_package.js');
+    }
+
     if (MAX_WEBGL_VERSION >= 2) {
       libraries.push('library_webgl2.js');
     }
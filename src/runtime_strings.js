@@ -114,10 +114,82 @@ function UTF8ToString(ptr, maxBytesToRead) {
   for(var end = ptr; !(end >= maxPtr) && HEAPU8[end];) ++end;
   return UTF8Decoder.decode(HEAPU8.subarray(ptr, end));
 #else
+#if WASM_STRING_TRANSCODING
+#if TEXTDECODER
+  if (ptr && !UTF8Decoder) {
+#else
+  if (ptr) {
+#endif
+    var str = UTF8ToStringInWasm(ptr, maxBytesToRead);
+    if (str !== undefined) return str;
+  }
+#endif
   return ptr ? UTF8ArrayToString(HEAPU8, ptr, maxBytesToRead) : '';
 #endif
 }
 
+#if WASM_STRING_TRANSCODING
+// Whether strings can be converted in wasm right now, see
+// WASM_STRING_TRANSCODING. Wasm cannot be called before the runtime is
+// initialized, or after it has exited.
+function canTranscodeInWasm() {
+#if MINIMAL_RUNTIME
+  return typeof _malloc !== 'undefined';
+#else
+  return runtimeInitialized && !runtimeExited;
+#endif
+}
+
+// Decodes the UTF-8 string at ptr in wasm, which beats the JS loop in
+// UTF8ArrayToString() for long strings. Returns undefined if the string is
+// shorter than WASM_STRING_TRANSCODING bytes, or if it cannot be done in wasm
+// right now.
+/**
+ * @param {number} ptr
+ * @param {number=} maxBytesToRead
+ * @return {string|undefined}
+ */
+function UTF8ToStringInWasm(ptr, maxBytesToRead) {
+  // Check the first bytes in JS, so short strings never pay for a call into
+  // wasm.
+  var minLength = {{{ WASM_STRING_TRANSCODING }}};
+  if (maxBytesToRead < minLength) return;
+  for (var p = ptr; p < ptr + minLength; ++p) {
+    if (!HEAPU8[p]) return;
+  }
+  if (!canTranscodeInWasm()) return;
+  var len = maxBytesToRead === undefined ? _strlen(ptr) : _strnlen(ptr, maxBytesToRead);
+  var buf = _malloc(len * 2);
+  if (!buf) return;
+  var units = _emscripten_utf8_to_utf16(ptr, len, buf, len);
+  // fromCharCode takes each code unit as an argument, so go in chunks to stay
+  // below the engine's limit on the number of arguments.
+  var str = '';
+  for (var i = buf >> 1, end = i + units; i < end; i += 4096) {
+    str += String.fromCharCode.apply(null, HEAPU16.subarray(i, Math.min(i + 4096, end)));
+  }
+  _free(buf);
+  return str;
+}
+
+// Encodes str to UTF-8 at outPtr in wasm, see UTF8ToStringInWasm(). Returns
+// the number of bytes written, excluding the null terminator, or undefined if
+// it cannot be done in wasm right now.
+function stringToUTF8InWasm(str, outPtr, maxBytesToWrite) {
+  if (!canTranscodeInWasm()) return;
+  var len = str.length;
+  var buf = _malloc(len * 2);
+  if (!buf) return;
+  for (var i = 0, idx = buf >> 1; i < len; ++i) {
+    HEAPU16[idx + i] = str.charCodeAt(i);
+  }
+  var written = _emscripten_utf16_to_utf8(buf, len, outPtr, maxBytesToWrite - 1);
+  HEAPU8[outPtr + written] = 0;
+  _free(buf);
+  return written;
+}
+#endif
+
 // Copies the given Javascript String object 'str' to the given byte array at address 'outIdx',
 // encoded in UTF8 form and null-terminated. The copy will require at most str.length*4+1 bytes of space in the HEAP.
 // Use the function lengthBytesUTF8 to compute the exact number of bytes (excluding null terminator) that this function will write.
@@ -185,6 +257,12 @@ function stringToUTF8Array(str, heap, outIdx, maxBytesToWrite) {
 function stringToUTF8(str, outPtr, maxBytesToWrite) {
 #if ASSERTIONS
   assert(typeof maxBytesToWrite == 'number', 'stringToUTF8(str, outPtr, maxBytesToWrite) is missing the third parameter that specifies the length of the output buffer!');
+#endif
+#if WASM_STRING_TRANSCODING
+  if (str.length >= {{{ WASM_STRING_TRANSCODING }}} && maxBytesToWrite > 0) {
+    var written = stringToUTF8InWasm(str, outPtr, maxBytesToWrite);
+    if (written !== undefined) return written;
+  }
 #endif
   return stringToUTF8Array(str, {{{ heapAndOffset('HEAPU8', 'outPtr') }}}, maxBytesToWrite);
 }
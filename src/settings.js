@@ -118,6 +118,12 @@ var TOTAL_STACK = 5*1024*1024;
 
 // What malloc()/free() to use, out of
 //  * dlmalloc - a powerful general-purpose malloc
+//  * dlmalloc-mt - dlmalloc with a separate heap for each thread, so that
+//                  threads do not contend for one lock. Memory freed by a
+//                  thread other than the one that allocated it is handed back
+//                  to the allocating thread's heap. This uses more memory than
+//                  dlmalloc, and is a little slower when only one thread
+//                  allocates. Without pthreads this is the same as dlmalloc.
 //  * emmalloc - a simple and compact malloc designed for emscripten
 //  * emmalloc-debug - use emmalloc and add extra assertion checks
 //  * emmalloc-memvalidate - use emmalloc with assertions+heap consistency
@@ -138,6 +144,14 @@ var TOTAL_STACK = 5*1024*1024;
 // [link]
 var MALLOC = "dlmalloc";
 
+// If 1, link a version of malloc that samples allocations and records their
+// call stacks, so that emscripten_malloc_profiler_write_profile() can write out
+// the live heap by call stack. See emscripten/malloc_profiler.h. This makes
+// malloc and free slower, and needs USE_OFFSET_CONVERTER, which is enabled
+// automatically. Link with --profiling-funcs to get function names.
+// [link]
+var MALLOC_PROFILER = 0;
+
 // If 1, then when malloc would fail we abort(). This is nonstandard behavior,
 // but makes sense for the web since we have a fixed amount of memory that
 // must all be allocated up front, and so (a) failing mallocs are much more
@@ -484,6 +498,20 @@ var GL_SUPPORT_EXPLICIT_SWAP_CONTROL = 0;
 // [link]
 var GL_POOL_TEMP_BUFFERS = 1;
 
+// If nonzero, WebGL 1 calls that upload data straight from the heap
+// (glUniform*v and glUniformMatrix*v with more values than fit in the temp
+// buffer pool, glBufferData, glBufferSubData, glTex(Sub)Image2D, glReadPixels,
+// glCompressedTex(Sub)Image2D and client-side vertex arrays) reuse the typed
+// array views they create, keyed by heap and range, instead of creating a new
+// view on every call. This removes the garbage that code which uploads the same
+// ranges every frame generates. The value is the number of views to keep; when
+// the cache is full the least recently used view is replaced, and the cache is
+// emptied when the heap grows. WebGL 2 contexts
+// do not need this, since they use the srcOffset overloads that take the heap
+// directly.
+// [link]
+var GL_HEAP_VIEW_CACHE_SIZE = 0;
+
 // Some old Android WeChat (Chromium 37?) browser has a WebGL bug that it ignores
 // the offset of a typed array view pointing to an ArrayBuffer. Set this to
 // 1 to enable a polyfill that works around the issue when it appears. This
@@ -637,6 +665,23 @@ var ENVIRONMENT = '';
 // [link]
 var LZ4 = 0;
 
+// Enable this to support lazily loaded file packages. Preloaded files are
+// written to a package that starts with an index of its files, and only that
+// index is read before main() runs. The data of each file is read in chunks
+// when the file is first read from: with range requests on the web, and from
+// the local package file in Node.
+// If you run the file packager separately, you still need to build the main
+// program with this flag, and also pass --lazy to the file packager.
+// Limitations:
+//   * Reads on the web use synchronous XHRs, which on the main thread block the
+//     page while a chunk is downloaded. The server must support range requests,
+//     otherwise the whole package is downloaded on the first read.
+//   * Files in the package are read-only.
+//   * This cannot be used with LZ4, --use-preload-cache or
+//     --use-preload-plugins.
+// [link]
+var LAZY_PACKAGE = 0;
+
 // Emscripten exception handling options.
 // These options only pertain to Emscripten exception handling and do not
 // control the experimental native wasm exception handling option.
@@ -1542,6 +1587,19 @@ var EVAL_CTORS = 0;
 // [link]
 var TEXTDECODER = 1;
 
+// If nonzero, UTF8ToString() and stringToUTF8() convert strings of at least
+// this many bytes (or UTF-16 code units, for stringToUTF8) in wasm instead of
+// in JS, using emscripten_utf8_to_utf16() and emscripten_utf16_to_utf8() from
+// emscripten/unicode.h. This mainly helps builds where TextDecoder cannot be
+// used, such as pthreads builds, where the JS fallback decodes byte by byte;
+// if TextDecoder is usable, UTF8ToString() still prefers it. Building with
+// -msimd128 lets the wasm side handle runs of ASCII 16 bytes at a time.
+// Conversions in wasm allocate a temporary buffer with malloc, so strings
+// handed to JS from inside malloc itself must be shorter than this. Ill-formed
+// input is replaced with U+FFFD, as TextDecoder does.
+// [link]
+var WASM_STRING_TRANSCODING = 0;
+
 // Embind specific: If enabled, assume UTF-8 encoded data in std::string binding.
 // Disable this to support binary data transfer.
 // [link]
@@ -1577,6 +1635,51 @@ var OFFSCREENCANVASES_TO_PTHREAD = "#canvas";
 // [link]
 var OFFSCREEN_FRAMEBUFFER = 0;
 
+// If set to 1, GL calls that a pthread proxies asynchronously to a context on
+// the main thread (-s OFFSCREEN_FRAMEBUFFER=1) are recorded into a compact
+// per-thread command buffer instead of being posted one by one to the main
+// thread's call queue. The buffer is replayed on the main thread when it is
+// flushed, which happens on emscripten_webgl_commit_frame(), glFlush(), any
+// synchronous GL call (e.g. glGet*), a context switch, or when it fills up.
+// Requires -s USE_PTHREADS and -s OFFSCREEN_FRAMEBUFFER.
+// [link]
+var OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER = 0;
+
+// If set to 1, a pthread that renders to a context on the main thread
+// (-s OFFSCREEN_FRAMEBUFFER=1) keeps a client-side copy of the context state
+// that follows from its own GL calls: buffer, texture, framebuffer and
+// renderbuffer bindings, enable caps, viewport, scissor box, uniform locations,
+// and which object names exist. glGetIntegerv(), glGetBooleanv(),
+// glIsEnabled(), glIs{Buffer,Texture,Framebuffer,Renderbuffer}() and
+// glGetUniformLocation() are then answered on the calling thread where possible,
+// instead of waiting for the main thread. State that has not been set or
+// queried yet is fetched from the main thread once.
+// The context must only be rendered to from pthreads through the GL API, since
+// state changes made directly on the main thread are not seen by the copy.
+// If set to 2, every query that could be answered locally is also sent to the
+// main thread and mismatches are logged, which is useful for debugging.
+// Requires -s USE_PTHREADS and -s OFFSCREEN_FRAMEBUFFER.
+// [link]
+var OFFSCREEN_FRAMEBUFFER_STATE_SHADOW = 0;
+
+// If set to 1, libgl remembers, per context, the last value passed to
+// glActiveTexture, glBindBuffer, glBindFramebuffer, glBindRenderbuffer,
+// glBindTexture, glBindVertexArray, glUseProgram, glEnable and glDisable, and
+// drops calls that pass the same value again before they reach WebGL (or, for
+// contexts proxied from a pthread, before they are sent to the main thread).
+// emscripten_webgl_get_filtered_call_counts() reports how many calls were
+// dropped. Things to keep in mind:
+//  - A call that fails with a GL error is still remembered, so repeating it
+//    does not raise the error again.
+//  - State changed without going through these C entry points, e.g. from JS
+//    code that uses the WebGL context directly, is not seen by the filter.
+//  - Only one thread filters the calls on a context. Once a second thread makes
+//    calls on it (e.g. the main thread on a context that is proxied to it from
+//    a pthread), calls on that context are no longer filtered.
+// Not compatible with LEGACY_GL_EMULATION.
+// [link]
+var GL_STATE_FILTER = 0;
+
 // If nonzero, Fetch API (and hence ASMFS) supports backing to IndexedDB. If 0, IndexedDB is not utilized. Set to 0 if
 // IndexedDB support is not interesting for target application, to save a few kBytes.
 // [link]
@@ -1595,6 +1698,17 @@ var FETCH = 0;
 // [link]
 var ASMFS = 0;
 
+// If set to 1, uses NATIVEFS, a filesystem that is implemented in C++ inside
+// the wasm module (system/lib/nativefs) instead of in JS. Files live in linear
+// memory, so with pthreads every thread does its own file I/O without proxying
+// to the main thread. Files are kept in memory like MEMFS, and the initial
+// layout (/tmp, /home/web_user, /dev) is the same. Only printing to stdout and
+// stderr goes through JS, and reading stdin returns end of file.
+// There is no JS FS API, so this cannot be used with --preload-file,
+// --embed-file or FORCE_FILESYSTEM.
+// [link]
+var NATIVEFS = 0;
+
 // If set to 1, embeds all subresources in the emitted file as base64 string
 // literals. Embedded subresources may include (but aren't limited to) wasm,
 // asm.js, and static memory initialization code.
@@ -1904,6 +2018,19 @@ var SPLIT_MODULE = 0;
 // [link]
 var REVERSE_DEPS = 'auto';
 
+// If set, the JS output of a link is kept next to the output, in a
+// <name>.link-state.json file. When the next link of the same output produces
+// the same metadata (imports, exports, EM_ASM and EM_JS code, and so on) with
+// the same settings and JS inputs, which is usually the case when only the
+// bodies of functions changed, the JS is reused as it is, and only the wasm is
+// processed. Each link that reuses the JS reports the time it saved.
+// This has no effect on builds that change the JS and the wasm together or
+// embed one in the other, that is with -O2 and above (unless -g is used),
+// closure, EVAL_CTORS, SINGLE_FILE, WASM2JS, dynamic linking or preloaded or
+// embedded files.
+// [link]
+var INCREMENTAL_LINK = 0;
+
 //===========================================
 // Internal, used for testing only, from here
 //===========================================
@@ -82,6 +82,15 @@ var EMSCRIPTEN_VERSION = '';
 // Will be set to 0 if -fno-rtti is used on the command line.
 var USE_RTTI = 1;
 
+// Will be set to 1 if -msimd128 is used on the command line. This selects the
+// libc variant with wasm SIMD128 string functions.
+var WASM_SIMD = 0;
+
+// Will be set to 1 if -mbulk-memory is used on the command line (or implied by
+// -pthread). This selects the memcpy/memmove/memset that use memory.copy and
+// memory.fill.
+var BULK_MEMORY = 0;
+
 // This will contain the optimization level (-Ox). You should not modify this.
 var OPT_LEVEL = 0;
 
@@ -90,6 +90,17 @@ struct mallinfo emmalloc_mallinfo();
 int malloc_trim(size_t pad);
 int emmalloc_trim(size_t pad);
 
+// emmalloc_release_free_pages() gives back as much memory held by free regions as possible:
+// free memory at the top of the dynamic heap is returned to sbrk() like emmalloc_trim(0) does,
+// and every whole 4KB page inside the other free regions that is not all zeros yet is zeroed.
+// Returns the number of bytes given back to sbrk() plus those of the pages that were zeroed.
+// WebAssembly memory cannot shrink, so this does not make the Memory smaller,
+// but the OS may reclaim zeroed pages, e.g. by compressing or deduplicating them. emmalloc
+// prefers to allocate at low addresses, so after a usage peak the freed memory tends to collect
+// in large regions at the top of the heap. This function runs in time linear to the size of
+// the free memory it looks at.
+size_t emmalloc_release_free_pages(void);
+
 // Validates the consistency of the malloc heap. Returns non-zero and prints an error to console
 // if memory map is corrupt. Returns 0 (and does not print anything) if memory is intact.
 int emmalloc_validate_memory_regions(void);
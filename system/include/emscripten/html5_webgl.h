@@ -95,6 +95,32 @@ void *emscripten_webgl2_get_proc_address(const char *name);
 // Combines emscripten_webgl1_get_proc_address() and emscripten_webgl2_get_proc_address() to return function pointers to both WebGL1 and WebGL2 functions. Same drawbacks apply.
 void *emscripten_webgl_get_proc_address(const char *name);
 
+// Number of calls to each state-setting function that the redundant state change filter (-s GL_STATE_FILTER=1)
+// dropped because they would not have changed the state of a context.
+typedef struct EmscriptenWebGLFilteredCallCounts {
+  unsigned int activeTexture;
+  unsigned int bindBuffer;
+  unsigned int bindFramebuffer;
+  unsigned int bindRenderbuffer;
+  unsigned int bindTexture;
+  unsigned int bindVertexArray;
+  unsigned int useProgram;
+  unsigned int enable;
+  unsigned int disable;
+
+  // Sum of all of the above.
+  unsigned int totalFiltered;
+  // Calls to the functions above that were passed on to WebGL.
+  unsigned int totalPassed;
+} EmscriptenWebGLFilteredCallCounts;
+
+// Returns the counts of filtered calls for the given context. Returns EMSCRIPTEN_RESULT_NOT_SUPPORTED if the program was
+// not built with -s GL_STATE_FILTER=1.
+EMSCRIPTEN_RESULT emscripten_webgl_get_filtered_call_counts(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, EmscriptenWebGLFilteredCallCounts *outCounts);
+
+// Sets the counts of filtered calls for the given context back to zero.
+EMSCRIPTEN_RESULT emscripten_webgl_reset_filtered_call_counts(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context);
+
 #define emscripten_set_webglcontextlost_callback(target, userData, useCapture, callback)      emscripten_set_webglcontextlost_callback_on_thread(     (target), (userData), (useCapture), (callback), EM_CALLBACK_THREAD_CONTEXT_CALLING_THREAD)
 #define emscripten_set_webglcontextrestored_callback(target, userData, useCapture, callback)  emscripten_set_webglcontextrestored_callback_on_thread( (target), (userData), (useCapture), (callback), EM_CALLBACK_THREAD_CONTEXT_CALLING_THREAD)
 
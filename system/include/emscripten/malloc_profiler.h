@@ -0,0 +1,40 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// Sampling heap profiler, available when linking with -s MALLOC_PROFILER=1.
+//
+// Allocations are sampled on average once per sample interval of allocated
+// bytes, and the call stack of each sampled allocation is recorded. Sampled
+// allocations are tracked until they are freed, and each also stands in for the
+// estimated number of bytes at its call stack that were not sampled, so the
+// profile estimates the live heap by call stack. Function names are looked up
+// in the wasm name section, so link with --profiling-funcs or -g to see them.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sets the mean number of bytes allocated between samples. The default is
+// 512KB. Pass 1 to sample every allocation, or 0 to stop sampling new
+// allocations. The calling thread switches to the new interval right away,
+// other threads at their next sample.
+void emscripten_malloc_profiler_set_sample_interval(size_t bytes);
+
+// Writes the estimated live heap to the file at `path` in folded stack format,
+// one line per call stack: the function names from the outermost to the
+// innermost, separated by semicolons, then a space and the number of bytes.
+// flamegraph.pl, speedscope and similar tools can read this format. Returns 0
+// on success, or -1 if the file could not be written.
+int emscripten_malloc_profiler_write_profile(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
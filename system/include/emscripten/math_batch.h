@@ -0,0 +1,47 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// Single precision math functions over arrays: out[i] = f(x[i]) for i < n.
+// `out` may be the same array as an input, but must not otherwise overlap it.
+//
+// When built with -msimd128 these evaluate four values at a time with wasm
+// SIMD polynomial kernels. Each function below lists the range its kernel
+// handles and its maximum error there, measured against the exact result over
+// every float in the range (for powf, over samples). Values outside that range,
+// including infinities and NaNs, go to the scalar libm function, so results
+// there match sinf(), expf() and so on exactly, as do all results without
+// -msimd128.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Kernel: |x| <= 6433 (4096 * pi/2), 2.5 ulp.
+void emscripten_batch_sinf(float *out, const float *x, size_t n);
+void emscripten_batch_cosf(float *out, const float *x, size_t n);
+
+// Kernel: -87.3 <= x <= 88.3, where the result is a normal number, 1.1 ulp.
+void emscripten_batch_expf(float *out, const float *x, size_t n);
+
+// Kernel: positive normal numbers, 1 ulp.
+void emscripten_batch_logf(float *out, const float *x, size_t n);
+
+// out[i] = powf(x[i], y[i]).
+// Kernel: positive normal finite x other than 1, finite nonzero y, and
+// |y * log(x)| <= 700. Computed in double precision, 1 ulp.
+void emscripten_batch_powf(float *out, const float *x, const float *y, size_t n);
+
+// Correctly rounded, like sqrtf().
+void emscripten_batch_sqrtf(float *out, const float *x, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// UTF-8 and UTF-16 validation and transcoding. All lengths are in code units:
+// bytes for UTF-8 and uint16_t values for UTF-16. Inputs are not null
+// terminated, and nothing here writes a terminator.
+//
+// Invalid input is handled the way the JS TextDecoder and TextEncoder do: each
+// ill-formed UTF-8 subsequence and each unpaired UTF-16 surrogate becomes one
+// U+FFFD replacement character.
+//
+// When built with -msimd128, runs of ASCII are handled 16 code units at a time.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the length of the longest prefix of `str` that is valid UTF-8, which
+// is `len` if all of it is.
+size_t emscripten_utf8_validate(const char *str, size_t len);
+
+// Returns the number of UTF-16 code units that emscripten_utf8_to_utf16()
+// produces for `str`. This is never more than `len`.
+size_t emscripten_utf8_to_utf16_length(const char *str, size_t len);
+
+// Converts UTF-8 to UTF-16, writing at most `out_len` code units to `out`.
+// Stops early rather than write part of a surrogate pair. Returns the number of
+// code units written.
+size_t emscripten_utf8_to_utf16(const char *str, size_t len, uint16_t *out, size_t out_len);
+
+// Returns the number of bytes that emscripten_utf16_to_utf8() produces for
+// `str`. This is never more than 3 * `len`.
+size_t emscripten_utf16_to_utf8_length(const uint16_t *str, size_t len);
+
+// Converts UTF-16 to UTF-8, writing at most `out_len` bytes to `out`. Stops
+// early rather than write part of a character. Returns the number of bytes
+// written.
+size_t emscripten_utf16_to_utf8(const uint16_t *str, size_t len, char *out, size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -34,7 +34,10 @@ namespace emscripten {
                 _EMVAL_UNDEFINED = 1,
                 _EMVAL_NULL = 2,
                 _EMVAL_TRUE = 3,
-                _EMVAL_FALSE = 4
+                _EMVAL_FALSE = 4,
+                // Handles at or above this value were allocated inside a
+                // val::scope and are not reference counted.
+                _EMVAL_SCOPED_BASE = 0x40000000
             };
 
             typedef struct _EM_VAL* EM_VAL;
@@ -102,6 +105,26 @@ namespace emscripten {
             bool _emval_delete(EM_VAL object, EM_VAL property);
             bool _emval_throw(EM_VAL object);
             EM_VAL _emval_await(EM_VAL promise);
+
+            void _emval_scope_enter();
+            void _emval_scope_exit();
+            EM_VAL _emval_scope_escape(EM_VAL value);
+        }
+
+        inline bool isScopedHandle(EM_VAL handle) {
+            return reinterpret_cast<uintptr_t>(handle) >= _EMVAL_SCOPED_BASE;
+        }
+
+        inline void increfUnlessScoped(EM_VAL handle) {
+            if (!isScopedHandle(handle)) {
+                _emval_incref(handle);
+            }
+        }
+
+        inline void decrefUnlessScoped(EM_VAL handle) {
+            if (!isScopedHandle(handle)) {
+                _emval_decref(handle);
+            }
         }
 
         template<const char* address>
@@ -296,6 +319,32 @@ namespace emscripten {
         // exposing void, comma, and conditional is unnecessary
         // same with: = += -= *= /= %= <<= >>= >>>= &= ^= |=
 
+        // While a scope is alive, every val created on this thread is
+        // bump-allocated in a JS-side arena instead of the refcounted handle
+        // table, so copying and destroying it never calls into JS.  All of
+        // them are released at once when the scope is destroyed; a val that
+        // must outlive the scope has to be passed through escape().  Scopes
+        // nest, and must be destroyed in reverse order of creation.
+        class scope {
+        public:
+            scope() {
+                internal::_emval_scope_enter();
+            }
+
+            ~scope() {
+                internal::_emval_scope_exit();
+            }
+
+            scope(const scope&) = delete;
+            void operator=(const scope&) = delete;
+
+            // Returns a refcounted val referring to the same JS value, which
+            // stays valid after all scopes have been exited.
+            static val escape(const val& v) {
+                return val(internal::_emval_scope_escape(v.handle));
+            }
+        };
+
         static val array() {
             return val(internal::_emval_new_array());
         }
@@ -364,23 +413,23 @@ namespace emscripten {
         val(const val& v)
             : handle(v.handle)
         {
-            internal::_emval_incref(handle);
+            internal::increfUnlessScoped(handle);
         }
 
         ~val() {
-            internal::_emval_decref(handle);
+            internal::decrefUnlessScoped(handle);
         }
 
         val& operator=(val&& v) {
-            internal::_emval_decref(handle);
+            internal::decrefUnlessScoped(handle);
             handle = v.handle;
             v.handle = 0;
             return *this;
         }
 
         val& operator=(const val& v) {
-            internal::_emval_incref(v.handle);
-            internal::_emval_decref(handle);
+            internal::increfUnlessScoped(v.handle);
+            internal::decrefUnlessScoped(handle);
             handle = v.handle;
             return *this;
         }
@@ -571,7 +620,7 @@ namespace emscripten {
         struct BindingType<val> {
             typedef internal::EM_VAL WireType;
             static WireType toWireType(const val& v) {
-                _emval_incref(v.handle);
+                increfUnlessScoped(v.handle);
                 return v.handle;
             }
             static val fromWireType(WireType v) {
@@ -4,8 +4,11 @@
 // When building for wasm we export `malloc` and `emscripten_builtin_malloc` as
 // weak alias of the internal `dlmalloc` which is static to this file.
 #define DLMALLOC_EXPORT static
-/* mmap uses malloc, so malloc can't use mmap */
+/* mmap uses malloc, so malloc can't use mmap. (dlmalloc_mt.c defines its own
+   mmap hooks on top of sbrk.) */
+#ifndef HAVE_MMAP
 #define HAVE_MMAP 0
+#endif
 /* we can only grow the heap up anyhow, so don't try to trim */
 #define MORECORE_CANNOT_TRIM 1
 #ifndef DLMALLOC_DEBUG
@@ -17,6 +20,13 @@
 #endif
 /* XXX Emscripten Tracing API. This defines away the code if tracing is disabled. */
 #include <emscripten/trace.h>
+/* XXX Emscripten heap profiler (-s MALLOC_PROFILER=1), see malloc_profiler.c. */
+#ifdef EMSCRIPTEN_MALLOC_PROFILER
+#include "malloc_profiler_hooks.h"
+#else
+#define _emscripten_malloc_profiler_record_allocation(ptr, size)
+#define _emscripten_malloc_profiler_record_free(ptr)
+#endif
 
 /* Make malloc() and free() threadsafe by securing the memory allocations with pthread mutexes. */
 #if __EMSCRIPTEN_PTHREADS__
@@ -3863,6 +3873,16 @@ if (m == gm) dlfree(mem); else mspace_free(m,mem);
 #endif /* MSPACES */
 #endif /* ONLY_MSPACES */
 
+#if __EMSCRIPTEN__ && !MSPACES
+/* XXX Emscripten heap profiler. The callers of internal_memalign() record
+   the aligned block it returns, so the larger one it allocates on the way
+   must not be recorded as well. */
+static void* dlmalloc_unprofiled(size_t bytes);
+#define internal_malloc_unprofiled(m, b) dlmalloc_unprofiled(b)
+#else
+#define internal_malloc_unprofiled(m, b) internal_malloc(m, b)
+#endif
+
 /* -----------------------  Direct-mmapping chunks ----------------------- */
 
 /*
@@ -4592,7 +4612,17 @@ static void* tmalloc_small(mstate m, size_t nb) {
 
 #if !ONLY_MSPACES
 
+#if __EMSCRIPTEN__ && !MSPACES
 void* dlmalloc(size_t bytes) {
+    void* mem = dlmalloc_unprofiled(bytes);
+    _emscripten_malloc_profiler_record_allocation(mem, bytes);
+    return mem;
+}
+
+static void* dlmalloc_unprofiled(size_t bytes) {
+#else
+void* dlmalloc(size_t bytes) {
+#endif
     /*
      Basic algorithm:
      If a small request (< 256 bytes minus per-chunk overhead):
@@ -4745,6 +4775,7 @@ void dlfree(void* mem) {
 #if __EMSCRIPTEN__
         /* XXX Emscripten Tracing API. */
         emscripten_trace_record_free(mem);
+        _emscripten_malloc_profiler_record_free(mem);
 #endif
         mchunkptr p  = mem2chunk(mem);
 #if FOOTERS
@@ -4963,7 +4994,7 @@ static void* internal_memalign(mstate m, size_t alignment, size_t bytes) {
     else {
         size_t nb = request2size(bytes);
         size_t req = nb + alignment + MIN_CHUNK_SIZE - CHUNK_OVERHEAD;
-        mem = internal_malloc(m, req);
+        mem = internal_malloc_unprofiled(m, req);
         if (mem != 0) {
             mchunkptr p = mem2chunk(mem);
             if (PREACTION(m))
@@ -5275,6 +5306,8 @@ void* dlrealloc(void* oldmem, size_t bytes) {
 #if __EMSCRIPTEN__
                 /* XXX Emscripten Tracing API. */
                 emscripten_trace_record_reallocation(oldmem, mem, bytes);
+                _emscripten_malloc_profiler_record_free(oldmem);
+                _emscripten_malloc_profiler_record_allocation(mem, bytes);
 #endif
             }
             else {
@@ -5321,6 +5354,10 @@ void* dlrealloc_in_place(void* oldmem, size_t bytes) {
 #if __EMSCRIPTEN__
     /* XXX Emscripten Tracing API. */
     emscripten_trace_record_reallocation(oldmem, mem, bytes);
+    if (mem != 0) {
+        _emscripten_malloc_profiler_record_free(oldmem);
+        _emscripten_malloc_profiler_record_allocation(mem, bytes);
+    }
 #endif
     return mem;
 }
@@ -5329,7 +5366,13 @@ void* dlmemalign(size_t alignment, size_t bytes) {
     if (alignment <= MALLOC_ALIGNMENT) {
         return dlmalloc(bytes);
     }
+#if __EMSCRIPTEN__
+    void* mem = internal_memalign(gm, alignment, bytes);
+    _emscripten_malloc_profiler_record_allocation(mem, bytes);
+    return mem;
+#else
     return internal_memalign(gm, alignment, bytes);
+#endif
 }
 
 int dlposix_memalign(void** pp, size_t alignment, size_t bytes) {
@@ -5345,6 +5388,9 @@ int dlposix_memalign(void** pp, size_t alignment, size_t bytes) {
             if (alignment <  MIN_CHUNK_SIZE)
                 alignment = MIN_CHUNK_SIZE;
             mem = internal_memalign(gm, alignment, bytes);
+#if __EMSCRIPTEN__
+            _emscripten_malloc_profiler_record_allocation(mem, bytes);
+#endif
         }
     }
     if (mem == 0)
@@ -0,0 +1,521 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// dlmalloc with a heap per thread, used for -s MALLOC=dlmalloc-mt.
+//
+// Plain dlmalloc in a -pthread build takes one global mutex around every
+// malloc and free. Here each thread instead allocates from its own unlocked
+// mspace. Every chunk records the mspace it came from in its footer (FOOTERS),
+// so free() can tell whose heap a pointer belongs to:
+//
+//  * A pointer from the calling thread's own heap is freed right away.
+//  * A pointer from another thread's heap is pushed onto that heap's list of
+//    remote frees with a compare-and-swap. The owning thread frees everything
+//    on the list the next time it allocates.
+//
+// The mspaces get their memory from sbrk() through dlmalloc's mmap hooks, in
+// DEFAULT_GRANULARITY sized segments. Like with plain dlmalloc that memory is
+// never given back. When a thread exits its heap is put on a list of abandoned
+// heaps, and the next thread that needs a heap takes it over, along with
+// anything other threads freed into it in the meantime.
+//
+// Until the main thread is registered with the pthreads runtime there is no
+// pthread_self(), and allocations come from a single, locked, startup heap.
+// Blocks from that heap are freed straight into it from any thread.
+//
+// The functions that report on or configure the whole allocator (malloc_trim,
+// malloc_footprint and friends) go over all heaps. A heap that another running
+// thread owns is never walked or trimmed, as that thread may be using it.
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define ONLY_MSPACES 1
+#define FOOTERS 1
+#define HAVE_MMAP 1
+#define MMAP_CLEARS 0
+#define MMAP(s) sbrk(s)
+#define MUNMAP(a, s) (-1)
+#define DIRECT_MMAP(s) MFAIL
+// Large requests must not be mmapped on their own, as they could never be
+// unmapped; they are carved from mspace segments like everything else.
+#define DEFAULT_MMAP_THRESHOLD MAX_SIZE_T
+
+#include "dlmalloc.c"
+
+typedef struct thread_heap {
+  mspace space;
+  // Blocks freed by other threads, linked through their first word.
+  _Atomic(void*) remote_frees;
+  // The thread that owns the heap, or 0 while it is abandoned.
+  _Atomic(pthread_t) thread;
+  // Whether this is the startup heap, which is locked and shared.
+  int shared;
+  struct thread_heap* next_abandoned;
+  // All heaps, which are never destroyed, linked together.
+  struct thread_heap* next;
+} thread_heap;
+
+static pthread_key_t heap_key;
+// Set once heap_key exists. Checking this is cheaper than pthread_once().
+static _Atomic(int) heap_key_created;
+static thread_heap* startup_heap;
+
+// Guards the lists of all heaps and of abandoned heaps.
+static pthread_mutex_t heaps_lock = PTHREAD_MUTEX_INITIALIZER;
+static thread_heap* all_heaps;
+static thread_heap* abandoned_heaps;
+// Set by malloc_set_footprint_limit(), and applied to each heap on its own.
+static size_t footprint_limit = MAX_SIZE_T;
+
+static void drain_remote_frees(thread_heap* heap) {
+  if (!atomic_load_explicit(&heap->remote_frees, memory_order_relaxed)) {
+    return;
+  }
+  void* mem = atomic_exchange_explicit(&heap->remote_frees, NULL, memory_order_acquire);
+  while (mem) {
+    void* next = *(void**)mem;
+    mspace_free(heap->space, mem);
+    mem = next;
+  }
+}
+
+static void abandon_heap(void* arg) {
+  thread_heap* heap = (thread_heap*)arg;
+  drain_remote_frees(heap);
+  atomic_store_explicit(&heap->thread, 0, memory_order_relaxed);
+  pthread_mutex_lock(&heaps_lock);
+  heap->next_abandoned = abandoned_heaps;
+  abandoned_heaps = heap;
+  pthread_mutex_unlock(&heaps_lock);
+}
+
+// Must be called with heaps_lock held.
+static thread_heap* new_heap(int locked) {
+  mspace space = create_mspace(0, locked);
+  if (!space) {
+    return 0;
+  }
+  thread_heap* heap = (thread_heap*)mspace_malloc(space, sizeof(thread_heap));
+  if (!heap) {
+    destroy_mspace(space);
+    return 0;
+  }
+  heap->space = space;
+  atomic_init(&heap->remote_frees, NULL);
+  atomic_init(&heap->thread, 0);
+  heap->shared = locked;
+  heap->next_abandoned = 0;
+  ((mstate)space)->extp = heap;
+  if (footprint_limit != MAX_SIZE_T) {
+    mspace_set_footprint_limit(space, footprint_limit);
+  }
+  heap->next = all_heaps;
+  all_heaps = heap;
+  return heap;
+}
+
+// Returns the calling thread's heap, or 0 if it does not have one yet.
+static inline thread_heap* current_heap(void) {
+  if (!pthread_self()) {
+    return startup_heap;
+  }
+  if (!atomic_load_explicit(&heap_key_created, memory_order_acquire)) {
+    return 0;
+  }
+  return (thread_heap*)pthread_getspecific(heap_key);
+}
+
+static thread_heap* acquire_heap(void) {
+  thread_heap* heap;
+  pthread_mutex_lock(&heaps_lock);
+  if (!pthread_self()) {
+    if (!startup_heap) {
+      startup_heap = new_heap(1);
+    }
+    heap = startup_heap;
+    pthread_mutex_unlock(&heaps_lock);
+    return heap;
+  }
+  if (!atomic_load_explicit(&heap_key_created, memory_order_relaxed)) {
+    // The destructor runs when the thread exits.
+    pthread_key_create(&heap_key, abandon_heap);
+    atomic_store_explicit(&heap_key_created, 1, memory_order_release);
+  }
+  heap = abandoned_heaps;
+  if (heap) {
+    abandoned_heaps = heap->next_abandoned;
+  } else {
+    heap = new_heap(0);
+  }
+  pthread_mutex_unlock(&heaps_lock);
+  if (heap) {
+    atomic_store_explicit(&heap->thread, pthread_self(), memory_order_relaxed);
+    // If this happens in another key's destructor during thread exit, setting
+    // the key again makes abandon_heap() run once more afterwards.
+    pthread_setspecific(heap_key, heap);
+  }
+  return heap;
+}
+
+static inline thread_heap* get_heap(void) {
+  thread_heap* heap = current_heap();
+  if (!heap) {
+    heap = acquire_heap();
+  }
+  if (heap) {
+    drain_remote_frees(heap);
+  }
+  return heap;
+}
+
+static inline thread_heap* owner_of(void* mem) {
+  mstate m = get_mstate_for(mem2chunk(mem));
+  if (!ok_magic(m)) {
+    USAGE_ERROR_ACTION(m, mem);
+    return 0;
+  }
+  return (thread_heap*)m->extp;
+}
+
+// Whether the calling thread may use the heap directly. Comparing thread ids is
+// cheaper than looking up the calling thread's heap.
+static inline int can_use(thread_heap* heap) {
+  return heap->shared ||
+         atomic_load_explicit(&heap->thread, memory_order_relaxed) == pthread_self();
+}
+
+static void* mt_malloc(size_t bytes) {
+  thread_heap* heap = get_heap();
+  if (!heap) {
+    MALLOC_FAILURE_ACTION;
+    return 0;
+  }
+  void* mem = mspace_malloc(heap->space, bytes);
+  /* XXX Emscripten Tracing API. */
+  emscripten_trace_record_allocation(mem, bytes);
+  _emscripten_malloc_profiler_record_allocation(mem, bytes);
+  return mem;
+}
+
+static void mt_free(void* mem) {
+  if (!mem) {
+    return;
+  }
+  /* XXX Emscripten Tracing API. */
+  emscripten_trace_record_free(mem);
+  _emscripten_malloc_profiler_record_free(mem);
+  thread_heap* owner = owner_of(mem);
+  if (!owner) {
+    return;
+  }
+  if (can_use(owner)) {
+    mspace_free(owner->space, mem);
+    return;
+  }
+  void* head = atomic_load_explicit(&owner->remote_frees, memory_order_relaxed);
+  do {
+    *(void**)mem = head;
+  } while (!atomic_compare_exchange_weak_explicit(&owner->remote_frees, &head, mem,
+                                                  memory_order_release,
+                                                  memory_order_relaxed));
+}
+
+static void* mt_calloc(size_t n_elements, size_t elem_size) {
+  thread_heap* heap = get_heap();
+  if (!heap) {
+    MALLOC_FAILURE_ACTION;
+    return 0;
+  }
+  void* mem = mspace_calloc(heap->space, n_elements, elem_size);
+  /* XXX Emscripten Tracing API. */
+  emscripten_trace_record_allocation(mem, n_elements * elem_size);
+  _emscripten_malloc_profiler_record_allocation(mem, n_elements * elem_size);
+  return mem;
+}
+
+static void* mt_realloc(void* oldmem, size_t bytes) {
+  if (!oldmem) {
+    return mt_malloc(bytes);
+  }
+  thread_heap* owner = owner_of(oldmem);
+  if (!owner) {
+    return 0;
+  }
+  if (can_use(owner)) {
+    void* mem = mspace_realloc(owner->space, oldmem, bytes);
+    /* XXX Emscripten Tracing API. */
+    emscripten_trace_record_reallocation(oldmem, mem, bytes);
+    if (mem) {
+      _emscripten_malloc_profiler_record_free(oldmem);
+      _emscripten_malloc_profiler_record_allocation(mem, bytes);
+    }
+    return mem;
+  }
+  // A block from another thread's heap moves to this thread's heap.
+#ifdef REALLOC_ZERO_BYTES_FREES
+  if (bytes == 0) {
+    mt_free(oldmem);
+    return 0;
+  }
+#endif
+  void* mem = mt_malloc(bytes);
+  if (mem) {
+    size_t oc = mspace_usable_size(oldmem);
+    memcpy(mem, oldmem, (oc < bytes) ? oc : bytes);
+    mt_free(oldmem);
+  }
+  return mem;
+}
+
+static void* mt_realloc_in_place(void* oldmem, size_t bytes) {
+  if (!oldmem) {
+    return 0;
+  }
+  thread_heap* owner = owner_of(oldmem);
+  if (!owner || !can_use(owner)) {
+    return 0;
+  }
+  void* mem = mspace_realloc_in_place(owner->space, oldmem, bytes);
+  if (mem) {
+    _emscripten_malloc_profiler_record_free(oldmem);
+    _emscripten_malloc_profiler_record_allocation(mem, bytes);
+  }
+  return mem;
+}
+
+static void* mt_memalign(size_t alignment, size_t bytes) {
+  thread_heap* heap = get_heap();
+  if (!heap) {
+    MALLOC_FAILURE_ACTION;
+    return 0;
+  }
+  void* mem = mspace_memalign(heap->space, alignment, bytes);
+  /* XXX Emscripten Tracing API. */
+  emscripten_trace_record_allocation(mem, bytes);
+  _emscripten_malloc_profiler_record_allocation(mem, bytes);
+  return mem;
+}
+
+static int mt_posix_memalign(void** pp, size_t alignment, size_t bytes) {
+  void* mem = 0;
+  if (alignment == MALLOC_ALIGNMENT) {
+    mem = mt_malloc(bytes);
+  } else {
+    size_t d = alignment / sizeof(void*);
+    size_t r = alignment % sizeof(void*);
+    if (r != 0 || d == 0 || (d & (d - SIZE_T_ONE)) != 0) {
+      return EINVAL;
+    } else if (bytes <= MAX_REQUEST - alignment) {
+      if (alignment < MIN_CHUNK_SIZE) {
+        alignment = MIN_CHUNK_SIZE;
+      }
+      mem = mt_memalign(alignment, bytes);
+    }
+  }
+  if (mem == 0) {
+    return ENOMEM;
+  }
+  *pp = mem;
+  return 0;
+}
+
+static void* mt_valloc(size_t bytes) {
+  ensure_initialization();
+  return mt_memalign(mparams.page_size, bytes);
+}
+
+static void* mt_pvalloc(size_t bytes) {
+  ensure_initialization();
+  size_t pagesz = mparams.page_size;
+  return mt_memalign(pagesz, (bytes + pagesz - SIZE_T_ONE) & ~(pagesz - SIZE_T_ONE));
+}
+
+static size_t mt_malloc_usable_size(void* mem) {
+  return mspace_usable_size(mem);
+}
+
+// Statistics are for the calling thread's heap.
+#if !NO_MALLINFO
+static struct mallinfo mt_mallinfo(void) {
+  thread_heap* heap = get_heap();
+  if (!heap) {
+    struct mallinfo nm = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    return nm;
+  }
+  return mspace_mallinfo(heap->space);
+}
+#endif
+
+static int mt_mallopt(int param_number, int value) {
+  return mspace_mallopt(param_number, value);
+}
+
+// Whether the calling thread may walk the heap. Must be called with heaps_lock
+// held, which keeps abandoned heaps from being taken over in the meantime.
+static int can_walk(thread_heap* heap) {
+  return can_use(heap) || !atomic_load_explicit(&heap->thread, memory_order_relaxed);
+}
+
+static int mt_malloc_trim(size_t pad) {
+  int result = 0;
+  pthread_mutex_lock(&heaps_lock);
+  for (thread_heap* heap = all_heaps; heap; heap = heap->next) {
+    if (can_walk(heap)) {
+      drain_remote_frees(heap);
+      result |= mspace_trim(heap->space, pad);
+    }
+  }
+  pthread_mutex_unlock(&heaps_lock);
+  return result;
+}
+
+#if !NO_MALLOC_STATS
+// Free chunks in heaps that other running threads own are counted as in use,
+// as those heaps cannot be walked.
+static void mt_malloc_stats(void) {
+  size_t maxfp = 0;
+  size_t fp = 0;
+  size_t used = 0;
+  ensure_initialization();
+  pthread_mutex_lock(&heaps_lock);
+  for (thread_heap* heap = all_heaps; heap; heap = heap->next) {
+    mstate m = (mstate)heap->space;
+    int walk = can_walk(heap);
+    if (walk && PREACTION(m)) {
+      continue;
+    }
+    if (is_initialized(m)) {
+      msegmentptr s = &m->seg;
+      maxfp += m->max_footprint;
+      fp += m->footprint;
+      used += m->footprint - (m->topsize + TOP_FOOT_SIZE);
+      while (walk && s != 0) {
+        mchunkptr q = align_as_chunk(s->base);
+        while (segment_holds(s, q) &&
+               q != m->top && q->head != FENCEPOST_HEAD) {
+          if (!is_inuse(q))
+            used -= chunksize(q);
+          q = next_chunk(q);
+        }
+        s = s->next;
+      }
+    }
+    if (walk) {
+      POSTACTION(m);
+    }
+  }
+  pthread_mutex_unlock(&heaps_lock);
+  fprintf(stderr, "max system bytes = %10lu\n", (unsigned long)(maxfp));
+  fprintf(stderr, "system bytes     = %10lu\n", (unsigned long)(fp));
+  fprintf(stderr, "in use bytes     = %10lu\n", (unsigned long)(used));
+}
+#endif
+
+static size_t mt_malloc_footprint(void) {
+  size_t result = 0;
+  pthread_mutex_lock(&heaps_lock);
+  for (thread_heap* heap = all_heaps; heap; heap = heap->next) {
+    result += mspace_footprint(heap->space);
+  }
+  pthread_mutex_unlock(&heaps_lock);
+  return result;
+}
+
+static size_t mt_malloc_max_footprint(void) {
+  size_t result = 0;
+  pthread_mutex_lock(&heaps_lock);
+  for (thread_heap* heap = all_heaps; heap; heap = heap->next) {
+    result += mspace_max_footprint(heap->space);
+  }
+  pthread_mutex_unlock(&heaps_lock);
+  return result;
+}
+
+static size_t mt_malloc_footprint_limit(void) {
+  pthread_mutex_lock(&heaps_lock);
+  size_t result = footprint_limit;
+  pthread_mutex_unlock(&heaps_lock);
+  return result;
+}
+
+// The limit applies to each heap on its own, not to all of them together.
+static size_t mt_malloc_set_footprint_limit(size_t bytes) {
+  ensure_initialization();
+  // Like mspace_set_footprint_limit(), this returns 0 if the limit is removed.
+  size_t result = (bytes == MAX_SIZE_T) ? 0 : granularity_align(bytes ? bytes : 1);
+  pthread_mutex_lock(&heaps_lock);
+  for (thread_heap* heap = all_heaps; heap; heap = heap->next) {
+    mspace_set_footprint_limit(heap->space, bytes);
+  }
+  footprint_limit = result ? result : MAX_SIZE_T;
+  pthread_mutex_unlock(&heaps_lock);
+  return result;
+}
+
+static void** mt_independent_calloc(size_t n_elements, size_t elem_size, void* chunks[]) {
+  thread_heap* heap = get_heap();
+  if (!heap) {
+    MALLOC_FAILURE_ACTION;
+    return 0;
+  }
+  return mspace_independent_calloc(heap->space, n_elements, elem_size, chunks);
+}
+
+static void** mt_independent_comalloc(size_t n_elements, size_t sizes[], void* chunks[]) {
+  thread_heap* heap = get_heap();
+  if (!heap) {
+    MALLOC_FAILURE_ACTION;
+    return 0;
+  }
+  return mspace_independent_comalloc(heap->space, n_elements, sizes, chunks);
+}
+
+// The blocks can come from any heap, so they are freed one by one, each into
+// the heap it came from.
+static size_t mt_bulk_free(void* array[], size_t nelem) {
+  for (size_t i = 0; i < nelem; i++) {
+    if (array[i]) {
+      mt_free(array[i]);
+      array[i] = 0;
+    }
+  }
+  return 0;
+}
+
+void* malloc(size_t) __attribute__((weak, alias("mt_malloc")));
+void  free(void*) __attribute__((weak, alias("mt_free")));
+void* calloc(size_t, size_t) __attribute__((weak, alias("mt_calloc")));
+void* realloc(void*, size_t) __attribute__((weak, alias("mt_realloc")));
+void* realloc_in_place(void*, size_t) __attribute__((weak, alias("mt_realloc_in_place")));
+void* memalign(size_t, size_t) __attribute__((weak, alias("mt_memalign")));
+int posix_memalign(void**, size_t, size_t) __attribute__((weak, alias("mt_posix_memalign")));
+void* valloc(size_t) __attribute__((weak, alias("mt_valloc")));
+void* pvalloc(size_t) __attribute__((weak, alias("mt_pvalloc")));
+#if !NO_MALLINFO
+struct mallinfo mallinfo(void) __attribute__((weak, alias("mt_mallinfo")));
+#endif
+int mallopt(int, int) __attribute__((weak, alias("mt_mallopt")));
+int malloc_trim(size_t) __attribute__((weak, alias("mt_malloc_trim")));
+#if !NO_MALLOC_STATS
+void malloc_stats(void) __attribute__((weak, alias("mt_malloc_stats")));
+#endif
+size_t malloc_usable_size(void*) __attribute__((weak, alias("mt_malloc_usable_size")));
+size_t malloc_footprint(void) __attribute__((weak, alias("mt_malloc_footprint")));
+size_t malloc_max_footprint(void) __attribute__((weak, alias("mt_malloc_max_footprint")));
+size_t malloc_footprint_limit(void) __attribute__((weak, alias("mt_malloc_footprint_limit")));
+size_t malloc_set_footprint_limit(size_t bytes) __attribute__((weak, alias("mt_malloc_set_footprint_limit")));
+void** independent_calloc(size_t, size_t, void**) __attribute__((weak, alias("mt_independent_calloc")));
+void** independent_comalloc(size_t, size_t*, void**) __attribute__((weak, alias("mt_independent_comalloc")));
+size_t bulk_free(void**, size_t n_elements) __attribute__((weak, alias("mt_bulk_free")));
+
+// See the comment at the end of dlmalloc.c.
+extern __typeof(malloc) emscripten_builtin_malloc __attribute__((alias("mt_malloc")));
+extern __typeof(free) emscripten_builtin_free __attribute__((alias("mt_free")));
+extern __typeof(memalign) emscripten_builtin_memalign __attribute__((alias("mt_memalign")));
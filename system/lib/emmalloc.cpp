@@ -52,6 +52,10 @@
 #include <emscripten/trace.h>
 #endif
 
+#ifdef EMSCRIPTEN_MALLOC_PROFILER
+#include "malloc_profiler_hooks.h"
+#endif
+
 // Behavior of right shifting a signed integer is compiler implementation defined.
 static_assert((((int32_t)0x80000000U) >> 31) == -1, "This malloc implementation requires that right-shifting a signed integer produces a sign-extending (arithmetic) shift!");
 
@@ -323,6 +327,17 @@ static void link_to_free_list(Region *freeRegion)
   assert(freeRegion->size >= sizeof(Region));
   int bucketIndex = compute_free_list_bucket(freeRegion->size-REGION_HEADER_SIZE);
   Region *freeListHead = freeRegionBuckets + bucketIndex;
+  // Allocation always looks at the front of a bucket first, so to keep the heap compact, only put the new free
+  // region at the front if it lies at a lower address than the current front region, and otherwise at the back.
+  // That makes allocations gravitate towards low addresses in constant time, which leaves the free space at the
+  // top of the heap free for as long as possible, so that emmalloc_trim() and emmalloc_release_free_pages()
+  // can give it back after a usage peak.
+  if (freeRegion > freeListHead->next)
+  {
+    prepend_to_free_list(freeRegion, freeListHead);
+    freeRegionBucketsUsed |= ((BUCKET_BITMASK_T)1) << bucketIndex;
+    return;
+  }
   freeRegion->prev = freeListHead;
   freeRegion->next = freeListHead->next;
   assert(freeRegion->next);
@@ -769,6 +784,9 @@ void *emmalloc_memalign(size_t alignment, size_t size)
   MALLOC_ACQUIRE();
   void *ptr = allocate_memory(alignment, size);
   MALLOC_RELEASE();
+#ifdef EMSCRIPTEN_MALLOC_PROFILER
+  _emscripten_malloc_profiler_record_allocation(ptr, size);
+#endif
   return ptr;
 }
 extern __typeof(emmalloc_memalign) emscripten_builtin_memalign __attribute__((alias("emmalloc_memalign")));
@@ -834,6 +852,10 @@ void emmalloc_free(void *ptr)
   MAIN_THREAD_ASYNC_EM_ASM(console.log('free(ptr=0x'+($0>>>0).toString(16)+')'), ptr);
 #endif
 
+#ifdef EMSCRIPTEN_MALLOC_PROFILER
+  _emscripten_malloc_profiler_record_free(ptr);
+#endif
+
   uint8_t *regionStartPtr = (uint8_t*)ptr - sizeof(uint32_t);
   Region *region = (Region*)(regionStartPtr);
   assert(HAS_ALIGNMENT(region, sizeof(uint32_t)));
@@ -1001,6 +1023,10 @@ void *emmalloc_aligned_realloc(void *ptr, size_t alignment, size_t size)
   {
 #ifdef __EMSCRIPTEN_TRACING__
     emscripten_trace_record_reallocation(ptr, ptr, size);
+#endif
+#ifdef EMSCRIPTEN_MALLOC_PROFILER
+    _emscripten_malloc_profiler_record_free(ptr);
+    _emscripten_malloc_profiler_record_allocation(ptr, size);
 #endif
     return ptr;
   }
@@ -1045,6 +1071,13 @@ void *emmalloc_realloc_try(void *ptr, size_t size)
 #ifdef __EMSCRIPTEN_TRACING__
   if (success)
     emscripten_trace_record_reallocation(ptr, ptr, size);
+#endif
+#ifdef EMSCRIPTEN_MALLOC_PROFILER
+  if (success)
+  {
+    _emscripten_malloc_profiler_record_free(ptr);
+    _emscripten_malloc_profiler_record_allocation(ptr, size);
+  }
 #endif
   return success ? ptr : 0;
 }
@@ -1072,6 +1105,10 @@ void *emmalloc_aligned_realloc_uninitialized(void *ptr, size_t alignment, size_t
   {
 #ifdef __EMSCRIPTEN_TRACING__
     emscripten_trace_record_reallocation(ptr, ptr, size);
+#endif
+#ifdef EMSCRIPTEN_MALLOC_PROFILER
+    _emscripten_malloc_profiler_record_free(ptr);
+    _emscripten_malloc_profiler_record_allocation(ptr, size);
 #endif
     return ptr;
   }
@@ -1287,6 +1324,66 @@ int EMMALLOC_EXPORT malloc_trim(size_t pad)
   return emmalloc_trim(pad);
 }
 
+// The granularity at which the OS underneath the wasm engine manages memory.
+#define RELEASE_PAGE_SIZE 4096
+
+static bool page_is_zero(const uint8_t *page)
+{
+  const uint64_t *words = (const uint64_t*)page;
+  for(int i = 0; i < RELEASE_PAGE_SIZE / (int)sizeof(uint64_t); ++i)
+    if (words[i])
+      return false;
+  return true;
+}
+
+size_t emmalloc_release_free_pages()
+{
+  size_t releasedBytes = 0;
+
+  MALLOC_ACQUIRE();
+
+  // First give free space at the top of the heap back to sbrk(), if nobody else has sbrk()ed after us.
+  if (listOfAllRegions && sbrk(0) == (void*)((uint32_t*)listOfAllRegions)[2])
+  {
+    uint8_t *oldSbrk = (uint8_t*)sbrk(0);
+    if (trim_dynamic_heap_reservation(0))
+      releasedBytes += oldSbrk - (uint8_t*)sbrk(0);
+  }
+
+  // Then zero all whole pages inside the remaining free regions. A WebAssembly Memory cannot shrink, but pages
+  // that only contain zeros can be deduplicated or compressed away by the OS, and new pages obtained by growing
+  // the Memory are zero too. Only regions that are large enough to span a page are looked at. Pages that are
+  // already zero, e.g. because they were released before and not reused since, are only read and not written,
+  // so that they are not made dirty again.
+  int bucketIndex = compute_free_list_bucket(RELEASE_PAGE_SIZE);
+  BUCKET_BITMASK_T bucketMask = freeRegionBucketsUsed >> bucketIndex;
+  while(bucketMask)
+  {
+    BUCKET_BITMASK_T indexAdd = __builtin_ctzll(bucketMask);
+    bucketIndex += indexAdd;
+    bucketMask >>= indexAdd;
+    for(Region *freeRegion = freeRegionBuckets[bucketIndex].next;
+      freeRegion != &freeRegionBuckets[bucketIndex];
+      freeRegion = freeRegion->next)
+    {
+      // Leave the size and the free list pointers at the start, and the size at the end of the region intact.
+      uint8_t *pageStart = ALIGN_UP((uint8_t*)freeRegion + sizeof(Region) - sizeof(uint32_t), RELEASE_PAGE_SIZE);
+      uint8_t *pageEnd = (uint8_t*)((uintptr_t)region_payload_end_ptr(freeRegion) & ~(uintptr_t)(RELEASE_PAGE_SIZE-1));
+      for(uint8_t *page = pageStart; page < pageEnd; page += RELEASE_PAGE_SIZE)
+        if (!page_is_zero(page))
+        {
+          memset(page, 0, RELEASE_PAGE_SIZE);
+          releasedBytes += RELEASE_PAGE_SIZE;
+        }
+    }
+    ++bucketIndex;
+    bucketMask >>= 1;
+  }
+
+  MALLOC_RELEASE();
+  return releasedBytes;
+}
+
 size_t emmalloc_dynamic_heap_size()
 {
   size_t dynamicHeapSize = 0;
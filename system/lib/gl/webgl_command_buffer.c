@@ -0,0 +1,236 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// Command buffer for GL calls proxied from a pthread to the main thread
+// (-s OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER).
+//
+// Instead of posting one em_queued_call per asynchronous GL call, the calling
+// thread appends the call to a flat array of 32-bit words:
+//
+//   word 0:    number of words used in the whole buffer (including this one)
+//   then, for each call:
+//     sig       EM_FUNC_SIGNATURE of the call
+//     func      function pointer to invoke (an emscripten_gl* function)
+//     satellite heap block to free() after the call, or 0
+//     args...   one word per parameter, as int or float
+//
+// The buffer is handed over to the main thread as a single proxied call when
+// it is flushed, and the main thread decodes and replays it in order.
+
+#include <assert.h>
+#include <emscripten/threading.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include <webgl/webgl1.h>
+
+#if defined(__EMSCRIPTEN_PTHREADS__) && defined(__EMSCRIPTEN_OFFSCREEN_FRAMEBUFFER__) && defined(__EMSCRIPTEN_GL_COMMAND_BUFFER__)
+
+typedef union gl_command_word
+{
+  uint32_t u;
+  int i;
+  float f;
+  void *p;
+} gl_command_word;
+
+_Static_assert(sizeof(gl_command_word) == 4, "the command buffer encoding assumes wasm32");
+
+#define HEADER_WORDS 3
+
+// Start small, and grow up to this size before flushing on our own. A typical
+// frame fits in a few tens of kilobytes.
+#define INITIAL_CAPACITY_WORDS 1024
+#define MAX_CAPACITY_WORDS (256*1024)
+
+typedef struct gl_command_buffer
+{
+  gl_command_word *words;
+  uint32_t capacity;
+} gl_command_buffer;
+
+static pthread_key_t commandBufferKey;
+static pthread_once_t commandBufferKeyInit = PTHREAD_ONCE_INIT;
+
+static void FreeCommandBuffer(void *ptr)
+{
+  gl_command_buffer *buffer = (gl_command_buffer*)ptr;
+  // Commands that were recorded right before the thread exited still need to
+  // reach the main thread.
+  pthread_setspecific(commandBufferKey, buffer);
+  _emscripten_gl_command_buffer_flush();
+  pthread_setspecific(commandBufferKey, 0);
+  free(buffer);
+}
+
+static void InitCommandBufferKey()
+{
+  pthread_key_create(&commandBufferKey, FreeCommandBuffer);
+}
+
+static gl_command_buffer *GetCommandBuffer()
+{
+  pthread_once(&commandBufferKeyInit, InitCommandBufferKey);
+  gl_command_buffer *buffer = (gl_command_buffer*)pthread_getspecific(commandBufferKey);
+  if (!buffer)
+  {
+    buffer = (gl_command_buffer*)calloc(1, sizeof(gl_command_buffer));
+    if (buffer)
+      pthread_setspecific(commandBufferKey, buffer);
+  }
+  return buffer;
+}
+
+// Makes room for numWords more words, flushing or growing the buffer as
+// needed. Returns a pointer to the reserved words, or 0 on allocation failure.
+static gl_command_word *Reserve(gl_command_buffer *buffer, uint32_t numWords)
+{
+  if (buffer->words && buffer->words[0].u + numWords > buffer->capacity)
+  {
+    if (buffer->capacity >= MAX_CAPACITY_WORDS)
+      _emscripten_gl_command_buffer_flush();
+    else
+    {
+      uint32_t capacity = buffer->capacity * 2;
+      gl_command_word *words = (gl_command_word*)realloc(buffer->words, capacity * sizeof(gl_command_word));
+      if (!words)
+        return 0;
+      buffer->words = words;
+      buffer->capacity = capacity;
+    }
+  }
+  if (!buffer->words)
+  {
+    // The previous buffer is owned by the main thread after a flush, so start
+    // a new one.
+    buffer->words = (gl_command_word*)malloc(INITIAL_CAPACITY_WORDS * sizeof(gl_command_word));
+    if (!buffer->words)
+      return 0;
+    buffer->capacity = INITIAL_CAPACITY_WORDS;
+    buffer->words[0].u = 1;
+  }
+  gl_command_word *reserved = buffer->words + buffer->words[0].u;
+  buffer->words[0].u += numWords;
+  return reserved;
+}
+
+static void ReplayCommands(gl_command_word *words);
+
+void _emscripten_gl_command_buffer_record(EM_FUNC_SIGNATURE sig, void *func, void *satellite, ...)
+{
+  assert((sig & EM_FUNC_SIG_RETURN_VALUE_MASK) == EM_FUNC_SIG_RETURN_VALUE_V && "only calls without a return value can be recorded");
+  int numArguments = EM_FUNC_SIG_NUM_FUNC_ARGUMENTS(sig);
+  gl_command_buffer *buffer = GetCommandBuffer();
+  gl_command_word *w = buffer ? Reserve(buffer, HEADER_WORDS + numArguments) : 0;
+
+  // If we are out of memory, run this one call synchronously from a buffer on
+  // the stack, after everything that was recorded before it.
+  gl_command_word fallback[1 + HEADER_WORDS + EM_QUEUED_CALL_MAX_ARGS];
+  if (!w)
+  {
+    fallback[0].u = 1 + HEADER_WORDS + numArguments;
+    w = fallback + 1;
+  }
+
+  w[0].u = sig;
+  w[1].p = func;
+  w[2].p = satellite;
+  EM_FUNC_SIGNATURE argumentsType = sig & EM_FUNC_SIG_ARGUMENTS_TYPE_MASK;
+  va_list args;
+  va_start(args, satellite);
+  for (int i = 0; i < numArguments; ++i)
+  {
+    switch (argumentsType & EM_FUNC_SIG_ARGUMENT_TYPE_SIZE_MASK)
+    {
+      case EM_FUNC_SIG_PARAM_I:
+        w[HEADER_WORDS + i].i = va_arg(args, int);
+        break;
+      case EM_FUNC_SIG_PARAM_F:
+        w[HEADER_WORDS + i].f = (float)va_arg(args, double);
+        break;
+      default:
+        assert(0 && "64-bit parameters cannot be recorded");
+    }
+    argumentsType >>= EM_FUNC_SIG_ARGUMENT_TYPE_SIZE_SHIFT;
+  }
+  va_end(args);
+
+  if (w == fallback + 1)
+  {
+    _emscripten_gl_command_buffer_flush();
+    emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_VI, &ReplayCommands, fallback);
+  }
+}
+
+void _emscripten_gl_command_buffer_flush(void)
+{
+  pthread_once(&commandBufferKeyInit, InitCommandBufferKey);
+  gl_command_buffer *buffer = (gl_command_buffer*)pthread_getspecific(commandBufferKey);
+  if (!buffer || !buffer->words)
+    return;
+  // Hand the words over to the main thread, which frees them after replaying.
+  gl_command_word *words = buffer->words;
+  buffer->words = 0;
+  buffer->capacity = 0;
+  emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VI, &_emscripten_gl_command_buffer_replay, words);
+}
+
+#define I(n) a[n].i
+#define F(n) a[n].f
+
+static void ReplayCommands(gl_command_word *words)
+{
+  uint32_t end = words[0].u;
+  uint32_t pos = 1;
+  while (pos < end)
+  {
+    EM_FUNC_SIGNATURE sig = words[pos].u;
+    void *func = words[pos+1].p;
+    void *satellite = words[pos+2].p;
+    gl_command_word *a = words + pos + HEADER_WORDS;
+    switch (sig)
+    {
+      case EM_FUNC_SIG_V: ((em_func_v)func)(); break;
+      case EM_FUNC_SIG_VI: ((em_func_vi)func)(I(0)); break;
+      case EM_FUNC_SIG_VF: ((em_func_vf)func)(F(0)); break;
+      case EM_FUNC_SIG_VII: ((em_func_vii)func)(I(0), I(1)); break;
+      case EM_FUNC_SIG_VIF: ((em_func_vif)func)(I(0), F(1)); break;
+      case EM_FUNC_SIG_VFF: ((em_func_vff)func)(F(0), F(1)); break;
+      case EM_FUNC_SIG_VIII: ((em_func_viii)func)(I(0), I(1), I(2)); break;
+      case EM_FUNC_SIG_VIIF: ((em_func_viif)func)(I(0), I(1), F(2)); break;
+      case EM_FUNC_SIG_VIFF: ((em_func_viff)func)(I(0), F(1), F(2)); break;
+      case EM_FUNC_SIG_VFFF: ((em_func_vfff)func)(F(0), F(1), F(2)); break;
+      case EM_FUNC_SIG_VIIII: ((em_func_viiii)func)(I(0), I(1), I(2), I(3)); break;
+      case EM_FUNC_SIG_VIIFI: ((em_func_viifi)func)(I(0), I(1), F(2), I(3)); break;
+      case EM_FUNC_SIG_VIFFF: ((em_func_vifff)func)(I(0), F(1), F(2), F(3)); break;
+      case EM_FUNC_SIG_VFFFF: ((em_func_vffff)func)(F(0), F(1), F(2), F(3)); break;
+      case EM_FUNC_SIG_VIIIII: ((em_func_viiiii)func)(I(0), I(1), I(2), I(3), I(4)); break;
+      case EM_FUNC_SIG_VIFFFF: ((em_func_viffff)func)(I(0), F(1), F(2), F(3), F(4)); break;
+      case EM_FUNC_SIG_VIIIIII: ((em_func_viiiiii)func)(I(0), I(1), I(2), I(3), I(4), I(5)); break;
+      case EM_FUNC_SIG_VIIIIIII: ((em_func_viiiiiii)func)(I(0), I(1), I(2), I(3), I(4), I(5), I(6)); break;
+      case EM_FUNC_SIG_VIIIIIIII: ((em_func_viiiiiiii)func)(I(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7)); break;
+      case EM_FUNC_SIG_VIIIIIIIII: ((em_func_viiiiiiiii)func)(I(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7), I(8)); break;
+      case EM_FUNC_SIG_VIIIIIIIIII: ((em_func_viiiiiiiiii)func)(I(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7), I(8), I(9)); break;
+      case EM_FUNC_SIG_VIIIIIIIIIII: ((em_func_viiiiiiiiiii)func)(I(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7), I(8), I(9), I(10)); break;
+      default: assert(0 && "invalid signature in GL command buffer"); break;
+    }
+    free(satellite);
+    pos += HEADER_WORDS + EM_FUNC_SIG_NUM_FUNC_ARGUMENTS(sig);
+  }
+}
+
+void _emscripten_gl_command_buffer_replay(void *commands)
+{
+  ReplayCommands((gl_command_word*)commands);
+  free(commands);
+}
+
+#undef I
+#undef F
+
+#endif
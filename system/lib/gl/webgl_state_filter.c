@@ -0,0 +1,550 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// Redundant state change filter (-s GL_STATE_FILTER).
+//
+// Engines often rebind the same buffer, texture or program, or enable a cap
+// that is already enabled, once per draw call. Each of those calls crosses
+// into JS (and, for proxied contexts, to the main thread) only to do nothing.
+// This layer remembers the last value passed to each of the calls below, per
+// context, and drops calls that pass the same value again:
+//
+//   glActiveTexture, glBindBuffer, glBindFramebuffer, glBindRenderbuffer,
+//   glBindTexture, glBindVertexArray, glUseProgram, glEnable, glDisable
+//
+// Nothing is assumed about a context before the first call that sets a given
+// piece of state, and deleting an object forgets every binding that referred
+// to it, so the first call after either always goes through.
+//
+// The state of a context is only filtered by one thread: the first one that
+// makes a filtered call on it. A context proxied to the main thread can be
+// current on a pthread and on the main thread at the same time, and the calls
+// from the two reach WebGL in an order that neither thread sees, so once a
+// second thread makes a filtered call on a context, filtering stops for that
+// context on all threads.
+//
+// In builds where the gl* functions are not already implemented in C
+// (everything except pthreads + OFFSCREEN_FRAMEBUFFER), this file also
+// provides the gl* entry points for the calls above, and forwards the ones
+// that are not dropped to the emscripten_gl* functions in library_webgl.js.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <emscripten/html5_webgl.h>
+#include <webgl/webgl1.h>
+#include <webgl/webgl1_ext.h>
+#include <webgl/webgl2.h>
+
+#ifdef __EMSCRIPTEN_GL_STATE_FILTER__
+
+#if defined(__EMSCRIPTEN_PTHREADS__) && defined(__EMSCRIPTEN_OFFSCREEN_FRAMEBUFFER__)
+#define GL_FUNCTIONS_IN_C 1
+#else
+#define GL_FUNCTIONS_IN_C 0
+#endif
+
+// Vertex array object bindings only go through this file if something in C
+// implements glBindVertexArray(OES): either this file, or webgl2.c. Otherwise
+// the element array buffer binding, which is part of the vertex array object
+// state, cannot be tracked.
+#if !GL_FUNCTIONS_IN_C || MAX_WEBGL_VERSION >= 2 || defined(__EMSCRIPTEN_FULL_ES3__)
+#define TRACK_VERTEX_ARRAYS 1
+#else
+#define TRACK_VERTEX_ARRAYS 0
+#endif
+
+// Value of a binding that has not been set yet, or that may have changed
+// behind our back. Object names come from a counter in library_webgl.js and
+// never get this large.
+#define UNKNOWN 0xFFFFFFFFu
+
+#define MAX_TEXTURE_UNITS 32
+
+enum
+{
+  TEXTURE_2D,
+  TEXTURE_CUBE_MAP,
+  TEXTURE_3D,
+  TEXTURE_2D_ARRAY,
+  NUM_TEXTURE_TARGETS
+};
+
+enum
+{
+  ARRAY_BUFFER,
+  ELEMENT_ARRAY_BUFFER,
+  COPY_READ_BUFFER,
+  COPY_WRITE_BUFFER,
+  PIXEL_PACK_BUFFER,
+  PIXEL_UNPACK_BUFFER,
+  NUM_BUFFER_TARGETS
+};
+
+typedef struct gl_filter_state
+{
+  GLenum activeTexture;
+  GLuint textures[MAX_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+  GLuint buffers[NUM_BUFFER_TARGETS];
+  GLuint drawFramebuffer;
+  GLuint readFramebuffer;
+  GLuint renderbuffer;
+  GLuint program;
+  GLuint vertexArray;
+  uint32_t knownCaps;
+  uint32_t enabledCaps;
+} gl_filter_state;
+
+typedef struct gl_state_filter
+{
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context;
+  struct gl_state_filter *next;
+  gl_filter_state state;
+  EmscriptenWebGLFilteredCallCounts counts;
+  // The thread that filters calls on this context, or 0 if none has yet.
+  pthread_t thread;
+  // Set, and never cleared until the context is deleted, once calls on this
+  // context have been made from more than one thread.
+  EM_BOOL shared;
+} gl_state_filter;
+
+// Filters are never freed: with pthreads, context handles are heap addresses
+// that can be reused after a context is destroyed, and another thread may
+// still hold a pointer to the filter of a destroyed context.
+static gl_state_filter *filters;
+static pthread_mutex_t filtersLock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread gl_state_filter *current;
+
+// Returns the filter of the current context, if the calling thread may use it.
+static gl_state_filter *CurrentFilter()
+{
+  gl_state_filter *f = current;
+  if (!f) return 0;
+  pthread_t self = pthread_self();
+  pthread_t thread = __atomic_load_n(&f->thread, __ATOMIC_ACQUIRE);
+  if (thread != self && (thread || !__atomic_compare_exchange_n(&f->thread, &thread, self, EM_FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)))
+  {
+    __atomic_store_n(&f->shared, EM_TRUE, __ATOMIC_RELEASE);
+    current = 0;
+    return 0;
+  }
+  return __atomic_load_n(&f->shared, __ATOMIC_ACQUIRE) ? 0 : f;
+}
+
+static void ForgetState(gl_filter_state *state)
+{
+  memset(state, 0xFF, sizeof(*state));
+  state->knownCaps = 0;
+  state->enabledCaps = 0;
+}
+
+static gl_state_filter *FindFilter(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, EM_BOOL create)
+{
+  pthread_mutex_lock(&filtersLock);
+  gl_state_filter *filter = filters;
+  while (filter && filter->context != context)
+    filter = filter->next;
+  if (!filter && create)
+  {
+    filter = (gl_state_filter*)calloc(1, sizeof(gl_state_filter));
+    if (filter)
+    {
+      filter->context = context;
+      ForgetState(&filter->state);
+      filter->next = filters;
+      filters = filter;
+    }
+  }
+  pthread_mutex_unlock(&filtersLock);
+  return filter;
+}
+
+// Called from GL.makeContextCurrent() in library_webgl.js, and from
+// emscripten_webgl_make_context_current() for contexts proxied to the main
+// thread.
+void _emscripten_gl_state_filter_make_current(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context)
+{
+  // If we run out of memory, calls on this context are simply not filtered.
+  current = context ? FindFilter(context, EM_TRUE) : 0;
+}
+
+// Called from GL.deleteContext() in library_webgl.js.
+void _emscripten_gl_state_filter_forget_context(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context)
+{
+  gl_state_filter *filter = FindFilter(context, EM_FALSE);
+  if (filter)
+  {
+    ForgetState(&filter->state);
+    memset(&filter->counts, 0, sizeof(filter->counts));
+    // The handle may be reused for a new context, which starts out unclaimed.
+    __atomic_store_n(&filter->thread, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&filter->shared, EM_FALSE, __ATOMIC_RELEASE);
+  }
+  if (current == filter)
+    current = 0;
+}
+
+static EM_BOOL Drop(gl_state_filter *filter, unsigned int *counter)
+{
+  ++*counter;
+  ++filter->counts.totalFiltered;
+  return EM_TRUE;
+}
+
+static EM_BOOL Pass(gl_state_filter *filter)
+{
+  ++filter->counts.totalPassed;
+  return EM_FALSE;
+}
+
+static int CapIndex(GLenum cap)
+{
+  switch (cap)
+  {
+    case GL_BLEND: return 0;
+    case GL_CULL_FACE: return 1;
+    case GL_DEPTH_TEST: return 2;
+    case GL_DITHER: return 3;
+    case GL_POLYGON_OFFSET_FILL: return 4;
+    case GL_SAMPLE_ALPHA_TO_COVERAGE: return 5;
+    case GL_SAMPLE_COVERAGE: return 6;
+    case GL_SCISSOR_TEST: return 7;
+    case GL_STENCIL_TEST: return 8;
+    case GL_RASTERIZER_DISCARD: return 9;
+    default: return -1;
+  }
+}
+
+static int TextureTargetIndex(GLenum target)
+{
+  switch (target)
+  {
+    case GL_TEXTURE_2D: return TEXTURE_2D;
+    case GL_TEXTURE_CUBE_MAP: return TEXTURE_CUBE_MAP;
+    case GL_TEXTURE_3D: return TEXTURE_3D;
+    case GL_TEXTURE_2D_ARRAY: return TEXTURE_2D_ARRAY;
+    default: return -1;
+  }
+}
+
+// GL_UNIFORM_BUFFER and GL_TRANSFORM_FEEDBACK_BUFFER are not tracked, since
+// glBindBufferBase/Range() also change their generic bindings.
+static int BufferTargetIndex(GLenum target)
+{
+  switch (target)
+  {
+    case GL_ARRAY_BUFFER: return ARRAY_BUFFER;
+#if TRACK_VERTEX_ARRAYS
+    case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_ARRAY_BUFFER;
+#endif
+    case GL_COPY_READ_BUFFER: return COPY_READ_BUFFER;
+    case GL_COPY_WRITE_BUFFER: return COPY_WRITE_BUFFER;
+    case GL_PIXEL_PACK_BUFFER: return PIXEL_PACK_BUFFER;
+    case GL_PIXEL_UNPACK_BUFFER: return PIXEL_UNPACK_BUFFER;
+    default: return -1;
+  }
+}
+
+EM_BOOL _emscripten_gl_filter_glActiveTexture(GLenum texture)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  if (f->state.activeTexture == texture)
+    return Drop(f, &f->counts.activeTexture);
+  f->state.activeTexture = texture;
+  return Pass(f);
+}
+
+EM_BOOL _emscripten_gl_filter_glBindBuffer(GLenum target, GLuint buffer)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  int index = BufferTargetIndex(target);
+  if (index < 0)
+    return Pass(f);
+  if (f->state.buffers[index] == buffer)
+    return Drop(f, &f->counts.bindBuffer);
+  f->state.buffers[index] = buffer;
+  return Pass(f);
+}
+
+EM_BOOL _emscripten_gl_filter_glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  switch (target)
+  {
+    case GL_FRAMEBUFFER:
+      if (f->state.drawFramebuffer == framebuffer && f->state.readFramebuffer == framebuffer)
+        return Drop(f, &f->counts.bindFramebuffer);
+      f->state.drawFramebuffer = f->state.readFramebuffer = framebuffer;
+      break;
+    case GL_DRAW_FRAMEBUFFER:
+      if (f->state.drawFramebuffer == framebuffer)
+        return Drop(f, &f->counts.bindFramebuffer);
+      f->state.drawFramebuffer = framebuffer;
+      break;
+    case GL_READ_FRAMEBUFFER:
+      if (f->state.readFramebuffer == framebuffer)
+        return Drop(f, &f->counts.bindFramebuffer);
+      f->state.readFramebuffer = framebuffer;
+      break;
+  }
+  return Pass(f);
+}
+
+EM_BOOL _emscripten_gl_filter_glBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  if (target != GL_RENDERBUFFER)
+    return Pass(f);
+  if (f->state.renderbuffer == renderbuffer)
+    return Drop(f, &f->counts.bindRenderbuffer);
+  f->state.renderbuffer = renderbuffer;
+  return Pass(f);
+}
+
+EM_BOOL _emscripten_gl_filter_glBindTexture(GLenum target, GLuint texture)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  unsigned int unit = f->state.activeTexture - GL_TEXTURE0;
+  int index = TextureTargetIndex(target);
+  if (unit >= MAX_TEXTURE_UNITS || index < 0)
+    return Pass(f);
+  if (f->state.textures[unit][index] == texture)
+    return Drop(f, &f->counts.bindTexture);
+  f->state.textures[unit][index] = texture;
+  return Pass(f);
+}
+
+EM_BOOL _emscripten_gl_filter_glBindVertexArray(GLuint array)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  if (f->state.vertexArray == array)
+    return Drop(f, &f->counts.bindVertexArray);
+  f->state.vertexArray = array;
+  f->state.buffers[ELEMENT_ARRAY_BUFFER] = UNKNOWN;
+  return Pass(f);
+}
+
+EM_BOOL _emscripten_gl_filter_glUseProgram(GLuint program)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  if (f->state.program == program)
+    return Drop(f, &f->counts.useProgram);
+  f->state.program = program;
+  return Pass(f);
+}
+
+static EM_BOOL SetCap(GLenum cap, EM_BOOL enable)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  int index = CapIndex(cap);
+  if (index < 0)
+    return Pass(f);
+  uint32_t bit = 1u << index;
+  if ((f->state.knownCaps & bit) && !!(f->state.enabledCaps & bit) == enable)
+    return Drop(f, enable ? &f->counts.enable : &f->counts.disable);
+  f->state.knownCaps |= bit;
+  if (enable)
+    f->state.enabledCaps |= bit;
+  else
+    f->state.enabledCaps &= ~bit;
+  return Pass(f);
+}
+
+EM_BOOL _emscripten_gl_filter_glEnable(GLenum cap)
+{
+  return SetCap(cap, EM_TRUE);
+}
+
+EM_BOOL _emscripten_gl_filter_glDisable(GLenum cap)
+{
+  return SetCap(cap, EM_FALSE);
+}
+
+// Deleting an object unbinds it from the current context. The delete calls are
+// never dropped, they only make us forget the bindings that they affect.
+
+EM_BOOL _emscripten_gl_filter_glDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f || !buffers) return EM_FALSE;
+  for (GLsizei i = 0; i < n; ++i)
+    for (int j = 0; j < NUM_BUFFER_TARGETS; ++j)
+      if (buffers[i] && f->state.buffers[j] == buffers[i])
+        f->state.buffers[j] = UNKNOWN;
+  return EM_FALSE;
+}
+
+EM_BOOL _emscripten_gl_filter_glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f || !framebuffers) return EM_FALSE;
+  for (GLsizei i = 0; i < n; ++i)
+  {
+    if (!framebuffers[i]) continue;
+    if (f->state.drawFramebuffer == framebuffers[i]) f->state.drawFramebuffer = UNKNOWN;
+    if (f->state.readFramebuffer == framebuffers[i]) f->state.readFramebuffer = UNKNOWN;
+  }
+  return EM_FALSE;
+}
+
+EM_BOOL _emscripten_gl_filter_glDeleteProgram(GLuint program)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f) return EM_FALSE;
+  if (program && f->state.program == program)
+    f->state.program = UNKNOWN;
+  return EM_FALSE;
+}
+
+EM_BOOL _emscripten_gl_filter_glDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f || !renderbuffers) return EM_FALSE;
+  for (GLsizei i = 0; i < n; ++i)
+    if (renderbuffers[i] && f->state.renderbuffer == renderbuffers[i])
+      f->state.renderbuffer = UNKNOWN;
+  return EM_FALSE;
+}
+
+EM_BOOL _emscripten_gl_filter_glDeleteTextures(GLsizei n, const GLuint *textures)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f || !textures) return EM_FALSE;
+  for (GLsizei i = 0; i < n; ++i)
+  {
+    if (!textures[i]) continue;
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+      for (int j = 0; j < NUM_TEXTURE_TARGETS; ++j)
+        if (f->state.textures[unit][j] == textures[i])
+          f->state.textures[unit][j] = UNKNOWN;
+  }
+  return EM_FALSE;
+}
+
+EM_BOOL _emscripten_gl_filter_glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+  gl_state_filter *f = CurrentFilter();
+  if (!f || !arrays) return EM_FALSE;
+  for (GLsizei i = 0; i < n; ++i)
+    if (arrays[i] && f->state.vertexArray == arrays[i])
+    {
+      f->state.vertexArray = UNKNOWN;
+      f->state.buffers[ELEMENT_ARRAY_BUFFER] = UNKNOWN;
+    }
+  return EM_FALSE;
+}
+
+EMSCRIPTEN_RESULT emscripten_webgl_get_filtered_call_counts(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, EmscriptenWebGLFilteredCallCounts *outCounts)
+{
+  if (!context || !outCounts) return EMSCRIPTEN_RESULT_INVALID_PARAM;
+  gl_state_filter *filter = FindFilter(context, EM_FALSE);
+  if (filter)
+    *outCounts = filter->counts;
+  else
+    memset(outCounts, 0, sizeof(*outCounts));
+  return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+EMSCRIPTEN_RESULT emscripten_webgl_reset_filtered_call_counts(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context)
+{
+  if (!context) return EMSCRIPTEN_RESULT_INVALID_PARAM;
+  gl_state_filter *filter = FindFilter(context, EM_FALSE);
+  if (filter)
+    memset(&filter->counts, 0, sizeof(filter->counts));
+  return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+#if GL_FUNCTIONS_IN_C
+
+// webgl1.c and webgl2.c already return their own entry points, which call into
+// the filter.
+void *_emscripten_gl_filter_get_proc_address(const char *name)
+{
+  return 0;
+}
+
+#else
+
+#define FILTERED_GL_FUNCTION_1(functionName, t0) \
+  GL_APICALL void GL_APIENTRY functionName(t0 p0) { if (!_emscripten_gl_filter_##functionName(p0)) emscripten_##functionName(p0); }
+#define FILTERED_GL_FUNCTION_2(functionName, t0, t1) \
+  GL_APICALL void GL_APIENTRY functionName(t0 p0, t1 p1) { if (!_emscripten_gl_filter_##functionName(p0, p1)) emscripten_##functionName(p0, p1); }
+
+FILTERED_GL_FUNCTION_1(glActiveTexture, GLenum);
+FILTERED_GL_FUNCTION_2(glBindBuffer, GLenum, GLuint);
+FILTERED_GL_FUNCTION_2(glBindFramebuffer, GLenum, GLuint);
+FILTERED_GL_FUNCTION_2(glBindRenderbuffer, GLenum, GLuint);
+FILTERED_GL_FUNCTION_2(glBindTexture, GLenum, GLuint);
+FILTERED_GL_FUNCTION_1(glBindVertexArray, GLuint);
+FILTERED_GL_FUNCTION_2(glDeleteBuffers, GLsizei, const GLuint *);
+FILTERED_GL_FUNCTION_2(glDeleteFramebuffers, GLsizei, const GLuint *);
+FILTERED_GL_FUNCTION_1(glDeleteProgram, GLuint);
+FILTERED_GL_FUNCTION_2(glDeleteRenderbuffers, GLsizei, const GLuint *);
+FILTERED_GL_FUNCTION_2(glDeleteTextures, GLsizei, const GLuint *);
+FILTERED_GL_FUNCTION_2(glDeleteVertexArrays, GLsizei, const GLuint *);
+FILTERED_GL_FUNCTION_1(glDisable, GLenum);
+FILTERED_GL_FUNCTION_1(glEnable, GLenum);
+FILTERED_GL_FUNCTION_1(glUseProgram, GLuint);
+
+// webgl2.c forwards the OES entry points to the ones above when it is built.
+#if !(MAX_WEBGL_VERSION >= 2 || defined(__EMSCRIPTEN_FULL_ES3__))
+GL_APICALL void GL_APIENTRY glBindVertexArrayOES(GLuint array) { if (!_emscripten_gl_filter_glBindVertexArray(array)) emscripten_glBindVertexArrayOES(array); }
+GL_APICALL void GL_APIENTRY glDeleteVertexArraysOES(GLsizei n, const GLuint *arrays) { _emscripten_gl_filter_glDeleteVertexArrays(n, arrays); emscripten_glDeleteVertexArraysOES(n, arrays); }
+#endif
+
+#define RETURN_FILTERED_FN(functionName) if (!strcmp(name, #functionName)) return functionName;
+
+// Without this, emscripten_GetProcAddress() and friends would hand out the
+// emscripten_gl* functions, which bypass the filter.
+void *_emscripten_gl_filter_get_proc_address(const char *name)
+{
+  RETURN_FILTERED_FN(glActiveTexture);
+  RETURN_FILTERED_FN(glBindBuffer);
+  RETURN_FILTERED_FN(glBindFramebuffer);
+  RETURN_FILTERED_FN(glBindRenderbuffer);
+  RETURN_FILTERED_FN(glBindTexture);
+  RETURN_FILTERED_FN(glBindVertexArray);
+  RETURN_FILTERED_FN(glBindVertexArrayOES);
+  RETURN_FILTERED_FN(glDeleteBuffers);
+  RETURN_FILTERED_FN(glDeleteFramebuffers);
+  RETURN_FILTERED_FN(glDeleteProgram);
+  RETURN_FILTERED_FN(glDeleteRenderbuffers);
+  RETURN_FILTERED_FN(glDeleteTextures);
+  RETURN_FILTERED_FN(glDeleteVertexArrays);
+  RETURN_FILTERED_FN(glDeleteVertexArraysOES);
+  RETURN_FILTERED_FN(glDisable);
+  RETURN_FILTERED_FN(glEnable);
+  RETURN_FILTERED_FN(glUseProgram);
+  return 0;
+}
+
+#endif // ~GL_FUNCTIONS_IN_C
+
+#else
+
+EMSCRIPTEN_RESULT emscripten_webgl_get_filtered_call_counts(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context, EmscriptenWebGLFilteredCallCounts *outCounts)
+{
+  return EMSCRIPTEN_RESULT_NOT_SUPPORTED;
+}
+
+EMSCRIPTEN_RESULT emscripten_webgl_reset_filtered_call_counts(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context)
+{
+  return EMSCRIPTEN_RESULT_NOT_SUPPORTED;
+}
+
+#endif // ~__EMSCRIPTEN_GL_STATE_FILTER__
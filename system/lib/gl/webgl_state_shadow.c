@@ -0,0 +1,839 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// Client-side shadow of GL context state for contexts that a pthread proxies to
+// the main thread (-s OFFSCREEN_FRAMEBUFFER_STATE_SHADOW).
+//
+// Every state query made from a pthread is a synchronous round trip to the main
+// thread. Much of the state that applications query (bindings, enable caps,
+// the viewport, uniform locations, whether an object exists) follows directly
+// from the calls the same thread made earlier, so we keep a copy of it here and
+// answer those queries locally.
+//
+// Each piece of state starts out unknown. It becomes known either when the
+// thread sets it, or when a query for it has been answered by the main thread.
+// Anything that could make the copy ambiguous (e.g. binding a name that we have
+// never seen generated) puts that piece back into the unknown state, so that
+// the next query goes to the main thread again.
+//
+// The shadow only sees calls made through the proxying entry points in this
+// directory. State changed by the main thread directly, or from JS, is not
+// tracked, so the shadow must not be used for contexts that are also rendered
+// to that way. With -s OFFSCREEN_FRAMEBUFFER_STATE_SHADOW=2 every query that is
+// answered locally is also sent to the main thread and the two results are
+// compared, which helps to find such cases.
+
+#include <emscripten.h>
+#include <emscripten/threading.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <webgl/webgl1.h>
+#include <webgl/webgl2.h>
+
+#if defined(__EMSCRIPTEN_PTHREADS__) && defined(__EMSCRIPTEN_OFFSCREEN_FRAMEBUFFER__) && defined(__EMSCRIPTEN_GL_STATE_SHADOW__)
+
+#define MAX_TEXTURE_UNITS 32
+// WebGL only guarantees this many combined texture units.
+#define MIN_TEXTURE_UNITS 8
+#define UNIFORM_LOCATION_BUCKETS 64
+
+// Bits of gl_state_shadow.known
+#define KNOWN_ACTIVE_TEXTURE         (1u << 0)
+#define KNOWN_ARRAY_BUFFER           (1u << 1)
+#define KNOWN_ELEMENT_ARRAY_BUFFER   (1u << 2)
+#define KNOWN_CURRENT_PROGRAM        (1u << 3)
+#define KNOWN_FRAMEBUFFER            (1u << 4)
+#define KNOWN_RENDERBUFFER           (1u << 5)
+#define KNOWN_VIEWPORT               (1u << 6)
+#define KNOWN_SCISSOR_BOX            (1u << 7)
+
+// What the shadow knows about an object name.
+enum
+{
+  OBJECT_UNKNOWN = 0,
+  OBJECT_GENERATED, // glGen* returned it, but it has not been bound yet, so glIs* is false.
+  OBJECT_CREATED,   // It has been bound, so glIs* is true.
+  OBJECT_DELETED
+};
+#define OBJECT_STATE_MASK 3
+
+// Buffers and textures can only ever be bound to the kind of target that they
+// were first bound to, which is kept in the bits above the state. Kind 0 means
+// that any target will do (framebuffers and renderbuffers), or, for an object
+// that we only know exists from glIs*, that its kind is unknown.
+#define OBJECT_KIND_SHIFT 2
+enum
+{
+  BUFFER_KIND_ELEMENT_ARRAY = 1,
+  BUFFER_KIND_OTHER // Any other target, which WebGL 2 lets such buffers switch between.
+};
+enum
+{
+  TEXTURE_KIND_2D = 1,
+  TEXTURE_KIND_CUBE_MAP,
+  TEXTURE_KIND_3D,
+  TEXTURE_KIND_2D_ARRAY
+};
+
+typedef struct object_names
+{
+  uint8_t *states;
+  GLuint size;
+} object_names;
+
+typedef struct uniform_location
+{
+  struct uniform_location *next;
+  GLuint program;
+  GLint location;
+  char name[];
+} uniform_location;
+
+typedef struct gl_state_shadow
+{
+  struct gl_state_shadow *next;
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context;
+
+  uint32_t known;
+  GLint activeTexture;
+  GLint arrayBuffer;
+  GLint elementArrayBuffer;
+  GLint currentProgram;
+  GLint framebuffer;
+  GLint renderbuffer;
+  GLint viewport[4];
+  GLint scissorBox[4];
+
+  uint32_t capsKnown;
+  uint32_t capsEnabled;
+
+  uint32_t texture2DKnown;
+  uint32_t textureCubeMapKnown;
+  GLint texture2D[MAX_TEXTURE_UNITS];
+  GLint textureCubeMap[MAX_TEXTURE_UNITS];
+
+  object_names buffers;
+  object_names textures;
+  object_names framebuffers;
+  object_names renderbuffers;
+
+  uniform_location *uniformLocations[UNIFORM_LOCATION_BUCKETS];
+} gl_state_shadow;
+
+static gl_state_shadow *shadows;
+static pthread_mutex_t shadowsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_key_t currentShadow;
+static pthread_once_t currentShadowInit = PTHREAD_ONCE_INIT;
+
+static void InitCurrentShadow()
+{
+  pthread_key_create(&currentShadow, NULL);
+}
+
+static gl_state_shadow *GetShadow()
+{
+  pthread_once(&currentShadowInit, InitCurrentShadow);
+  return (gl_state_shadow*)pthread_getspecific(currentShadow);
+}
+
+static void ForgetUniformLocations(gl_state_shadow *s, GLuint program, EM_BOOL allPrograms)
+{
+  for (int i = 0; i < UNIFORM_LOCATION_BUCKETS; ++i)
+  {
+    uniform_location **prev = &s->uniformLocations[i];
+    while (*prev)
+    {
+      uniform_location *u = *prev;
+      if (allPrograms || u->program == program)
+      {
+        *prev = u->next;
+        free(u);
+      }
+      else
+        prev = &u->next;
+    }
+  }
+}
+
+static void ResetShadow(gl_state_shadow *s)
+{
+  ForgetUniformLocations(s, 0, EM_TRUE);
+  free(s->buffers.states);
+  free(s->textures.states);
+  free(s->framebuffers.states);
+  free(s->renderbuffers.states);
+  gl_state_shadow *next = s->next;
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context = s->context;
+  memset(s, 0, sizeof(*s));
+  s->next = next;
+  s->context = context;
+}
+
+void _emscripten_gl_shadow_context_created(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context)
+{
+  // Context handles can be reused after a context has been destroyed, so
+  // forget anything we knew about an earlier context with the same handle.
+  pthread_mutex_lock(&shadowsLock);
+  for (gl_state_shadow *s = shadows; s; s = s->next)
+    if (s->context == context)
+      ResetShadow(s);
+  pthread_mutex_unlock(&shadowsLock);
+}
+
+void _emscripten_gl_shadow_make_current(EMSCRIPTEN_WEBGL_CONTEXT_HANDLE context)
+{
+  gl_state_shadow *s = 0;
+  if (context)
+  {
+    pthread_mutex_lock(&shadowsLock);
+    for (s = shadows; s && s->context != context; s = s->next)
+      ;
+    if (!s)
+    {
+      s = (gl_state_shadow*)calloc(1, sizeof(gl_state_shadow));
+      if (s)
+      {
+        s->context = context;
+        s->next = shadows;
+        shadows = s;
+      }
+    }
+    pthread_mutex_unlock(&shadowsLock);
+  }
+  pthread_once(&currentShadowInit, InitCurrentShadow);
+  pthread_setspecific(currentShadow, s);
+}
+
+// Object names
+
+static uint8_t GetObjectState(const object_names *names, GLuint name)
+{
+  return name < names->size ? names->states[name] & OBJECT_STATE_MASK : OBJECT_UNKNOWN;
+}
+
+static void SetObjectState(object_names *names, GLuint name, uint8_t state)
+{
+  if (name >= names->size)
+  {
+    if (state == OBJECT_UNKNOWN)
+      return;
+    GLuint size = names->size ? names->size : 64;
+    while (size <= name)
+      size *= 2;
+    uint8_t *states = (uint8_t*)realloc(names->states, size);
+    if (!states)
+      return; // Out of memory: the name simply stays unknown.
+    memset(states + names->size, OBJECT_UNKNOWN, size - names->size);
+    names->states = states;
+    names->size = size;
+  }
+  names->states[name] = state;
+}
+
+static void GeneratedObjects(object_names *names, GLsizei n, const GLuint *generated)
+{
+  for (GLsizei i = 0; i < n; ++i)
+    if (generated[i])
+      SetObjectState(names, generated[i], OBJECT_GENERATED);
+}
+
+// Returns true if binding name to a target of the given kind is known to
+// succeed, and records that the object now exists, with that kind. Binding an
+// object to a target of another kind fails with GL_INVALID_OPERATION, which we
+// cannot tell from a call that only failed in a way that we do not model, so
+// that is unknown too.
+static EM_BOOL BoundObject(object_names *names, GLuint name, uint8_t kind)
+{
+  if (!name)
+    return EM_TRUE;
+  switch (GetObjectState(names, name))
+  {
+    case OBJECT_GENERATED:
+      SetObjectState(names, name, OBJECT_CREATED | (kind << OBJECT_KIND_SHIFT));
+      return EM_TRUE;
+    case OBJECT_CREATED:
+      return (names->states[name] >> OBJECT_KIND_SHIFT) == kind;
+    default:
+      return EM_FALSE;
+  }
+}
+
+// Enable caps
+
+static int CapIndex(GLenum cap)
+{
+  switch (cap)
+  {
+    case GL_BLEND: return 0;
+    case GL_CULL_FACE: return 1;
+    case GL_DEPTH_TEST: return 2;
+    case GL_DITHER: return 3;
+    case GL_POLYGON_OFFSET_FILL: return 4;
+    case GL_SAMPLE_ALPHA_TO_COVERAGE: return 5;
+    case GL_SAMPLE_COVERAGE: return 6;
+    case GL_SCISSOR_TEST: return 7;
+    case GL_STENCIL_TEST: return 8;
+    default: return -1;
+  }
+}
+
+static void SetCap(GLenum cap, EM_BOOL enabled)
+{
+  gl_state_shadow *s = GetShadow();
+  int i = CapIndex(cap);
+  if (!s || i < 0)
+    return;
+  s->capsKnown |= 1u << i;
+  if (enabled)
+    s->capsEnabled |= 1u << i;
+  else
+    s->capsEnabled &= ~(1u << i);
+}
+
+// Calls that change shadowed state. These run on the calling thread before (or,
+// for synchronous calls, right after) the call is proxied to the main thread.
+
+void _emscripten_gl_shadow_glActiveTexture(GLenum texture)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  // Units past GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS raise GL_INVALID_ENUM and
+  // leave the active unit as it was. We do not know that limit here, so only
+  // remember units that every implementation has.
+  if (texture >= GL_TEXTURE0 && texture < GL_TEXTURE0 + MIN_TEXTURE_UNITS)
+  {
+    s->known |= KNOWN_ACTIVE_TEXTURE;
+    s->activeTexture = texture;
+  }
+  else
+    s->known &= ~KNOWN_ACTIVE_TEXTURE;
+}
+
+void _emscripten_gl_shadow_glBindBuffer(GLenum target, GLuint buffer)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  uint32_t bit = 0;
+  GLint *binding = 0;
+  switch (target)
+  {
+    case GL_ARRAY_BUFFER: bit = KNOWN_ARRAY_BUFFER; binding = &s->arrayBuffer; break;
+    case GL_ELEMENT_ARRAY_BUFFER: bit = KNOWN_ELEMENT_ARRAY_BUFFER; binding = &s->elementArrayBuffer; break;
+  }
+  // The other (WebGL 2) targets are not shadowed, but binding to them still
+  // fixes the kind of the buffer.
+  uint8_t kind = target == GL_ELEMENT_ARRAY_BUFFER ? BUFFER_KIND_ELEMENT_ARRAY : BUFFER_KIND_OTHER;
+  EM_BOOL bound = BoundObject(&s->buffers, buffer, kind);
+  if (!binding)
+    return;
+  if (bound)
+  {
+    s->known |= bit;
+    *binding = buffer;
+  }
+  else
+    s->known &= ~bit;
+}
+
+void _emscripten_gl_shadow_glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  // GL_FRAMEBUFFER_BINDING is the draw framebuffer binding in WebGL 2.
+  if (target != GL_FRAMEBUFFER && target != GL_DRAW_FRAMEBUFFER)
+    return;
+  // Binding 0 selects the offscreen framebuffer, which is not a name that
+  // this thread can see, so leave that to the main thread.
+  if (framebuffer && BoundObject(&s->framebuffers, framebuffer, 0))
+  {
+    s->known |= KNOWN_FRAMEBUFFER;
+    s->framebuffer = framebuffer;
+  }
+  else
+    s->known &= ~KNOWN_FRAMEBUFFER;
+}
+
+void _emscripten_gl_shadow_glBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s || target != GL_RENDERBUFFER)
+    return;
+  if (BoundObject(&s->renderbuffers, renderbuffer, 0))
+  {
+    s->known |= KNOWN_RENDERBUFFER;
+    s->renderbuffer = renderbuffer;
+  }
+  else
+    s->known &= ~KNOWN_RENDERBUFFER;
+}
+
+void _emscripten_gl_shadow_glBindTexture(GLenum target, GLuint texture)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  uint32_t *knownUnits = 0;
+  GLint *bindings = 0;
+  uint8_t kind;
+  switch (target)
+  {
+    case GL_TEXTURE_2D: knownUnits = &s->texture2DKnown; bindings = s->texture2D; kind = TEXTURE_KIND_2D; break;
+    case GL_TEXTURE_CUBE_MAP: knownUnits = &s->textureCubeMapKnown; bindings = s->textureCubeMap; kind = TEXTURE_KIND_CUBE_MAP; break;
+    // Not shadowed, but binding to them fixes the target of the texture.
+    case GL_TEXTURE_3D: kind = TEXTURE_KIND_3D; break;
+    case GL_TEXTURE_2D_ARRAY: kind = TEXTURE_KIND_2D_ARRAY; break;
+    default: return;
+  }
+  EM_BOOL bound = BoundObject(&s->textures, texture, kind);
+  if (!knownUnits)
+    return;
+  if (!(s->known & KNOWN_ACTIVE_TEXTURE))
+  {
+    // We do not know which unit this went to.
+    *knownUnits = 0;
+    return;
+  }
+  int unit = s->activeTexture - GL_TEXTURE0;
+  if (bound)
+  {
+    *knownUnits |= 1u << unit;
+    bindings[unit] = texture;
+  }
+  else
+    *knownUnits &= ~(1u << unit);
+}
+
+void _emscripten_gl_shadow_glBindVertexArray(GLuint array)
+{
+  gl_state_shadow *s = GetShadow();
+  // The element array buffer binding is part of the vertex array object.
+  if (s)
+    s->known &= ~KNOWN_ELEMENT_ARRAY_BUFFER;
+}
+
+void _emscripten_gl_shadow_glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+  // Deleting the bound vertex array object reverts to the default one.
+  _emscripten_gl_shadow_glBindVertexArray(0);
+}
+
+void _emscripten_gl_shadow_glDisable(GLenum cap)
+{
+  SetCap(cap, EM_FALSE);
+}
+
+void _emscripten_gl_shadow_glEnable(GLenum cap)
+{
+  SetCap(cap, EM_TRUE);
+}
+
+void _emscripten_gl_shadow_glGenBuffers(GLsizei n, GLuint *buffers)
+{
+  gl_state_shadow *s = GetShadow();
+  if (s)
+    GeneratedObjects(&s->buffers, n, buffers);
+}
+
+void _emscripten_gl_shadow_glGenFramebuffers(GLsizei n, GLuint *framebuffers)
+{
+  gl_state_shadow *s = GetShadow();
+  if (s)
+    GeneratedObjects(&s->framebuffers, n, framebuffers);
+}
+
+void _emscripten_gl_shadow_glGenRenderbuffers(GLsizei n, GLuint *renderbuffers)
+{
+  gl_state_shadow *s = GetShadow();
+  if (s)
+    GeneratedObjects(&s->renderbuffers, n, renderbuffers);
+}
+
+void _emscripten_gl_shadow_glGenTextures(GLsizei n, GLuint *textures)
+{
+  gl_state_shadow *s = GetShadow();
+  if (s)
+    GeneratedObjects(&s->textures, n, textures);
+}
+
+// Deleting an object that is bound to the current context also unbinds it.
+
+void _emscripten_gl_shadow_glDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  for (GLsizei i = 0; i < n; ++i)
+  {
+    if (!buffers[i])
+      continue;
+    SetObjectState(&s->buffers, buffers[i], OBJECT_DELETED);
+    if (s->arrayBuffer == buffers[i]) s->arrayBuffer = 0;
+    if (s->elementArrayBuffer == buffers[i]) s->elementArrayBuffer = 0;
+  }
+}
+
+void _emscripten_gl_shadow_glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  for (GLsizei i = 0; i < n; ++i)
+  {
+    if (!framebuffers[i])
+      continue;
+    SetObjectState(&s->framebuffers, framebuffers[i], OBJECT_DELETED);
+    // This falls back to the offscreen framebuffer, see glBindFramebuffer above.
+    if (s->framebuffer == framebuffers[i]) s->known &= ~KNOWN_FRAMEBUFFER;
+  }
+}
+
+void _emscripten_gl_shadow_glDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  for (GLsizei i = 0; i < n; ++i)
+  {
+    if (!renderbuffers[i])
+      continue;
+    SetObjectState(&s->renderbuffers, renderbuffers[i], OBJECT_DELETED);
+    if (s->renderbuffer == renderbuffers[i]) s->renderbuffer = 0;
+  }
+}
+
+void _emscripten_gl_shadow_glDeleteTextures(GLsizei n, const GLuint *textures)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  for (GLsizei i = 0; i < n; ++i)
+  {
+    if (!textures[i])
+      continue;
+    SetObjectState(&s->textures, textures[i], OBJECT_DELETED);
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+    {
+      if (s->texture2D[unit] == textures[i]) s->texture2D[unit] = 0;
+      if (s->textureCubeMap[unit] == textures[i]) s->textureCubeMap[unit] = 0;
+    }
+  }
+}
+
+void _emscripten_gl_shadow_glDeleteProgram(GLuint program)
+{
+  gl_state_shadow *s = GetShadow();
+  if (s && program)
+    ForgetUniformLocations(s, program, EM_FALSE);
+}
+
+void _emscripten_gl_shadow_glLinkProgram(GLuint program)
+{
+  // Uniform locations are only valid until the program is linked again.
+  _emscripten_gl_shadow_glDeleteProgram(program);
+}
+
+void _emscripten_gl_shadow_glUseProgram(GLuint program)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  // A failed glUseProgram() leaves the current program in place, and whether
+  // it fails depends on the link status, so only trust unbinding.
+  if (!program)
+  {
+    s->known |= KNOWN_CURRENT_PROGRAM;
+    s->currentProgram = 0;
+  }
+  else
+    s->known &= ~KNOWN_CURRENT_PROGRAM;
+}
+
+static void SetRect(GLint *rect, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  rect[0] = x;
+  rect[1] = y;
+  rect[2] = width;
+  rect[3] = height;
+}
+
+void _emscripten_gl_shadow_glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  if (width >= 0 && height >= 0)
+  {
+    s->known |= KNOWN_SCISSOR_BOX;
+    SetRect(s->scissorBox, x, y, width, height);
+  }
+}
+
+void _emscripten_gl_shadow_glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s)
+    return;
+  // The implementation clamps the size to GL_MAX_VIEWPORT_DIMS, which we do
+  // not know here, so only remember sizes that are small enough for any GPU.
+  if (width >= 0 && height >= 0 && width <= 4096 && height <= 4096)
+  {
+    s->known |= KNOWN_VIEWPORT;
+    SetRect(s->viewport, x, y, width, height);
+  }
+  else
+    s->known &= ~KNOWN_VIEWPORT;
+}
+
+// Queries. These either answer from the shadow, or ask the main thread and
+// remember the answer.
+
+#if __EMSCRIPTEN_GL_STATE_SHADOW__ >= 2
+#define CROSS_CHECK 1
+#else
+#define CROSS_CHECK 0
+#endif
+
+static void ReportMismatch(const char *function, GLenum pname, GLint shadowValue, GLint realValue)
+{
+  emscripten_log(EM_LOG_ERROR | EM_LOG_C_STACK, "GL state shadow mismatch in %s(0x%x): shadow has %d, but the context has %d", function, pname, shadowValue, realValue);
+}
+
+// Looks up an integer state value in the shadow. Returns the number of values
+// written to data, or 0 if the shadow cannot answer.
+static int GetShadowedIntegers(gl_state_shadow *s, GLenum pname, GLint *data)
+{
+  int cap = CapIndex(pname);
+  if (cap >= 0)
+  {
+    if (!(s->capsKnown & (1u << cap)))
+      return 0;
+    data[0] = (s->capsEnabled >> cap) & 1;
+    return 1;
+  }
+
+  uint32_t bit;
+  const GLint *value;
+  int count = 1;
+  switch (pname)
+  {
+    case GL_ACTIVE_TEXTURE: bit = KNOWN_ACTIVE_TEXTURE; value = &s->activeTexture; break;
+    case GL_ARRAY_BUFFER_BINDING: bit = KNOWN_ARRAY_BUFFER; value = &s->arrayBuffer; break;
+    case GL_ELEMENT_ARRAY_BUFFER_BINDING: bit = KNOWN_ELEMENT_ARRAY_BUFFER; value = &s->elementArrayBuffer; break;
+    case GL_CURRENT_PROGRAM: bit = KNOWN_CURRENT_PROGRAM; value = &s->currentProgram; break;
+    case GL_FRAMEBUFFER_BINDING: bit = KNOWN_FRAMEBUFFER; value = &s->framebuffer; break;
+    case GL_RENDERBUFFER_BINDING: bit = KNOWN_RENDERBUFFER; value = &s->renderbuffer; break;
+    case GL_VIEWPORT: bit = KNOWN_VIEWPORT; value = s->viewport; count = 4; break;
+    case GL_SCISSOR_BOX: bit = KNOWN_SCISSOR_BOX; value = s->scissorBox; count = 4; break;
+    case GL_TEXTURE_BINDING_2D:
+    case GL_TEXTURE_BINDING_CUBE_MAP:
+    {
+      if (!(s->known & KNOWN_ACTIVE_TEXTURE))
+        return 0;
+      int unit = s->activeTexture - GL_TEXTURE0;
+      uint32_t knownUnits = pname == GL_TEXTURE_BINDING_2D ? s->texture2DKnown : s->textureCubeMapKnown;
+      if (!(knownUnits & (1u << unit)))
+        return 0;
+      data[0] = pname == GL_TEXTURE_BINDING_2D ? s->texture2D[unit] : s->textureCubeMap[unit];
+      return 1;
+    }
+    default: return 0;
+  }
+  if (!(s->known & bit))
+    return 0;
+  memcpy(data, value, count * sizeof(GLint));
+  return count;
+}
+
+// Stores an integer state value that the main thread returned for pname.
+static void LearnIntegers(gl_state_shadow *s, GLenum pname, const GLint *data)
+{
+  int cap = CapIndex(pname);
+  if (cap >= 0)
+  {
+    s->capsKnown |= 1u << cap;
+    if (data[0])
+      s->capsEnabled |= 1u << cap;
+    else
+      s->capsEnabled &= ~(1u << cap);
+    return;
+  }
+  switch (pname)
+  {
+    case GL_ACTIVE_TEXTURE:
+      if (data[0] >= GL_TEXTURE0 && data[0] < GL_TEXTURE0 + MAX_TEXTURE_UNITS)
+      {
+        s->known |= KNOWN_ACTIVE_TEXTURE;
+        s->activeTexture = data[0];
+      }
+      break;
+    case GL_ARRAY_BUFFER_BINDING: s->known |= KNOWN_ARRAY_BUFFER; s->arrayBuffer = data[0]; break;
+    case GL_ELEMENT_ARRAY_BUFFER_BINDING: s->known |= KNOWN_ELEMENT_ARRAY_BUFFER; s->elementArrayBuffer = data[0]; break;
+    case GL_CURRENT_PROGRAM: s->known |= KNOWN_CURRENT_PROGRAM; s->currentProgram = data[0]; break;
+    case GL_FRAMEBUFFER_BINDING: s->known |= KNOWN_FRAMEBUFFER; s->framebuffer = data[0]; break;
+    case GL_RENDERBUFFER_BINDING: s->known |= KNOWN_RENDERBUFFER; s->renderbuffer = data[0]; break;
+    case GL_VIEWPORT: s->known |= KNOWN_VIEWPORT; memcpy(s->viewport, data, 4 * sizeof(GLint)); break;
+    case GL_SCISSOR_BOX: s->known |= KNOWN_SCISSOR_BOX; memcpy(s->scissorBox, data, 4 * sizeof(GLint)); break;
+    case GL_TEXTURE_BINDING_2D:
+    case GL_TEXTURE_BINDING_CUBE_MAP:
+      if (s->known & KNOWN_ACTIVE_TEXTURE)
+      {
+        int unit = s->activeTexture - GL_TEXTURE0;
+        if (pname == GL_TEXTURE_BINDING_2D)
+        {
+          s->texture2DKnown |= 1u << unit;
+          s->texture2D[unit] = data[0];
+        }
+        else
+        {
+          s->textureCubeMapKnown |= 1u << unit;
+          s->textureCubeMap[unit] = data[0];
+        }
+      }
+      break;
+  }
+}
+
+static void QueryIntegers(GLenum pname, GLint *data)
+{
+  GL_PROXY_BARRIER();
+  emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_VII, &emscripten_glGetIntegerv, pname, data);
+}
+
+void _emscripten_gl_shadow_glGetIntegerv(GLenum pname, GLint *data)
+{
+  gl_state_shadow *s = GetShadow();
+  GLint shadowed[4];
+  int count = s ? GetShadowedIntegers(s, pname, shadowed) : 0;
+  if (count && !CROSS_CHECK)
+  {
+    memcpy(data, shadowed, count * sizeof(GLint));
+    return;
+  }
+  QueryIntegers(pname, data);
+  for (int i = 0; i < count; ++i)
+    if (shadowed[i] != data[i])
+      ReportMismatch("glGetIntegerv", pname, shadowed[i], data[i]);
+  if (s)
+    LearnIntegers(s, pname, data);
+}
+
+void _emscripten_gl_shadow_glGetBooleanv(GLenum pname, GLboolean *data)
+{
+  gl_state_shadow *s = GetShadow();
+  // Only the enable caps are answered from the shadow, other values have to
+  // be converted to booleans by the implementation.
+  if (!s || CapIndex(pname) < 0)
+  {
+    GL_PROXY_BARRIER();
+    emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_VII, &emscripten_glGetBooleanv, pname, data);
+    return;
+  }
+  GLint value;
+  _emscripten_gl_shadow_glGetIntegerv(pname, &value);
+  data[0] = value ? GL_TRUE : GL_FALSE;
+}
+
+GLboolean _emscripten_gl_shadow_glIsEnabled(GLenum cap)
+{
+  gl_state_shadow *s = GetShadow();
+  if (!s || CapIndex(cap) < 0)
+  {
+    GL_PROXY_BARRIER();
+    return (GLboolean)emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_II, &emscripten_glIsEnabled, cap);
+  }
+  GLint value;
+  _emscripten_gl_shadow_glGetIntegerv(cap, &value);
+  return value ? GL_TRUE : GL_FALSE;
+}
+
+static GLboolean IsObject(object_names *names, GLuint name, const char *function, GLboolean (*isObject)(GLuint))
+{
+  uint8_t state = name ? GetObjectState(names, name) : OBJECT_DELETED;
+  if (state != OBJECT_UNKNOWN && !CROSS_CHECK)
+    return state == OBJECT_CREATED;
+  GL_PROXY_BARRIER();
+  GLboolean result = (GLboolean)emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_II, isObject, name);
+  if (state != OBJECT_UNKNOWN && (state == OBJECT_CREATED) != (result != GL_FALSE))
+    ReportMismatch(function, name, state == OBJECT_CREATED, result);
+  // A name that is not an object could still be one that was generated but
+  // not bound yet, so only a positive answer tells us something. (The target
+  // the object was bound to stays unknown.)
+  if (result && state != OBJECT_CREATED)
+    SetObjectState(names, name, OBJECT_CREATED);
+  return result;
+}
+
+#define IS_OBJECT_FUNCTION(functionName, field) \
+  GLboolean _emscripten_gl_shadow_##functionName(GLuint name) \
+  { \
+    gl_state_shadow *s = GetShadow(); \
+    if (s) \
+      return IsObject(&s->field, name, #functionName, &emscripten_##functionName); \
+    GL_PROXY_BARRIER(); \
+    return (GLboolean)emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_II, &emscripten_##functionName, name); \
+  }
+
+IS_OBJECT_FUNCTION(glIsBuffer, buffers)
+IS_OBJECT_FUNCTION(glIsFramebuffer, framebuffers)
+IS_OBJECT_FUNCTION(glIsRenderbuffer, renderbuffers)
+IS_OBJECT_FUNCTION(glIsTexture, textures)
+
+static uint32_t HashUniformName(GLuint program, const GLchar *name)
+{
+  // FNV-1a
+  uint32_t hash = 2166136261u ^ program;
+  for (const GLchar *c = name; *c; ++c)
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  return hash;
+}
+
+GLint _emscripten_gl_shadow_glGetUniformLocation(GLuint program, const GLchar *name)
+{
+  gl_state_shadow *s = GetShadow();
+  uint32_t bucket = HashUniformName(program, name) % UNIFORM_LOCATION_BUCKETS;
+  uniform_location *cached = 0;
+  if (s)
+    for (cached = s->uniformLocations[bucket]; cached; cached = cached->next)
+      if (cached->program == program && !strcmp(cached->name, name))
+        break;
+  if (cached && !CROSS_CHECK)
+    return cached->location;
+
+  GL_PROXY_BARRIER();
+  GLint location = (GLint)emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_III, &emscripten_glGetUniformLocation, program, name);
+  if (cached)
+  {
+    if (cached->location != location)
+    {
+      ReportMismatch("glGetUniformLocation", program, cached->location, location);
+      cached->location = location;
+    }
+  }
+  else if (s && program)
+  {
+    size_t len = strlen(name);
+    uniform_location *u = (uniform_location*)malloc(sizeof(uniform_location) + len + 1);
+    if (u)
+    {
+      u->program = program;
+      u->location = location;
+      memcpy(u->name, name, len + 1);
+      u->next = s->uniformLocations[bucket];
+      s->uniformLocations[bucket] = u;
+    }
+  }
+  return location;
+}
+
+#endif
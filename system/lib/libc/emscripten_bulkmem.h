@@ -0,0 +1,70 @@
+/*
+ * Small-size paths shared by the bulk memory versions of memcpy, memmove and
+ * memset (built with -mbulk-memory).
+ *
+ * memory.copy and memory.fill have a fixed cost per call in current engines
+ * (bounds checks, and for memory.copy an overlap check), so sizes up to
+ * BULKMEM_INLINE_MAX are handled with a few possibly-overlapping unaligned
+ * loads and stores instead. All loads happen before any store, which keeps
+ * the copy correct for overlapping buffers too.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BULKMEM_INLINE_MAX 32
+
+typedef uint64_t __attribute__((__may_alias__, __aligned__(1))) bulkmem_u64;
+typedef uint32_t __attribute__((__may_alias__, __aligned__(1))) bulkmem_u32;
+
+static inline __attribute__((always_inline))
+void bulkmem_small_copy(unsigned char *d, const unsigned char *s, size_t n)
+{
+  if (n >= 16) {
+    uint64_t a = *(const bulkmem_u64 *)s;
+    uint64_t b = *(const bulkmem_u64 *)(s + 8);
+    uint64_t c = *(const bulkmem_u64 *)(s + n - 16);
+    uint64_t e = *(const bulkmem_u64 *)(s + n - 8);
+    *(bulkmem_u64 *)d = a;
+    *(bulkmem_u64 *)(d + 8) = b;
+    *(bulkmem_u64 *)(d + n - 16) = c;
+    *(bulkmem_u64 *)(d + n - 8) = e;
+  } else if (n >= 8) {
+    uint64_t a = *(const bulkmem_u64 *)s;
+    uint64_t b = *(const bulkmem_u64 *)(s + n - 8);
+    *(bulkmem_u64 *)d = a;
+    *(bulkmem_u64 *)(d + n - 8) = b;
+  } else if (n >= 4) {
+    uint32_t a = *(const bulkmem_u32 *)s;
+    uint32_t b = *(const bulkmem_u32 *)(s + n - 4);
+    *(bulkmem_u32 *)d = a;
+    *(bulkmem_u32 *)(d + n - 4) = b;
+  } else if (n) {
+    unsigned char a = s[0], b = s[n / 2], c = s[n - 1];
+    d[0] = a;
+    d[n / 2] = b;
+    d[n - 1] = c;
+  }
+}
+
+static inline __attribute__((always_inline))
+void bulkmem_small_fill(unsigned char *d, unsigned char c, size_t n)
+{
+  uint64_t v = 0x0101010101010101ull * c;
+  if (n >= 16) {
+    *(bulkmem_u64 *)d = v;
+    *(bulkmem_u64 *)(d + 8) = v;
+    *(bulkmem_u64 *)(d + n - 16) = v;
+    *(bulkmem_u64 *)(d + n - 8) = v;
+  } else if (n >= 8) {
+    *(bulkmem_u64 *)d = v;
+    *(bulkmem_u64 *)(d + n - 8) = v;
+  } else if (n >= 4) {
+    *(bulkmem_u32 *)d = (uint32_t)v;
+    *(bulkmem_u32 *)(d + n - 4) = (uint32_t)v;
+  } else if (n) {
+    d[0] = c;
+    d[n / 2] = c;
+    d[n - 1] = c;
+  }
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// Math functions over arrays, see emscripten/math_batch.h.
+
+#include <emscripten/math_batch.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __wasm_simd128__
+
+#include <wasm_simd128.h>
+
+#define F32(x) wasm_f32x4_splat(x)
+#define I32(x) wasm_i32x4_splat(x)
+
+// Adding and then subtracting this rounds a float of magnitude below 2^22 to
+// the nearest integer, which is also left in the low bits of the sum.
+#define ROUND_MAGIC 0x1.8p23f
+
+// Each kernel evaluates four values and sets *special to all ones in the lanes
+// it cannot handle, which are then recomputed with the scalar function.
+
+// pi/2 in three parts. The first two have at most 12 significant bits, so
+// multiplying them by a quadrant number of up to 2^12 is exact.
+#define PIO2_1 0x1.922p+0f
+#define PIO2_2 -0x1.2aep-18f
+#define PIO2_3 -0x1.de973ep-31f
+#define SINCOS_MAX 6433.0f
+
+// Coefficients from Cephes, for |r| <= pi/4.
+#define S1 -1.6666654611e-1f
+#define S2 8.3321608736e-3f
+#define S3 -1.9515295891e-4f
+#define C1 4.166664568298827e-2f
+#define C2 -1.388731625493765e-3f
+#define C3 2.443315711809948e-5f
+
+static inline v128_t sincos_kernel(v128_t x, int quadrant_offset, v128_t *special) {
+  *special = wasm_v128_not(wasm_f32x4_le(wasm_f32x4_abs(x), F32(SINCOS_MAX)));
+  // x = j * pi/2 + r, with |r| <= pi/4.
+  v128_t t = wasm_f32x4_add(wasm_f32x4_mul(x, F32(0x1.45f306p-1f)), F32(ROUND_MAGIC));
+  v128_t j = wasm_f32x4_sub(t, F32(ROUND_MAGIC));
+  v128_t r = wasm_f32x4_sub(x, wasm_f32x4_mul(j, F32(PIO2_1)));
+  r = wasm_f32x4_sub(r, wasm_f32x4_mul(j, F32(PIO2_2)));
+  r = wasm_f32x4_sub(r, wasm_f32x4_mul(j, F32(PIO2_3)));
+  v128_t z = wasm_f32x4_mul(r, r);
+  v128_t s = wasm_f32x4_add(F32(S2), wasm_f32x4_mul(z, F32(S3)));
+  s = wasm_f32x4_add(F32(S1), wasm_f32x4_mul(z, s));
+  s = wasm_f32x4_add(r, wasm_f32x4_mul(wasm_f32x4_mul(r, z), s));
+  v128_t c = wasm_f32x4_add(F32(C2), wasm_f32x4_mul(z, F32(C3)));
+  c = wasm_f32x4_add(F32(C1), wasm_f32x4_mul(z, c));
+  c = wasm_f32x4_add(wasm_f32x4_sub(F32(1.0f), wasm_f32x4_mul(z, F32(0.5f))),
+                     wasm_f32x4_mul(wasm_f32x4_mul(z, z), c));
+  // cos(x) = sin(x + pi/2), so cosf just starts one quadrant later. Odd
+  // quadrants use the cosine polynomial, and quadrants 2 and 3 are negated.
+  v128_t q = wasm_i32x4_add(wasm_i32x4_sub(t, F32(ROUND_MAGIC)), I32(quadrant_offset));
+  v128_t use_cos = wasm_i32x4_eq(wasm_v128_and(q, I32(1)), I32(1));
+  v128_t sign = wasm_i32x4_shl(wasm_v128_and(q, I32(2)), 30);
+  return wasm_v128_xor(wasm_v128_bitselect(c, s, use_cos), sign);
+}
+
+static inline v128_t sin_kernel(v128_t x, v128_t *special) {
+  return sincos_kernel(x, 0, special);
+}
+
+static inline v128_t cos_kernel(v128_t x, v128_t *special) {
+  return sincos_kernel(x, 1, special);
+}
+
+// ln(2) split so that k * LN2_HI is exact for |k| < 2^8.
+#define LN2_HI 0x1.62e4p-1f
+#define LN2_LO 0x1.7f7d1cp-20f
+
+static inline v128_t exp_kernel(v128_t x, v128_t *special) {
+  *special = wasm_v128_not(wasm_v128_and(wasm_f32x4_ge(x, F32(-87.3f)),
+                                         wasm_f32x4_le(x, F32(88.3f))));
+  // x = k * ln(2) + r, with |r| <= ln(2)/2.
+  v128_t t = wasm_f32x4_add(wasm_f32x4_mul(x, F32(0x1.715476p+0f)), F32(ROUND_MAGIC));
+  v128_t k = wasm_f32x4_sub(t, F32(ROUND_MAGIC));
+  v128_t r = wasm_f32x4_sub(x, wasm_f32x4_mul(k, F32(LN2_HI)));
+  r = wasm_f32x4_sub(r, wasm_f32x4_mul(k, F32(LN2_LO)));
+  // Taylor series to r^7.
+  v128_t p = wasm_f32x4_add(F32(1.0f / 720), wasm_f32x4_mul(r, F32(1.0f / 5040)));
+  p = wasm_f32x4_add(F32(1.0f / 120), wasm_f32x4_mul(r, p));
+  p = wasm_f32x4_add(F32(1.0f / 24), wasm_f32x4_mul(r, p));
+  p = wasm_f32x4_add(F32(1.0f / 6), wasm_f32x4_mul(r, p));
+  p = wasm_f32x4_add(F32(0.5f), wasm_f32x4_mul(r, p));
+  p = wasm_f32x4_add(r, wasm_f32x4_mul(wasm_f32x4_mul(r, r), p));
+  p = wasm_f32x4_add(F32(1.0f), p);
+  // Multiply by 2^k by adding k to the exponent.
+  v128_t scale = wasm_i32x4_shl(wasm_i32x4_sub(t, F32(ROUND_MAGIC)), 23);
+  return wasm_i32x4_add(p, scale);
+}
+
+// Splits positive normal x into 2^k * m, with sqrt(2)/2 <= m < sqrt(2), and
+// returns m - 1, which is exact. Like musl's logf.
+static inline v128_t log_reduce(v128_t x, v128_t *k) {
+  v128_t ix = wasm_i32x4_sub(x, I32(0x3f3504f3));
+  *k = wasm_i32x4_shr(ix, 23);
+  v128_t m = wasm_i32x4_add(wasm_v128_and(ix, I32(0x007fffff)), I32(0x3f3504f3));
+  return wasm_f32x4_sub(m, F32(1.0f));
+}
+
+static inline v128_t is_positive_normal(v128_t x) {
+  // Zero and subnormals wrap around to large unsigned values, and negative
+  // numbers, infinity and NaN are already beyond 0x7f000000.
+  return wasm_u32x4_lt(wasm_i32x4_sub(x, I32(0x00800000)), I32(0x7f000000));
+}
+
+// Coefficients from musl's logf.
+#define LG1 0xaaaaaa.0p-24f
+#define LG2 0xccce13.0p-25f
+#define LG3 0x91e9ee.0p-25f
+#define LG4 0xf89e26.0p-26f
+
+static inline v128_t log_kernel(v128_t x, v128_t *special) {
+  *special = wasm_v128_not(is_positive_normal(x));
+  v128_t k;
+  v128_t f = log_reduce(x, &k);
+  v128_t s = wasm_f32x4_div(f, wasm_f32x4_add(F32(2.0f), f));
+  v128_t z = wasm_f32x4_mul(s, s);
+  v128_t w = wasm_f32x4_mul(z, z);
+  v128_t t1 = wasm_f32x4_mul(w, wasm_f32x4_add(F32(LG2), wasm_f32x4_mul(w, F32(LG4))));
+  v128_t t2 = wasm_f32x4_mul(z, wasm_f32x4_add(F32(LG1), wasm_f32x4_mul(w, F32(LG3))));
+  v128_t hfsq = wasm_f32x4_mul(F32(0.5f), wasm_f32x4_mul(f, f));
+  v128_t dk = wasm_f32x4_convert_i32x4(k);
+  v128_t res = wasm_f32x4_mul(s, wasm_f32x4_add(hfsq, wasm_f32x4_add(t2, t1)));
+  res = wasm_f32x4_add(res, wasm_f32x4_mul(dk, F32(9.0580006145e-06f)));
+  res = wasm_f32x4_sub(res, hfsq);
+  res = wasm_f32x4_add(res, f);
+  return wasm_f32x4_add(res, wasm_f32x4_mul(dk, F32(6.9313812256e-01f)));
+}
+
+static inline v128_t sqrt_kernel(v128_t x, v128_t *special) {
+  *special = I32(0);
+  return wasm_f32x4_sqrt(x);
+}
+
+#define F64(x) wasm_f64x2_splat(x)
+
+// Returns exp(y * log(2^k * (1 + f))) for two lanes, in double precision, and
+// sets the lanes of *special where |y * log(x)| is too large.
+static inline v128_t pow_f64x2(v128_t k, v128_t f, v128_t y, v128_t *special) {
+  // log(1 + f) = 2 atanh(s), with s = f / (2 + f) and |s| < 0.172.
+  v128_t s = wasm_f64x2_div(f, wasm_f64x2_add(F64(2.0), f));
+  v128_t z = wasm_f64x2_mul(s, s);
+  v128_t p = wasm_f64x2_add(F64(1.0 / 15), wasm_f64x2_mul(z, F64(1.0 / 17)));
+  p = wasm_f64x2_add(F64(1.0 / 13), wasm_f64x2_mul(z, p));
+  p = wasm_f64x2_add(F64(1.0 / 11), wasm_f64x2_mul(z, p));
+  p = wasm_f64x2_add(F64(1.0 / 9), wasm_f64x2_mul(z, p));
+  p = wasm_f64x2_add(F64(1.0 / 7), wasm_f64x2_mul(z, p));
+  p = wasm_f64x2_add(F64(1.0 / 5), wasm_f64x2_mul(z, p));
+  p = wasm_f64x2_add(F64(1.0 / 3), wasm_f64x2_mul(z, p));
+  v128_t log_m = wasm_f64x2_add(s, wasm_f64x2_mul(wasm_f64x2_mul(s, z), p));
+  log_m = wasm_f64x2_add(log_m, log_m);
+  v128_t log_x = wasm_f64x2_add(wasm_f64x2_mul(k, F64(0x1.62e42fefa39efp-1)), log_m);
+  v128_t t = wasm_f64x2_mul(y, log_x);
+  // A double NaN compares false, so lanes that overflowed count as special.
+  *special = wasm_v128_not(wasm_f64x2_le(wasm_f64x2_abs(t), F64(700.0)));
+  // t = n * ln(2) + r, with |r| <= ln(2)/2.
+  v128_t u = wasm_f64x2_add(wasm_f64x2_mul(t, F64(0x1.71547652b82fep+0)), F64(0x1.8p52));
+  v128_t n = wasm_f64x2_sub(u, F64(0x1.8p52));
+  v128_t r = wasm_f64x2_sub(t, wasm_f64x2_mul(n, F64(0x1.62e42feep-1)));
+  r = wasm_f64x2_sub(r, wasm_f64x2_mul(n, F64(0x1.a39ef35793c76p-33)));
+  // Taylor series to r^11.
+  static const double coeffs[] = {
+    1.0 / 39916800, 1.0 / 3628800, 1.0 / 362880, 1.0 / 40320, 1.0 / 5040,
+    1.0 / 720, 1.0 / 120, 1.0 / 24, 1.0 / 6, 1.0 / 2, 1.0, 1.0
+  };
+  v128_t e = F64(coeffs[0]);
+  for (int i = 1; i < 12; i++) {
+    e = wasm_f64x2_add(F64(coeffs[i]), wasm_f64x2_mul(r, e));
+  }
+  v128_t scale = wasm_i64x2_shl(wasm_i64x2_sub(u, F64(0x1.8p52)), 52);
+  return wasm_i64x2_add(e, scale);
+}
+
+static inline v128_t pow_kernel(v128_t x, v128_t y, v128_t *special) {
+  v128_t finite_y = wasm_f32x4_lt(wasm_f32x4_abs(y), F32(INFINITY));
+  *special = wasm_v128_not(wasm_v128_and(wasm_v128_and(is_positive_normal(x), finite_y),
+                                         wasm_v128_and(wasm_f32x4_ne(x, F32(1.0f)),
+                                                       wasm_f32x4_ne(y, F32(0.0f)))));
+  v128_t k;
+  v128_t f = log_reduce(x, &k);
+  v128_t dk = wasm_f32x4_convert_i32x4(k);
+  v128_t lo_special, hi_special;
+  v128_t lo = pow_f64x2(
+    wasm_f64x2_make(wasm_f32x4_extract_lane(dk, 0), wasm_f32x4_extract_lane(dk, 1)),
+    wasm_f64x2_make(wasm_f32x4_extract_lane(f, 0), wasm_f32x4_extract_lane(f, 1)),
+    wasm_f64x2_make(wasm_f32x4_extract_lane(y, 0), wasm_f32x4_extract_lane(y, 1)),
+    &lo_special);
+  v128_t hi = pow_f64x2(
+    wasm_f64x2_make(wasm_f32x4_extract_lane(dk, 2), wasm_f32x4_extract_lane(dk, 3)),
+    wasm_f64x2_make(wasm_f32x4_extract_lane(f, 2), wasm_f32x4_extract_lane(f, 3)),
+    wasm_f64x2_make(wasm_f32x4_extract_lane(y, 2), wasm_f32x4_extract_lane(y, 3)),
+    &hi_special);
+  // Each 64-bit special lane is all ones, so taking its low half works.
+  *special = wasm_v128_or(*special, wasm_v8x16_shuffle(lo_special, hi_special,
+    0, 1, 2, 3, 8, 9, 10, 11, 16, 17, 18, 19, 24, 25, 26, 27));
+  return wasm_f32x4_make(wasm_f64x2_extract_lane(lo, 0), wasm_f64x2_extract_lane(lo, 1),
+                         wasm_f64x2_extract_lane(hi, 0), wasm_f64x2_extract_lane(hi, 1));
+}
+
+// Recomputes the special lanes of a kernel's result with the scalar function.
+static v128_t fix_special_1(v128_t res, v128_t x, v128_t special, float (*f)(float)) {
+  float r[4], in[4];
+  int32_t s[4];
+  wasm_v128_store(r, res);
+  wasm_v128_store(in, x);
+  wasm_v128_store(s, special);
+  for (int i = 0; i < 4; i++) {
+    if (s[i]) r[i] = f(in[i]);
+  }
+  return wasm_v128_load(r);
+}
+
+static v128_t fix_special_2(v128_t res, v128_t x, v128_t y, v128_t special, float (*f)(float, float)) {
+  float r[4], in_x[4], in_y[4];
+  int32_t s[4];
+  wasm_v128_store(r, res);
+  wasm_v128_store(in_x, x);
+  wasm_v128_store(in_y, y);
+  wasm_v128_store(s, special);
+  for (int i = 0; i < 4; i++) {
+    if (s[i]) r[i] = f(in_x[i], in_y[i]);
+  }
+  return wasm_v128_load(r);
+}
+
+// The last n % 4 values go through a padded copy, so that nothing is read or
+// written past the ends of the arrays. The padding is 2, which every kernel
+// handles without falling back to the scalar function (1 would not do for
+// pow_kernel, which leaves x == 1 to powf).
+static inline v128_t load_tail(const float *x, size_t n) {
+  float buf[4] = { 2.0f, 2.0f, 2.0f, 2.0f };
+  memcpy(buf, x, n * sizeof(float));
+  return wasm_v128_load(buf);
+}
+
+static inline void store_tail(float *out, v128_t v, size_t n) {
+  float buf[4];
+  wasm_v128_store(buf, v);
+  memcpy(out, buf, n * sizeof(float));
+}
+
+#define BATCH_1(name, kernel, scalar)                                       \
+  void emscripten_batch_##name(float *out, const float *x, size_t n) {      \
+    size_t i = 0;                                                           \
+    for (; n - i >= 4; i += 4) {                                            \
+      v128_t v = wasm_v128_load(x + i), special;                            \
+      v128_t res = kernel(v, &special);                                     \
+      if (wasm_i8x16_bitmask(special)) {                                    \
+        res = fix_special_1(res, v, special, scalar);                       \
+      }                                                                     \
+      wasm_v128_store(out + i, res);                                        \
+    }                                                                       \
+    if (i < n) {                                                            \
+      v128_t v = load_tail(x + i, n - i), special;                          \
+      v128_t res = kernel(v, &special);                                     \
+      if (wasm_i8x16_bitmask(special)) {                                    \
+        res = fix_special_1(res, v, special, scalar);                       \
+      }                                                                     \
+      store_tail(out + i, res, n - i);                                      \
+    }                                                                       \
+  }
+
+void emscripten_batch_powf(float *out, const float *x, const float *y, size_t n) {
+  size_t i = 0;
+  for (; n - i >= 4; i += 4) {
+    v128_t vx = wasm_v128_load(x + i), vy = wasm_v128_load(y + i), special;
+    v128_t res = pow_kernel(vx, vy, &special);
+    if (wasm_i8x16_bitmask(special)) {
+      res = fix_special_2(res, vx, vy, special, powf);
+    }
+    wasm_v128_store(out + i, res);
+  }
+  if (i < n) {
+    v128_t vx = load_tail(x + i, n - i), vy = load_tail(y + i, n - i), special;
+    v128_t res = pow_kernel(vx, vy, &special);
+    if (wasm_i8x16_bitmask(special)) {
+      res = fix_special_2(res, vx, vy, special, powf);
+    }
+    store_tail(out + i, res, n - i);
+  }
+}
+
+#else // __wasm_simd128__
+
+#define BATCH_1(name, kernel, scalar)                                       \
+  void emscripten_batch_##name(float *out, const float *x, size_t n) {      \
+    for (size_t i = 0; i < n; i++) {                                        \
+      out[i] = scalar(x[i]);                                                \
+    }                                                                       \
+  }
+
+void emscripten_batch_powf(float *out, const float *x, const float *y, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = powf(x[i], y[i]);
+  }
+}
+
+#endif // __wasm_simd128__
+
+BATCH_1(sinf, sin_kernel, sinf)
+BATCH_1(cosf, cos_kernel, cosf)
+BATCH_1(expf, exp_kernel, expf)
+BATCH_1(logf, log_kernel, logf)
+BATCH_1(sqrtf, sqrt_kernel, sqrtf)
@@ -6,9 +6,11 @@
 #include <string.h>
 #include <emscripten/emscripten.h>
 
+#ifndef __wasm_bulk_memory__
 // An external JS implementation that is efficient for very large copies, using
 // HEAPU8.set()
 void* emscripten_memcpy_big(void *restrict dest, const void *restrict src, size_t n) EM_IMPORT(emscripten_memcpy_big);
+#endif
 
 // XXX EMSCRIPTEN ASAN: build an uninstrumented version of memcpy
 #if defined(__EMSCRIPTEN__) && defined(__has_feature)
@@ -17,6 +19,23 @@ void* emscripten_memcpy_big(void *restrict dest, const void *restrict src, size_
 #endif
 #endif
 
+#ifdef __wasm_bulk_memory__
+
+#include "emscripten_bulkmem.h"
+
+void *memcpy(void *restrict dest, const void *restrict src, size_t n)
+{
+  if (n <= BULKMEM_INLINE_MAX) {
+    bulkmem_small_copy(dest, src, n);
+    return dest;
+  }
+  // With bulk memory enabled, LLVM lowers this to memory.copy rather than a
+  // call back into memcpy.
+  return __builtin_memcpy(dest, src, n);
+}
+
+#else
+
 void *memcpy(void *restrict dest, const void *restrict src, size_t n)
 {
   unsigned char *d = dest;
@@ -88,3 +107,5 @@ void *memcpy(void *restrict dest, const void *restrict src, size_t n)
   }
   return dest;
 }
+
+#endif
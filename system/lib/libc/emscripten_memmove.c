@@ -5,4 +5,21 @@
 #endif
 #endif
 
+#ifdef __wasm_bulk_memory__
+
+#include <string.h>
+#include "emscripten_bulkmem.h"
+
+void *memmove(void *dest, const void *src, size_t n)
+{
+  if (n <= BULKMEM_INLINE_MAX) {
+    bulkmem_small_copy(dest, src, n);
+    return dest;
+  }
+  // memory.copy handles overlapping ranges.
+  return __builtin_memmove(dest, src, n);
+}
+
+#else
 #include "musl/src/string/memmove.c"
+#endif
@@ -5,4 +5,22 @@
 #endif
 #endif
 
+#ifdef __wasm_bulk_memory__
+
+#include <string.h>
+#include "emscripten_bulkmem.h"
+
+void *memset(void *dest, int c, size_t n)
+{
+  if (n <= BULKMEM_INLINE_MAX) {
+    bulkmem_small_fill(dest, c, n);
+    return dest;
+  }
+  // With bulk memory enabled, LLVM lowers this to memory.fill rather than a
+  // call back into memset.
+  return __builtin_memset(dest, c, n);
+}
+
+#else
 #include "musl/src/string/memset.c"
+#endif
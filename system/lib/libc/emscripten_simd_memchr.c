@@ -0,0 +1,26 @@
+// XXX EMSCRIPTEN: wasm SIMD128 version of musl's memchr, used when building
+// with -msimd128. Loads are 16-byte aligned, so they never cross the end of
+// the wasm memory; matches outside of [src, src+n) are masked off.
+
+#include <string.h>
+#include <stdint.h>
+#include <wasm_simd128.h>
+
+void *memchr(const void *src, int c, size_t n)
+{
+	const unsigned char *s = src;
+	if (!n) return 0;
+	uintptr_t align = (uintptr_t)s % 16;
+	const unsigned char *w = s - align;
+	const v128_t needle = wasm_i8x16_splat(c);
+	uint32_t mask = wasm_i8x16_bitmask(wasm_i8x16_eq(wasm_v128_load(w), needle)) & (0xFFFFu << align);
+	for (;;) {
+		if (mask) {
+			size_t i = w + __builtin_ctz(mask) - s;
+			return i < n ? (void *)(s + i) : 0;
+		}
+		w += 16;
+		if ((size_t)(w - s) >= n) return 0;
+		mask = wasm_i8x16_bitmask(wasm_i8x16_eq(wasm_v128_load(w), needle));
+	}
+}
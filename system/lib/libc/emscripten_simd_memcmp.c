@@ -0,0 +1,21 @@
+// XXX EMSCRIPTEN: wasm SIMD128 version of musl's memcmp, used when building
+// with -msimd128. Both inputs are known to be n bytes long, so unaligned
+// 16-byte loads are used while at least 16 bytes remain.
+
+#include <string.h>
+#include <stdint.h>
+#include <wasm_simd128.h>
+
+int memcmp(const void *vl, const void *vr, size_t n)
+{
+	const unsigned char *l=vl, *r=vr;
+	for (; n >= 16; n -= 16, l += 16, r += 16) {
+		uint32_t mask = wasm_i8x16_bitmask(wasm_i8x16_ne(wasm_v128_load(l), wasm_v128_load(r)));
+		if (mask) {
+			int i = __builtin_ctz(mask);
+			return l[i] - r[i];
+		}
+	}
+	for (; n && *l == *r; n--, l++, r++);
+	return n ? *l-*r : 0;
+}
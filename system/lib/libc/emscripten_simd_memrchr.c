@@ -0,0 +1,27 @@
+// XXX EMSCRIPTEN: wasm SIMD128 version of musl's memrchr, used when building
+// with -msimd128. Scans backwards with 16-byte aligned loads, masking off
+// matches outside of [m, m+n).
+
+#include <string.h>
+#include <stdint.h>
+#include <wasm_simd128.h>
+#include "libc.h"
+
+void *__memrchr(const void *m, int c, size_t n)
+{
+	const unsigned char *s = m;
+	if (!n) return 0;
+	uintptr_t last = (uintptr_t)(s + n - 1);
+	const unsigned char *w = (const unsigned char *)(last & ~(uintptr_t)15);
+	const v128_t needle = wasm_i8x16_splat(c);
+	uint32_t mask = wasm_i8x16_bitmask(wasm_i8x16_eq(wasm_v128_load(w), needle)) & (0xFFFFu >> (15 - last % 16));
+	for (;;) {
+		if (w < s) mask &= 0xFFFFu << (s - w);
+		if (mask) return (void *)(w + 31 - __builtin_clz(mask));
+		if (w <= s) return 0;
+		w -= 16;
+		mask = wasm_i8x16_bitmask(wasm_i8x16_eq(wasm_v128_load(w), needle));
+	}
+}
+
+weak_alias(__memrchr, memrchr);
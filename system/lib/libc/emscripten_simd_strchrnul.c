@@ -0,0 +1,27 @@
+// XXX EMSCRIPTEN: wasm SIMD128 version of musl's __strchrnul (which strchr is
+// built on), used when building with -msimd128. Loads are 16-byte aligned, so
+// they never cross the end of the wasm memory.
+
+#include <string.h>
+#include <stdint.h>
+#include <wasm_simd128.h>
+#include "libc.h"
+
+char *__strchrnul(const char *s, int c)
+{
+	uintptr_t align = (uintptr_t)s % 16;
+	const char *w = s - align;
+	const v128_t zero = wasm_i8x16_splat(0);
+	const v128_t needle = wasm_i8x16_splat(c);
+	v128_t v = wasm_v128_load(w);
+	uint32_t mask = wasm_i8x16_bitmask(wasm_v128_or(wasm_i8x16_eq(v, zero), wasm_i8x16_eq(v, needle))) >> align;
+	if (mask) return (char *)s + __builtin_ctz(mask);
+	for (;;) {
+		w += 16;
+		v = wasm_v128_load(w);
+		mask = wasm_i8x16_bitmask(wasm_v128_or(wasm_i8x16_eq(v, zero), wasm_i8x16_eq(v, needle)));
+		if (mask) return (char *)w + __builtin_ctz(mask);
+	}
+}
+
+weak_alias(__strchrnul, strchrnul);
@@ -0,0 +1,30 @@
+// XXX EMSCRIPTEN: wasm SIMD128 version of musl's strcmp, used when building
+// with -msimd128. The two strings are rarely aligned the same way, so this
+// uses unaligned 16-byte loads, and steps a byte at a time whenever a load
+// would cross a wasm page boundary (past which memory may not exist).
+
+#include <string.h>
+#include <stdint.h>
+#include <wasm_simd128.h>
+
+#define WASM_PAGE_SIZE 65536
+#define NEAR_PAGE_END(p) ((uintptr_t)(p) % WASM_PAGE_SIZE > WASM_PAGE_SIZE - 16)
+
+int strcmp(const char *l, const char *r)
+{
+	const v128_t zero = wasm_i8x16_splat(0);
+	for (;;) {
+		if (NEAR_PAGE_END(l) || NEAR_PAGE_END(r)) {
+			if (*l != *r || !*l) return *(unsigned char *)l - *(unsigned char *)r;
+			l++, r++;
+			continue;
+		}
+		v128_t a = wasm_v128_load(l);
+		uint32_t mask = wasm_i8x16_bitmask(wasm_v128_or(wasm_i8x16_ne(a, wasm_v128_load(r)), wasm_i8x16_eq(a, zero)));
+		if (mask) {
+			int i = __builtin_ctz(mask);
+			return ((unsigned char *)l)[i] - ((unsigned char *)r)[i];
+		}
+		l += 16, r += 16;
+	}
+}
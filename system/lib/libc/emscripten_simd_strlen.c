@@ -0,0 +1,21 @@
+// XXX EMSCRIPTEN: wasm SIMD128 version of musl's strlen, used when building
+// with -msimd128. Loads are 16-byte aligned, so they never cross the end of
+// the wasm memory even though they may read a few bytes outside the string.
+
+#include <string.h>
+#include <stdint.h>
+#include <wasm_simd128.h>
+
+size_t strlen(const char *s)
+{
+	uintptr_t align = (uintptr_t)s % 16;
+	const char *w = s - align;
+	const v128_t zero = wasm_i8x16_splat(0);
+	uint32_t mask = wasm_i8x16_bitmask(wasm_i8x16_eq(wasm_v128_load(w), zero)) >> align;
+	if (mask) return __builtin_ctz(mask);
+	for (;;) {
+		w += 16;
+		mask = wasm_i8x16_bitmask(wasm_i8x16_eq(wasm_v128_load(w), zero));
+		if (mask) return w + __builtin_ctz(mask) - s;
+	}
+}
@@ -0,0 +1,58 @@
+// XXX EMSCRIPTEN: wasm SIMD128 version of musl's strspn, used when building
+// with -msimd128. The accept set is kept as two 16-byte tables indexed by the
+// low nibble of a byte, holding one bit per value of its high nibble, so that
+// membership of 16 bytes is tested with a couple of swizzles. Loads are
+// 16-byte aligned, so they never cross the end of the wasm memory.
+
+#include <string.h>
+#include <stdint.h>
+#include <wasm_simd128.h>
+
+size_t strspn(const char *s, const char *c)
+{
+	if (!c[0]) return 0;
+
+	uintptr_t align = (uintptr_t)s % 16;
+	const char *w = s - align;
+	uint32_t mask;
+
+	if (!c[1]) {
+		const v128_t needle = wasm_i8x16_splat(*c);
+		mask = wasm_i8x16_bitmask(wasm_i8x16_ne(wasm_v128_load(w), needle)) >> align;
+		if (mask) return __builtin_ctz(mask);
+		for (;;) {
+			w += 16;
+			mask = wasm_i8x16_bitmask(wasm_i8x16_ne(wasm_v128_load(w), needle));
+			if (mask) return w + __builtin_ctz(mask) - s;
+		}
+	}
+
+	// The terminating NUL is never part of the set, so it stops the scan.
+	uint8_t low_table[16] = { 0 }, high_table[16] = { 0 };
+	for (; *c; c++) {
+		unsigned char x = *c;
+		if (x < 128) low_table[x % 16] |= 1 << (x / 16);
+		else high_table[x % 16] |= 1 << (x / 16 - 8);
+	}
+	const v128_t low_set = wasm_v128_load(low_table);
+	const v128_t high_set = wasm_v128_load(high_table);
+	const v128_t bits = wasm_i8x16_make(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const v128_t nibble = wasm_i8x16_splat(15);
+	const v128_t eight = wasm_i8x16_splat(8);
+
+#define REJECTED(v) ({ \
+	v128_t lo = wasm_v128_and(v, nibble); \
+	v128_t hi = wasm_u8x16_shr(v, 4); \
+	v128_t row = wasm_v128_bitselect(wasm_v8x16_swizzle(low_set, lo), wasm_v8x16_swizzle(high_set, lo), wasm_u8x16_lt(hi, eight)); \
+	wasm_i8x16_bitmask(wasm_i8x16_eq(wasm_v128_and(row, wasm_v8x16_swizzle(bits, hi)), wasm_i8x16_splat(0))); \
+})
+
+	mask = REJECTED(wasm_v128_load(w)) >> align;
+	if (mask) return __builtin_ctz(mask);
+	for (;;) {
+		w += 16;
+		mask = REJECTED(wasm_v128_load(w));
+		if (mask) return w + __builtin_ctz(mask) - s;
+	}
+#undef REJECTED
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// UTF-8 <-> UTF-16 transcoding, see emscripten/unicode.h. This is also what
+// the JS string helpers (UTF8ToString, stringToUTF8) call for long strings
+// when built with -s WASM_STRING_TRANSCODING.
+
+#include <emscripten/unicode.h>
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+// Returned by the decoders for ill-formed input, which the callers replace
+// with U+FFFD.
+#define INVALID 0x110000u
+#define REPLACEMENT 0xFFFDu
+
+// Decodes the character at s[*i] and advances *i past it. On ill-formed input
+// *i is advanced past the maximal subpart, as the WHATWG decoder does.
+static uint32_t decode_utf8(const uint8_t *s, size_t len, size_t *i) {
+  size_t p = *i;
+  uint8_t lead = s[p++];
+  uint32_t c;
+  int need;
+  uint8_t lo = 0x80, hi = 0xBF;
+  if (lead < 0x80) {
+    *i = p;
+    return lead;
+  } else if (lead >= 0xC2 && lead <= 0xDF) {
+    need = 1;
+    c = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    need = 2;
+    c = lead & 0x0F;
+    // No overlong encodings, and no surrogates.
+    if (lead == 0xE0) lo = 0xA0;
+    if (lead == 0xED) hi = 0x9F;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    need = 3;
+    c = lead & 0x07;
+    // No overlong encodings, and nothing above U+10FFFF.
+    if (lead == 0xF0) lo = 0x90;
+    if (lead == 0xF4) hi = 0x8F;
+  } else {
+    *i = p;
+    return INVALID;
+  }
+  while (need--) {
+    if (p == len || s[p] < lo || s[p] > hi) {
+      *i = p;
+      return INVALID;
+    }
+    c = (c << 6) | (s[p++] & 0x3F);
+    lo = 0x80;
+    hi = 0xBF;
+  }
+  *i = p;
+  return c;
+}
+
+// Decodes the character at s[*i] and advances *i past it. Unpaired surrogates
+// decode as INVALID.
+static uint32_t decode_utf16(const uint16_t *s, size_t len, size_t *i) {
+  uint32_t c = s[(*i)++];
+  if (c < 0xD800 || c > 0xDFFF) {
+    return c;
+  }
+  if (c <= 0xDBFF && *i < len && s[*i] >= 0xDC00 && s[*i] <= 0xDFFF) {
+    return 0x10000 + ((c - 0xD800) << 10) + (s[(*i)++] - 0xDC00);
+  }
+  return INVALID;
+}
+
+static size_t utf8_length(uint32_t c) {
+  return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+}
+
+#ifdef __wasm_simd128__
+// Returns the number of ASCII bytes at the start of s. Only whole 16-byte
+// blocks are loaded, so this never reads past s + len.
+static size_t ascii_prefix(const uint8_t *s, size_t len) {
+  size_t i = 0;
+  for (; len - i >= 16; i += 16) {
+    uint32_t mask = wasm_i8x16_bitmask(wasm_v128_load(s + i));
+    if (mask) return i + __builtin_ctz(mask);
+  }
+  return i;
+}
+
+// Returns whether the 16 UTF-16 code units at s are all ASCII.
+static int is_ascii_utf16(const uint16_t *s, v128_t *lo, v128_t *hi) {
+  *lo = wasm_v128_load(s);
+  *hi = wasm_v128_load(s + 8);
+  v128_t high_bits = wasm_v128_and(wasm_v128_or(*lo, *hi), wasm_i16x8_splat(0xFF80));
+  return wasm_i8x16_bitmask(wasm_i8x16_eq(high_bits, wasm_i8x16_splat(0))) == 0xFFFF;
+}
+#endif
+
+size_t emscripten_utf8_validate(const char *str, size_t len) {
+  const uint8_t *s = (const uint8_t *)str;
+  size_t i = 0;
+  while (i < len) {
+#ifdef __wasm_simd128__
+    i += ascii_prefix(s + i, len - i);
+    if (i == len) break;
+#endif
+    size_t start = i;
+    if (decode_utf8(s, len, &i) == INVALID) return start;
+  }
+  return len;
+}
+
+size_t emscripten_utf8_to_utf16_length(const char *str, size_t len) {
+  const uint8_t *s = (const uint8_t *)str;
+  size_t i = 0, n = 0;
+  while (i < len) {
+#ifdef __wasm_simd128__
+    size_t ascii = ascii_prefix(s + i, len - i);
+    i += ascii;
+    n += ascii;
+    if (i == len) break;
+#endif
+    uint32_t c = decode_utf8(s, len, &i);
+    n += (c >= 0x10000 && c != INVALID) ? 2 : 1;
+  }
+  return n;
+}
+
+size_t emscripten_utf8_to_utf16(const char *str, size_t len, uint16_t *out, size_t out_len) {
+  const uint8_t *s = (const uint8_t *)str;
+  size_t i = 0, o = 0;
+#ifdef __wasm_simd128__
+  const v128_t zero = wasm_i8x16_splat(0);
+#endif
+  while (i < len && o < out_len) {
+#ifdef __wasm_simd128__
+    if (len - i >= 16 && out_len - o >= 16) {
+      v128_t v = wasm_v128_load(s + i);
+      uint32_t mask = wasm_i8x16_bitmask(v);
+      if (!mask) {
+        // Zero-extend each byte to 16 bits.
+        wasm_v128_store(out + o, wasm_v8x16_shuffle(v, zero, 0, 16, 1, 16, 2, 16, 3, 16, 4, 16, 5, 16, 6, 16, 7, 16));
+        wasm_v128_store(out + o + 8, wasm_v8x16_shuffle(v, zero, 8, 16, 9, 16, 10, 16, 11, 16, 12, 16, 13, 16, 14, 16, 15, 16));
+        i += 16;
+        o += 16;
+        continue;
+      }
+      for (size_t end = i + __builtin_ctz(mask); i < end; i++) {
+        out[o++] = s[i];
+      }
+    }
+#endif
+    size_t start = i;
+    uint32_t c = decode_utf8(s, len, &i);
+    if (c == INVALID) {
+      c = REPLACEMENT;
+    }
+    if (c >= 0x10000) {
+      if (out_len - o < 2) {
+        i = start;
+        break;
+      }
+      c -= 0x10000;
+      out[o++] = 0xD800 | (c >> 10);
+      out[o++] = 0xDC00 | (c & 0x3FF);
+    } else {
+      out[o++] = c;
+    }
+  }
+  return o;
+}
+
+size_t emscripten_utf16_to_utf8_length(const uint16_t *str, size_t len) {
+  size_t i = 0, n = 0;
+  while (i < len) {
+#ifdef __wasm_simd128__
+    v128_t lo, hi;
+    if (len - i >= 16 && is_ascii_utf16(str + i, &lo, &hi)) {
+      i += 16;
+      n += 16;
+      continue;
+    }
+#endif
+    uint32_t c = decode_utf16(str, len, &i);
+    n += c == INVALID ? 3 : utf8_length(c);
+  }
+  return n;
+}
+
+size_t emscripten_utf16_to_utf8(const uint16_t *str, size_t len, char *out, size_t out_len) {
+  uint8_t *u = (uint8_t *)out;
+  size_t i = 0, o = 0;
+  while (i < len && o < out_len) {
+#ifdef __wasm_simd128__
+    v128_t lo, hi;
+    if (len - i >= 16 && out_len - o >= 16 && is_ascii_utf16(str + i, &lo, &hi)) {
+      // Keep the low byte of each code unit.
+      wasm_v128_store(u + o, wasm_v8x16_shuffle(lo, hi, 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30));
+      i += 16;
+      o += 16;
+      continue;
+    }
+#endif
+    size_t start = i;
+    uint32_t c = decode_utf16(str, len, &i);
+    if (c == INVALID) {
+      c = REPLACEMENT;
+    }
+    size_t n = utf8_length(c);
+    if (out_len - o < n) {
+      i = start;
+      break;
+    }
+    switch (n) {
+      case 1:
+        u[o++] = c;
+        break;
+      case 2:
+        u[o++] = 0xC0 | (c >> 6);
+        u[o++] = 0x80 | (c & 0x3F);
+        break;
+      case 3:
+        u[o++] = 0xE0 | (c >> 12);
+        u[o++] = 0x80 | ((c >> 6) & 0x3F);
+        u[o++] = 0x80 | (c & 0x3F);
+        break;
+      default:
+        u[o++] = 0xF0 | (c >> 18);
+        u[o++] = 0x80 | ((c >> 12) & 0x3F);
+        u[o++] = 0x80 | ((c >> 6) & 0x3F);
+        u[o++] = 0x80 | (c & 0x3F);
+        break;
+    }
+  }
+  return o;
+}
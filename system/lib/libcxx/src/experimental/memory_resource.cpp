@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "experimental/memory_resource"
+#include "bit"
 
 #ifndef _LIBCPP_HAS_NO_ATOMIC_HEADER
 #include "atomic"
@@ -158,4 +159,389 @@ memory_resource * set_default_resource(memory_resource * __new_res) _NOEXCEPT
     return __default_memory_resource(true, __new_res);
 }
 
+// 8.9, memory.resource.pool
+
+static size_t __roundup(size_t __count, size_t __alignment)
+{
+    size_t __mask = __alignment - 1;
+    _LIBCPP_ASSERT(__count + __mask >= __count, "size overflows");
+    return (__count + __mask) & ~__mask;
+}
+
+struct unsynchronized_pool_resource::__adhoc_pool::__chunk_footer {
+    __chunk_footer *__next_;
+    char *__start_;
+    size_t __align_;
+    size_t __allocation_size() {
+        return (reinterpret_cast<char*>(this) - __start_) + sizeof(*this);
+    }
+};
+
+void unsynchronized_pool_resource::__adhoc_pool::__release_ptr(memory_resource *__upstream)
+{
+    while (__first_ != nullptr) {
+        __chunk_footer *__next = __first_->__next_;
+        __upstream->deallocate(__first_->__start_, __first_->__allocation_size(), __first_->__align_);
+        __first_ = __next;
+    }
+}
+
+void *unsynchronized_pool_resource::__adhoc_pool::__do_allocate(memory_resource *__upstream, size_t __bytes, size_t __align)
+{
+    const size_t __footer_size = sizeof(__chunk_footer);
+    const size_t __footer_align = alignof(__chunk_footer);
+
+    if (__align < __footer_align)
+        __align = __footer_align;
+
+    size_t __aligned_capacity = __roundup(__bytes, __footer_align) + __footer_size;
+
+    void *__result = __upstream->allocate(__aligned_capacity, __align);
+
+    __chunk_footer *__h = (__chunk_footer *)((char *)__result + __aligned_capacity - __footer_size);
+    __h->__next_ = __first_;
+    __h->__start_ = (char *)__result;
+    __h->__align_ = __align;
+    __first_ = __h;
+    return __result;
+}
+
+void unsynchronized_pool_resource::__adhoc_pool::__do_deallocate(memory_resource *__upstream, void *__p, size_t, size_t)
+{
+    _LIBCPP_ASSERT(__first_ != nullptr, "deallocating a block that was not allocated with this allocator");
+    if (__first_->__start_ == __p) {
+        __chunk_footer *__next = __first_->__next_;
+        __upstream->deallocate(__p, __first_->__allocation_size(), __first_->__align_);
+        __first_ = __next;
+    } else {
+        for (__chunk_footer *__h = __first_; __h->__next_ != nullptr; __h = __h->__next_) {
+            if (__h->__next_->__start_ == __p) {
+                __chunk_footer *__next = __h->__next_->__next_;
+                __upstream->deallocate(__p, __h->__next_->__allocation_size(), __h->__next_->__align_);
+                __h->__next_ = __next;
+                return;
+            }
+        }
+        _LIBCPP_ASSERT(false, "deallocating a block that was not allocated with this allocator");
+    }
+}
+
+// The pool for one block size. Free blocks form a singly linked list through
+// their first word. New chunks are not threaded onto that list up front;
+// instead blocks are cut from the newest chunk as they are needed, so memory
+// is only touched when it is used.
+class unsynchronized_pool_resource::__fixed_pool {
+    struct __chunk_footer {
+        __chunk_footer *__next_;
+        char *__start_;
+        size_t __align_;
+        size_t __allocation_size() {
+            return (reinterpret_cast<char*>(this) - __start_) + sizeof(*this);
+        }
+    };
+
+    struct __vacancy_header {
+        __vacancy_header *__next_vacancy_;
+    };
+
+    __chunk_footer *__first_chunk_ = nullptr;
+    __vacancy_header *__first_vacancy_ = nullptr;
+    char *__bump_ = nullptr;
+    char *__bump_end_ = nullptr;
+    size_t __chunk_blocks_ = 0;
+
+public:
+    static const size_t __default_alignment = alignof(max_align_t);
+
+    explicit __fixed_pool() = default;
+
+    void __release_ptr(memory_resource *__upstream) {
+        while (__first_chunk_ != nullptr) {
+            __chunk_footer *__next = __first_chunk_->__next_;
+            __upstream->deallocate(__first_chunk_->__start_, __first_chunk_->__allocation_size(), __first_chunk_->__align_);
+            __first_chunk_ = __next;
+        }
+        __first_vacancy_ = nullptr;
+        __bump_ = __bump_end_ = nullptr;
+        __chunk_blocks_ = 0;
+    }
+
+    void *__try_allocate(size_t __block_size) {
+        if (__first_vacancy_ != nullptr) {
+            void *__result = __first_vacancy_;
+            __first_vacancy_ = __first_vacancy_->__next_vacancy_;
+            return __result;
+        }
+        if (__bump_ != __bump_end_) {
+            void *__result = __bump_;
+            __bump_ += __block_size;
+            return __result;
+        }
+        return nullptr;
+    }
+
+    size_t __previous_chunk_blocks() const { return __chunk_blocks_; }
+
+    void *__allocate_in_new_chunk(memory_resource *__upstream, size_t __block_size, size_t __chunk_blocks) {
+        static_assert(__default_alignment >= alignof(max_align_t), "");
+        static_assert(__default_alignment >= alignof(__chunk_footer), "");
+        static_assert(__default_alignment >= alignof(__vacancy_header), "");
+
+        const size_t __footer_size = sizeof(__chunk_footer);
+        const size_t __footer_align = alignof(__chunk_footer);
+
+        size_t __chunk_size = __chunk_blocks * __block_size;
+        size_t __aligned_capacity = __roundup(__chunk_size, __footer_align) + __footer_size;
+
+        char *__result = (char *)__upstream->allocate(__aligned_capacity, __default_alignment);
+
+        __chunk_footer *__h = (__chunk_footer *)(__result + __aligned_capacity - __footer_size);
+        __h->__next_ = __first_chunk_;
+        __h->__start_ = __result;
+        __h->__align_ = __default_alignment;
+        __first_chunk_ = __h;
+
+        // Whatever was left of the previous chunk goes onto the free list.
+        while (__bump_ != __bump_end_) {
+            __evacuate(__bump_);
+            __bump_ += __block_size;
+        }
+        __bump_ = __result + __block_size;
+        __bump_end_ = __result + __chunk_size;
+        __chunk_blocks_ = __chunk_blocks;
+        return __result;
+    }
+
+    void __evacuate(void *__p) {
+        __vacancy_header *__vh = (__vacancy_header *)(__p);
+        __vh->__next_vacancy_ = __first_vacancy_;
+        __first_vacancy_ = __vh;
+    }
+};
+
+size_t unsynchronized_pool_resource::__pool_block_size(int __i) _NOEXCEPT
+{
+    if (__i < 4)
+        return size_t(8) * (__i + 1);
+    // 48, 64, 96, 128, 192, 256, ...
+    int __j = __i - 4;
+    size_t __pow = size_t(32) << (__j / 2);
+    return (__j & 1) ? __pow * 2 : __pow + __pow / 2;
+}
+
+size_t unsynchronized_pool_resource::__pool_block_align(int __i) _NOEXCEPT
+{
+    // Blocks sit at multiples of their size from the start of a chunk, which
+    // is aligned to __fixed_pool::__default_alignment.
+    size_t __size = __pool_block_size(__i);
+    size_t __align = __size & -__size;
+    return __align < __fixed_pool::__default_alignment ? __align : __fixed_pool::__default_alignment;
+}
+
+int unsynchronized_pool_resource::__size_class(size_t __bytes) _NOEXCEPT
+{
+    if (__bytes <= 32)
+        return __bytes == 0 ? 0 : int((__bytes - 1) / 8);
+    // 2^__k < __bytes <= 2^(__k+1), with __k >= 5.
+    int __k = numeric_limits<size_t>::digits - 1 - _VSTD::__libcpp_clz(__bytes - 1);
+    return 4 + 2 * (__k - 5) + (__bytes > (size_t(3) << (__k - 1)) ? 1 : 0);
+}
+
+int unsynchronized_pool_resource::__pool_index(size_t __bytes, size_t __align) const _NOEXCEPT
+{
+    if (__align > alignof(max_align_t) || __bytes > __pool_block_size(__num_fixed_pools_ - 1))
+        return __num_fixed_pools_;
+    int __i = __size_class(__bytes);
+    // Sizes from 32 up are multiples of max_align_t's alignment, so this stops
+    // at the last pool at the latest.
+    while (__pool_block_align(__i) < __align)
+        ++__i;
+    return __i;
+}
+
+unsynchronized_pool_resource::unsynchronized_pool_resource(const pool_options& __opts, memory_resource* __upstream)
+    : __res_(__upstream), __fixed_pools_(nullptr)
+{
+    size_t __largest_block_size;
+    if (__opts.largest_required_pool_block == 0)
+        __largest_block_size = __default_largest_block_size;
+    else if (__opts.largest_required_pool_block < __min_largest_block_size)
+        __largest_block_size = __min_largest_block_size;
+    else if (__opts.largest_required_pool_block > __max_largest_block_size)
+        __largest_block_size = __max_largest_block_size;
+    else
+        __largest_block_size = __opts.largest_required_pool_block;
+
+    __num_fixed_pools_ = __size_class(__largest_block_size) + 1;
+
+    if (__opts.max_blocks_per_chunk == 0)
+        __options_max_blocks_per_chunk_ = __max_blocks_per_chunk;
+    else if (__opts.max_blocks_per_chunk < __min_blocks_per_chunk)
+        __options_max_blocks_per_chunk_ = __min_blocks_per_chunk;
+    else if (__opts.max_blocks_per_chunk > __max_blocks_per_chunk)
+        __options_max_blocks_per_chunk_ = __max_blocks_per_chunk;
+    else
+        __options_max_blocks_per_chunk_ = __opts.max_blocks_per_chunk;
+}
+
+pool_options unsynchronized_pool_resource::options() const
+{
+    pool_options __p;
+    __p.max_blocks_per_chunk = __options_max_blocks_per_chunk_;
+    __p.largest_required_pool_block = __pool_block_size(__num_fixed_pools_ - 1);
+    return __p;
+}
+
+void unsynchronized_pool_resource::release()
+{
+    __adhoc_pool_.__release_ptr(__res_);
+    if (__fixed_pools_ != nullptr) {
+        const int __n = __num_fixed_pools_;
+        for (int __i = 0; __i < __n; ++__i)
+            __fixed_pools_[__i].__release_ptr(__res_);
+        __res_->deallocate(__fixed_pools_, __num_fixed_pools_ * sizeof(__fixed_pool), alignof(__fixed_pool));
+        __fixed_pools_ = nullptr;
+    }
+}
+
+void* unsynchronized_pool_resource::do_allocate(size_t __bytes, size_t __align)
+{
+    // The pools are indexed by size class, so finding one is constant time.
+    int __i = __pool_index(__bytes, __align);
+    if (__i == __num_fixed_pools_)
+        return __adhoc_pool_.__do_allocate(__res_, __bytes, __align);
+
+    if (__fixed_pools_ == nullptr) {
+        __fixed_pools_ = (__fixed_pool*)__res_->allocate(__num_fixed_pools_ * sizeof(__fixed_pool), alignof(__fixed_pool));
+        __fixed_pool *__first = __fixed_pools_;
+        __fixed_pool *__last = __fixed_pools_ + __num_fixed_pools_;
+        for (__fixed_pool *__pool = __first; __pool != __last; ++__pool)
+            ::new((void*)__pool) __fixed_pool;
+    }
+
+    size_t __block_size = __pool_block_size(__i);
+    void *__result = __fixed_pools_[__i].__try_allocate(__block_size);
+    if (__result == nullptr) {
+        // Each chunk is 25% larger than the previous one, starting from
+        // __min_bytes_per_chunk and capped by the options.
+        size_t __prev_blocks = __fixed_pools_[__i].__previous_chunk_blocks();
+        size_t __chunk_blocks;
+        if (__prev_blocks == 0) {
+            __chunk_blocks = __min_bytes_per_chunk / __block_size;
+            if (__chunk_blocks < __min_blocks_per_chunk)
+                __chunk_blocks = __min_blocks_per_chunk;
+        } else {
+            static_assert(__max_bytes_per_chunk <= SIZE_MAX - (__max_bytes_per_chunk / 4), "unsigned overflow is possible");
+            __chunk_blocks = __prev_blocks + (__prev_blocks / 4);
+        }
+
+        size_t __max_blocks = __max_bytes_per_chunk / __block_size;
+        if (__max_blocks > __max_blocks_per_chunk)
+            __max_blocks = __max_blocks_per_chunk;
+        if (__max_blocks > __options_max_blocks_per_chunk_)
+            __max_blocks = __options_max_blocks_per_chunk_;
+        if (__chunk_blocks > __max_blocks)
+            __chunk_blocks = __max_blocks;
+
+        __result = __fixed_pools_[__i].__allocate_in_new_chunk(__res_, __block_size, __chunk_blocks);
+    }
+    return __result;
+}
+
+void unsynchronized_pool_resource::do_deallocate(void* __p, size_t __bytes, size_t __align)
+{
+    int __i = __pool_index(__bytes, __align);
+    if (__i == __num_fixed_pools_)
+        return __adhoc_pool_.__do_deallocate(__res_, __p, __bytes, __align);
+    _LIBCPP_ASSERT(__fixed_pools_ != nullptr, "deallocating a block that was not allocated with this allocator");
+    __fixed_pools_[__i].__evacuate(__p);
+}
+
+// 8.10, memory.resource.monotonic.buffer
+
+static void *__align_down(size_t __align, size_t __size, void *&__ptr, size_t &__space)
+{
+    if (__size > __space)
+        return nullptr;
+
+    char *__p1 = static_cast<char *>(__ptr);
+    char *__new_ptr = reinterpret_cast<char *>(reinterpret_cast<uintptr_t>(__p1 - __size) & ~(__align - 1));
+
+    if (__new_ptr < (__p1 - __space))
+        return nullptr;
+
+    __ptr = __new_ptr;
+    __space -= __p1 - __new_ptr;
+
+    return __ptr;
+}
+
+void *monotonic_buffer_resource::__initial_descriptor::__try_allocate_from_chunk(size_t __bytes, size_t __align)
+{
+    if (!__cur_)
+        return nullptr;
+    void *__new_ptr = static_cast<void *>(__cur_);
+    size_t __new_capacity = (__cur_ - __start_);
+    void *__aligned_ptr = __align_down(__align, __bytes, __new_ptr, __new_capacity);
+    if (__aligned_ptr != nullptr)
+        __cur_ = static_cast<char *>(__new_ptr);
+    return __aligned_ptr;
+}
+
+void *monotonic_buffer_resource::__chunk_footer::__try_allocate_from_chunk(size_t __bytes, size_t __align)
+{
+    void *__new_ptr = static_cast<void *>(__cur_);
+    size_t __new_capacity = (__cur_ - __start_);
+    void *__aligned_ptr = __align_down(__align, __bytes, __new_ptr, __new_capacity);
+    if (__aligned_ptr != nullptr)
+        __cur_ = static_cast<char *>(__new_ptr);
+    return __aligned_ptr;
+}
+
+void *monotonic_buffer_resource::do_allocate(size_t __bytes, size_t __align)
+{
+    const size_t __footer_size = sizeof(__chunk_footer);
+    const size_t __footer_align = alignof(__chunk_footer);
+
+    auto __previous_allocation_size = [&]() {
+        if (__chunks_ != nullptr)
+            return __chunks_->__allocation_size();
+
+        size_t __newsize = (__initial_.__start_ != nullptr) ? (__initial_.__end_ - __initial_.__start_) : __initial_.__size_;
+
+        return __roundup(__newsize, __footer_align) + __footer_size;
+    };
+
+    if (void *__result = __initial_.__try_allocate_from_chunk(__bytes, __align))
+        return __result;
+    if (__chunks_ != nullptr) {
+        if (void *__result = __chunks_->__try_allocate_from_chunk(__bytes, __align))
+            return __result;
+    }
+
+    // Allocate a brand-new chunk.
+
+    if (__align < __footer_align)
+        __align = __footer_align;
+
+    size_t __aligned_capacity = __roundup(__bytes, __footer_align) + __footer_size;
+    size_t __previous_capacity = __previous_allocation_size();
+
+    if (__aligned_capacity <= __previous_capacity) {
+        size_t __newsize = 2 * (__previous_capacity - __footer_size);
+        __aligned_capacity = __roundup(__newsize, __footer_align) + __footer_size;
+    }
+
+    char *__start = (char *)__res_->allocate(__aligned_capacity, __align);
+    char *__end = __start + __aligned_capacity - __footer_size;
+    __chunk_footer *__footer = (__chunk_footer *)(__end);
+    __footer->__next_ = __chunks_;
+    __footer->__start_ = __start;
+    __footer->__cur_ = __end;
+    __footer->__align_ = __align;
+    __chunks_ = __footer;
+
+    return __chunks_->__try_allocate_from_chunk(__bytes, __align);
+}
+
 _LIBCPP_END_NAMESPACE_LFTS_PMR
@@ -0,0 +1,179 @@
+//===------------------------ pstl_emscripten.cpp -------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// XXX EMSCRIPTEN: backend for the parallel algorithms in <__pstl_algorithm>
+// and <__pstl_numeric>.
+//
+// A persistent pool of emscripten_num_logical_cores() - 1 workers is started
+// on first use. Each call splits its range into chunks, and the workers and
+// the calling thread claim chunks from a shared counter until none are left.
+// The calling thread never waits for a chunk that no thread has claimed, so a
+// call makes progress even if the workers have not started yet (for example
+// when the pool is first used from the main browser thread without
+// PTHREAD_POOL_SIZE); it then simply runs serially.
+//
+// In builds without pthreads, and for calls made while another parallel call
+// is running (including nested ones), all chunks run on the calling thread.
+
+#include "__config"
+#include "__pstl_execution"
+#include "algorithm"
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <emscripten/threading.h>
+#endif
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace __pstl {
+
+namespace {
+
+// Enough chunks per thread to balance uneven work without much overhead.
+const size_t __chunks_per_thread = 4;
+
+// Chunk __chunk of __chunks covers [__chunk_begin(__chunk), __chunk_begin(__chunk + 1)).
+inline size_t __chunk_begin(size_t __n, size_t __chunks, size_t __chunk)
+{
+    return static_cast<size_t>(static_cast<unsigned long long>(__n) * __chunk / __chunks);
+}
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+
+struct __job {
+    size_t __n;
+    size_t __chunks;
+    void (*__fn)(void*, size_t, size_t, size_t);
+    void* __ctx;
+    atomic<size_t> __next_chunk;
+    // Workers that have picked up this job and may still claim chunks.
+    size_t __active_workers;
+};
+
+struct __pool {
+    mutex __mut;
+    condition_variable __job_posted;
+    condition_variable __job_left;
+    __job* __current = nullptr;
+    unsigned __generation = 0;
+    size_t __threads = 1;
+    // Held for the duration of a parallel call; other calls run serially.
+    mutex __busy;
+};
+
+__pool* __the_pool;
+once_flag __pool_init;
+
+void __run_chunks(__job& __j) _NOEXCEPT
+{
+    for (;;) {
+        size_t __chunk = __j.__next_chunk.fetch_add(1, memory_order_relaxed);
+        if (__chunk >= __j.__chunks)
+            return;
+        __j.__fn(__j.__ctx, __chunk, __chunk_begin(__j.__n, __j.__chunks, __chunk),
+                 __chunk_begin(__j.__n, __j.__chunks, __chunk + 1));
+    }
+}
+
+void* __worker_main(void*)
+{
+    __pool& __p = *__the_pool;
+    unsigned __seen = 0;
+    unique_lock<mutex> __lock(__p.__mut);
+    for (;;) {
+        __p.__job_posted.wait(__lock, [&] { return __p.__current && __p.__generation != __seen; });
+        __seen = __p.__generation;
+        __job& __j = *__p.__current;
+        ++__j.__active_workers;
+        __lock.unlock();
+        __run_chunks(__j);
+        __lock.lock();
+        if (--__j.__active_workers == 0)
+            __p.__job_left.notify_all();
+    }
+    return nullptr;
+}
+
+void __init_pool()
+{
+    __the_pool = new __pool;
+    int __cores = emscripten_num_logical_cores();
+    for (int __i = 1; __i < __cores; ++__i) {
+        pthread_t __worker;
+        if (pthread_create(&__worker, nullptr, __worker_main, nullptr) != 0)
+            break;
+        pthread_detach(__worker);
+        ++__the_pool->__threads;
+    }
+}
+
+size_t __num_threads()
+{
+    call_once(__pool_init, __init_pool);
+    return __the_pool->__threads;
+}
+
+#else
+
+size_t __num_threads()
+{
+    return 1;
+}
+
+#endif
+
+} // namespace
+
+size_t __chunk_count(size_t __n, size_t __grain) _NOEXCEPT
+{
+    if (__n == 0)
+        return 0;
+    __grain = _VSTD::max<size_t>(__grain, 1);
+    size_t __chunks = __n / __grain + (__n % __grain != 0);
+    return _VSTD::min(__chunks, __num_threads() * __chunks_per_thread);
+}
+
+void __parallel_for_chunks(size_t __n, size_t __grain,
+                           void (*__fn)(void*, size_t, size_t, size_t),
+                           void* __ctx) _NOEXCEPT
+{
+    size_t __chunks = __chunk_count(__n, __grain);
+#ifdef __EMSCRIPTEN_PTHREADS__
+    if (__chunks > 1 && __the_pool->__threads > 1 && __the_pool->__busy.try_lock()) {
+        __pool& __p = *__the_pool;
+        __job __j{__n, __chunks, __fn, __ctx, {0}, 0};
+        {
+            lock_guard<mutex> __lock(__p.__mut);
+            __p.__current = &__j;
+            ++__p.__generation;
+        }
+        __p.__job_posted.notify_all();
+        __run_chunks(__j);
+        {
+            // Every chunk has been claimed. Stop further workers from picking
+            // the job up, and wait for the ones still running chunks.
+            unique_lock<mutex> __lock(__p.__mut);
+            __p.__current = nullptr;
+            __p.__job_left.wait(__lock, [&] { return __j.__active_workers == 0; });
+        }
+        __p.__busy.unlock();
+        return;
+    }
+#endif
+    for (size_t __chunk = 0; __chunk < __chunks; ++__chunk)
+        __fn(__ctx, __chunk, __chunk_begin(__n, __chunks, __chunk),
+             __chunk_begin(__n, __chunks, __chunk + 1));
+}
+
+} // namespace __pstl
+
+_LIBCPP_END_NAMESPACE_STD
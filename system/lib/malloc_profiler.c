@@ -0,0 +1,284 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ *
+ * Sampling heap profiler, built into libmalloc with -s MALLOC_PROFILER=1.
+ *
+ * The allocators call the hooks in malloc_profiler_hooks.h. Each thread counts
+ * down the bytes it allocates, and when the count runs out the allocation is
+ * sampled: its call stack is captured and interned in a table of stacks, and
+ * the pointer is added to a table of live samples. Freeing a sampled pointer
+ * removes it again. The distance between samples is drawn from an exponential
+ * distribution, so that each sample can be weighted by the inverse of the
+ * probability that an allocation of its size gets sampled.
+ *
+ * The tables are fixed size static arrays, so that the profiler never calls
+ * back into malloc. Samples that do not fit are dropped, and stacks that do not
+ * fit are counted under a single "[unknown]" stack.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <emscripten/emscripten.h>
+#include <emscripten/malloc_profiler.h>
+
+#include "malloc_profiler_hooks.h"
+
+#define MAX_STACK_DEPTH 32
+// Stack 0 is the "[unknown]" stack.
+#define MAX_STACKS 1024
+#define STACK_TABLE_SIZE (2 * MAX_STACKS)
+#define MAX_LIVE_SAMPLES 8192
+#define LIVE_TABLE_SIZE (2 * MAX_LIVE_SAMPLES)
+
+#define DEFAULT_SAMPLE_INTERVAL (512 * 1024)
+// How often a thread looks for a new interval when sampling is off.
+#define DISABLED_RECHECK_BYTES (1024 * 1024)
+
+// JS library functions, see library.js.
+int _emscripten_malloc_profiler_unwind(uint32_t* buffer, int count);
+const char* emscripten_pc_get_function(uintptr_t pc);
+
+typedef struct stack_info {
+  uint32_t hash;
+  uint32_t depth;
+  // Innermost frame first.
+  uint32_t frames[MAX_STACK_DEPTH];
+  uint64_t live_bytes;
+} stack_info;
+
+typedef struct live_sample {
+  uintptr_t ptr; // 0 if the slot is empty.
+  uint32_t stack;
+  uint32_t weight;
+} live_sample;
+
+static stack_info stacks[MAX_STACKS];
+static uint32_t num_stacks = 1;
+// Indices into stacks, 0 if the slot is empty.
+static uint16_t stack_table[STACK_TABLE_SIZE];
+
+static live_sample live_table[LIVE_TABLE_SIZE];
+int _emscripten_malloc_profiler_live_samples;
+
+static size_t sample_interval = DEFAULT_SAMPLE_INTERVAL;
+
+__thread intptr_t _emscripten_malloc_profiler_bytes_until_sample;
+static __thread int thread_initialized;
+static __thread uint32_t random_state;
+// Set while the profiler itself runs on this thread, so that the allocations
+// it makes (e.g. in stdio) are neither sampled nor looked up.
+static __thread int in_profiler;
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+static volatile uint8_t profiler_lock = 0;
+#define PROFILER_ACQUIRE() while (__sync_lock_test_and_set(&profiler_lock, 1)) { while (profiler_lock) { /*nop*/ } }
+#define PROFILER_RELEASE() __sync_lock_release(&profiler_lock)
+#else
+#define PROFILER_ACQUIRE() ((void)0)
+#define PROFILER_RELEASE() ((void)0)
+#endif
+
+static uint32_t hash_ptr(uintptr_t ptr) {
+  // Allocations are at least 8 byte aligned, so drop the low bits.
+  return (uint32_t)(ptr >> 3) * 2654435761u;
+}
+
+static uint32_t next_random(void) {
+  // xorshift32
+  uint32_t x = random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return random_state = x;
+}
+
+// Draws the number of bytes until the next sample.
+static intptr_t next_sample_distance(size_t interval) {
+  if (!interval) {
+    return DISABLED_RECHECK_BYTES;
+  }
+  // Uniform in (0, 1].
+  double u = ((next_random() >> 8) + 1) / (double)(1 << 24);
+  double distance = -log(u) * interval;
+  return distance < INTPTR_MAX / 2 ? (intptr_t)distance : INTPTR_MAX / 2;
+}
+
+static void init_thread(size_t interval) {
+  thread_initialized = 1;
+  random_state = hash_ptr((uintptr_t)&thread_initialized) | 1;
+  _emscripten_malloc_profiler_bytes_until_sample = next_sample_distance(interval);
+}
+
+static uint32_t intern_stack(const uint32_t* frames, uint32_t depth) {
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < depth; i++) {
+    hash = (hash ^ frames[i]) * 16777619u;
+  }
+  for (uint32_t slot = hash % STACK_TABLE_SIZE;; slot = (slot + 1) % STACK_TABLE_SIZE) {
+    uint32_t index = stack_table[slot];
+    if (!index) {
+      if (num_stacks == MAX_STACKS) {
+        return 0;
+      }
+      index = num_stacks++;
+      stack_table[slot] = index;
+      stacks[index].hash = hash;
+      stacks[index].depth = depth;
+      memcpy(stacks[index].frames, frames, depth * sizeof(uint32_t));
+      return index;
+    }
+    if (stacks[index].hash == hash && stacks[index].depth == depth &&
+        !memcmp(stacks[index].frames, frames, depth * sizeof(uint32_t))) {
+      return index;
+    }
+  }
+}
+
+static void add_live_sample(uintptr_t ptr, uint32_t stack, uint32_t weight) {
+  if (_emscripten_malloc_profiler_live_samples == MAX_LIVE_SAMPLES) {
+    return;
+  }
+  uint32_t slot = hash_ptr(ptr) % LIVE_TABLE_SIZE;
+  while (live_table[slot].ptr) {
+    slot = (slot + 1) % LIVE_TABLE_SIZE;
+  }
+  live_table[slot].ptr = ptr;
+  live_table[slot].stack = stack;
+  live_table[slot].weight = weight;
+  stacks[stack].live_bytes += weight;
+  __atomic_store_n(&_emscripten_malloc_profiler_live_samples,
+                   _emscripten_malloc_profiler_live_samples + 1, __ATOMIC_RELAXED);
+}
+
+static void remove_live_sample(uintptr_t ptr) {
+  uint32_t slot = hash_ptr(ptr) % LIVE_TABLE_SIZE;
+  while (live_table[slot].ptr != ptr) {
+    if (!live_table[slot].ptr) {
+      return;
+    }
+    slot = (slot + 1) % LIVE_TABLE_SIZE;
+  }
+  stacks[live_table[slot].stack].live_bytes -= live_table[slot].weight;
+  __atomic_store_n(&_emscripten_malloc_profiler_live_samples,
+                   _emscripten_malloc_profiler_live_samples - 1, __ATOMIC_RELAXED);
+  // Linear probing: move later entries of the same run back into the hole,
+  // unless their home slot lies after the hole.
+  uint32_t hole = slot;
+  for (;;) {
+    slot = (slot + 1) % LIVE_TABLE_SIZE;
+    if (!live_table[slot].ptr) {
+      break;
+    }
+    uint32_t home = hash_ptr(live_table[slot].ptr) % LIVE_TABLE_SIZE;
+    if ((slot > hole && (home <= hole || home > slot)) ||
+        (slot < hole && (home <= hole && home > slot))) {
+      live_table[hole] = live_table[slot];
+      hole = slot;
+    }
+  }
+  live_table[hole].ptr = 0;
+}
+
+void _emscripten_malloc_profiler_sample(void* ptr, size_t size) {
+  if (in_profiler) {
+    return;
+  }
+  in_profiler = 1;
+  size_t interval = __atomic_load_n(&sample_interval, __ATOMIC_RELAXED);
+  if (!thread_initialized) {
+    // Start the countdown without sampling this allocation.
+    init_thread(interval);
+    in_profiler = 0;
+    return;
+  }
+  _emscripten_malloc_profiler_bytes_until_sample = next_sample_distance(interval);
+  if (!interval) {
+    in_profiler = 0;
+    return;
+  }
+
+  // An allocation of `size` bytes is sampled with probability
+  // 1 - exp(-size / interval), so it stands in for size / that many bytes.
+  double probability = -expm1(-(double)size / interval);
+  double weight = size / probability;
+
+  uint32_t frames[MAX_STACK_DEPTH];
+  int depth = _emscripten_malloc_profiler_unwind(frames, MAX_STACK_DEPTH);
+
+  PROFILER_ACQUIRE();
+  uint32_t stack = depth > 0 ? intern_stack(frames, depth) : 0;
+  add_live_sample((uintptr_t)ptr, stack, weight < UINT32_MAX ? (uint32_t)weight : UINT32_MAX);
+  PROFILER_RELEASE();
+  in_profiler = 0;
+}
+
+void _emscripten_malloc_profiler_forget(void* ptr) {
+  if (in_profiler) {
+    return;
+  }
+  PROFILER_ACQUIRE();
+  remove_live_sample((uintptr_t)ptr);
+  PROFILER_RELEASE();
+}
+
+void emscripten_malloc_profiler_set_sample_interval(size_t bytes) {
+  __atomic_store_n(&sample_interval, bytes, __ATOMIC_RELAXED);
+  // The calling thread switches right away.
+  init_thread(bytes);
+}
+
+static void write_frame(FILE* file, uint32_t pc) {
+  const char* name = emscripten_pc_get_function(pc);
+  if (!name) {
+    fprintf(file, "0x%x", pc);
+    return;
+  }
+  // Semicolons separate the frames.
+  for (; *name; name++) {
+    fputc(*name == ';' ? ':' : *name, file);
+  }
+}
+
+int emscripten_malloc_profiler_write_profile(const char* path) {
+  in_profiler = 1;
+  // Stacks are never changed after they are interned, so only their byte
+  // counts need to be read under the lock.
+  uint64_t live_bytes[MAX_STACKS];
+  PROFILER_ACQUIRE();
+  uint32_t count = num_stacks;
+  for (uint32_t i = 0; i < count; i++) {
+    live_bytes[i] = stacks[i].live_bytes;
+  }
+  PROFILER_RELEASE();
+
+  int ret = -1;
+  FILE* file = fopen(path, "w");
+  if (file) {
+    for (uint32_t i = 0; i < count; i++) {
+      if (!live_bytes[i]) {
+        continue;
+      }
+      if (!stacks[i].depth) {
+        fputs("[unknown]", file);
+      }
+      for (uint32_t j = stacks[i].depth; j-- > 0;) {
+        write_frame(file, stacks[i].frames[j]);
+        if (j) {
+          fputc(';', file);
+        }
+      }
+      fprintf(file, " %llu\n", live_bytes[i]);
+    }
+    ret = ferror(file) ? -1 : 0;
+    if (fclose(file)) {
+      ret = -1;
+    }
+  }
+  in_profiler = 0;
+  return ret;
+}
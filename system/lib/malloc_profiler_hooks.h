@@ -0,0 +1,41 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// Hooks that the allocators in libmalloc call when built with
+// EMSCRIPTEN_MALLOC_PROFILER, see malloc_profiler.c. Only the byte countdown to
+// the next sample is done inline; everything else is out of line.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern __thread intptr_t _emscripten_malloc_profiler_bytes_until_sample;
+extern int _emscripten_malloc_profiler_live_samples;
+
+void _emscripten_malloc_profiler_sample(void *ptr, size_t size);
+void _emscripten_malloc_profiler_forget(void *ptr);
+
+static inline void _emscripten_malloc_profiler_record_allocation(void *ptr, size_t size) {
+  if (ptr && (_emscripten_malloc_profiler_bytes_until_sample -= (intptr_t)size) < 0) {
+    _emscripten_malloc_profiler_sample(ptr, size);
+  }
+}
+
+static inline void _emscripten_malloc_profiler_record_free(void *ptr) {
+  if (ptr && __atomic_load_n(&_emscripten_malloc_profiler_live_samples, __ATOMIC_RELAXED)) {
+    _emscripten_malloc_profiler_forget(ptr);
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,53 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// The devices in /dev of NATIVEFS.
+
+#include "nativefs.h"
+
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+extern "C" {
+// Implemented in library_nativefs.js.
+void _emscripten_nativefs_write_stdio(int fd, const uint8_t* buf, size_t len);
+}
+
+namespace nativefs {
+
+class NullDevice : public DataFile {
+public:
+  NullDevice() : DataFile(S_IFCHR | 0666, getMemoryBackend()) { rdev = makedev(1, 3); }
+
+  ssize_t read(uint8_t* buf, size_t len, off_t offset) override { return 0; }
+  ssize_t write(const uint8_t* buf, size_t len, off_t offset) override { return len; }
+};
+
+// Output goes to out() or err() in JS, a line at a time. There is no input, so
+// reading stdin returns end of file.
+class StdioDevice : public DataFile {
+public:
+  StdioDevice(int fd) : DataFile(S_IFCHR | 0666, getMemoryBackend()), fd(fd) {
+    rdev = fd == STDERR_FILENO ? makedev(6, 0) : makedev(5, 0);
+  }
+
+  ssize_t read(uint8_t* buf, size_t len, off_t offset) override { return 0; }
+
+  ssize_t write(const uint8_t* buf, size_t len, off_t offset) override {
+    _emscripten_nativefs_write_stdio(fd, buf, len);
+    return len;
+  }
+
+  bool isTerminal() override { return true; }
+
+private:
+  const int fd;
+};
+
+DataFile* createNullDevice() { return new NullDevice(); }
+
+DataFile* createStdioDevice(int fd) { return new StdioDevice(fd); }
+
+} // namespace nativefs
@@ -0,0 +1,96 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// The in-memory backend of NATIVEFS, which stores file contents the same way
+// MEMFS does, but in malloc()ed memory instead of typed arrays.
+
+#include "nativefs.h"
+
+#include <string.h>
+
+namespace nativefs {
+
+class MemoryFile : public DataFile {
+public:
+  MemoryFile(mode_t mode, Backend* backend) : DataFile(mode, backend) {}
+  ~MemoryFile() { free(data); }
+
+  off_t getSize() override { return size; }
+
+  ssize_t read(uint8_t* buf, size_t len, off_t offset) override {
+    if (offset >= (off_t)size)
+      return 0;
+    if (len > size - offset)
+      len = size - offset;
+    memcpy(buf, data + offset, len);
+    return len;
+  }
+
+  ssize_t write(const uint8_t* buf, size_t len, off_t offset) override {
+    if ((uint64_t)offset > SIZE_MAX - len)
+      return -EFBIG;
+    size_t end = offset + len;
+    if (end > capacity) {
+      // Grow geometrically like MEMFS: doubling up to 1MB, then by 1/8.
+      size_t newCapacity = capacity < 1024 * 1024 ? capacity * 2 : capacity + capacity / 8;
+      if (newCapacity < end)
+        newCapacity = end;
+      if (capacity && newCapacity < 256)
+        newCapacity = 256;
+      if (!reserve(newCapacity))
+        return -ENOSPC;
+    }
+    if (offset > (off_t)size)
+      memset(data + size, 0, offset - size);
+    memcpy(data + offset, buf, len);
+    if (end > size)
+      size = end;
+    return len;
+  }
+
+  int setSize(off_t newSize) override {
+    if (newSize < 0)
+      return -EINVAL;
+    if ((uint64_t)newSize > SIZE_MAX)
+      return -EFBIG;
+    // Like MEMFS, resize the storage to exactly the new size.
+    if ((size_t)newSize != capacity && !reserve(newSize))
+      return -ENOSPC;
+    if ((size_t)newSize > size)
+      memset(data + size, 0, newSize - size);
+    size = newSize;
+    return 0;
+  }
+
+private:
+  bool reserve(size_t newCapacity) {
+    if (!newCapacity) {
+      free(data);
+      data = nullptr;
+    } else {
+      uint8_t* newData = (uint8_t*)realloc(data, newCapacity);
+      if (!newData)
+        return false;
+      data = newData;
+    }
+    capacity = newCapacity;
+    return true;
+  }
+
+  uint8_t* data = nullptr;
+  size_t size = 0;
+  size_t capacity = 0;
+};
+
+class MemoryBackend : public Backend {
+public:
+  DataFile* createFile(mode_t mode) override { return new MemoryFile(mode, this); }
+};
+
+static MemoryBackend memoryBackend;
+
+Backend* getMemoryBackend() { return &memoryBackend; }
+
+} // namespace nativefs
@@ -0,0 +1,362 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// The core of NATIVEFS: inodes, the directory tree, path lookup and the file
+// table. See nativefs.h for the locking rules.
+
+#include "nativefs.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace nativefs {
+
+// Same limits as the JS FS.
+#define MAX_OPEN_FDS 4096
+#define MAX_SYMLINK_DEPTH 40
+
+static ino_t nextIno = 1;
+
+Inode::Inode(mode_t mode, Backend* backend)
+  : ino(__atomic_fetch_add(&nextIno, 1, __ATOMIC_RELAXED)), backend(backend), mode(mode) {
+  clock_gettime(CLOCK_REALTIME, &mtime);
+  atime = ctime = mtime;
+}
+
+void Inode::touch(bool contents) {
+  clock_gettime(CLOCK_REALTIME, &ctime);
+  if (contents)
+    mtime = ctime;
+}
+
+Directory::~Directory() {
+  for (size_t i = 0; i < numEntries; ++i) {
+    free(entries[i].name);
+    entries[i].node->release();
+  }
+  free(entries);
+}
+
+static size_t findIndex(Directory* dir, const char* name, size_t len) {
+  for (size_t i = 0; i < dir->numEntries; ++i) {
+    const char* entryName = dir->entries[i].name;
+    if (!strncmp(entryName, name, len) && entryName[len] == '\0')
+      return i;
+  }
+  return dir->numEntries;
+}
+
+Inode* Directory::find(const char* name, size_t len) {
+  size_t i = findIndex(this, name, len);
+  return i < numEntries ? entries[i].node : nullptr;
+}
+
+int Directory::insert(const char* name, size_t len, Inode* node) {
+  if (numEntries == capacity) {
+    size_t newCapacity = capacity ? capacity * 2 : 8;
+    Entry* newEntries = (Entry*)realloc(entries, newCapacity * sizeof(Entry));
+    if (!newEntries)
+      return -ENOMEM;
+    entries = newEntries;
+    capacity = newCapacity;
+  }
+  char* copy = (char*)malloc(len + 1);
+  if (!copy)
+    return -ENOMEM;
+  memcpy(copy, name, len);
+  copy[len] = '\0';
+  entries[numEntries++] = {copy, node};
+  node->nlink = 1;
+  if (node->isDirectory())
+    ((Directory*)node)->parent = this;
+  return 0;
+}
+
+Inode* Directory::remove(const char* name, size_t len) {
+  size_t i = findIndex(this, name, len);
+  if (i == numEntries)
+    return nullptr;
+  Inode* node = entries[i].node;
+  free(entries[i].name);
+  // Keep the order of the remaining entries, so that readdir() does not skip
+  // any while they are being removed one by one.
+  memmove(entries + i, entries + i + 1, (numEntries - i - 1) * sizeof(Entry));
+  --numEntries;
+  node->nlink = 0;
+  if (node->isDirectory())
+    ((Directory*)node)->parent = nullptr;
+  return node;
+}
+
+Inode* Directory::replace(const char* name, size_t len, Inode* node) {
+  size_t i = findIndex(this, name, len);
+  Inode* old = entries[i].node;
+  entries[i].node = node;
+  old->nlink = 0;
+  if (old->isDirectory())
+    ((Directory*)old)->parent = nullptr;
+  node->nlink = 1;
+  if (node->isDirectory())
+    ((Directory*)node)->parent = this;
+  return old;
+}
+
+const char* Directory::nameInParent() {
+  for (size_t i = 0; parent && i < parent->numEntries; ++i) {
+    if (parent->entries[i].node == this)
+      return parent->entries[i].name;
+  }
+  return nullptr;
+}
+
+Symlink::Symlink(const char* target, Backend* backend)
+  : Inode(S_IFLNK | 0777, backend), target(strdup(target)) {}
+
+Symlink::~Symlink() { free(target); }
+
+off_t Symlink::getSize() { return strlen(target); }
+
+static RWLock tree;
+static Directory* root;
+static Directory* cwd;
+
+RWLock& treeLock() { return tree; }
+
+Directory* getRoot() { return root; }
+
+Directory* getCwd() { return cwd; }
+
+void setCwd(Directory* dir) {
+  cwd->release();
+  cwd = dir;
+}
+
+int getDirectoryPath(Directory* dir, char* buf, size_t size) {
+  // Measure the path first, then write it from the end.
+  size_t len = 0;
+  for (Directory* d = dir; d != root; d = d->parent) {
+    if (!d->parent)
+      return -ENOENT;
+    len += 1 + strlen(d->nameInParent());
+  }
+  if (!len)
+    len = 1;
+  if (len + 1 > size) {
+    if (size)
+      buf[0] = '\0';
+    return len;
+  }
+  buf[0] = '/';
+  buf[len] = '\0';
+  char* end = buf + len;
+  for (Directory* d = dir; d != root; d = d->parent) {
+    const char* name = d->nameInParent();
+    size_t nameLen = strlen(name);
+    end -= nameLen;
+    memcpy(end, name, nameLen);
+    *--end = '/';
+  }
+  return len;
+}
+
+int checkAccess(Inode* node, int mask) {
+  // Like the JS FS, allow access if any of the user, group or other bits
+  // allow it.
+  if ((mask & R_OK) && !(node->mode & (S_IRUSR | S_IRGRP | S_IROTH)))
+    return -EACCES;
+  if ((mask & W_OK) && !(node->mode & (S_IWUSR | S_IWGRP | S_IWOTH)))
+    return -EACCES;
+  if ((mask & X_OK) && !(node->mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+    return -EACCES;
+  return 0;
+}
+
+static int lookup(Directory* dir, const char* path, bool followLast, PathLookup& result, int& depth) {
+  if (*path == '\0')
+    return -ENOENT;
+  if (*path == '/') {
+    dir = root;
+    while (*path == '/')
+      ++path;
+    if (*path == '\0') {
+      result = PathLookup();
+      result.node = root;
+      return 0;
+    }
+  }
+
+  for (;;) {
+    const char* end = path;
+    while (*end && *end != '/')
+      ++end;
+    size_t len = end - path;
+    if (len > NAME_MAX)
+      return -ENAMETOOLONG;
+    const char* next = end;
+    while (*next == '/')
+      ++next;
+    bool last = *next == '\0';
+    bool trailingSlash = *end == '/';
+
+    int err = checkAccess(dir, X_OK);
+    if (err)
+      return err;
+
+    Inode* child;
+    bool dots = false;
+    if (len == 1 && path[0] == '.') {
+      child = dir;
+      dots = true;
+    } else if (len == 2 && path[0] == '.' && path[1] == '.') {
+      // A directory that was removed while in use has no parent.
+      if (!dir->parent)
+        return -ENOENT;
+      child = dir->parent;
+      dots = true;
+    } else {
+      child = dir->find(path, len);
+    }
+
+    if (child && child->isSymlink() && (!last || followLast || trailingSlash)) {
+      if (++depth > MAX_SYMLINK_DEPTH)
+        return -ELOOP;
+      PathLookup target;
+      err = lookup(dir, ((Symlink*)child)->target, true, target, depth);
+      if (err)
+        return err;
+      if (last) {
+        result = target;
+        if (trailingSlash && result.node && !result.node->isDirectory())
+          return -ENOTDIR;
+        return 0;
+      }
+      child = target.node;
+      if (!child)
+        return -ENOENT;
+    }
+
+    if (last) {
+      result.parent = dots ? nullptr : dir;
+      result.name = path;
+      result.nameLen = len;
+      result.node = child;
+      if (trailingSlash && child && !child->isDirectory())
+        return -ENOTDIR;
+      return 0;
+    }
+
+    if (!child)
+      return -ENOENT;
+    if (!child->isDirectory())
+      return -ENOTDIR;
+    dir = (Directory*)child;
+    path = next;
+  }
+}
+
+int lookupPath(Directory* base, const char* path, bool followLast, PathLookup& result) {
+  int depth = 0;
+  result = PathLookup();
+  return lookup(base, path, followLast, result, depth);
+}
+
+static Mutex fileTableMutex;
+static OpenFile* fileTable[MAX_OPEN_FDS];
+
+int addOpenFile(OpenFile* file, int minFd) {
+  LockGuard guard(fileTableMutex);
+  for (int fd = minFd < 0 ? 0 : minFd; fd < MAX_OPEN_FDS; ++fd) {
+    if (!fileTable[fd]) {
+      fileTable[fd] = file;
+      return fd;
+    }
+  }
+  return -EMFILE;
+}
+
+int setOpenFile(int fd, OpenFile* file) {
+  if (fd < 0 || fd >= MAX_OPEN_FDS)
+    return -EBADF;
+  OpenFile* old;
+  {
+    LockGuard guard(fileTableMutex);
+    old = fileTable[fd];
+    fileTable[fd] = file;
+  }
+  if (old)
+    old->release();
+  return fd;
+}
+
+OpenFile* getOpenFile(int fd) {
+  if (fd < 0 || fd >= MAX_OPEN_FDS)
+    return nullptr;
+  LockGuard guard(fileTableMutex);
+  OpenFile* file = fileTable[fd];
+  if (file)
+    file->acquire();
+  return file;
+}
+
+int closeOpenFile(int fd) {
+  if (fd < 0 || fd >= MAX_OPEN_FDS)
+    return -EBADF;
+  OpenFile* file;
+  {
+    LockGuard guard(fileTableMutex);
+    file = fileTable[fd];
+    fileTable[fd] = nullptr;
+  }
+  if (!file)
+    return -EBADF;
+  file->release();
+  return 0;
+}
+
+static void add(Directory* dir, const char* name, Inode* node) {
+  dir->insert(name, strlen(name), node);
+}
+
+static Directory* addDirectory(Directory* dir, const char* name) {
+  Directory* child = new Directory(S_IFDIR | 0777, dir->backend);
+  add(dir, name, child);
+  return child;
+}
+
+static void openStdio(int fd, Inode* node, int flags, const char* path) {
+  node->acquire();
+  fileTable[fd] = new OpenFile(node, flags, strdup(path));
+}
+
+// Sets up the same default layout as the JS FS. This runs before any other
+// code can do file I/O, on the main thread.
+__attribute__((constructor(50))) static void initialize() {
+  root = new Directory(S_IFDIR | 0777, getMemoryBackend());
+  root->parent = root;
+  root->nlink = 1;
+  root->acquire();
+  cwd = root;
+
+  addDirectory(root, "tmp");
+  addDirectory(addDirectory(root, "home"), "web_user");
+
+  Directory* dev = addDirectory(root, "dev");
+  add(dev, "null", createNullDevice());
+  DataFile* tty = createStdioDevice(STDOUT_FILENO);
+  DataFile* tty1 = createStdioDevice(STDERR_FILENO);
+  add(dev, "tty", tty);
+  add(dev, "tty1", tty1);
+  add(dev, "stdin", new Symlink("/dev/tty", dev->backend));
+  add(dev, "stdout", new Symlink("/dev/tty", dev->backend));
+  add(dev, "stderr", new Symlink("/dev/tty1", dev->backend));
+
+  openStdio(STDIN_FILENO, tty, O_RDONLY, "/dev/tty");
+  openStdio(STDOUT_FILENO, tty, O_WRONLY, "/dev/tty");
+  openStdio(STDERR_FILENO, tty1, O_WRONLY, "/dev/tty1");
+}
+
+} // namespace nativefs
@@ -0,0 +1,330 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Internal interface of NATIVEFS (-s NATIVEFS), a filesystem that lives in
+// the wasm module instead of in JS.
+//
+// All inodes and file contents are in linear memory, so in pthread builds any
+// thread can do file I/O directly, without proxying to the main thread.
+//
+// Locking:
+//  - treeLock() protects the names in the tree: directory entries, the parent
+//    of each directory, and the current working directory. Path lookups hold it
+//    for reading, and anything that adds, removes or renames an entry holds it
+//    for writing.
+//  - Inode::lock protects the metadata and contents of one inode. read() and
+//    pread() hold it for reading, so threads can read the same file at once.
+//  - OpenFile::lock protects the position of an open file description.
+//  - The file table has its own mutex.
+// Locks are taken in the order treeLock(), OpenFile::lock, Inode::lock, and
+// none of them is held while calling into a different subsystem.
+//
+// The C++ here does not depend on libc++ or libc++abi: objects are allocated
+// with malloc() through class-specific operator new, there is no RTTI, no
+// exceptions and no pure virtual methods.
+
+#pragma once
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+namespace nativefs {
+
+// Locks compile away in builds without pthreads.
+class Mutex {
+public:
+#ifdef __EMSCRIPTEN_PTHREADS__
+  void lock() { pthread_mutex_lock(&mutex); }
+  void unlock() { pthread_mutex_unlock(&mutex); }
+
+private:
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+#else
+  void lock() {}
+  void unlock() {}
+#endif
+};
+
+class RWLock {
+public:
+#ifdef __EMSCRIPTEN_PTHREADS__
+  void readLock() { pthread_rwlock_rdlock(&rwlock); }
+  void writeLock() { pthread_rwlock_wrlock(&rwlock); }
+  void unlock() { pthread_rwlock_unlock(&rwlock); }
+
+private:
+  pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+#else
+  void readLock() {}
+  void writeLock() {}
+  void unlock() {}
+#endif
+};
+
+class LockGuard {
+public:
+  explicit LockGuard(Mutex& mutex) : mutex(mutex) { mutex.lock(); }
+  ~LockGuard() { mutex.unlock(); }
+
+private:
+  Mutex& mutex;
+};
+
+class ReadGuard {
+public:
+  explicit ReadGuard(RWLock& rwlock) : rwlock(rwlock) { rwlock.readLock(); }
+  ~ReadGuard() { rwlock.unlock(); }
+
+private:
+  RWLock& rwlock;
+};
+
+class WriteGuard {
+public:
+  explicit WriteGuard(RWLock& rwlock) : rwlock(rwlock) { rwlock.writeLock(); }
+  ~WriteGuard() { rwlock.unlock(); }
+
+private:
+  RWLock& rwlock;
+};
+
+// Takes the read or the write side of a lock, chosen at runtime.
+class RWGuard {
+public:
+  RWGuard(RWLock& rwlock, bool write) : rwlock(rwlock) {
+    if (write)
+      rwlock.writeLock();
+    else
+      rwlock.readLock();
+  }
+  ~RWGuard() { rwlock.unlock(); }
+
+private:
+  RWLock& rwlock;
+};
+
+class Backend;
+
+// Base of everything in the tree. Inodes are reference counted: every
+// directory entry, open file, memory mapping and the current working directory
+// holds one reference.
+class Inode {
+public:
+  static void* operator new(size_t size) noexcept { return malloc(size); }
+  static void operator delete(void* ptr) { free(ptr); }
+
+  Inode(mode_t mode, Backend* backend);
+  virtual ~Inode() {}
+
+  void acquire() { __atomic_add_fetch(&refcount, 1, __ATOMIC_RELAXED); }
+  void release() {
+    if (__atomic_sub_fetch(&refcount, 1, __ATOMIC_ACQ_REL) == 0)
+      delete this;
+  }
+
+  bool isDirectory() const { return S_ISDIR(mode); }
+  bool isSymlink() const { return S_ISLNK(mode); }
+  bool isRegular() const { return S_ISREG(mode); }
+  bool isCharDevice() const { return S_ISCHR(mode); }
+
+  // Returns the size that stat() reports. Called with `lock` held.
+  virtual off_t getSize() { return 0; }
+
+  // Marks the inode as changed now. Called with `lock` held for writing.
+  void touch(bool contents);
+
+  // These are set on creation and never change.
+  const ino_t ino;
+  Backend* const backend;
+  dev_t rdev = 0;
+
+  RWLock lock;
+  // Protected by `lock`. The file type bits never change, and the permission
+  // bits are only changed with treeLock() held for writing as well, so that
+  // path lookups can check them.
+  mode_t mode;
+  // 1 while the inode has a name in the tree, 0 after it was removed.
+  // Protected by treeLock().
+  nlink_t nlink = 0;
+  struct timespec atime, mtime, ctime;
+
+private:
+  uint32_t refcount = 1;
+};
+
+// A regular file or a device. Backends subclass this to provide storage.
+// read() and getSize() are called with `lock` held for reading, the others
+// with `lock` held for writing.
+class DataFile : public Inode {
+public:
+  DataFile(mode_t mode, Backend* backend) : Inode(mode, backend) {}
+
+  virtual ssize_t read(uint8_t* buf, size_t len, off_t offset) { return -EIO; }
+  virtual ssize_t write(const uint8_t* buf, size_t len, off_t offset) { return -EIO; }
+  virtual int setSize(off_t size) { return -EINVAL; }
+  // Terminals have no position, and respond to the terminal ioctls.
+  virtual bool isTerminal() { return false; }
+};
+
+class Directory : public Inode {
+public:
+  struct Entry {
+    char* name;
+    Inode* node;
+  };
+
+  Directory(mode_t mode, Backend* backend) : Inode(mode, backend) {}
+  ~Directory();
+
+  off_t getSize() override { return 4096; }
+
+  // All of these are called with treeLock() held; the ones that modify the
+  // directory need it held for writing.
+  Inode* find(const char* name, size_t len);
+  // Adds an entry and takes over the caller's reference to `node`.
+  int insert(const char* name, size_t len, Inode* node);
+  // Removes an entry and hands its reference to the caller.
+  Inode* remove(const char* name, size_t len);
+  // Points an existing entry to a different inode, returning the old one.
+  Inode* replace(const char* name, size_t len, Inode* node);
+  // Returns the name this directory has in its parent.
+  const char* nameInParent();
+
+  // The containing directory; the root is its own parent, and a removed
+  // directory has none.
+  Directory* parent = nullptr;
+  Entry* entries = nullptr;
+  size_t numEntries = 0;
+
+private:
+  size_t capacity = 0;
+};
+
+class Symlink : public Inode {
+public:
+  Symlink(const char* target, Backend* backend);
+  ~Symlink();
+
+  off_t getSize() override;
+
+  // Set on creation and never changes.
+  char* target;
+};
+
+// Where new files get their storage. Files created in a directory use the
+// backend of that directory.
+class Backend {
+public:
+  // Returns null if out of memory.
+  virtual DataFile* createFile(mode_t mode) { return nullptr; }
+};
+
+// Keeps file contents in malloc()ed memory, like MEMFS.
+Backend* getMemoryBackend();
+
+// /dev/null and the terminal devices behind stdin, stdout and stderr.
+DataFile* createNullDevice();
+DataFile* createStdioDevice(int fd);
+
+// An open file description, shared by file descriptors made with dup().
+class OpenFile {
+public:
+  static void* operator new(size_t size) noexcept { return malloc(size); }
+  static void operator delete(void* ptr) { free(ptr); }
+
+  // Takes over the caller's reference to `node`, and the malloc()ed `path`.
+  OpenFile(Inode* node, int flags, char* path) : node(node), path(path), flags(flags) {}
+  ~OpenFile() {
+    node->release();
+    free(path);
+  }
+
+  void acquire() { __atomic_add_fetch(&refcount, 1, __ATOMIC_RELAXED); }
+  void release() {
+    if (__atomic_sub_fetch(&refcount, 1, __ATOMIC_ACQ_REL) == 0)
+      delete this;
+  }
+
+  Inode* const node;
+  // The absolute path the file was opened with, which is what readlink() of
+  // /proc/self/fd/N returns. Null if out of memory.
+  char* const path;
+  // Protects `position` and `flags`.
+  Mutex lock;
+  off_t position = 0;
+  int flags;
+
+private:
+  uint32_t refcount = 1;
+};
+
+RWLock& treeLock();
+Directory* getRoot();
+// Called with treeLock() held.
+Directory* getCwd();
+// Called with treeLock() held for writing. Takes over the reference to `dir`.
+void setCwd(Directory* dir);
+
+// Writes the absolute path of `dir` to `buf`, truncated to `size` bytes
+// including the terminating null, like snprintf(). Returns the length of the
+// full path, or -ENOENT if the directory was removed. Called with treeLock()
+// held.
+int getDirectoryPath(Directory* dir, char* buf, size_t size);
+
+// Adds `file` to the file table at the lowest free descriptor >= minFd.
+// Returns the descriptor, in which case the table took over the caller's
+// reference, or -EMFILE.
+int addOpenFile(OpenFile* file, int minFd = 0);
+// Puts `file` at exactly descriptor `fd`, closing what was there before.
+int setOpenFile(int fd, OpenFile* file);
+// Returns the open file for `fd` with a reference held, or null.
+OpenFile* getOpenFile(int fd);
+// Removes `fd` from the table and drops its reference.
+int closeOpenFile(int fd);
+
+// Holds a reference to an open file for the duration of a syscall, so another
+// thread closing the descriptor does not free it under us.
+class FileRef {
+public:
+  explicit FileRef(int fd) : file(getOpenFile(fd)) {}
+  ~FileRef() {
+    if (file)
+      file->release();
+  }
+  OpenFile* operator->() const { return file; }
+  explicit operator bool() const { return file; }
+  OpenFile* get() const { return file; }
+
+private:
+  OpenFile* file;
+};
+
+// The result of looking up a path. `parent` and `name` describe the last
+// component so that callers can create or remove it; `parent` is null when
+// the last component is "." or "..", or the path is "/".
+struct PathLookup {
+  Directory* parent = nullptr;
+  const char* name = nullptr;
+  size_t nameLen = 0;
+  // Null if the last component does not exist.
+  Inode* node = nullptr;
+};
+
+// Looks up `path`, relative to `base` unless it is absolute, following
+// symlinks in all but the last component; the last one is followed when
+// `followLast` is set. Called with treeLock() held. Returns 0 or -errno; a
+// missing last component is not an error.
+int lookupPath(Directory* base, const char* path, bool followLast, PathLookup& result);
+
+// Checks R_OK, W_OK and X_OK bits against the mode of `node`, like the JS FS
+// does. Returns 0 or -EACCES.
+int checkAccess(Inode* node, int mask);
+
+} // namespace nativefs
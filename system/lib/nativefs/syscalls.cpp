@@ -0,0 +1,1296 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// The syscalls and WASI functions that NATIVEFS implements. Defining them here
+// means the linker resolves them to these instead of importing the JS versions
+// from library_syscall.js and library_wasi.js, so they run on the calling
+// thread. Everything follows the behavior of the JS FS with MEMFS, including
+// its errors.
+
+#include "nativefs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <malloc.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+#include <wasi/api.h>
+
+using namespace nativefs;
+
+namespace {
+
+// Looks up a path for the *at() syscalls, where `dir` is the open file for
+// `dirfd`. Called with treeLock() held.
+int lookupAt(int dirfd, const FileRef& dir, const char* path, bool followLast, PathLookup& result) {
+  if (!path)
+    return -EFAULT;
+  Directory* base;
+  if (dirfd == AT_FDCWD || path[0] == '/')
+    base = getCwd();
+  else if (!dir)
+    return -EBADF;
+  else if (!dir->node->isDirectory())
+    return -ENOTDIR;
+  else
+    base = (Directory*)dir->node;
+  return lookupPath(base, path, followLast, result);
+}
+
+// Adds a new regular file as the last component of `lookup`. Called with
+// treeLock() held for writing.
+int createFile(PathLookup& lookup, mode_t mode, DataFile** created) {
+  if (lookup.name[lookup.nameLen] == '/')
+    return -EISDIR;
+  int err = checkAccess(lookup.parent, W_OK | X_OK);
+  if (err)
+    return err;
+  DataFile* file = lookup.parent->backend->createFile(S_IFREG | (mode & 0777));
+  if (!file)
+    return -ENOMEM;
+  err = lookup.parent->insert(lookup.name, lookup.nameLen, file);
+  if (err) {
+    file->release();
+    return err;
+  }
+  *created = file;
+  return 0;
+}
+
+void fillStat(Inode* node, struct stat* buf) {
+  memset(buf, 0, sizeof(*buf));
+  buf->st_dev = node->isCharDevice() ? node->ino : 1;
+  buf->st_ino = node->ino;
+  buf->st_mode = node->mode;
+  buf->st_nlink = node->nlink;
+  buf->st_rdev = node->rdev;
+  buf->st_size = node->getSize();
+  buf->st_blksize = 4096;
+  buf->st_blocks = (buf->st_size + 4095) / 4096;
+  buf->st_atim = node->atime;
+  buf->st_mtim = node->mtime;
+  buf->st_ctim = node->ctime;
+}
+
+ssize_t readAt(Inode* node, const __wasi_iovec_t* iovs, size_t iovsLen, off_t offset) {
+  if (node->isDirectory())
+    return -EISDIR;
+  DataFile* file = (DataFile*)node;
+  ssize_t total = 0;
+  for (size_t i = 0; i < iovsLen; ++i) {
+    ssize_t n = file->read(iovs[i].buf, iovs[i].buf_len, offset + total);
+    if (n < 0)
+      return total ? total : n;
+    total += n;
+    if ((size_t)n < iovs[i].buf_len)
+      break;
+  }
+  return total;
+}
+
+ssize_t writeAt(Inode* node, const __wasi_ciovec_t* iovs, size_t iovsLen, off_t offset) {
+  if (node->isDirectory())
+    return -EISDIR;
+  DataFile* file = (DataFile*)node;
+  ssize_t total = 0;
+  for (size_t i = 0; i < iovsLen; ++i) {
+    ssize_t n = file->write(iovs[i].buf, iovs[i].buf_len, offset + total);
+    if (n < 0)
+      return total ? total : n;
+    total += n;
+  }
+  if (total && node->isRegular())
+    node->touch(true);
+  return total;
+}
+
+bool isTerminal(Inode* node) { return !node->isDirectory() && ((DataFile*)node)->isTerminal(); }
+
+// Returns the absolute path of the last component of `lookup` in malloc()ed
+// memory, or null if out of memory. Called with treeLock() held.
+char* getLookupPath(const PathLookup& lookup) {
+  if (!lookup.parent) {
+    // ".", ".." or "/", which are all directories.
+    int len = getDirectoryPath((Directory*)lookup.node, nullptr, 0);
+    char* path = len >= 0 ? (char*)malloc(len + 1) : nullptr;
+    if (path)
+      getDirectoryPath((Directory*)lookup.node, path, len + 1);
+    return path;
+  }
+  int len = getDirectoryPath(lookup.parent, nullptr, 0);
+  if (len < 0)
+    return nullptr;
+  // The root directory is "/", everything else needs a separator.
+  size_t dirLen = len == 1 ? 0 : len;
+  char* path = (char*)malloc(dirLen + 1 + lookup.nameLen + 1);
+  if (!path)
+    return nullptr;
+  getDirectoryPath(lookup.parent, path, dirLen + 1);
+  path[dirLen] = '/';
+  memcpy(path + dirLen + 1, lookup.name, lookup.nameLen);
+  path[dirLen + 1 + lookup.nameLen] = '\0';
+  return path;
+}
+
+long doOpen(int dirfd, const char* path, int flags, mode_t mode) {
+  FileRef dir(dirfd);
+  Inode* node;
+  char* fullPath;
+  bool created = false;
+  {
+    bool create = flags & O_CREAT;
+    RWGuard guard(treeLock(), create);
+    PathLookup lookup;
+    int err = lookupAt(dirfd, dir, path, !(flags & O_NOFOLLOW), lookup);
+    if (err)
+      return err;
+    node = lookup.node;
+    if (node) {
+      if (create && (flags & O_EXCL))
+        return -EEXIST;
+    } else {
+      if (!create)
+        return -ENOENT;
+      DataFile* file;
+      err = createFile(lookup, mode, &file);
+      if (err)
+        return err;
+      node = file;
+      created = true;
+    }
+    node->acquire();
+    fullPath = getLookupPath(lookup);
+  }
+
+  // Like the JS FS, the permissions of a file that was just created are not
+  // checked, so that it can be opened for writing whatever its mode.
+  int err = 0;
+  int accmode = flags & O_ACCMODE;
+  if (!created) {
+    ReadGuard guard(node->lock);
+    if (node->isSymlink())
+      err = -ELOOP;
+    else if (node->isDirectory() && (accmode != O_RDONLY || (flags & O_TRUNC)))
+      err = -EISDIR;
+    else if ((flags & O_DIRECTORY) && !node->isDirectory())
+      err = -ENOTDIR;
+    else
+      err = checkAccess(node, (accmode != O_WRONLY ? R_OK : 0) |
+                              (accmode != O_RDONLY || (flags & O_TRUNC) ? W_OK : 0));
+  }
+  if (!err && (flags & O_TRUNC) && node->isRegular()) {
+    WriteGuard guard(node->lock);
+    err = ((DataFile*)node)->setSize(0);
+    if (!err)
+      node->touch(true);
+  }
+  if (err) {
+    node->release();
+    free(fullPath);
+    return err;
+  }
+
+  OpenFile* file = new OpenFile(node, flags & ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC), fullPath);
+  if (!file) {
+    node->release();
+    free(fullPath);
+    return -ENOMEM;
+  }
+  int fd = addOpenFile(file);
+  if (fd < 0)
+    file->release();
+  return fd;
+}
+
+long doUnlinkAt(int dirfd, const char* path, int flags) {
+  FileRef dir(dirfd);
+  Inode* node;
+  {
+    WriteGuard guard(treeLock());
+    PathLookup lookup;
+    int err = lookupAt(dirfd, dir, path, false, lookup);
+    if (err)
+      return err;
+    if (!lookup.node)
+      return -ENOENT;
+    if (flags & AT_REMOVEDIR) {
+      if (!lookup.node->isDirectory())
+        return -ENOTDIR;
+      if (!lookup.parent)
+        return lookup.node == getRoot() ? -EBUSY : -EINVAL;
+      // Like the JS FS, do not remove the current working directory.
+      if (lookup.node == getCwd())
+        return -EBUSY;
+      if (((Directory*)lookup.node)->numEntries)
+        return -ENOTEMPTY;
+    } else if (lookup.node->isDirectory()) {
+      return -EISDIR;
+    }
+    err = checkAccess(lookup.parent, W_OK | X_OK);
+    if (err)
+      return err;
+    node = lookup.parent->remove(lookup.name, lookup.nameLen);
+  }
+  // Open files keep the inode alive until they are closed.
+  node->release();
+  return 0;
+}
+
+long doMkdirAt(int dirfd, const char* path, mode_t mode) {
+  FileRef dir(dirfd);
+  WriteGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupAt(dirfd, dir, path, false, lookup);
+  if (err)
+    return err;
+  if (lookup.node)
+    return -EEXIST;
+  err = checkAccess(lookup.parent, W_OK | X_OK);
+  if (err)
+    return err;
+  Directory* child = new Directory(S_IFDIR | (mode & 0777), lookup.parent->backend);
+  if (!child)
+    return -ENOMEM;
+  err = lookup.parent->insert(lookup.name, lookup.nameLen, child);
+  if (err)
+    child->release();
+  return err;
+}
+
+long doMknodAt(int dirfd, const char* path, mode_t mode, dev_t dev) {
+  switch (mode & S_IFMT) {
+    case 0:
+    case S_IFREG:
+      break;
+    case S_IFCHR:
+    case S_IFBLK:
+    case S_IFIFO:
+    case S_IFSOCK:
+      // Only /dev has devices.
+      return -EPERM;
+    default:
+      return -EINVAL;
+  }
+  FileRef dir(dirfd);
+  WriteGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupAt(dirfd, dir, path, false, lookup);
+  if (err)
+    return err;
+  if (lookup.node)
+    return -EEXIST;
+  DataFile* file;
+  return createFile(lookup, mode, &file);
+}
+
+long doRenameAt(int olddirfd, const char* oldpath, int newdirfd, const char* newpath) {
+  FileRef oldDir(olddirfd);
+  FileRef newDir(newdirfd);
+  Inode* replaced = nullptr;
+  {
+    WriteGuard guard(treeLock());
+    PathLookup from, to;
+    int err = lookupAt(olddirfd, oldDir, oldpath, false, from);
+    if (err)
+      return err;
+    if (!from.node)
+      return -ENOENT;
+    err = lookupAt(newdirfd, newDir, newpath, false, to);
+    if (err)
+      return err;
+    if (!from.parent || !to.parent)
+      return -EBUSY;
+    if (from.node == to.node)
+      return 0;
+    bool isDirectory = from.node->isDirectory();
+    if (to.node) {
+      if (isDirectory && !to.node->isDirectory())
+        return -ENOTDIR;
+      if (!isDirectory && to.node->isDirectory())
+        return -EISDIR;
+      if (to.node->isDirectory() && ((Directory*)to.node)->numEntries)
+        return -ENOTEMPTY;
+      if (to.node == getCwd())
+        return -EBUSY;
+    }
+    if (isDirectory) {
+      // A directory cannot be moved into itself.
+      for (Directory* dir = to.parent; dir && dir != getRoot(); dir = dir->parent) {
+        if (dir == from.node)
+          return -EINVAL;
+      }
+    }
+    err = checkAccess(from.parent, W_OK | X_OK);
+    if (!err)
+      err = checkAccess(to.parent, W_OK | X_OK);
+    if (err)
+      return err;
+
+    Inode* node = from.node;
+    if (to.node) {
+      from.parent->remove(from.name, from.nameLen);
+      replaced = to.parent->replace(to.name, to.nameLen, node);
+    } else {
+      // Add the new name first, as that is what can fail. The entry shares
+      // the reference of the old one, which remove() hands back to us.
+      err = to.parent->insert(to.name, to.nameLen, node);
+      if (err)
+        return err;
+      from.parent->remove(from.name, from.nameLen);
+      // remove() marked the inode as detached from the tree.
+      node->nlink = 1;
+      if (isDirectory)
+        ((Directory*)node)->parent = to.parent;
+    }
+    node->lock.writeLock();
+    node->touch(false);
+    node->lock.unlock();
+  }
+  if (replaced)
+    replaced->release();
+  return 0;
+}
+
+long doSymlinkAt(const char* target, int newdirfd, const char* linkpath) {
+  if (!target)
+    return -EFAULT;
+  if (!*target)
+    return -ENOENT;
+  FileRef dir(newdirfd);
+  WriteGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupAt(newdirfd, dir, linkpath, false, lookup);
+  if (err)
+    return err;
+  if (lookup.node)
+    return -EEXIST;
+  err = checkAccess(lookup.parent, W_OK | X_OK);
+  if (err)
+    return err;
+  Symlink* link = new Symlink(target, lookup.parent->backend);
+  if (!link)
+    return -ENOMEM;
+  if (!link->target) {
+    link->release();
+    return -ENOMEM;
+  }
+  err = lookup.parent->insert(lookup.name, lookup.nameLen, link);
+  if (err)
+    link->release();
+  return err;
+}
+
+// Like the JS FS, /proc/self/fd/N is a link to the path of open file N, which
+// is what realpath() uses. There is nothing else in /proc.
+long readFdLink(const char* fdName, char* buf, size_t bufsize) {
+  char* end;
+  long fd = strtol(fdName, &end, 10);
+  if (end == fdName || *end)
+    return -ENOENT;
+  FileRef file(fd);
+  if (!file)
+    return -ENOENT;
+  if (!file->path)
+    return -ENOMEM;
+  size_t len = strlen(file->path);
+  if (len > bufsize)
+    len = bufsize;
+  memcpy(buf, file->path, len);
+  return len;
+}
+
+long doReadlinkAt(int dirfd, const char* path, char* buf, size_t bufsize) {
+  if ((ssize_t)bufsize <= 0)
+    return -EINVAL;
+  if (path && !strncmp(path, "/proc/self/fd/", 14))
+    return readFdLink(path + 14, buf, bufsize);
+  FileRef dir(dirfd);
+  ReadGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupAt(dirfd, dir, path, false, lookup);
+  if (err)
+    return err;
+  if (!lookup.node)
+    return -ENOENT;
+  if (!lookup.node->isSymlink())
+    return -EINVAL;
+  const char* target = ((Symlink*)lookup.node)->target;
+  size_t len = strlen(target);
+  if (len > bufsize)
+    len = bufsize;
+  memcpy(buf, target, len);
+  return len;
+}
+
+long doStatAt(int dirfd, const char* path, struct stat* buf, int flags) {
+  FileRef dir(dirfd);
+  if (path && !*path && (flags & AT_EMPTY_PATH)) {
+    if (!dir)
+      return -EBADF;
+    ReadGuard guard(dir->node->lock);
+    fillStat(dir->node, buf);
+    return 0;
+  }
+  ReadGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupAt(dirfd, dir, path, !(flags & AT_SYMLINK_NOFOLLOW), lookup);
+  if (err)
+    return err;
+  if (!lookup.node)
+    return -ENOENT;
+  ReadGuard nodeGuard(lookup.node->lock);
+  fillStat(lookup.node, buf);
+  return 0;
+}
+
+int setMode(Inode* node, mode_t mode) {
+  WriteGuard guard(node->lock);
+  node->mode = (node->mode & S_IFMT) | (mode & 07777);
+  node->touch(false);
+  return 0;
+}
+
+long doChmodAt(int dirfd, const char* path, mode_t mode, int flags) {
+  FileRef dir(dirfd);
+  WriteGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupAt(dirfd, dir, path, !(flags & AT_SYMLINK_NOFOLLOW), lookup);
+  if (err)
+    return err;
+  if (!lookup.node)
+    return -ENOENT;
+  return setMode(lookup.node, mode);
+}
+
+long doAccessAt(int dirfd, const char* path, int amode, int flags) {
+  if (amode & ~(R_OK | W_OK | X_OK))
+    return -EINVAL;
+  FileRef dir(dirfd);
+  ReadGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupAt(dirfd, dir, path, !(flags & AT_SYMLINK_NOFOLLOW), lookup);
+  if (err)
+    return err;
+  if (!lookup.node)
+    return -ENOENT;
+  return checkAccess(lookup.node, amode);
+}
+
+// Ownership is not tracked; like the JS FS, only check that the file exists.
+long doChownAt(int dirfd, const char* path, int flags) {
+  FileRef dir(dirfd);
+  ReadGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupAt(dirfd, dir, path, !(flags & AT_SYMLINK_NOFOLLOW), lookup);
+  if (err)
+    return err;
+  return lookup.node ? 0 : -ENOENT;
+}
+
+int truncateNode(Inode* node, off_t length) {
+  if (length < 0)
+    return -EINVAL;
+  if (node->isDirectory())
+    return -EISDIR;
+  if (!node->isRegular())
+    return -EINVAL;
+  WriteGuard guard(node->lock);
+  int err = ((DataFile*)node)->setSize(length);
+  if (!err)
+    node->touch(true);
+  return err;
+}
+
+off_t makeOffset(long low, long high) {
+  return (off_t)(((uint64_t)(uint32_t)high << 32) | (uint32_t)low);
+}
+
+void fillStatfs(struct statfs* buf) {
+  // None of these are true, they are the same safe values the JS FS reports.
+  memset(buf, 0, sizeof(*buf));
+  buf->f_bsize = 4096;
+  buf->f_frsize = 4096;
+  buf->f_blocks = 1000000;
+  buf->f_bfree = 500000;
+  buf->f_bavail = 500000;
+  buf->f_files = 1000000;
+  buf->f_ffree = 1000000;
+  buf->f_fsid.__val[0] = 42;
+  buf->f_flags = 2; // ST_NOSUID
+  buf->f_namelen = NAME_MAX;
+}
+
+int dupTo(int oldfd, int newfd) {
+  FileRef file(oldfd);
+  if (!file)
+    return -EBADF;
+  file->acquire();
+  int fd = setOpenFile(newfd, file.get());
+  if (fd < 0)
+    file->release();
+  return fd;
+}
+
+// Memory mappings of files. Like the JS FS, mappings are copies of the file
+// contents; MAP_SHARED mappings are written back by msync() and munmap().
+struct Mapping {
+  Mapping* next;
+  uint8_t* addr;
+  size_t len;
+  // Null for anonymous mappings.
+  DataFile* file;
+  off_t offset;
+  int flags;
+  int prot;
+};
+
+Mutex mappingsMutex;
+Mapping* mappings;
+
+// Called with mappingsMutex held.
+void syncMapping(Mapping* mapping) {
+  if (!mapping->file || !(mapping->flags & MAP_SHARED) || !(mapping->prot & PROT_WRITE))
+    return;
+  WriteGuard guard(mapping->file->lock);
+  // Do not extend the file with the padding at the end of the last page.
+  off_t size = mapping->file->getSize();
+  if (mapping->offset >= size)
+    return;
+  size_t len = mapping->len;
+  if ((off_t)len > size - mapping->offset)
+    len = size - mapping->offset;
+  if (mapping->file->write(mapping->addr, len, mapping->offset) > 0)
+    mapping->file->touch(true);
+}
+
+} // anonymous namespace
+
+extern "C" {
+
+long __syscall5(long path, long flags, ...) // open
+{
+  mode_t mode = 0;
+  if (flags & O_CREAT) {
+    va_list vl;
+    va_start(vl, flags);
+    mode = va_arg(vl, int);
+    va_end(vl);
+  }
+  return doOpen(AT_FDCWD, (const char*)path, flags, mode);
+}
+
+long __syscall295(long dirfd, long path, long flags, ...) // openat
+{
+  mode_t mode = 0;
+  if (flags & O_CREAT) {
+    va_list vl;
+    va_start(vl, flags);
+    mode = va_arg(vl, int);
+    va_end(vl);
+  }
+  return doOpen(dirfd, (const char*)path, flags, mode);
+}
+
+__wasi_errno_t __wasi_fd_close(__wasi_fd_t fd) {
+  return -closeOpenFile(fd);
+}
+
+__wasi_errno_t __wasi_fd_read(
+  __wasi_fd_t fd, const __wasi_iovec_t* iovs, size_t iovs_len, __wasi_size_t* nread) {
+  FileRef file(fd);
+  if (!file || (file->flags & O_ACCMODE) == O_WRONLY)
+    return __WASI_ERRNO_BADF;
+  Inode* node = file->node;
+  LockGuard positionGuard(file->lock);
+  ssize_t n;
+  {
+    ReadGuard guard(node->lock);
+    n = readAt(node, iovs, iovs_len, file->position);
+  }
+  if (n < 0)
+    return -n;
+  if (!isTerminal(node))
+    file->position += n;
+  *nread = n;
+  return 0;
+}
+
+__wasi_errno_t __wasi_fd_write(
+  __wasi_fd_t fd, const __wasi_ciovec_t* iovs, size_t iovs_len, __wasi_size_t* nwritten) {
+  FileRef file(fd);
+  if (!file || (file->flags & O_ACCMODE) == O_RDONLY)
+    return __WASI_ERRNO_BADF;
+  Inode* node = file->node;
+  LockGuard positionGuard(file->lock);
+  off_t offset;
+  ssize_t n;
+  {
+    WriteGuard guard(node->lock);
+    offset = (file->flags & O_APPEND) ? node->getSize() : file->position;
+    n = writeAt(node, iovs, iovs_len, offset);
+  }
+  if (n < 0)
+    return -n;
+  if (!isTerminal(node))
+    file->position = offset + n;
+  *nwritten = n;
+  return 0;
+}
+
+__wasi_errno_t __wasi_fd_pread(__wasi_fd_t fd, const __wasi_iovec_t* iovs, size_t iovs_len,
+  __wasi_filesize_t offset, __wasi_size_t* nread) {
+  FileRef file(fd);
+  if (!file || (file->flags & O_ACCMODE) == O_WRONLY)
+    return __WASI_ERRNO_BADF;
+  if (isTerminal(file->node))
+    return __WASI_ERRNO_SPIPE;
+  if ((off_t)offset < 0)
+    return __WASI_ERRNO_INVAL;
+  ReadGuard guard(file->node->lock);
+  ssize_t n = readAt(file->node, iovs, iovs_len, offset);
+  if (n < 0)
+    return -n;
+  *nread = n;
+  return 0;
+}
+
+__wasi_errno_t __wasi_fd_pwrite(__wasi_fd_t fd, const __wasi_ciovec_t* iovs, size_t iovs_len,
+  __wasi_filesize_t offset, __wasi_size_t* nwritten) {
+  FileRef file(fd);
+  if (!file || (file->flags & O_ACCMODE) == O_RDONLY)
+    return __WASI_ERRNO_BADF;
+  if (isTerminal(file->node))
+    return __WASI_ERRNO_SPIPE;
+  if ((off_t)offset < 0)
+    return __WASI_ERRNO_INVAL;
+  WriteGuard guard(file->node->lock);
+  ssize_t n = writeAt(file->node, iovs, iovs_len, offset);
+  if (n < 0)
+    return -n;
+  *nwritten = n;
+  return 0;
+}
+
+__wasi_errno_t __wasi_fd_seek(__wasi_fd_t fd, __wasi_filedelta_t offset, __wasi_whence_t whence,
+  __wasi_filesize_t* newoffset) {
+  FileRef file(fd);
+  if (!file)
+    return __WASI_ERRNO_BADF;
+  Inode* node = file->node;
+  if (isTerminal(node))
+    return __WASI_ERRNO_SPIPE;
+  LockGuard positionGuard(file->lock);
+  off_t base;
+  switch (whence) {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = file->position;
+      break;
+    case SEEK_END: {
+      ReadGuard guard(node->lock);
+      base = node->getSize();
+      break;
+    }
+    default:
+      return __WASI_ERRNO_INVAL;
+  }
+  off_t position = base + offset;
+  if (position < 0)
+    return __WASI_ERRNO_INVAL;
+  file->position = position;
+  *newoffset = position;
+  return 0;
+}
+
+__wasi_errno_t __wasi_fd_sync(__wasi_fd_t fd) {
+  // There is nowhere to write the data to.
+  return FileRef(fd) ? 0 : __WASI_ERRNO_BADF;
+}
+
+__wasi_errno_t __wasi_fd_fdstat_get(__wasi_fd_t fd, __wasi_fdstat_t* stat) {
+  FileRef file(fd);
+  if (!file)
+    return __WASI_ERRNO_BADF;
+  Inode* node = file->node;
+  memset(stat, 0, sizeof(*stat));
+  if (isTerminal(node))
+    stat->fs_filetype = __WASI_FILETYPE_CHARACTER_DEVICE;
+  else if (node->isDirectory())
+    stat->fs_filetype = __WASI_FILETYPE_DIRECTORY;
+  else
+    stat->fs_filetype = __WASI_FILETYPE_REGULAR_FILE;
+  return 0;
+}
+
+long __syscall10(long path) // unlink
+{
+  return doUnlinkAt(AT_FDCWD, (const char*)path, 0);
+}
+
+long __syscall301(long dirfd, long path, long flags) // unlinkat
+{
+  if (flags & ~AT_REMOVEDIR)
+    return -EINVAL;
+  return doUnlinkAt(dirfd, (const char*)path, flags);
+}
+
+long __syscall40(long path) // rmdir
+{
+  return doUnlinkAt(AT_FDCWD, (const char*)path, AT_REMOVEDIR);
+}
+
+long __syscall39(long path, long mode) // mkdir
+{
+  return doMkdirAt(AT_FDCWD, (const char*)path, mode);
+}
+
+long __syscall296(long dirfd, long path, long mode) // mkdirat
+{
+  return doMkdirAt(dirfd, (const char*)path, mode);
+}
+
+long __syscall14(long path, long mode, long dev) // mknod
+{
+  return doMknodAt(AT_FDCWD, (const char*)path, mode, dev);
+}
+
+long __syscall297(long dirfd, long path, long mode, long dev) // mknodat
+{
+  return doMknodAt(dirfd, (const char*)path, mode, dev);
+}
+
+long __syscall38(long old_path, long new_path) // rename
+{
+  return doRenameAt(AT_FDCWD, (const char*)old_path, AT_FDCWD, (const char*)new_path);
+}
+
+long __syscall302(long olddirfd, long oldpath, long newdirfd, long newpath) // renameat
+{
+  return doRenameAt(olddirfd, (const char*)oldpath, newdirfd, (const char*)newpath);
+}
+
+long __syscall83(long target, long linkpath) // symlink
+{
+  return doSymlinkAt((const char*)target, AT_FDCWD, (const char*)linkpath);
+}
+
+long __syscall304(long target, long newdirfd, long linkpath) // symlinkat
+{
+  return doSymlinkAt((const char*)target, newdirfd, (const char*)linkpath);
+}
+
+long __syscall85(long path, long buf, long bufsize) // readlink
+{
+  return doReadlinkAt(AT_FDCWD, (const char*)path, (char*)buf, bufsize);
+}
+
+long __syscall305(long dirfd, long path, long buf, long bufsize) // readlinkat
+{
+  return doReadlinkAt(dirfd, (const char*)path, (char*)buf, bufsize);
+}
+
+long __syscall195(long path, long buf) // stat64
+{
+  return doStatAt(AT_FDCWD, (const char*)path, (struct stat*)buf, 0);
+}
+
+long __syscall196(long path, long buf) // lstat64
+{
+  return doStatAt(AT_FDCWD, (const char*)path, (struct stat*)buf, AT_SYMLINK_NOFOLLOW);
+}
+
+long __syscall197(long fd, long buf) // fstat64
+{
+  FileRef file(fd);
+  if (!file)
+    return -EBADF;
+  ReadGuard guard(file->node->lock);
+  fillStat(file->node, (struct stat*)buf);
+  return 0;
+}
+
+long __syscall300(long dirfd, long path, long buf, long flags) // fstatat64
+{
+  if (flags & ~(AT_SYMLINK_NOFOLLOW | AT_EMPTY_PATH | AT_NO_AUTOMOUNT))
+    return -EINVAL;
+  return doStatAt(dirfd, (const char*)path, (struct stat*)buf, flags);
+}
+
+long __syscall15(long path, long mode) // chmod
+{
+  return doChmodAt(AT_FDCWD, (const char*)path, mode, 0);
+}
+
+long __syscall306(long dirfd, long path, long mode, ...) // fchmodat
+{
+  va_list vl;
+  va_start(vl, mode);
+  int flags = va_arg(vl, int);
+  va_end(vl);
+  return doChmodAt(dirfd, (const char*)path, mode, flags);
+}
+
+long __syscall94(long fd, long mode) // fchmod
+{
+  FileRef file(fd);
+  if (!file)
+    return -EBADF;
+  WriteGuard guard(treeLock());
+  return setMode(file->node, mode);
+}
+
+long __syscall33(long path, long amode) // access
+{
+  return doAccessAt(AT_FDCWD, (const char*)path, amode, 0);
+}
+
+long __syscall307(long dirfd, long path, long amode, long flags) // faccessat
+{
+  return doAccessAt(dirfd, (const char*)path, amode, flags);
+}
+
+long __syscall212(long path, long owner, long group) // chown32
+{
+  return doChownAt(AT_FDCWD, (const char*)path, 0);
+}
+
+long __syscall198(long path, long owner, long group) // lchown32
+{
+  return doChownAt(AT_FDCWD, (const char*)path, AT_SYMLINK_NOFOLLOW);
+}
+
+long __syscall298(long dirfd, long path, long owner, long group, long flags) // fchownat
+{
+  return doChownAt(dirfd, (const char*)path, flags);
+}
+
+long __syscall207(long fd, long owner, long group) // fchown32
+{
+  return FileRef(fd) ? 0 : -EBADF;
+}
+
+long __syscall12(long path) // chdir
+{
+  WriteGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupPath(getCwd(), (const char*)path, true, lookup);
+  if (err)
+    return err;
+  if (!lookup.node)
+    return -ENOENT;
+  if (!lookup.node->isDirectory())
+    return -ENOTDIR;
+  err = checkAccess(lookup.node, X_OK);
+  if (err)
+    return err;
+  lookup.node->acquire();
+  setCwd((Directory*)lookup.node);
+  return 0;
+}
+
+long __syscall133(long fd) // fchdir
+{
+  FileRef file(fd);
+  if (!file)
+    return -EBADF;
+  if (!file->node->isDirectory())
+    return -ENOTDIR;
+  WriteGuard guard(treeLock());
+  file->node->acquire();
+  setCwd((Directory*)file->node);
+  return 0;
+}
+
+long __syscall183(long buf, long size) // getcwd
+{
+  if (size == 0)
+    return -EINVAL;
+  ReadGuard guard(treeLock());
+  int len = getDirectoryPath(getCwd(), (char*)buf, size);
+  if (len < 0)
+    return len;
+  if (len + 1 > size)
+    return -ERANGE;
+  return len + 1;
+}
+
+long __syscall220(long fd, long dirp, long count) // getdents64
+{
+  FileRef file(fd);
+  if (!file)
+    return -EBADF;
+  if (!file->node->isDirectory())
+    return -ENOTDIR;
+  Directory* dir = (Directory*)file->node;
+  ReadGuard guard(treeLock());
+  LockGuard positionGuard(file->lock);
+  // Like the JS FS, the position is the offset of the next entry as if all
+  // entries were stored one after another, starting with "." and "..".
+  size_t index = file->position / sizeof(struct dirent);
+  size_t written = 0;
+  while (index < dir->numEntries + 2 && written + sizeof(struct dirent) <= (size_t)count) {
+    struct dirent* entry = (struct dirent*)((uint8_t*)dirp + written);
+    const char* name;
+    Inode* node;
+    if (index == 0) {
+      name = ".";
+      node = dir;
+    } else if (index == 1) {
+      name = "..";
+      node = dir->parent ? dir->parent : dir;
+    } else {
+      name = dir->entries[index - 2].name;
+      node = dir->entries[index - 2].node;
+    }
+    entry->d_ino = node->ino;
+    entry->d_off = (index + 1) * sizeof(struct dirent);
+    entry->d_reclen = sizeof(struct dirent);
+    entry->d_type = node->isDirectory() ? DT_DIR
+                  : node->isSymlink()   ? DT_LNK
+                  : node->isCharDevice() ? DT_CHR
+                                        : DT_REG;
+    strcpy(entry->d_name, name);
+    written += sizeof(struct dirent);
+    ++index;
+  }
+  file->position = index * sizeof(struct dirent);
+  return written;
+}
+
+long __syscall221(long fd, long cmd, ...) // fcntl64
+{
+  FileRef file(fd);
+  if (!file)
+    return -EBADF;
+  va_list vl;
+  va_start(vl, cmd);
+  long arg = va_arg(vl, long);
+  va_end(vl);
+  switch (cmd) {
+    case F_DUPFD:
+    case F_DUPFD_CLOEXEC: {
+      if (arg < 0)
+        return -EINVAL;
+      file->acquire();
+      int newfd = addOpenFile(file.get(), arg);
+      if (newfd < 0)
+        file->release();
+      return newfd;
+    }
+    case F_GETFD:
+    case F_SETFD:
+      return 0; // FD_CLOEXEC makes no sense for a single process.
+    case F_GETFL: {
+      LockGuard guard(file->lock);
+      return file->flags;
+    }
+    case F_SETFL: {
+      LockGuard guard(file->lock);
+      file->flags = (file->flags & ~(O_APPEND | O_NONBLOCK)) | (arg & (O_APPEND | O_NONBLOCK));
+      return 0;
+    }
+    case F_GETLK:
+      // We're always unlocked.
+      ((struct flock*)arg)->l_type = F_UNLCK;
+      return 0;
+    case F_SETLK:
+    case F_SETLKW:
+      return 0; // Pretend that the locking is successful.
+    case F_GETOWN:
+      // musl trusts the return value of F_GETOWN, as valid values overlap
+      // with errors, so set errno ourselves.
+      errno = EINVAL;
+      return -1;
+    default:
+      return -EINVAL;
+  }
+}
+
+long __syscall54(long fd, long request, ...) // ioctl
+{
+  FileRef file(fd);
+  if (!file)
+    return -EBADF;
+  bool terminal = isTerminal(file->node);
+  switch (request) {
+    case TCGETA:
+    case TCGETS:
+    case TCSETA:
+    case TCSETAW:
+    case TCSETAF:
+    case TCSETS:
+    case TCSETSW:
+    case TCSETSF:
+    case TIOCGWINSZ:
+      // Not actually reading or changing any terminal settings.
+      return terminal ? 0 : -ENOTTY;
+    case TIOCGPGRP: {
+      if (!terminal)
+        return -ENOTTY;
+      va_list vl;
+      va_start(vl, request);
+      int* pgrp = va_arg(vl, int*);
+      va_end(vl);
+      *pgrp = 0;
+      return 0;
+    }
+    case TIOCSPGRP:
+      return terminal ? -EINVAL : -ENOTTY;
+    case FIONREAD:
+      return -ENOTTY;
+    default:
+      return -EINVAL;
+  }
+}
+
+long __syscall168(long fds, long nfds, long timeout) // poll
+{
+  // Files are always ready.
+  struct pollfd* pollfds = (struct pollfd*)fds;
+  long ready = 0;
+  for (long i = 0; i < nfds; ++i) {
+    struct pollfd* pollfd = &pollfds[i];
+    if (pollfd->fd < 0) {
+      pollfd->revents = 0;
+      continue;
+    }
+    pollfd->revents = FileRef(pollfd->fd) ? pollfd->events & (POLLIN | POLLOUT) : POLLNVAL;
+    if (pollfd->revents)
+      ++ready;
+  }
+  return ready;
+}
+
+long __syscall41(long fd) // dup
+{
+  FileRef file(fd);
+  if (!file)
+    return -EBADF;
+  file->acquire();
+  int newfd = addOpenFile(file.get());
+  if (newfd < 0)
+    file->release();
+  return newfd;
+}
+
+long __syscall63(long oldfd, long newfd) // dup2
+{
+  if (oldfd == newfd)
+    return FileRef(oldfd) ? newfd : -EBADF;
+  return dupTo(oldfd, newfd);
+}
+
+long __syscall330(long oldfd, long newfd, long flags) // dup3
+{
+  if (oldfd == newfd || (flags & ~O_CLOEXEC))
+    return -EINVAL;
+  return dupTo(oldfd, newfd);
+}
+
+long __syscall60(long mask) // umask
+{
+  // Like the JS FS, the mask is remembered but not applied.
+  static mode_t currentMask = 0777;
+  return __atomic_exchange_n(&currentMask, mask & 0777, __ATOMIC_RELAXED);
+}
+
+long __syscall36() // sync
+{
+  return 0;
+}
+
+long __syscall148(long fd) // fdatasync
+{
+  return FileRef(fd) ? 0 : -EBADF;
+}
+
+long __syscall193(long path, long zero, long low, long high) // truncate64
+{
+  ReadGuard guard(treeLock());
+  PathLookup lookup;
+  int err = lookupPath(getCwd(), (const char*)path, true, lookup);
+  if (err)
+    return err;
+  if (!lookup.node)
+    return -ENOENT;
+  err = checkAccess(lookup.node, W_OK);
+  if (err)
+    return err;
+  return truncateNode(lookup.node, makeOffset(low, high));
+}
+
+long __syscall194(long fd, long zero, long low, long high) // ftruncate64
+{
+  FileRef file(fd);
+  if (!file)
+    return -EBADF;
+  if ((file->flags & O_ACCMODE) == O_RDONLY)
+    return -EINVAL;
+  return truncateNode(file->node, makeOffset(low, high));
+}
+
+long __syscall324(long fd, long mode, long off_low, long off_high, long len_low, long len_high) // fallocate
+{
+  if (mode)
+    return -EOPNOTSUPP;
+  off_t offset = makeOffset(off_low, off_high);
+  off_t len = makeOffset(len_low, len_high);
+  if (offset < 0 || len <= 0)
+    return -EINVAL;
+  FileRef file(fd);
+  if (!file || (file->flags & O_ACCMODE) == O_RDONLY)
+    return -EBADF;
+  if (!file->node->isRegular())
+    return -ENODEV;
+  DataFile* data = (DataFile*)file->node;
+  WriteGuard guard(data->lock);
+  if (data->getSize() >= offset + len)
+    return 0;
+  int err = data->setSize(offset + len);
+  if (!err)
+    data->touch(true);
+  return err;
+}
+
+long __syscall320(long dirfd, long path, long times, long flags) // utimensat
+{
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  const struct timespec* newTimes = (const struct timespec*)times;
+  struct timespec atime = now, mtime = now;
+  bool setAtime = true, setMtime = true;
+  if (newTimes) {
+    setAtime = newTimes[0].tv_nsec != UTIME_OMIT;
+    if (newTimes[0].tv_nsec != UTIME_NOW)
+      atime = newTimes[0];
+    setMtime = newTimes[1].tv_nsec != UTIME_OMIT;
+    if (newTimes[1].tv_nsec != UTIME_NOW)
+      mtime = newTimes[1];
+  }
+
+  FileRef dir(dirfd);
+  // futimens() passes no path, to change the times of dirfd itself.
+  Inode* node = dir ? dir->node : nullptr;
+  ReadGuard guard(treeLock());
+  if (path) {
+    PathLookup lookup;
+    int err = lookupAt(dirfd, dir, (const char*)path, !(flags & AT_SYMLINK_NOFOLLOW), lookup);
+    if (err)
+      return err;
+    node = lookup.node;
+    if (!node)
+      return -ENOENT;
+  } else if (!node) {
+    return -EBADF;
+  }
+  WriteGuard nodeGuard(node->lock);
+  if (setAtime)
+    node->atime = atime;
+  if (setMtime)
+    node->mtime = mtime;
+  node->ctime = now;
+  return 0;
+}
+
+long __syscall268(long path, long size, long buf) // statfs64
+{
+  fillStatfs((struct statfs*)buf);
+  return 0;
+}
+
+long __syscall269(long fd, long size, long buf) // fstatfs64
+{
+  if (!FileRef(fd))
+    return -EBADF;
+  fillStatfs((struct statfs*)buf);
+  return 0;
+}
+
+long __syscall192(long addr, long len, long prot, long flags, long fd, long off) // mmap2
+{
+  if (((flags & MAP_FIXED) && (addr % 4096)) || !len)
+    return -EINVAL;
+  off_t offset = (off_t)off * 4096;
+  DataFile* data = nullptr;
+  if (!(flags & MAP_ANONYMOUS)) {
+    FileRef file(fd);
+    if (!file)
+      return -EBADF;
+    if (!file->node->isRegular())
+      return -ENODEV;
+    int accmode = file->flags & O_ACCMODE;
+    if (accmode == O_WRONLY || ((flags & MAP_SHARED) && (prot & PROT_WRITE) && accmode == O_RDONLY))
+      return -EACCES;
+    data = (DataFile*)file->node;
+  }
+
+  Mapping* mapping = (Mapping*)malloc(sizeof(Mapping));
+  uint8_t* ptr = (uint8_t*)memalign(4096, len);
+  if (!mapping || !ptr) {
+    free(mapping);
+    free(ptr);
+    return -ENOMEM;
+  }
+  size_t filled = 0;
+  if (data) {
+    ReadGuard guard(data->lock);
+    ssize_t n = data->read(ptr, len, offset);
+    filled = n > 0 ? n : 0;
+    data->acquire();
+  }
+  memset(ptr + filled, 0, len - filled);
+
+  *mapping = {nullptr, ptr, (size_t)len, data, offset, (int)flags, (int)prot};
+  LockGuard guard(mappingsMutex);
+  mapping->next = mappings;
+  mappings = mapping;
+  return (long)ptr;
+}
+
+long __syscall91(long addr, long len) // munmap
+{
+  if (addr == (long)MAP_FAILED || !len)
+    return -EINVAL;
+  Mapping* mapping;
+  {
+    LockGuard guard(mappingsMutex);
+    Mapping** link = &mappings;
+    while (*link && (long)(*link)->addr != addr)
+      link = &(*link)->next;
+    mapping = *link;
+    // Like the JS FS, unmapping only part of a mapping does nothing.
+    if (!mapping || (size_t)len != mapping->len)
+      return 0;
+    syncMapping(mapping);
+    *link = mapping->next;
+  }
+  if (mapping->file)
+    mapping->file->release();
+  free(mapping->addr);
+  free(mapping);
+  return 0;
+}
+
+long __syscall144(long addr, long len, long flags) // msync
+{
+  LockGuard guard(mappingsMutex);
+  for (Mapping* mapping = mappings; mapping; mapping = mapping->next) {
+    if ((long)mapping->addr == addr) {
+      syncMapping(mapping);
+      break;
+    }
+  }
+  return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+# Copyright 2021 The Emscripten Authors.  All rights reserved.
+# Emscripten is available under two separate licenses, the MIT license and the
+# University of Illinois/NCSA Open Source License.  Both these licenses can be
+# found in the LICENSE file.
+
+"""Measures tools/acorn-optimizer.js on a large generated glue file, running
+function local passes on the whole file in one process, and on chunks of it in
+parallel (see building.acorn_optimizer). Also checks that both give the same
+output.
+
+  tests/benchmark_acorn_optimizer.py [--size 30] [--cores N]
+"""
+
+import argparse
+import os
+import shutil
+import sys
+import tempfile
+import time
+
+__rootpath__ = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.append(__rootpath__)
+
+from tools import building
+
+PASS_GROUPS = [['safeHeap'], ['growableHeap'], ['unsignPointers', 'minifyWhitespace']]
+
+
+def generate_glue(filename, size_mb):
+  """Writes something like the glue of a large embind or WebIDL binding: many
+  small functions that read and write the heap."""
+  with open(filename, 'w') as f:
+    f.write('var HEAP8, HEAP16, HEAP32, HEAPU8, HEAPU16, HEAPU32, HEAPF32, HEAPF64;\n')
+    i = 0
+    while f.tell() < size_mb * 1024 * 1024:
+      f.write('''
+/** @param {number} ptr */
+function __embind_getter_%(i)d(ptr, value) {
+  var x = HEAP32[(ptr + %(i)d) >> 2];
+  HEAPF64[(ptr + 8) >> 3] = HEAPF64[value >> 3] * x;
+  for (var j = 0; j < x; j++) {
+    HEAPU8[ptr + j] = HEAPU8[value + j] ^ %(mask)d;
+  }
+  return {
+    "value": HEAPU16[(ptr + 2) >> 1],
+    "name": "binding_%(i)d"
+  };
+}
+Module["binding_%(i)d"] = __embind_getter_%(i)d;
+''' % {'i': i, 'mask': i & 255})
+      i += 1
+
+
+def run(filename, passes, cores):
+  os.environ['EMCC_CORES'] = str(cores)
+  start = time.time()
+  output = building.acorn_optimizer(filename, passes, return_output=True)
+  return time.time() - start, output
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--size', type=int, default=30, help='size of the generated file in MB')
+  parser.add_argument('--cores', type=int, default=building.get_num_cores(), help='number of cores to use in parallel')
+  args = parser.parse_args()
+
+  temp_dir = tempfile.mkdtemp()
+  try:
+    filename = os.path.join(temp_dir, 'glue.js')
+    generate_glue(filename, args.size)
+    print('%.1f MB of JS, %d cores' % (os.path.getsize(filename) / (1024 * 1024.), args.cores))
+    for passes in PASS_GROUPS:
+      serial, serial_output = run(filename, passes, 1)
+      parallel, parallel_output = run(filename, passes, args.cores)
+      print('%-32s one process %7.2fs  in parallel %7.2fs  speedup %.2fx  %s' %
+            (' '.join(passes), serial, parallel, serial / parallel,
+             'same output' if serial_output == parallel_output else 'OUTPUT DIFFERS'))
+  finally:
+    shutil.rmtree(temp_dir)
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+# Copyright 2021 The Emscripten Authors.  All rights reserved.
+# Emscripten is available under two separate licenses, the MIT license and the
+# University of Illinois/NCSA Open Source License.  Both these licenses can be
+# found in the LICENSE file.
+
+"""Measures the per-file overhead of emcc, with and without the compile server
+(tools/compile_server.py), on a generated project of small source files.
+
+Each file is compiled with clang directly (with the flags from `emcc --cflags`),
+with emcc, and with emcc on a compile server. The overhead is the time per file
+beyond the direct clang compile.
+
+  tests/benchmark_compile_server.py [--files 1000] [--jobs 1]
+"""
+
+import argparse
+import os
+import shlex
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+__rootpath__ = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.append(__rootpath__)
+
+from tools.shared import CLANG_CC, EMCC, PIPE, PYTHON, path_from_root, run_process
+
+
+def generate_project(directory, count):
+  sources = []
+  for i in range(count):
+    filename = os.path.join(directory, 'file%d.c' % i)
+    with open(filename, 'w') as f:
+      f.write('#include <stdio.h>\n'
+              'int function%d(int x) {\n'
+              '  printf("%%d\\n", x);\n'
+              '  return x * %d;\n'
+              '}\n' % (i, i))
+    sources.append(filename)
+  return sources
+
+
+def compile_all(compiler, sources, jobs, env=None):
+  def compile_one(source):
+    subprocess.check_call(compiler + ['-c', source, '-o', source + '.o'], env=env)
+
+  start = time.time()
+  with ThreadPoolExecutor(jobs) as pool:
+    list(pool.map(compile_one, sources))
+  return time.time() - start
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--files', type=int, default=1000, help='number of source files')
+  parser.add_argument('--jobs', type=int, default=1, help='number of compiles to run at once')
+  args = parser.parse_args()
+
+  temp_dir = tempfile.mkdtemp()
+  try:
+    sources = generate_project(temp_dir, args.files)
+    cflags = shlex.split(run_process([EMCC, '--cflags'], stdout=PIPE).stdout)
+    # Warm up the cache and the sanity check.
+    run_process([EMCC, '-c', sources[0], '-o', sources[0] + '.o'])
+
+    results = [('clang', compile_all([CLANG_CC] + cflags, sources, args.jobs)),
+               ('emcc', compile_all([EMCC], sources, args.jobs))]
+
+    socket_path = os.path.join(temp_dir, 'server.sock')
+    server_py = path_from_root('tools', 'compile_server.py')
+    server = subprocess.Popen([PYTHON, server_py, socket_path])
+    try:
+      while not os.path.exists(socket_path):
+        time.sleep(0.1)
+      env = os.environ.copy()
+      env['EMCC_SERVER'] = socket_path
+      results.append(('emcc (server)', compile_all([EMCC], sources, args.jobs, env)))
+    finally:
+      run_process([PYTHON, server_py, '--stop', socket_path])
+      server.wait()
+  finally:
+    shutil.rmtree(temp_dir)
+
+  print('%d files, %d jobs' % (args.files, args.jobs))
+  baseline = results[0][1]
+  for name, seconds in results:
+    print('%-14s total %7.2fs  per file %6.1fms  overhead per file %6.1fms' %
+          (name, seconds, 1000 * seconds / args.files, 1000 * (seconds - baseline) / args.files))
+
+
+if __name__ == '__main__':
+  main()
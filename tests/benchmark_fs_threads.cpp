@@ -0,0 +1,102 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Benchmarks NUM_THREADS threads that each open, read and close a set of small
+// files over and over. With the JS FS every one of those calls is proxied to
+// the main thread; with NATIVEFS they run on the calling thread.
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tick.h"
+
+#ifndef NUM_THREADS
+#define NUM_THREADS 4
+#endif
+
+#ifndef NUM_FILES
+#define NUM_FILES 16
+#endif
+
+#ifndef FILE_SIZE
+#define FILE_SIZE 4096
+#endif
+
+#ifndef NUM_ROUNDS
+#define NUM_ROUNDS 500
+#endif
+
+static const char *dir = "/tmp";
+
+static uint32_t checkSums[NUM_THREADS];
+
+static void *reader(void *arg)
+{
+	int id = (int)(intptr_t)arg;
+	char path[64];
+	uint8_t buf[FILE_SIZE];
+	uint32_t sum = 0;
+	for(int round = 0; round < NUM_ROUNDS; ++round)
+	{
+		for(int i = 0; i < NUM_FILES; ++i)
+		{
+			snprintf(path, sizeof(path), "%s/bench_fs_%d", dir, (i + id) % NUM_FILES);
+			int fd = open(path, O_RDONLY);
+			assert(fd >= 0);
+			ssize_t n = read(fd, buf, sizeof(buf));
+			assert(n == FILE_SIZE);
+			sum += buf[round % FILE_SIZE];
+			close(fd);
+		}
+	}
+	checkSums[id] = sum;
+	return NULL;
+}
+
+int main()
+{
+	char path[64];
+	uint8_t buf[FILE_SIZE];
+	for(int i = 0; i < FILE_SIZE; ++i) buf[i] = (uint8_t)(i * 7);
+	for(int i = 0; i < NUM_FILES; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/bench_fs_%d", dir, i);
+		int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0666);
+		assert(fd >= 0);
+		ssize_t n = write(fd, buf, sizeof(buf));
+		assert(n == FILE_SIZE);
+		close(fd);
+	}
+
+	pthread_t threads[NUM_THREADS];
+	tick_t t0 = tick();
+	for(int i = 0; i < NUM_THREADS; ++i)
+	{
+		int rc = pthread_create(&threads[i], NULL, reader, (void*)(intptr_t)i);
+		assert(rc == 0);
+	}
+	uint32_t resultCheckSum = 0;
+	for(int i = 0; i < NUM_THREADS; ++i)
+	{
+		pthread_join(threads[i], NULL);
+		resultCheckSum += checkSums[i];
+	}
+	tick_t t1 = tick();
+
+	for(int i = 0; i < NUM_FILES; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/bench_fs_%d", dir, i);
+		unlink(path);
+	}
+
+	printf("%d threads, %d opens and reads each\n", NUM_THREADS, NUM_ROUNDS * NUM_FILES);
+	printf("Result checksum: %u\n", resultCheckSum);
+	printf("Total time: %f\n", (double)(t1 - t0) / ticks_per_sec());
+}
@@ -0,0 +1,106 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Benchmarks NUM_THREADS threads that each allocate and free small blocks in a
+// random pattern. One in CROSS_THREAD_RATE blocks is handed to another thread
+// through a shared slot, and freed (or reallocated) by whichever thread takes
+// it, so the allocator also sees frees of other threads' memory.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "tick.h"
+
+#ifndef NUM_THREADS
+#define NUM_THREADS 4
+#endif
+
+#ifndef NUM_OPS
+#define NUM_OPS 2000000
+#endif
+
+#ifndef CROSS_THREAD_RATE
+#define CROSS_THREAD_RATE 16
+#endif
+
+#define LIVE_BLOCKS 1024
+#define SHARED_SLOTS 256
+#define MAX_SIZE 512
+
+static std::atomic<void*> sharedSlots[SHARED_SLOTS];
+
+static uint32_t checkSums[NUM_THREADS];
+
+static void *worker(void *arg)
+{
+	int id = (int)(intptr_t)arg;
+	uint32_t rnd = 2654435761u * (id + 1);
+	void *live[LIVE_BLOCKS] = {};
+	uint32_t sum = 0;
+	for(int i = 0; i < NUM_OPS; ++i)
+	{
+		rnd = rnd * 1103515245 + 12345;
+		int slot = (rnd >> 8) % LIVE_BLOCKS;
+		size_t size = 8 + (rnd >> 20) % MAX_SIZE;
+		if (live[slot])
+		{
+			sum += *(uint8_t*)live[slot];
+			free(live[slot]);
+			live[slot] = NULL;
+		}
+		else
+		{
+			live[slot] = malloc(size);
+			memset(live[slot], i, 8);
+		}
+		if ((rnd >> 4) % CROSS_THREAD_RATE == 0)
+		{
+			void *p = malloc(size);
+			memset(p, id, 8);
+			p = sharedSlots[(rnd >> 12) % SHARED_SLOTS].exchange(p);
+			if (p)
+			{
+				sum += *(uint8_t*)p;
+				if (rnd & 1) p = realloc(p, 2 * size);
+				free(p);
+			}
+		}
+	}
+	for(int i = 0; i < LIVE_BLOCKS; ++i)
+		free(live[i]);
+	checkSums[id] = sum;
+	return NULL;
+}
+
+int main()
+{
+	pthread_t threads[NUM_THREADS];
+	tick_t t0 = tick();
+	for(int i = 0; i < NUM_THREADS; ++i)
+	{
+		int rc = pthread_create(&threads[i], NULL, worker, (void*)(intptr_t)i);
+		assert(rc == 0);
+	}
+	uint32_t resultCheckSum = 0;
+	for(int i = 0; i < NUM_THREADS; ++i)
+	{
+		pthread_join(threads[i], NULL);
+		resultCheckSum += checkSums[i];
+	}
+	tick_t t1 = tick();
+
+	for(int i = 0; i < SHARED_SLOTS; ++i)
+		free(sharedSlots[i].load());
+
+	printf("%d threads, %d allocations and frees each\n", NUM_THREADS, NUM_OPS);
+	printf("Result checksum: %u\n", resultCheckSum);
+	printf("Total time: %f\n", (double)(t1 - t0) / ticks_per_sec());
+}
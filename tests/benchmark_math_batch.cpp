@@ -0,0 +1,111 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Benchmarks emscripten/math_batch.h against scalar loops over the libm
+// functions, on arrays of ARRAY_SIZE floats. Native builds, which do not have
+// math_batch.h, run only the scalar loops.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/math_batch.h>
+#endif
+
+#include "tick.h"
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE 4096
+#endif
+
+#ifndef NUM_VALUES
+#define NUM_VALUES (1 << 25)
+#endif
+
+float x[ARRAY_SIZE], y[ARRAY_SIZE], out[ARRAY_SIZE];
+
+double resultCheckSum = 0;
+double totalTimeSecs = 0;
+
+#define SCALAR_1(name) \
+	void __attribute__((noinline)) scalar_##name() \
+	{ \
+		for (int i = 0; i < ARRAY_SIZE; ++i) out[i] = name(x[i]); \
+	}
+
+SCALAR_1(sinf)
+SCALAR_1(cosf)
+SCALAR_1(expf)
+SCALAR_1(logf)
+SCALAR_1(sqrtf)
+
+void __attribute__((noinline)) scalar_powf()
+{
+	for (int i = 0; i < ARRAY_SIZE; ++i) out[i] = powf(x[i], y[i]);
+}
+
+#ifdef __EMSCRIPTEN__
+#define BATCH_1(name) \
+	void __attribute__((noinline)) batch_##name() \
+	{ \
+		emscripten_batch_##name(out, x, ARRAY_SIZE); \
+	}
+
+BATCH_1(sinf)
+BATCH_1(cosf)
+BATCH_1(expf)
+BATCH_1(logf)
+BATCH_1(sqrtf)
+
+void __attribute__((noinline)) batch_powf()
+{
+	emscripten_batch_powf(out, x, y, ARRAY_SIZE);
+}
+#endif
+
+void run(const char *name, void (*func)())
+{
+	tick_t t0 = tick();
+	for (int i = 0; i < NUM_VALUES / ARRAY_SIZE; ++i)
+	{
+		func();
+		resultCheckSum += out[i % ARRAY_SIZE];
+	}
+	tick_t t1 = tick();
+	double seconds = (double)(t1 - t0) / ticks_per_sec();
+	totalTimeSecs += seconds;
+	printf("%s: %.2f Mvalues/s\n", name, NUM_VALUES / seconds / 1e6);
+}
+
+int main()
+{
+	// Arguments in the range of the SIMD kernels: angles within a few turns,
+	// and powers that neither overflow nor underflow.
+	for (int i = 0; i < ARRAY_SIZE; ++i)
+	{
+		x[i] = 0.01f + 20.0f * rand() / RAND_MAX;
+		y[i] = -10.0f + 20.0f * rand() / RAND_MAX;
+	}
+
+	run("sinf (scalar)", scalar_sinf);
+	run("cosf (scalar)", scalar_cosf);
+	run("expf (scalar)", scalar_expf);
+	run("logf (scalar)", scalar_logf);
+	run("powf (scalar)", scalar_powf);
+	run("sqrtf (scalar)", scalar_sqrtf);
+#ifdef __EMSCRIPTEN__
+	run("sinf (batch)", batch_sinf);
+	run("cosf (batch)", batch_cosf);
+	run("expf (batch)", batch_expf);
+	run("logf (batch)", batch_logf);
+	run("powf (batch)", batch_powf);
+	run("sqrtf (batch)", batch_sqrtf);
+#endif
+
+	printf("Result checksum: %f\n", resultCheckSum);
+	printf("Total time: %f\n", totalTimeSecs);
+	return 0;
+}
@@ -0,0 +1,85 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Benchmarks std::sort, std::reduce and std::transform with the serial and
+// the parallel execution policies, at several sizes from MIN_SIZE to MAX_SIZE.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "tick.h"
+
+#ifndef MIN_SIZE
+#define MIN_SIZE 10000
+#endif
+
+#ifndef MAX_SIZE
+#define MAX_SIZE 10000000
+#endif
+
+#ifndef NUM_TRIALS
+#define NUM_TRIALS 5
+#endif
+
+double totalTimeSecs = 0.0;
+double resultCheckSum = 0.0;
+
+// Runs f NUM_TRIALS times, and returns the best time in milliseconds.
+template <class F>
+double best_time(F f)
+{
+	tick_t bestResult = 0;
+	for(int i = 0; i < NUM_TRIALS; ++i)
+	{
+		tick_t t0 = tick();
+		f();
+		tick_t t1 = tick();
+		if (i == 0 || t1 - t0 < bestResult) bestResult = t1 - t0;
+		totalTimeSecs += (double)(t1 - t0) / ticks_per_sec();
+	}
+	return (double)bestResult * 1000.0 / ticks_per_sec();
+}
+
+template <class Policy>
+void run(const char *policyName, Policy policy, size_t size)
+{
+	std::mt19937 rng(size);
+	std::vector<float> input(size);
+	for (auto &x : input) x = (float)rng() / (float)rng.max();
+	std::vector<float> data(size), output(size);
+
+	double sortTime = best_time([&]() {
+		data = input;
+		std::sort(policy, data.begin(), data.end());
+	});
+	resultCheckSum += data[size / 2];
+
+	double reduceTime = best_time([&]() {
+		resultCheckSum += std::reduce(policy, input.begin(), input.end(), 0.0);
+	});
+
+	double transformTime = best_time([&]() {
+		std::transform(policy, input.begin(), input.end(), output.begin(), [](float x) { return x * x + 1.0f; });
+	});
+	resultCheckSum += output[size / 2];
+
+	printf("%s %zu: sort %f ms, reduce %f ms, transform %f ms\n", policyName, size, sortTime, reduceTime, transformTime);
+}
+
+int main()
+{
+	for(size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 10)
+	{
+		run("seq", std::execution::seq, size);
+		run("par", std::execution::par, size);
+	}
+	printf("Result checksum: %f\n", resultCheckSum);
+	printf("Total time: %f\n", totalTimeSecs);
+}
@@ -0,0 +1,103 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Benchmarks node-based containers on the default allocator against the same
+// containers on the polymorphic memory resources. Emscripten's libc++ has these
+// in <experimental/memory_resource>; native builds use C++17 <memory_resource>.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __EMSCRIPTEN__
+#include <experimental/list>
+#include <experimental/map>
+#include <experimental/memory_resource>
+namespace pmr = std::experimental::pmr;
+#else
+#include <list>
+#include <map>
+#include <memory_resource>
+namespace pmr = std::pmr;
+#endif
+
+#include "tick.h"
+
+#ifndef NUM_ELEMENTS
+#define NUM_ELEMENTS 100000
+#endif
+
+#ifndef NUM_ROUNDS
+#define NUM_ROUNDS 10
+#endif
+
+long resultCheckSum = 0;
+double totalTimeSecs = 0;
+
+// Builds a map and a list, erases half of each and refills them, so freed
+// nodes get reused.
+template<typename Map, typename List>
+void __attribute__((noinline)) workload(Map& m, List& l)
+{
+	for (int i = 0; i < NUM_ELEMENTS; ++i)
+	{
+		m[(i * 7919) % NUM_ELEMENTS] = i;
+		l.push_back(i);
+	}
+	for (int i = 0; i < NUM_ELEMENTS; i += 2)
+	{
+		m.erase((i * 7919) % NUM_ELEMENTS);
+		l.pop_front();
+	}
+	for (int i = 0; i < NUM_ELEMENTS / 2; ++i)
+	{
+		m[-i] = i;
+		l.push_back(i);
+	}
+	for (auto& kv : m) resultCheckSum += kv.second;
+	for (int x : l) resultCheckSum += x;
+}
+
+template<typename F>
+void run(const char *name, F func)
+{
+	tick_t t0 = tick();
+	for (int i = 0; i < NUM_ROUNDS; ++i)
+		func();
+	tick_t t1 = tick();
+	double seconds = (double)(t1 - t0) / ticks_per_sec();
+	totalTimeSecs += seconds;
+	printf("%s: %.3f s\n", name, seconds);
+}
+
+int main()
+{
+	run("default allocator", []() {
+		std::map<int, int> m;
+		std::list<int> l;
+		workload(m, l);
+	});
+	run("unsynchronized_pool_resource", []() {
+		pmr::unsynchronized_pool_resource res;
+		pmr::map<int, int> m(&res);
+		pmr::list<int> l(&res);
+		workload(m, l);
+	});
+	run("synchronized_pool_resource", []() {
+		pmr::synchronized_pool_resource res;
+		pmr::map<int, int> m(&res);
+		pmr::list<int> l(&res);
+		workload(m, l);
+	});
+	run("monotonic_buffer_resource", []() {
+		pmr::monotonic_buffer_resource res;
+		pmr::map<int, int> m(&res);
+		pmr::list<int> l(&res);
+		workload(m, l);
+	});
+
+	printf("Result checksum: %ld\n", resultCheckSum);
+	printf("Total time: %f\n", totalTimeSecs);
+	return 0;
+}
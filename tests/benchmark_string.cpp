@@ -0,0 +1,211 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Benchmarks the libc string functions that have wasm SIMD128 versions
+// (-msimd128), in the same way as benchmark_memset.cpp: each function scans a
+// string or buffer of a given size, for sizes from MIN_COPY to MAX_COPY.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/emscripten.h>
+#endif
+
+#include "tick.h"
+
+#define BUFFER_SIZE (1024*1024*16+16)
+
+// src and src2 hold copySize bytes of 'a', followed by a NUL. 'b' never
+// appears, so every function scans the whole input.
+char src[BUFFER_SIZE] = {};
+char src2[BUFFER_SIZE] = {};
+
+// Read through volatile pointers, so that the calls, which have no side
+// effects, are not hoisted out of the benchmark loops.
+char *volatile srcPtr = src;
+char *volatile src2Ptr = src2;
+
+size_t resultCheckSum = 0;
+
+#define BENCH(name, expr) \
+	void __attribute__((noinline)) test_##name(int numTimes, int copySize) \
+	{ \
+		for(int i = 0; i < numTimes; ++i) \
+		{ \
+			resultCheckSum += (size_t)(expr); \
+		} \
+	}
+
+BENCH(strlen, strlen(srcPtr))
+BENCH(memchr, memchr(srcPtr, 'b', copySize))
+BENCH(memrchr, memrchr(srcPtr, 'b', copySize))
+BENCH(strchr, strchr(srcPtr, 'b'))
+BENCH(memcmp, memcmp(srcPtr, src2Ptr, copySize))
+BENCH(strcmp, strcmp(srcPtr, src2Ptr))
+BENCH(strspn, strspn(srcPtr, "a") + strspn(srcPtr, "abc"))
+
+typedef void (*test_func)(int numTimes, int copySize);
+
+struct routine
+{
+	const char *name;
+	test_func func;
+};
+
+const routine routines[] = {
+	{ "strlen", test_strlen },
+	{ "memchr", test_memchr },
+	{ "memrchr", test_memrchr },
+	{ "strchr", test_strchr },
+	{ "memcmp", test_memcmp },
+	{ "strcmp", test_strcmp },
+	{ "strspn", test_strspn },
+};
+
+#define NUM_ROUTINES (sizeof(routines) / sizeof(routines[0]))
+
+std::vector<int> copySizes;
+std::vector<double> results[NUM_ROUTINES];
+
+std::vector<int> testCases;
+
+double totalTimeSecs = 0.0;
+
+void test_case(int copySize)
+{
+	const int minimumCopyBytes = 1024*1024*16;
+
+	int numTimes = (minimumCopyBytes + copySize-1) / copySize;
+	if (numTimes < 8) numTimes = 8;
+
+	memset(src, 'a', copySize);
+	memset(src2, 'a', copySize);
+	src[copySize] = src2[copySize] = 0;
+
+#ifndef NUM_TRIALS
+#define NUM_TRIALS 5
+#endif
+
+	copySizes.push_back(copySize);
+	for(size_t r = 0; r < NUM_ROUTINES; ++r)
+	{
+		tick_t bestResult = 1e9;
+		for(int i = 0; i < NUM_TRIALS; ++i)
+		{
+			double t0 = tick();
+			routines[r].func(numTimes, copySize);
+			double t1 = tick();
+			if (t1 - t0 < bestResult) bestResult = t1 - t0;
+			totalTimeSecs += (double)(t1 - t0) / ticks_per_sec();
+		}
+		unsigned long long totalBytesScanned = (unsigned long long)numTimes * copySize;
+
+		tick_t ticksElapsed = bestResult;
+		if (ticksElapsed > 0)
+		{
+			double seconds = (double)ticksElapsed / ticks_per_sec();
+			double bytesPerSecond = totalBytesScanned / seconds;
+			double mbytesPerSecond = bytesPerSecond / (1024.0*1024.0);
+			results[r].push_back(mbytesPerSecond);
+		}
+		else
+		{
+			results[r].push_back(0.0);
+		}
+	}
+
+	src[copySize] = src2[copySize] = 'a';
+}
+
+void print_results()
+{
+	std::cout << "Test cases: " << std::endl;
+	for(size_t i = 0; i < copySizes.size(); ++i)
+	{
+		std::cout << copySizes[i];
+		if (i != copySizes.size()-1) std::cout << ",";
+		else std::cout << std::endl;
+		if (i % 10 == 9) std::cout << std::endl;
+	}
+	for(size_t r = 0; r < NUM_ROUTINES; ++r)
+	{
+		std::cout << std::endl;
+		std::cout << "Test results (" << routines[r].name << "): " << std::endl;
+		for(size_t i = 0; i < results[r].size(); ++i)
+		{
+			std::cout << results[r][i];
+			if (i != results[r].size()-1) std::cout << ",";
+			else std::cout << std::endl;
+			if (i % 10 == 9) std::cout << std::endl;
+		}
+	}
+
+	std::cout << "Result checksum: " << resultCheckSum << std::endl;
+	std::cout << "Total time: " << totalTimeSecs << std::endl;
+}
+
+int numDone = 0;
+
+void run_one()
+{
+	std::cout << (numDone+1) << "/" << (numDone+testCases.size()) << std::endl;
+	++numDone;
+
+	int copySize = testCases.front();
+	testCases.erase(testCases.begin());
+	test_case(copySize);
+}
+
+#ifdef __EMSCRIPTEN__
+void main_loop()
+{
+	if (!testCases.empty())
+	{
+		run_one();
+	}
+	else
+	{
+		emscripten_cancel_main_loop();
+		print_results();
+	}
+}
+#endif
+
+#ifndef MAX_COPY
+#define MAX_COPY 8*1024*1024
+#endif
+
+#ifndef MIN_COPY
+#define MIN_COPY 1
+#endif
+
+int main()
+{
+	memset(src, 'a', sizeof(src));
+	memset(src2, 'a', sizeof(src2));
+
+	for(int copySizeI = MIN_COPY; copySizeI < MAX_COPY; copySizeI <<= 1)
+		for(int copySizeJ = 1; copySizeJ <= copySizeI; copySizeJ <<= 1)
+		{
+			testCases.push_back(copySizeI | copySizeJ);
+		}
+
+	std::sort(testCases.begin(), testCases.end());
+#if defined(__EMSCRIPTEN__) && !defined(BUILD_FOR_SHELL)
+	emscripten_set_main_loop(main_loop, 0, 0);
+#else
+	while(!testCases.empty()) run_one();
+	print_results();
+#endif
+}
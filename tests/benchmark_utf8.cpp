@@ -10,6 +10,11 @@
 #include <cassert>
 #include <emscripten.h>
 
+// Length in bytes of the strings to decode.
+#ifndef STRING_LENGTH
+#define STRING_LENGTH 8
+#endif
+
 double test(const char *str) {
   double res = EM_ASM_DOUBLE({
     var t0 = _emscripten_get_now();
@@ -58,7 +63,7 @@ int main() {
   double t2 = emscripten_get_now();
   for(int i = 0; i < 100000; ++i) {
     // FF Nightly: Already on small strings of 64 bytes in length, TextDecoder trumps in performance.
-    char *str = randomString(8);
+    char *str = randomString(STRING_LENGTH);
     t += test(str);
     delete [] str;
   }
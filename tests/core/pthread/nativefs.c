@@ -0,0 +1,78 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Threads do file I/O while the main thread busy-waits without ever yielding
+// or processing proxied calls. With NATIVEFS that works, as nothing is proxied
+// to the main thread; with the JS FS it would deadlock.
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NUM_THREADS 4
+#define ITERATIONS 100
+
+static atomic_int done;
+
+static void* thread_main(void* arg) {
+  int id = (int)(long)arg;
+  char dir[32], path[64], buf[64];
+  snprintf(dir, sizeof(dir), "/tmp/thread%d", id);
+  assert(mkdir(dir, 0777) == 0);
+  for (int i = 0; i < ITERATIONS; i++) {
+    snprintf(path, sizeof(path), "%s/file%d", dir, i);
+    int fd = open(path, O_CREAT | O_EXCL | O_RDWR, 0666);
+    assert(fd >= 0);
+    int len = snprintf(buf, sizeof(buf), "thread %d iteration %d", id, i);
+    assert(write(fd, buf, len) == len);
+    assert(close(fd) == 0);
+  }
+  // Every thread also appends to one shared file.
+  int fd = open("/tmp/shared", O_CREAT | O_WRONLY | O_APPEND, 0666);
+  assert(fd >= 0);
+  for (int i = 0; i < ITERATIONS; i++) {
+    assert(write(fd, "0123456789", 10) == 10);
+  }
+  assert(close(fd) == 0);
+  for (int i = 0; i < ITERATIONS; i++) {
+    snprintf(path, sizeof(path), "%s/file%d", dir, i);
+    fd = open(path, O_RDONLY);
+    assert(fd >= 0);
+    char expected[64];
+    int len = snprintf(expected, sizeof(expected), "thread %d iteration %d", id, i);
+    memset(buf, 0, sizeof(buf));
+    assert(read(fd, buf, sizeof(buf)) == len);
+    assert(strcmp(buf, expected) == 0);
+    assert(close(fd) == 0);
+    assert(unlink(path) == 0);
+  }
+  assert(rmdir(dir) == 0);
+  atomic_fetch_add(&done, 1);
+  return NULL;
+}
+
+int main() {
+  pthread_t threads[NUM_THREADS];
+  for (int i = 0; i < NUM_THREADS; i++) {
+    int rc = pthread_create(&threads[i], NULL, thread_main, (void*)(long)i);
+    assert(rc == 0);
+  }
+  while (atomic_load(&done) != NUM_THREADS) {}
+  for (int i = 0; i < NUM_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  struct stat st;
+  assert(stat("/tmp/shared", &st) == 0);
+  printf("shared size: %lld\n", (long long)st.st_size);
+  assert(access("/tmp/thread0", F_OK) == -1);
+  printf("done\n");
+  return 0;
+}
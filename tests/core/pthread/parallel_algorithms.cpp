@@ -0,0 +1,75 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Checks the C++17 parallel algorithms against their serial versions, for
+// sizes that are split into chunks in different ways.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+int main() {
+  for (size_t n : {0, 1, 7, 4095, 4096, 4097, 100000, 1000003}) {
+    std::mt19937 rng(n);
+    std::vector<int> s(n);
+    for (auto& x : s) x = rng() % 1000;
+
+    auto v = s, w = s;
+    std::sort(std::execution::par, v.begin(), v.end());
+    std::sort(w.begin(), w.end());
+    assert(v == w);
+    std::sort(std::execution::par_unseq, v.begin(), v.end(), std::greater<int>());
+    assert(std::is_sorted(v.begin(), v.end(), std::greater<int>()));
+
+    // Pairs of (key, original position), so that stability is visible.
+    std::vector<std::pair<int, int>> p(n);
+    for (size_t i = 0; i < n; i++) p[i] = {s[i] % 10, (int)i};
+    auto q = p;
+    auto byKey = [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; };
+    std::stable_sort(std::execution::par, p.begin(), p.end(), byKey);
+    std::stable_sort(q.begin(), q.end(), byKey);
+    assert(p == q);
+
+    assert(std::reduce(std::execution::par, s.begin(), s.end(), 0LL) == std::accumulate(s.begin(), s.end(), 0LL));
+    assert(std::reduce(std::execution::par, s.begin(), s.end()) == std::accumulate(s.begin(), s.end(), 0));
+
+    std::vector<int> t(n);
+    std::transform(std::execution::par, s.begin(), s.end(), t.begin(), [](int x) { return x * 2; });
+    for (size_t i = 0; i < n; i++) assert(t[i] == 2 * s[i]);
+    std::transform(std::execution::par, s.begin(), s.end(), t.begin(), t.begin(), std::plus<int>());
+    for (size_t i = 0; i < n; i++) assert(t[i] == 3 * s[i]);
+
+    assert(std::transform_reduce(std::execution::par, s.begin(), s.end(), t.begin(), 0LL) ==
+           std::inner_product(s.begin(), s.end(), t.begin(), 0LL));
+    auto square = [](int x) { return (long long)x * x; };
+    assert(std::transform_reduce(std::execution::par, s.begin(), s.end(), 0LL, std::plus<long long>(), square) ==
+           std::transform_reduce(s.begin(), s.end(), 0LL, std::plus<long long>(), square));
+
+    auto small = [](int x) { return x < 500; };
+    assert(std::count_if(std::execution::par, s.begin(), s.end(), small) == std::count_if(s.begin(), s.end(), small));
+    assert(std::count(std::execution::par, s.begin(), s.end(), 3) == std::count(s.begin(), s.end(), 3));
+
+    std::fill(std::execution::par, t.begin(), t.end(), 5);
+    std::atomic<long long> sum(0);
+    std::for_each(std::execution::par, t.begin(), t.end(), [&](int x) { sum += x; });
+    assert(sum == 5LL * (long long)n);
+    assert(std::for_each_n(std::execution::par, t.begin(), n / 2, [](int& x) { x = 1; }) == t.begin() + n / 2);
+    assert(std::count(t.begin(), t.end(), 1) == (long)(n / 2));
+
+    printf("%zu: ok\n", n);
+  }
+
+  static_assert(std::is_execution_policy_v<std::execution::parallel_policy>);
+  static_assert(!std::is_execution_policy_v<int>);
+  printf("done\n");
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <emscripten/emmalloc.h>
+
+static bool all_zero(uint8_t *begin, uint8_t *end)
+{
+	for(uint8_t *p = begin; p < end; ++p)
+		if (*p) return false;
+	return true;
+}
+
+int main()
+{
+	// Of two free regions of the same size, the lower one is reused first,
+	// regardless of the order they were freed in.
+	void *a = malloc(1000);
+	void *sep1 = malloc(16);
+	void *b = malloc(1000);
+	void *sep2 = malloc(16);
+	free(a);
+	free(b);
+	void *c = malloc(1000);
+	printf("low address reused: %d\n", (int)(c == a));
+	free(c);
+
+	// Free space in the middle of the heap cannot be trimmed, so its pages get zeroed.
+	void *big = malloc(8*1024*1024);
+	memset(big, 0xAB, 8*1024*1024);
+	void *top = malloc(16);
+	free(big);
+	void *sbrkBefore = sbrk(0);
+	size_t released = emmalloc_release_free_pages();
+	printf("released middle: %d\n", (int)(released >= 8*1024*1024 - 2*4096));
+	// Pages that are zero already are not counted, or written, again.
+	printf("released middle again: %d\n", (int)emmalloc_release_free_pages());
+	printf("heap still ends after top: %d\n", (int)((uint8_t*)sbrk(0) > (uint8_t*)top && sbrk(0) <= sbrkBefore));
+	printf("valid: %d\n", emmalloc_validate_memory_regions());
+	uint8_t *big2 = (uint8_t*)malloc(8*1024*1024);
+	printf("same region: %d\n", (int)(big2 == big));
+	printf("zeroed: %d\n", (int)all_zero(big2 + 4096, big2 + 8*1024*1024 - 4096));
+
+	// Free space at the top of the heap is given back to sbrk().
+	free(top);
+	free(big2);
+	sbrkBefore = sbrk(0);
+	released = emmalloc_release_free_pages();
+	printf("released top: %d\n", (int)(released >= 8*1024*1024));
+	printf("sbrk shrunk: %d\n", (int)((uint8_t*)sbrkBefore - (uint8_t*)sbrk(0) >= 8*1024*1024));
+	printf("valid: %d\n", emmalloc_validate_memory_regions());
+
+	// After releasing everything once, the top of the heap has nothing more to give back.
+	free(sep1);
+	free(sep2);
+	emmalloc_release_free_pages();
+	sbrkBefore = sbrk(0);
+	emmalloc_release_free_pages();
+	printf("nothing more to trim: %d\n", (int)(sbrk(0) == sbrkBefore));
+	printf("valid: %d\n", emmalloc_validate_memory_regions());
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+#include <assert.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emscripten/malloc_profiler.h>
+
+#define N 100
+
+void *small[N], *large[N], *aligned[N];
+
+__attribute__((noinline)) void *alloc_small(void) {
+  return malloc(24);
+}
+
+__attribute__((noinline)) void *alloc_large(void) {
+  return calloc(1, 4000);
+}
+
+__attribute__((noinline)) void *alloc_aligned(int i) {
+  if (i % 2) {
+    return memalign(64, 100);
+  }
+  void *ptr = NULL;
+  assert(posix_memalign(&ptr, 128, 100) == 0);
+  return ptr;
+}
+
+// Prints the bytes of the profile line whose stack contains `name`.
+static void print_bytes(const char *name) {
+  FILE *file = fopen("profile.txt", "r");
+  assert(file);
+  char line[4096];
+  unsigned long long total = 0;
+  while (fgets(line, sizeof(line), file)) {
+    char *bytes = strrchr(line, ' ');
+    assert(bytes);
+    *bytes++ = 0;
+    // Stacks run from main to the allocator.
+    assert(strstr(line, "main"));
+    if (strstr(line, name)) {
+      assert(strstr(line, "main") <= strstr(line, name));
+      total += strtoull(bytes, NULL, 10);
+    }
+  }
+  fclose(file);
+  printf("%s: %llu\n", name, total);
+}
+
+int main() {
+  // Sample every allocation, so that the numbers are exact.
+  emscripten_malloc_profiler_set_sample_interval(1);
+  for (int i = 0; i < N; i++) {
+    small[i] = alloc_small();
+    large[i] = alloc_large();
+  }
+  for (int i = 0; i < N; i += 2) {
+    free(small[i]);
+  }
+  for (int i = 0; i < N / 4; i++) {
+    large[i] = realloc(large[i], 8000);
+  }
+  assert(emscripten_malloc_profiler_write_profile("profile.txt") == 0);
+  print_bytes("alloc_small");
+  print_bytes("alloc_large");
+  print_bytes("main");
+
+  for (int i = 0; i < N; i++) {
+    if (i % 2) {
+      free(small[i]);
+    }
+    free(large[i]);
+  }
+  assert(emscripten_malloc_profiler_write_profile("profile.txt") == 0);
+  print_bytes("alloc_small");
+  print_bytes("alloc_large");
+
+  // Aligned allocations are recorded once, with their aligned address, so
+  // they are forgotten when they are freed.
+  for (int i = 0; i < N; i++) {
+    aligned[i] = alloc_aligned(i);
+  }
+  assert(emscripten_malloc_profiler_write_profile("profile.txt") == 0);
+  print_bytes("alloc_aligned");
+  for (int i = 0; i < N; i++) {
+    free(aligned[i]);
+  }
+  assert(emscripten_malloc_profiler_write_profile("profile.txt") == 0);
+  print_bytes("alloc_aligned");
+
+  assert(emscripten_malloc_profiler_write_profile("/no/such/dir/profile.txt") == -1);
+  puts("done");
+}
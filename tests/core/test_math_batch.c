@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// Compares emscripten/math_batch.h against the scalar musl functions. Those are
+// within 1 ulp of the exact result, so the batch results must be within the
+// documented bound, rounded up, plus one of them.
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emscripten/math_batch.h>
+
+#define N 1003
+
+static float in[N], in2[N], out[N];
+
+static float from_bits(uint32_t u) {
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+static int64_t ordered(float f) {
+  int32_t i;
+  memcpy(&i, &f, sizeof(i));
+  return i < 0 ? -(int64_t)(i & 0x7fffffff) : i;
+}
+
+// Distance between two floats in ulps. NaNs must match NaNs.
+static int64_t ulps(float a, float b) {
+  if (isnan(a) || isnan(b)) return isnan(a) && isnan(b) ? 0 : INT32_MAX;
+  int64_t d = ordered(a) - ordered(b);
+  return d < 0 ? -d : d;
+}
+
+static void fill(float lo, float hi) {
+  for (int i = 0; i < N; i++) {
+    in[i] = lo + (hi - lo) * (float)rand() / RAND_MAX;
+  }
+  // Also some values outside the kernels' ranges.
+  const float special[] = { 0.0f, -0.0f, INFINITY, -INFINITY, NAN, 1e30f, -1e30f, 1e-40f, -1.0f, 1.0f };
+  for (int i = 0; i < sizeof(special) / sizeof(special[0]); i++) {
+    in[rand() % N] = special[i];
+  }
+}
+
+static void check(const char *name, float (*f)(float), void (*batch)(float *, const float *, size_t),
+                  int max_ulps, float lo, float hi) {
+  int64_t worst = 0;
+  for (int trial = 0; trial < 20; trial++) {
+    fill(lo, hi);
+    // Odd lengths also cover the tails.
+    size_t n = N - trial;
+    batch(out, in, n);
+    for (size_t i = 0; i < n; i++) {
+      int64_t d = ulps(out[i], f(in[i]));
+      if (d > max_ulps + 1) {
+        printf("%s(%a) = %a, expected %a\n", name, in[i], out[i], f(in[i]));
+      }
+      if (d > worst) worst = d;
+    }
+  }
+  // In place.
+  fill(lo, hi);
+  memcpy(in2, in, sizeof(in));
+  batch(in2, in2, N);
+  for (int i = 0; i < N; i++) {
+    assert(ulps(in2[i], f(in[i])) <= max_ulps + 1);
+  }
+  printf("%s: %s\n", name, worst <= max_ulps + 1 ? "ok" : "FAIL");
+}
+
+static void check_pow(int max_ulps) {
+  int64_t worst = 0;
+  for (int trial = 0; trial < 20; trial++) {
+    fill(0.0f, 100.0f);
+    for (int i = 0; i < N; i++) {
+      in2[i] = (float)(rand() % 4001 - 2000) / 100;
+    }
+    size_t n = N - trial;
+    emscripten_batch_powf(out, in, in2, n);
+    for (size_t i = 0; i < n; i++) {
+      int64_t d = ulps(out[i], powf(in[i], in2[i]));
+      if (d > max_ulps + 1) {
+        printf("powf(%a, %a) = %a, expected %a\n", in[i], in2[i], out[i], powf(in[i], in2[i]));
+      }
+      if (d > worst) worst = d;
+    }
+  }
+  printf("powf: %s\n", worst <= max_ulps + 1 ? "ok" : "FAIL");
+}
+
+int main() {
+  check("sinf", sinf, emscripten_batch_sinf, 3, -7000.0f, 7000.0f);
+  check("sinf", sinf, emscripten_batch_sinf, 3, -4.0f, 4.0f);
+  check("cosf", cosf, emscripten_batch_cosf, 3, -7000.0f, 7000.0f);
+  check("cosf", cosf, emscripten_batch_cosf, 3, -4.0f, 4.0f);
+  check("expf", expf, emscripten_batch_expf, 2, -100.0f, 100.0f);
+  check("logf", logf, emscripten_batch_logf, 1, 0.0f, 1e6f);
+  check("logf", logf, emscripten_batch_logf, 1, 0.5f, 2.0f);
+  check("sqrtf", sqrtf, emscripten_batch_sqrtf, 0, 0.0f, 1e6f);
+  check_pow(1);
+
+  // Special values behave exactly like the scalar functions.
+  in[0] = from_bits(0x7fc00000);
+  in[1] = -1.0f;
+  in[2] = 0.0f;
+  in[3] = INFINITY;
+  emscripten_batch_logf(out, in, 4);
+  assert(isnan(out[0]) && isnan(out[1]) && out[2] == -INFINITY && out[3] == INFINITY);
+  emscripten_batch_expf(out, in, 4);
+  assert(isnan(out[0]) && out[1] == expf(-1.0f) && out[2] == 1.0f && out[3] == INFINITY);
+
+  puts("done");
+  return 0;
+}
@@ -0,0 +1,174 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <experimental/list>
+#include <experimental/map>
+#include <experimental/memory_resource>
+#include <experimental/vector>
+
+namespace pmr = std::experimental::pmr;
+
+// Counts what reaches the upstream resource.
+struct counting_resource : pmr::memory_resource {
+  int allocations = 0;
+  int live = 0;
+  size_t live_bytes = 0;
+
+  void* do_allocate(size_t bytes, size_t align) override {
+    allocations++;
+    live++;
+    live_bytes += bytes;
+    return pmr::new_delete_resource()->allocate(bytes, align);
+  }
+  void do_deallocate(void* p, size_t bytes, size_t align) override {
+    live--;
+    live_bytes -= bytes;
+    pmr::new_delete_resource()->deallocate(p, bytes, align);
+  }
+  bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+template<typename Resource>
+void test_containers(const char* name, Resource& res, counting_resource& upstream) {
+  {
+    pmr::map<int, int> m(&res);
+    pmr::list<int> l(&res);
+    for (int i = 0; i < 10000; i++) {
+      m[i * 7 % 10007] = i;
+      l.push_back(i);
+    }
+    for (int i = 0; i < 10000; i += 2) {
+      m.erase(i * 7 % 10007);
+      l.pop_front();
+    }
+    for (int i = 0; i < 5000; i++) {
+      m[-i] = i;
+      l.push_back(i);
+    }
+    long sum = 0;
+    for (auto& kv : m) sum += kv.second;
+    for (int x : l) sum += x;
+    printf("%s: map %zu, list %zu, sum %ld\n", name, m.size(), l.size(), sum);
+  }
+  // Far fewer upstream allocations than container nodes.
+  assert(upstream.allocations > 0 && upstream.allocations < 200);
+  res.release();
+  assert(upstream.live == 0 && upstream.live_bytes == 0);
+}
+
+void test_pool_blocks() {
+  counting_resource upstream;
+  pmr::unsynchronized_pool_resource pool(&upstream);
+
+  // Freed blocks are reused.
+  void* a = pool.allocate(24, 8);
+  pool.deallocate(a, 24, 8);
+  void* b = pool.allocate(24, 8);
+  assert(a == b);
+  pool.deallocate(b, 24, 8);
+
+  // Every size and alignment gets a suitable, distinct block.
+  void* ptrs[300][4];
+  for (int size = 1; size < 300; size++) {
+    for (int k = 0; k < 4; k++) {
+      size_t align = size_t(1) << k * 2;
+      ptrs[size][k] = pool.allocate(size, align);
+      assert((uintptr_t)ptrs[size][k] % align == 0);
+      memset(ptrs[size][k], size & 0xff, size);
+    }
+  }
+  for (int size = 1; size < 300; size++) {
+    for (int k = 0; k < 4; k++) {
+      const unsigned char* p = (const unsigned char*)ptrs[size][k];
+      for (int i = 0; i < size; i++) assert(p[i] == (size & 0xff));
+      pool.deallocate(ptrs[size][k], size, size_t(1) << k * 2);
+    }
+  }
+
+  // Blocks larger than largest_required_pool_block, or with alignments above
+  // max_align_t, go straight upstream.
+  int before = upstream.live;
+  void* big = pool.allocate(4 << 20, 8);
+  void* aligned = pool.allocate(64, 256);
+  assert((uintptr_t)aligned % 256 == 0);
+  assert(upstream.live == before + 2);
+  pool.deallocate(big, 4 << 20, 8);
+  pool.deallocate(aligned, 64, 256);
+  assert(upstream.live == before);
+
+  pool.release();
+  assert(upstream.live == 0);
+  puts("pool blocks: ok");
+}
+
+void test_options() {
+  pmr::pool_options opts;
+  opts.max_blocks_per_chunk = 1;
+  opts.largest_required_pool_block = 100;
+  pmr::unsynchronized_pool_resource pool(opts);
+  pmr::pool_options actual = pool.options();
+  assert(actual.max_blocks_per_chunk >= 1);
+  assert(actual.largest_required_pool_block >= 100);
+  printf("options: %zu %zu\n", actual.max_blocks_per_chunk, actual.largest_required_pool_block);
+
+  pmr::unsynchronized_pool_resource defaults;
+  assert(defaults.upstream_resource() == pmr::get_default_resource());
+  assert(defaults.options().largest_required_pool_block > 0);
+  assert(defaults.options().max_blocks_per_chunk > 0);
+}
+
+void test_monotonic() {
+  counting_resource upstream;
+  char buffer[256];
+  {
+    pmr::monotonic_buffer_resource mono(buffer, sizeof(buffer), &upstream);
+    void* p = mono.allocate(100, 4);
+    assert(p >= buffer && (char*)p + 100 <= buffer + sizeof(buffer));
+    assert(upstream.allocations == 0);
+    // Does not fit in the rest of the buffer.
+    void* q = mono.allocate(200, 16);
+    assert((uintptr_t)q % 16 == 0);
+    assert(upstream.allocations == 1);
+    mono.deallocate(q, 200, 16);
+    assert(upstream.live == 1);
+
+    pmr::vector<int> v(&mono);
+    for (int i = 0; i < 10000; i++) v.push_back(i);
+    // Chunks grow geometrically.
+    assert(upstream.allocations < 30);
+    mono.release();
+    assert(upstream.live == 0);
+    // After release() the initial buffer is used again.
+    p = mono.allocate(100, 4);
+    assert(p >= buffer && (char*)p + 100 <= buffer + sizeof(buffer));
+  }
+  assert(upstream.live == 0);
+  puts("monotonic: ok");
+}
+
+int main() {
+  {
+    counting_resource upstream;
+    pmr::unsynchronized_pool_resource pool(&upstream);
+    test_containers("unsynchronized", pool, upstream);
+  }
+  {
+    counting_resource upstream;
+    pmr::synchronized_pool_resource pool(&upstream);
+    test_containers("synchronized", pool, upstream);
+  }
+  test_pool_blocks();
+  test_options();
+  test_monotonic();
+  puts("done");
+  return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <emscripten/unicode.h>
+
+static void print_utf16(const char *name, const uint16_t *str, size_t len) {
+  printf("%s:", name);
+  for (size_t i = 0; i < len; i++) {
+    printf(" %04x", str[i]);
+  }
+  printf("\n");
+}
+
+static void print_utf8(const char *name, const char *str, size_t len) {
+  printf("%s:", name);
+  for (size_t i = 0; i < len; i++) {
+    printf(" %02x", (unsigned char)str[i]);
+  }
+  printf("\n");
+}
+
+static void test_utf8(const char *name, const char *str, size_t len) {
+  uint16_t out[64];
+  size_t n = emscripten_utf8_to_utf16(str, len, out, 64);
+  assert(n == emscripten_utf8_to_utf16_length(str, len));
+  printf("valid prefix %zu/%zu, ", emscripten_utf8_validate(str, len), len);
+  print_utf16(name, out, n);
+}
+
+static void test_utf16(const char *name, const uint16_t *str, size_t len) {
+  char out[128];
+  size_t n = emscripten_utf16_to_utf8(str, len, out, 128);
+  assert(n == emscripten_utf16_to_utf8_length(str, len));
+  print_utf8(name, out, n);
+}
+
+int main() {
+  // Long enough for the 16-byte blocks of the SIMD version.
+  const char *ascii = "The quick brown fox jumps over the lazy dog";
+  test_utf8("ascii", ascii, strlen(ascii));
+  const char *mixed = "abcdefghijklmnop\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80qrstuvwxyz0123456";
+  test_utf8("mixed", mixed, strlen(mixed));
+
+  // Each maximal ill-formed subpart becomes one U+FFFD.
+  test_utf8("truncated", "a\xe2\x82", 3);
+  test_utf8("overlong", "\xc0\xaf\xe0\x80\xaf", 5);
+  test_utf8("surrogate", "\xed\xa0\x80", 3);
+  test_utf8("too large", "\xf4\x90\x80\x80", 4);
+  test_utf8("stray", "\x80z\xff", 3);
+
+  const uint16_t pair[] = {'a', 0xd83d, 0xde00, 'b'};
+  test_utf16("pair", pair, 4);
+  const uint16_t lone[] = {0xdc00, 'a', 0xd800};
+  test_utf16("lone", lone, 3);
+  uint16_t wide[40];
+  for (int i = 0; i < 40; i++) {
+    wide[i] = i == 20 ? 0x20ac : 'A' + i % 26;
+  }
+  test_utf16("wide", wide, 40);
+
+  // Limited output only ever holds whole characters.
+  uint16_t out16[8];
+  assert(emscripten_utf8_to_utf16("a\xf0\x9f\x98\x80", 5, out16, 2) == 1);
+  assert(emscripten_utf8_to_utf16("a\xf0\x9f\x98\x80", 5, out16, 3) == 3);
+  char out8[8];
+  assert(emscripten_utf16_to_utf8(pair, 4, out8, 4) == 1);
+  assert(emscripten_utf16_to_utf8(pair, 4, out8, 5) == 5);
+  assert(emscripten_utf8_to_utf16(mixed, strlen(mixed), out16, 0) == 0);
+
+  puts("done");
+  return 0;
+}
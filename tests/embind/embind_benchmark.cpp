@@ -462,6 +462,45 @@ void __attribute__((noinline)) pass_gameobject_ptr_benchmark()
     printf("C++ pass_gameobject_ptr %d iters: %f msecs.\n", N, (t2-t));
 }
 
+void __attribute__((noinline)) val_property_access_benchmark(int N, bool scoped)
+{
+    EM_ASM(
+        benchmark_scene = [];
+        for (var i = 0; i < 100; ++i) {
+            var position = {};
+            position.x = i;
+            position.y = 2 * i;
+            position.z = 3 * i;
+            benchmark_scene.push({ transform: { position: position } });
+        }
+    );
+    emscripten::val scene = emscripten::val::global("benchmark_scene");
+    volatile double sum = 0;
+    volatile float t = emscripten_get_now();
+    for (int i = 0; i < N; ++i)
+    {
+        if (scoped)
+        {
+            emscripten::val::scope scope;
+            for (int j = 0; j < 100; ++j)
+            {
+                emscripten::val position = scene[j]["transform"]["position"];
+                sum += position["x"].as<double>() + position["y"].as<double>() + position["z"].as<double>();
+            }
+        }
+        else
+        {
+            for (int j = 0; j < 100; ++j)
+            {
+                emscripten::val position = scene[j]["transform"]["position"];
+                sum += position["x"].as<double>() + position["y"].as<double>() + position["z"].as<double>();
+            }
+        }
+    }
+    volatile float t2 = emscripten_get_now();
+    printf("C++ val property access%s %d frames: %f msecs. Result: %f\n", scoped ? " (val::scope)" : "", N, (t2-t), (double)sum);
+}
+
 int main()
 {
     /*
@@ -507,4 +546,11 @@ int main()
     call_through_interface1();
     call_through_interface2();
     returns_val_benchmark();
+
+    for(int i = 100; i <= 10000; i *= 10)
+    {
+        val_property_access_benchmark(i, false);
+        val_property_access_benchmark(i, true);
+        printf("\n");
+    }
 }
@@ -570,6 +570,30 @@ int main()
   ensure_js("test_val_throw_('message')");
   ensure_js("test_val_throw_(new TypeError('message'))");
   
+  test("class scope");
+  EM_ASM(
+    a = {x: 1};
+    a.y = {z: 'nested'};
+  );
+  int handles_before = EM_ASM_INT(return Module['count_emval_handles']());
+  val escaped = val::undefined();
+  {
+    val::scope scope;
+    val a = val::global("a");
+    ensure(a["x"].as<int>() == 1);
+    ensure(a["y"]["z"].as<string>() == "nested");
+    val copy = a;
+    ensure(copy["x"].as<int>() == 1);
+    {
+      val::scope inner;
+      ensure(a["y"]["z"].as<string>() == "nested");
+    }
+    ensure(a["x"].as<int>() == 1);
+    escaped = val::scope::escape(a["y"]);
+  }
+  ensure(escaped["z"].as<string>() == "nested");
+  ensure(EM_ASM_INT(return Module['count_emval_handles']()) == handles_before + 1);
+  
   // this test should probably go elsewhere as it is not a member of val
   test("template<typename T> std::vector<T> vecFromJSArray(const val& v)");
   EM_ASM(
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <emscripten.h>
+
+// The size of big.bin, which the test fills with (i * 7 + i / 256) & 0xff,
+// so that most of its bytes are not ASCII.
+#define SIZE (3 * 1024 * 1024 + 123)
+
+static unsigned char expected(long i) {
+  return (i * 7 + i / 256) & 0xff;
+}
+
+int main() {
+  FILE* f = fopen("big.bin", "rb");
+  assert(f);
+  // Read across the boundary of the first two chunks of the package, and then
+  // the end of the file.
+  long offsets[] = { 1024 * 1024 - 1000, SIZE - 5000 };
+  for (int i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+    unsigned char buffer[4096];
+    fseek(f, offsets[i], SEEK_SET);
+    size_t num = fread(buffer, 1, sizeof(buffer), f);
+    assert(num == sizeof(buffer));
+    for (size_t j = 0; j < num; j++) {
+      if (buffer[j] != expected(offsets[i] + j)) {
+        printf("byte %ld is %d, not %d\n", offsets[i] + j, buffer[j], expected(offsets[i] + j));
+        REPORT_RESULT(0);
+        return 0;
+      }
+    }
+  }
+  fclose(f);
+  printf("ok\n");
+  REPORT_RESULT(1);
+  return 0;
+}
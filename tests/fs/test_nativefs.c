@@ -0,0 +1,240 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void test_read_write() {
+  int fd = open("/tmp/file", O_CREAT | O_EXCL | O_RDWR, 0644);
+  assert(fd >= 0);
+  assert(write(fd, "hello world", 11) == 11);
+  assert(lseek(fd, 0, SEEK_CUR) == 11);
+
+  char buf[32] = {0};
+  assert(pread(fd, buf, 5, 6) == 5);
+  assert(strcmp(buf, "world") == 0);
+  // pread does not move the position.
+  assert(lseek(fd, 0, SEEK_CUR) == 11);
+
+  assert(pwrite(fd, "W", 1, 6) == 1);
+  assert(lseek(fd, 0, SEEK_SET) == 0);
+  memset(buf, 0, sizeof(buf));
+  assert(read(fd, buf, sizeof(buf)) == 11);
+  assert(strcmp(buf, "hello World") == 0);
+  assert(read(fd, buf, sizeof(buf)) == 0);
+
+  // Writing past the end leaves a hole of zeros.
+  assert(lseek(fd, 16, SEEK_SET) == 16);
+  assert(write(fd, "!", 1) == 1);
+  struct stat st;
+  assert(fstat(fd, &st) == 0);
+  assert(S_ISREG(st.st_mode));
+  assert(st.st_size == 17);
+  assert(pread(fd, buf, 6, 11) == 6);
+  assert(memcmp(buf, "\0\0\0\0\0!", 6) == 0);
+  assert(close(fd) == 0);
+  assert(close(fd) == -1 && errno == EBADF);
+
+  assert(open("/tmp/file", O_CREAT | O_EXCL | O_RDWR, 0644) == -1);
+  assert(errno == EEXIST);
+  assert(open("/tmp/missing", O_RDONLY) == -1);
+  assert(errno == ENOENT);
+}
+
+static void test_flags() {
+  int fd = open("/tmp/file", O_WRONLY | O_APPEND);
+  assert(fd >= 0);
+  assert(write(fd, "?", 1) == 1);
+  struct stat st;
+  assert(stat("/tmp/file", &st) == 0);
+  assert(st.st_size == 18);
+  char c;
+  assert(read(fd, &c, 1) == -1 && errno == EBADF);
+  assert(close(fd) == 0);
+
+  fd = open("/tmp/file", O_RDWR | O_TRUNC);
+  assert(fd >= 0);
+  assert(fstat(fd, &st) == 0);
+  assert(st.st_size == 0);
+  assert(close(fd) == 0);
+
+  // Read-only files cannot be opened for writing.
+  assert(chmod("/tmp/file", 0444) == 0);
+  assert(open("/tmp/file", O_WRONLY) == -1);
+  assert(errno == EACCES);
+  assert(chmod("/tmp/file", 0644) == 0);
+}
+
+static void test_truncate() {
+  assert(truncate("/tmp/file", 100) == 0);
+  struct stat st;
+  assert(stat("/tmp/file", &st) == 0);
+  assert(st.st_size == 100);
+
+  int fd = open("/tmp/file", O_RDWR);
+  assert(ftruncate(fd, 10) == 0);
+  assert(lseek(fd, 0, SEEK_END) == 10);
+  assert(close(fd) == 0);
+
+  fd = open("/tmp/file", O_RDONLY);
+  assert(ftruncate(fd, 0) == -1 && errno == EINVAL);
+  assert(close(fd) == 0);
+}
+
+static void test_directories() {
+  assert(mkdir("/tmp/dir", 0777) == 0);
+  assert(mkdir("/tmp/dir", 0777) == -1 && errno == EEXIST);
+  assert(mkdir("/tmp/dir/sub", 0777) == 0);
+  close(open("/tmp/dir/a", O_CREAT | O_WRONLY, 0666));
+  close(open("/tmp/dir/b", O_CREAT | O_WRONLY, 0666));
+
+  DIR* dir = opendir("/tmp/dir");
+  assert(dir);
+  int found = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir))) {
+    if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+      found |= 1;
+    else if (!strcmp(entry->d_name, "sub"))
+      found |= entry->d_type == DT_DIR ? 2 : 0;
+    else if (!strcmp(entry->d_name, "a") || !strcmp(entry->d_name, "b"))
+      found |= entry->d_type == DT_REG ? 4 : 0;
+    else
+      assert(0);
+  }
+  assert(found == 7);
+  closedir(dir);
+
+  assert(rmdir("/tmp/dir") == -1 && errno == ENOTEMPTY);
+  assert(unlink("/tmp/dir/sub") == -1 && errno == EISDIR);
+  assert(rmdir("/tmp/dir/a") == -1 && errno == ENOTDIR);
+  assert(open("/tmp/dir/a/x", O_RDONLY) == -1 && errno == ENOTDIR);
+}
+
+static void test_rename() {
+  assert(rename("/tmp/dir/a", "/tmp/dir/sub/c") == 0);
+  assert(access("/tmp/dir/a", F_OK) == -1 && errno == ENOENT);
+  assert(access("/tmp/dir/sub/c", F_OK) == 0);
+  // Replacing an existing file.
+  assert(rename("/tmp/dir/b", "/tmp/dir/sub/c") == 0);
+  assert(access("/tmp/dir/b", F_OK) == -1 && errno == ENOENT);
+  // A directory cannot be moved into itself.
+  assert(rename("/tmp/dir", "/tmp/dir/sub/dir") == -1 && errno == EINVAL);
+  assert(rename("/tmp/dir/sub", "/tmp/sub") == 0);
+  assert(access("/tmp/sub/c", F_OK) == 0);
+}
+
+static void test_unlink_open_file() {
+  int fd = open("/tmp/sub/c", O_RDWR);
+  assert(fd >= 0);
+  assert(unlink("/tmp/sub/c") == 0);
+  assert(access("/tmp/sub/c", F_OK) == -1);
+  // The file stays usable until it is closed.
+  assert(write(fd, "still here", 10) == 10);
+  char buf[16] = {0};
+  assert(pread(fd, buf, sizeof(buf), 0) == 10);
+  assert(strcmp(buf, "still here") == 0);
+  struct stat st;
+  assert(fstat(fd, &st) == 0);
+  assert(st.st_nlink == 0);
+  assert(close(fd) == 0);
+  assert(rmdir("/tmp/sub") == 0);
+  assert(rmdir("/tmp/dir") == 0);
+}
+
+static void test_symlinks() {
+  close(open("/tmp/target", O_CREAT | O_WRONLY, 0666));
+  assert(symlink("target", "/tmp/link") == 0);
+  char buf[32] = {0};
+  assert(readlink("/tmp/link", buf, sizeof(buf)) == 6);
+  assert(strcmp(buf, "target") == 0);
+  struct stat st;
+  assert(lstat("/tmp/link", &st) == 0);
+  assert(S_ISLNK(st.st_mode));
+  assert(stat("/tmp/link", &st) == 0);
+  assert(S_ISREG(st.st_mode));
+  assert(open("/tmp/link", O_RDONLY | O_NOFOLLOW) == -1 && errno == ELOOP);
+  assert(readlink("/tmp/target", buf, sizeof(buf)) == -1 && errno == EINVAL);
+  assert(unlink("/tmp/link") == 0);
+  assert(access("/tmp/target", F_OK) == 0);
+  assert(unlink("/tmp/target") == 0);
+}
+
+static void test_dup() {
+  int fd = open("/tmp/dup", O_CREAT | O_RDWR, 0666);
+  int fd2 = dup(fd);
+  assert(fd2 > fd);
+  // Duplicates share the position.
+  assert(write(fd, "abc", 3) == 3);
+  assert(lseek(fd2, 0, SEEK_CUR) == 3);
+  assert(dup2(fd, 50) == 50);
+  assert(close(fd) == 0);
+  assert(write(fd2, "d", 1) == 1);
+  assert(lseek(50, 0, SEEK_CUR) == 4);
+  assert(close(fd2) == 0);
+  assert(close(50) == 0);
+  assert(unlink("/tmp/dup") == 0);
+}
+
+static void test_cwd() {
+  char buf[64];
+  assert(getcwd(buf, sizeof(buf)));
+  assert(strcmp(buf, "/") == 0);
+  assert(chdir("/home/web_user") == 0);
+  assert(getcwd(buf, sizeof(buf)));
+  assert(strcmp(buf, "/home/web_user") == 0);
+  assert(getcwd(buf, 4) == NULL && errno == ERANGE);
+
+  close(open("relative", O_CREAT | O_WRONLY, 0666));
+  assert(access("/home/web_user/relative", F_OK) == 0);
+  assert(chdir("..") == 0);
+  assert(access("web_user/relative", F_OK) == 0);
+  char* resolved = realpath("web_user/../web_user/./relative", NULL);
+  assert(resolved);
+  assert(strcmp(resolved, "/home/web_user/relative") == 0);
+  free(resolved);
+  assert(unlink("web_user/relative") == 0);
+  assert(chdir("/tmp/missing") == -1 && errno == ENOENT);
+  assert(chdir("/dev/null") == -1 && errno == ENOTDIR);
+  assert(chdir("/") == 0);
+}
+
+static void test_devices() {
+  int fd = open("/dev/null", O_RDWR);
+  assert(fd >= 0);
+  assert(write(fd, "x", 1) == 1);
+  char c;
+  assert(read(fd, &c, 1) == 0);
+  assert(close(fd) == 0);
+  assert(isatty(STDOUT_FILENO));
+  assert(!isatty(STDIN_FILENO + 100));
+  struct stat st;
+  assert(stat("/dev/stdout", &st) == 0);
+  assert(S_ISCHR(st.st_mode));
+}
+
+int main() {
+  test_read_write();
+  test_flags();
+  test_truncate();
+  test_directories();
+  test_rename();
+  test_unlink_open_file();
+  test_symlinks();
+  test_dup();
+  test_cwd();
+  test_devices();
+  puts("success");
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Exercises the encoder and decoder of -s OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER
+// with stand-in functions instead of real GL entry points, so no GPU is needed.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emscripten/threading.h"
+
+void _emscripten_gl_command_buffer_record(EM_FUNC_SIGNATURE sig, void *func, void *satellite, ...);
+void _emscripten_gl_command_buffer_flush(void);
+void _emscripten_gl_command_buffer_replay(void *commands);
+
+#define NUM_THREAD_CALLS 10000
+
+static int calls;
+static int nextSequence;
+
+static void record_vi(int value) {
+  printf("vi %d\n", value);
+  ++calls;
+}
+
+static void record_vfff(float a, float b, float c) {
+  printf("vfff %.2f %.2f %.2f\n", a, b, c);
+  ++calls;
+}
+
+static void record_vifi(int a, int b, float c, int d) {
+  printf("viifi %d %d %.2f %d\n", a, b, c, d);
+  ++calls;
+}
+
+static void record_data(int size, const char *data) {
+  printf("data %d %s\n", size, data);
+  ++calls;
+}
+
+static void record_v11(int a0, int a1, int a2, int a3, int a4, int a5, int a6, int a7, int a8, int a9, int a10) {
+  printf("v11 %d\n", a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8 + a9 + a10);
+  ++calls;
+}
+
+static void sequence(int value) {
+  // Calls recorded on a thread must be replayed in the order they were made.
+  assert(value == nextSequence);
+  ++nextSequence;
+}
+
+static void *thread_main(void *arg) {
+  for (int i = 0; i < NUM_THREAD_CALLS; ++i) {
+    _emscripten_gl_command_buffer_record(EM_FUNC_SIG_VI, &sequence, 0, i);
+  }
+  _emscripten_gl_command_buffer_flush();
+  return 0;
+}
+
+int main() {
+  // Nothing runs until the buffer is flushed.
+  _emscripten_gl_command_buffer_record(EM_FUNC_SIG_VI, &record_vi, 0, 42);
+  _emscripten_gl_command_buffer_record(EM_FUNC_SIG_VFFF, &record_vfff, 0, 0.5f, -1.25f, 3.0f);
+  _emscripten_gl_command_buffer_record(EM_FUNC_SIG_VIIFI, &record_vifi, 0, 1, 2, 0.75f, 4);
+  char *satellite = strdup("satellite");
+  _emscripten_gl_command_buffer_record(EM_FUNC_SIG_VII, &record_data, satellite, 9, satellite);
+  _emscripten_gl_command_buffer_record(EM_FUNC_SIG_VIIIIIIIIIII, &record_v11, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11);
+  printf("recorded, calls: %d\n", calls);
+  _emscripten_gl_command_buffer_flush();
+  printf("flushed, calls: %d\n", calls);
+
+  // Flushing an empty buffer is a no-op.
+  _emscripten_gl_command_buffer_flush();
+
+  // Replay a stream that was encoded by hand.
+  uint32_t *stream = (uint32_t*)malloc(11 * sizeof(uint32_t));
+  stream[0] = 11;
+  stream[1] = EM_FUNC_SIG_VI;
+  stream[2] = (uint32_t)(uintptr_t)&record_vi;
+  stream[3] = 0;
+  stream[4] = 7;
+  stream[5] = EM_FUNC_SIG_VFFF;
+  stream[6] = (uint32_t)(uintptr_t)&record_vfff;
+  stream[7] = 0;
+  float args[3] = { 1.0f, 2.0f, 4.0f };
+  memcpy(&stream[8], args, sizeof(args));
+  _emscripten_gl_command_buffer_replay(stream);
+  printf("replayed, calls: %d\n", calls);
+
+  // Calls from a pthread are replayed on the main thread, in order, even when
+  // the buffer has to grow several times.
+  pthread_t thread;
+  pthread_create(&thread, NULL, thread_main, NULL);
+  pthread_join(thread, NULL);
+  printf("thread calls replayed: %d\n", nextSequence);
+  return 0;
+}
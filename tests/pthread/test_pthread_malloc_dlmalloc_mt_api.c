@@ -0,0 +1,77 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// The dlmalloc extensions that MALLOC=dlmalloc provides link with
+// MALLOC=dlmalloc-mt too, and cover the heaps of all threads.
+
+#include <pthread.h>
+#include <emscripten.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+int malloc_trim(size_t pad);
+size_t malloc_footprint(void);
+size_t malloc_max_footprint(void);
+size_t malloc_footprint_limit(void);
+size_t malloc_set_footprint_limit(size_t bytes);
+void** independent_calloc(size_t n_elements, size_t elem_size, void** chunks);
+void** independent_comalloc(size_t n_elements, size_t* sizes, void** chunks);
+size_t bulk_free(void** array, size_t n_elements);
+
+#define N 4
+
+static void *thread_start(void *arg)
+{
+  void **mem = (void**)arg;
+  for (int i = 0; i < N; ++i)
+    mem[i] = malloc(100000);
+  return 0;
+}
+
+int main()
+{
+  void *mem[2 * N];
+  for (int i = 0; i < N; ++i)
+    mem[i] = malloc(1000);
+  size_t mainFootprint = malloc_footprint();
+
+  pthread_t thread;
+  pthread_create(&thread, 0, thread_start, mem + N);
+  pthread_join(thread, 0);
+  // The footprint includes the heap of the other thread.
+  assert(malloc_footprint() >= mainFootprint + N * 100000);
+  assert(malloc_max_footprint() >= malloc_footprint());
+
+  assert(malloc_footprint_limit() == SIZE_MAX);
+  size_t limit = malloc_set_footprint_limit(64 * 1024 * 1024);
+  assert(limit >= 64 * 1024 * 1024);
+  assert(malloc_footprint_limit() == limit);
+  assert(malloc_set_footprint_limit(SIZE_MAX) == 0);
+  assert(malloc_footprint_limit() == SIZE_MAX);
+
+  void *elements[3];
+  assert(independent_calloc(3, 16, elements) == elements);
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 16; ++j)
+      assert(((char*)elements[i])[j] == 0);
+  size_t sizes[2] = { 8, 300 };
+  void **parts = independent_comalloc(2, sizes, 0);
+  assert(parts && parts[0] && parts[1]);
+
+  // Blocks from both heaps.
+  assert(bulk_free(mem, 2 * N) == 0);
+  for (int i = 0; i < 2 * N; ++i)
+    assert(!mem[i]);
+  bulk_free(elements, 3);
+  bulk_free(parts, 2);
+  free(parts);
+  malloc_trim(0);
+
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+}
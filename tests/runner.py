@@ -27,6 +27,7 @@ import difflib
 import fnmatch
 import glob
 import hashlib
+import io
 import json
 import logging
 import math
@@ -1144,6 +1145,19 @@ def harness_server_func(in_queue, out_queue, port):
         self.send_header('Connection', 'close')
         self.end_headers()
         return f
+      elif self.headers.get('Range') and os.path.isfile(self.translate_path(self.path)):
+        # Serve byte ranges, as packages with -s LAZY_PACKAGE are read in
+        # chunks that way.
+        data = open(self.translate_path(self.path), 'rb').read()
+        start, end = self.headers.get('Range').split('=')[1].split('-')
+        start = int(start)
+        end = min(len(data) - 1, int(end))
+        self.send_response(206)
+        self.send_header('Content-type', 'application/octet-stream')
+        self.send_header('Content-Length', str(end - start + 1))
+        self.send_header('Content-Range', 'bytes %d-%d/%d' % (start, end, len(data)))
+        self.end_headers()
+        return io.BytesIO(data[start:end + 1])
       else:
         return SimpleHTTPRequestHandler.send_head(self)
 
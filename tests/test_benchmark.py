@@ -932,6 +932,129 @@ class benchmark(runner.RunnerCore):
       return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
     self.do_benchmark('memset_16mb', open(path_from_root('tests', 'benchmark_memset.cpp')).read(), 'Total time:', output_parser=output_parser, shared_args=['-DMIN_COPY=1048576', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
 
+  @non_core
+  def test_memcpy_128b_bulk_memory(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memcpy_128b_bulk_memory', open(path_from_root('tests', 'benchmark_memcpy.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-mbulk-memory'], shared_args=['-DMAX_COPY=128', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_memcpy_4k_bulk_memory(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memcpy_4k_bulk_memory', open(path_from_root('tests', 'benchmark_memcpy.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-mbulk-memory'], shared_args=['-DMIN_COPY=128', '-DMAX_COPY=4096', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_memcpy_16k_bulk_memory(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memcpy_16k_bulk_memory', open(path_from_root('tests', 'benchmark_memcpy.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-mbulk-memory'], shared_args=['-DMIN_COPY=4096', '-DMAX_COPY=16384', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_memset_128b_bulk_memory(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memset_128b_bulk_memory', open(path_from_root('tests', 'benchmark_memset.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-mbulk-memory'], shared_args=['-DMAX_COPY=128', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_memset_4k_bulk_memory(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memset_4k_bulk_memory', open(path_from_root('tests', 'benchmark_memset.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-mbulk-memory'], shared_args=['-DMIN_COPY=128', '-DMAX_COPY=4096', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_memset_16k_bulk_memory(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('memset_16k_bulk_memory', open(path_from_root('tests', 'benchmark_memset.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-mbulk-memory'], shared_args=['-DMIN_COPY=4096', '-DMAX_COPY=16384', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_string_128b(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('string_128b', open(path_from_root('tests', 'benchmark_string.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-msimd128'], shared_args=['-DMAX_COPY=128', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_string_4k(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('string_4k', open(path_from_root('tests', 'benchmark_string.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-msimd128'], shared_args=['-DMIN_COPY=128', '-DMAX_COPY=4096', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_string_1mb(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('string_1mb', open(path_from_root('tests', 'benchmark_string.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-msimd128'], shared_args=['-DMIN_COPY=4096', '-DMAX_COPY=1048576', '-DBUILD_FOR_SHELL', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_math_batch(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('math_batch', open(path_from_root('tests', 'benchmark_math_batch.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-msimd128'], shared_args=['-I' + path_from_root('tests')])
+
+  @non_core
+  def test_pmr(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('pmr', open(path_from_root('tests', 'benchmark_pmr.cpp')).read(), 'Total time:', output_parser=output_parser, shared_args=['-std=c++17', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_parallel_algorithms_100k(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    # Native builds would need TBB for libstdc++'s parallel algorithms.
+    self.do_benchmark('parallel_algorithms_100k', open(path_from_root('tests', 'benchmark_parallel_algorithms.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-pthread', '-s', 'PTHREAD_POOL_SIZE=8'], shared_args=['-DMIN_SIZE=100000', '-DMAX_SIZE=100000', '-std=c++17', '-I' + path_from_root('tests')], skip_native=True)
+
+  @non_core
+  def test_parallel_algorithms_1m(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    # Native builds would need TBB for libstdc++'s parallel algorithms.
+    self.do_benchmark('parallel_algorithms_1m', open(path_from_root('tests', 'benchmark_parallel_algorithms.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-pthread', '-s', 'PTHREAD_POOL_SIZE=8'], shared_args=['-DMIN_SIZE=1000000', '-DMAX_SIZE=1000000', '-std=c++17', '-I' + path_from_root('tests')], skip_native=True)
+
+  @non_core
+  def test_parallel_algorithms_10m(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    # Native builds would need TBB for libstdc++'s parallel algorithms.
+    self.do_benchmark('parallel_algorithms_10m', open(path_from_root('tests', 'benchmark_parallel_algorithms.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-pthread', '-s', 'PTHREAD_POOL_SIZE=8'], shared_args=['-DMIN_SIZE=10000000', '-DMAX_SIZE=10000000', '-std=c++17', '-I' + path_from_root('tests')], skip_native=True)
+
+  @non_core
+  def test_fs_read_1_thread(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('fs_read_1_thread', open(path_from_root('tests', 'benchmark_fs_threads.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-s', 'PTHREAD_POOL_SIZE=2', '-s', 'PROXY_TO_PTHREAD', '-s', 'EXIT_RUNTIME'], shared_args=['-pthread', '-DNUM_THREADS=1', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_fs_read_1_thread_nativefs(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('fs_read_1_thread_nativefs', open(path_from_root('tests', 'benchmark_fs_threads.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-s', 'PTHREAD_POOL_SIZE=2', '-s', 'PROXY_TO_PTHREAD', '-s', 'EXIT_RUNTIME', '-s', 'NATIVEFS'], shared_args=['-pthread', '-DNUM_THREADS=1', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_fs_read_4_threads(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('fs_read_4_threads', open(path_from_root('tests', 'benchmark_fs_threads.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-s', 'PTHREAD_POOL_SIZE=5', '-s', 'PROXY_TO_PTHREAD', '-s', 'EXIT_RUNTIME'], shared_args=['-pthread', '-DNUM_THREADS=4', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_fs_read_4_threads_nativefs(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('fs_read_4_threads_nativefs', open(path_from_root('tests', 'benchmark_fs_threads.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-s', 'PTHREAD_POOL_SIZE=5', '-s', 'PROXY_TO_PTHREAD', '-s', 'EXIT_RUNTIME', '-s', 'NATIVEFS'], shared_args=['-pthread', '-DNUM_THREADS=4', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_malloc_4_threads(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('malloc_4_threads', open(path_from_root('tests', 'benchmark_malloc_threads.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-s', 'PTHREAD_POOL_SIZE=5', '-s', 'PROXY_TO_PTHREAD', '-s', 'EXIT_RUNTIME', '-s', 'INITIAL_MEMORY=64MB'], shared_args=['-pthread', '-DNUM_THREADS=4', '-I' + path_from_root('tests')])
+
+  @non_core
+  def test_malloc_4_threads_dlmalloc_mt(self):
+    def output_parser(output):
+      return float(re.search(r'Total time: ([\d\.]+)', output).group(1))
+    self.do_benchmark('malloc_4_threads_dlmalloc_mt', open(path_from_root('tests', 'benchmark_malloc_threads.cpp')).read(), 'Total time:', output_parser=output_parser, emcc_args=['-s', 'PTHREAD_POOL_SIZE=5', '-s', 'PROXY_TO_PTHREAD', '-s', 'EXIT_RUNTIME', '-s', 'INITIAL_MEMORY=64MB', '-s', 'MALLOC=dlmalloc-mt'], shared_args=['-pthread', '-DNUM_THREADS=4', '-I' + path_from_root('tests')])
+
   def test_matrix_multiply(self):
     def output_parser(output):
       return float(re.search(r'Total elapsed: ([\d\.]+)', output).group(1))
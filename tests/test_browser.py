@@ -1377,6 +1377,16 @@ keydown(100);keyup(100); // trigger the end
     open('files.js', 'wb').write(out)
     self.btest(os.path.join('fs', 'test_lz4fs.cpp'), '2', args=['--pre-js', 'files.js'])'''
 
+  def test_lazy_package(self):
+    # The data of the file is read in chunks with synchronous range requests,
+    # which must keep its bytes that are not ASCII intact on the main thread
+    # as well as in a worker.
+    size = 3 * 1024 * 1024 + 123
+    create_test_file('big.bin', bytes((i * 7 + i // 256) & 0xff for i in range(size)), binary=True)
+    self.btest(os.path.join('fs', 'test_lazy_package.c'), '1', args=['-s', 'LAZY_PACKAGE', '--preload-file', 'big.bin'])
+    print('proxy-to-worker')
+    self.btest(os.path.join('fs', 'test_lazy_package.c'), '1', args=['-s', 'LAZY_PACKAGE', '--preload-file', 'big.bin', '--proxy-to-worker'])
+
   def test_separate_metadata_later(self):
     # see issue #6654 - we need to handle separate-metadata both when we run before
     # the main program, and when we are run later
@@ -1866,7 +1876,8 @@ keydown(100);keyup(100); // trigger the end
   @requires_graphics_hardware
   @requires_threads
   def test_gl_textures(self):
-    for args in [[], ['-s', 'USE_PTHREADS', '-s', 'PROXY_TO_PTHREAD', '-s', 'OFFSCREEN_FRAMEBUFFER']]:
+    for args in [[], ['-s', 'USE_PTHREADS', '-s', 'PROXY_TO_PTHREAD', '-s', 'OFFSCREEN_FRAMEBUFFER'],
+                 ['-s', 'USE_PTHREADS', '-s', 'PROXY_TO_PTHREAD', '-s', 'OFFSCREEN_FRAMEBUFFER', '-s', 'OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER']]:
       self.btest('gl_textures.cpp', '0', args=['-lGL'] + args)
 
   @requires_graphics_hardware
@@ -3807,6 +3818,14 @@ window.close = function() {
   def test_pthread_malloc_free(self):
     self.btest(path_from_root('tests', 'pthread', 'test_pthread_malloc_free.cpp'), expected='0', args=['-s', 'INITIAL_MEMORY=64MB', '-O3', '-s', 'USE_PTHREADS', '-s', 'PTHREAD_POOL_SIZE=8', '-s', 'INITIAL_MEMORY=256MB'])
 
+  # Same as the two tests above, with a heap per thread. In the second test the
+  # main thread frees memory from other threads' heaps after they have exited.
+  @requires_threads
+  def test_pthread_malloc_dlmalloc_mt(self):
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_malloc.cpp'), expected='0', args=['-O3', '-s', 'USE_PTHREADS', '-s', 'PTHREAD_POOL_SIZE=8', '-s', 'MALLOC=dlmalloc-mt', '-s', 'INITIAL_MEMORY=64MB'])
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_malloc_free.cpp'), expected='0', args=['-O3', '-s', 'USE_PTHREADS', '-s', 'PTHREAD_POOL_SIZE=8', '-s', 'MALLOC=dlmalloc-mt', '-s', 'INITIAL_MEMORY=256MB'])
+    self.btest(path_from_root('tests', 'pthread', 'test_pthread_malloc_dlmalloc_mt_api.c'), expected='0', args=['-s', 'USE_PTHREADS', '-s', 'PTHREAD_POOL_SIZE=1', '-s', 'MALLOC=dlmalloc-mt'])
+
   # Test that the pthread_barrier API works ok.
   @requires_threads
   def test_pthread_barrier(self):
@@ -4184,6 +4203,10 @@ window.close = function() {
   def test_utf8_textdecoder(self):
     self.btest_exit('benchmark_utf8.cpp', 0, args=['--embed-file', path_from_root('tests/utf8_corpus.txt') + '@/utf8_corpus.txt', '-s', 'EXTRA_EXPORTED_RUNTIME_METHODS=["UTF8ToString"]'])
 
+  def test_utf8_wasm_transcoding(self):
+    # Long strings, without TextDecoder, as in pthreads builds.
+    self.btest_exit('benchmark_utf8.cpp', 0, args=['--embed-file', path_from_root('tests/utf8_corpus.txt') + '@/utf8_corpus.txt', '-s', 'EXTRA_EXPORTED_RUNTIME_METHODS=["UTF8ToString"]', '-s', 'TEXTDECODER=0', '-s', 'WASM_STRING_TRANSCODING=256', '-DSTRING_LENGTH=1024'])
+
   def test_utf16_textdecoder(self):
     self.btest_exit('benchmark_utf16.cpp', 0, args=['--embed-file', path_from_root('tests/utf16_corpus.txt') + '@/utf16_corpus.txt', '-s', 'EXTRA_EXPORTED_RUNTIME_METHODS=["UTF16ToString","stringToUTF16","lengthBytesUTF16"]'])
 
@@ -4275,6 +4298,33 @@ window.close = function() {
         print('with args: %s' % str(args))
         self.btest('webgl_draw_triangle.c', '0', args=args)
 
+  # Tests that -s OFFSCREEN_FRAMEBUFFER_STATE_SHADOW answers state queries the same way the context does.
+  @requires_graphics_hardware
+  @requires_threads
+  def test_webgl_offscreen_framebuffer_state_shadow(self):
+    for shadow in [0, 1, 2]:
+      args = ['-lGL', '-s', 'USE_PTHREADS', '-s', 'PROXY_TO_PTHREAD', '-s', 'OFFSCREEN_FRAMEBUFFER', '-s', 'OFFSCREEN_FRAMEBUFFER_STATE_SHADOW=%d' % shadow]
+      print('with args: %s' % str(args))
+      self.btest('webgl_state_shadow.c', '0', args=args)
+
+  # Tests that synchronous html5_webgl.h calls see the GL calls recorded by -s OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER before them.
+  @requires_graphics_hardware
+  @requires_threads
+  def test_webgl_offscreen_framebuffer_command_buffer_sync(self):
+    for args in [[], ['-s', 'OFFSCREENCANVAS_SUPPORT']]:
+      args = ['-lGL', '-s', 'USE_PTHREADS', '-s', 'PROXY_TO_PTHREAD', '-s', 'OFFSCREEN_FRAMEBUFFER', '-s', 'OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER'] + args
+      print('with args: %s' % str(args))
+      self.btest('webgl_command_buffer_sync.c', '0', args=args)
+
+  # Tests that -s GL_STATE_FILTER drops redundant state changes, both for contexts on the main thread and proxied ones.
+  @requires_graphics_hardware
+  @requires_threads
+  def test_webgl_state_filter(self):
+    for args in [[], ['-s', 'USE_PTHREADS', '-s', 'PROXY_TO_PTHREAD', '-s', 'OFFSCREEN_FRAMEBUFFER']]:
+      args = ['-lGL', '-s', 'GL_STATE_FILTER'] + args
+      print('with args: %s' % str(args))
+      self.btest('webgl_state_filter.c', '0', args=args)
+
   # Tests that VAOs can be used even if WebGL enableExtensionsByDefault is set to 0.
   @requires_graphics_hardware
   def test_webgl_vao_without_automatic_extensions(self):
@@ -4299,6 +4349,15 @@ window.close = function() {
       cmd = args + ['-lGL', '-s', 'OFFSCREEN_FRAMEBUFFER', '-DEXPLICIT_SWAP=1']
       self.btest('webgl_offscreen_framebuffer_swap_with_bad_state.c', '0', args=cmd)
 
+  # Tests that -s GL_HEAP_VIEW_CACHE_SIZE rendering works, also when the cache overflows and when memory grows.
+  @requires_graphics_hardware
+  def test_webgl_heap_view_cache(self):
+    for args in [['-s', 'GL_HEAP_VIEW_CACHE_SIZE=256'], ['-s', 'GL_HEAP_VIEW_CACHE_SIZE=1', '-s', 'GL_POOL_TEMP_BUFFERS=0', '-s', 'ALLOW_MEMORY_GROWTH']]:
+      print('with args: %s' % str(args))
+      self.btest('webgl_draw_triangle_with_uniform_color.c', '0', args=['-lGL'] + args)
+    # Many more distinct ranges than the cache holds, before and after memory growth.
+    self.btest('webgl_heap_view_cache.c', '0', args=['-lGL', '-s', 'GL_HEAP_VIEW_CACHE_SIZE=16', '-DCACHE_SIZE=16', '-s', 'ALLOW_MEMORY_GROWTH'])
+
   # Tests that -s WORKAROUND_OLD_WEBGL_UNIFORM_UPLOAD_IGNORED_OFFSET_BUG=1 rendering works.
   @requires_graphics_hardware
   def test_webgl_workaround_webgl_uniform_upload_bug(self):
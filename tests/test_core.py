@@ -137,6 +137,25 @@ def also_with_noderawfs(func):
   return decorated
 
 
+def also_with_nativefs(func):
+  def decorated(self):
+    orig_args = self.emcc_args[:]
+    orig_settings = self.settings_mods.copy()
+    func(self)
+    # NATIVEFS replaces the JS FS, so it cannot be combined with NODERAWFS
+    # when stacked under also_with_noderawfs.
+    if self.get_setting('NODERAWFS'):
+      return
+    print('nativefs')
+    self.emcc_args = orig_args
+    self.set_setting('NATIVEFS')
+    func(self)
+    # Do not leak NATIVEFS into later passes of the decorators above us.
+    self.emcc_args = orig_args
+    self.settings_mods = orig_settings
+  return decorated
+
+
 def can_do_standalone(self):
   return self.is_wasm() and \
       self.get_setting('STACK_OVERFLOW_CHECK', 0) < 2 and \
@@ -712,6 +731,9 @@ class TestCoreBase(RunnerCore):
   def test_math_fmodf(self):
     self.do_run_in_out_file_test('tests', 'math', 'fmodf.c')
 
+  def test_math_batch(self):
+    self.do_run_in_out_file_test('tests', 'core', 'test_math_batch.c')
+
   def test_frexp(self):
     self.do_run_in_out_file_test('tests', 'core', 'test_frexp.c')
 
@@ -891,11 +913,32 @@ base align: 0, 0, 0, 0'''])
 
     self.do_run_in_out_file_test('tests', 'core', 'test_emmalloc_trim.cpp')
 
+  @no_asan('ASan does not support custom memory allocators')
+  @no_lsan('LSan does not support custom memory allocators')
+  def test_emmalloc_release_free_pages(self, *args):
+    self.set_setting('MALLOC', 'emmalloc')
+    self.emcc_args += ['-s', 'ALLOW_MEMORY_GROWTH'] + list(args)
+
+    self.do_run_in_out_file_test('tests', 'core', 'test_emmalloc_release_free_pages.cpp')
+
   # Test case against https://github.com/emscripten-core/emscripten/issues/10363
   def test_emmalloc_memalign_corruption(self, *args):
     self.set_setting('MALLOC', 'emmalloc')
     self.do_run_in_out_file_test('tests', 'core', 'emmalloc_memalign_corruption.cpp')
 
+  @no_asan('ASan does not support custom memory allocators')
+  @no_lsan('LSan does not support custom memory allocators')
+  @no_wasm2js('the profiler maps stack traces to wasm functions')
+  @parameterized({
+    'dlmalloc': ('dlmalloc',),
+    'emmalloc': ('emmalloc',),
+  })
+  def test_malloc_profiler(self, malloc):
+    self.set_setting('MALLOC', malloc)
+    self.set_setting('MALLOC_PROFILER')
+    self.emcc_args += ['--profiling-funcs']
+    self.do_run_in_out_file_test('tests', 'core', 'test_malloc_profiler.c')
+
   def test_newstruct(self):
     self.do_run(self.gen_struct_src.replace('{{gen_struct}}', 'new S').replace('{{del_struct}}', 'delete'), '*51,62*')
 
@@ -2377,6 +2420,12 @@ The current type of b is: 9
   def test_pthread_dispatch_after_exit(self):
     self.do_run_in_out_file_test('tests', 'pthread', 'test_pthread_dispatch_after_exit.c')
 
+  @node_pthreads
+  def test_gl_command_buffer(self):
+    self.set_setting('OFFSCREEN_FRAMEBUFFER')
+    self.set_setting('OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER')
+    self.do_run_in_out_file_test('tests', 'pthread', 'test_gl_command_buffer.c')
+
   def test_tcgetattr(self):
     self.do_runf(path_from_root('tests', 'termios', 'test_tcgetattr.c'), 'success')
 
@@ -5020,6 +5069,7 @@ main( int argv, char ** argc ) {
   def test_readdir(self):
     self.do_run_in_out_file_test('tests', 'dirent', 'test_readdir.c')
 
+  @also_with_nativefs
   def test_readdir_empty(self):
     self.do_run_in_out_file_test('tests', 'dirent', 'test_readdir_empty.c')
 
@@ -5100,6 +5150,17 @@ main( int argv, char ** argc ) {
     self.emcc_args += ['--embed-file', path_from_root('tests/utf8_corpus.txt') + '@/utf8_corpus.txt']
     self.do_runf(path_from_root('tests', 'benchmark_utf8.cpp'), 'OK.')
 
+  def test_utf8_wasm_transcoding(self):
+    self.set_setting('EXTRA_EXPORTED_RUNTIME_METHODS',
+                     ['UTF8ToString', 'stringToUTF8', 'AsciiToString', 'stringToAscii'])
+    # Without TextDecoder, so that UTF8ToString() goes through wasm too.
+    self.set_setting('TEXTDECODER', 0)
+    self.set_setting('WASM_STRING_TRANSCODING', 8)
+    self.do_runf(path_from_root('tests', 'utf8.cpp'), 'OK.')
+
+  def test_unicode_transcoding(self):
+    self.do_run_in_out_file_test('tests', 'core', 'test_unicode_transcoding.c')
+
   # Test that invalid character in UTF8 does not cause decoding to crash.
   def test_utf8_invalid(self):
     self.set_setting('EXTRA_EXPORTED_RUNTIME_METHODS', ['UTF8ToString', 'stringToUTF8'])
@@ -5141,6 +5202,9 @@ main( int argv, char ** argc ) {
   def test_std_function_incomplete_return(self):
     self.do_run_in_out_file_test('tests', 'core', 'test_std_function_incomplete_return.cpp')
 
+  def test_pmr_pool_resources(self):
+    self.do_run_in_out_file_test('tests', 'core', 'test_pmr_pool_resources.cpp')
+
   def test_istream(self):
     # needs to flush stdio streams
     self.set_setting('EXIT_RUNTIME')
@@ -5200,10 +5264,12 @@ main( int argv, char ** argc ) {
     self.do_run_in_out_file_test('tests', 'fs', 'test_write.cpp')
 
   @also_with_noderawfs
+  @also_with_nativefs
   def test_fs_emptyPath(self):
     self.do_run_in_out_file_test('tests', 'fs', 'test_emptyPath.c')
 
   @also_with_noderawfs
+  @also_with_nativefs
   def test_fs_append(self):
     self.do_runf(path_from_root('tests', 'fs', 'test_append.c'), 'success')
 
@@ -5252,6 +5318,10 @@ main( int argv, char ** argc ) {
   def test_fs_64bit(self):
     self.do_runf(path_from_root('tests', 'fs', 'test_64bit.c'), 'success')
 
+  def test_fs_nativefs(self):
+    self.set_setting('NATIVEFS')
+    self.do_runf(path_from_root('tests', 'fs', 'test_nativefs.c'), 'success')
+
   def test_sigalrm(self):
     self.do_runf(path_from_root('tests', 'sigalrm.cpp'), '')
 
@@ -5275,6 +5345,7 @@ main( int argv, char ** argc ) {
     self.do_run_in_out_file_test('tests', 'unistd', 'curdir.c')
 
   @also_with_noderawfs
+  @also_with_nativefs
   def test_unistd_close(self):
     self.do_run_in_out_file_test('tests', 'unistd', 'close.c')
 
@@ -5811,6 +5882,18 @@ return malloc(size);
     self.emcc_args.extend(['-munimplemented-simd128', '-xc', '-std=c99'])
     self.build(path_from_root('tests', 'test_wasm_intrinsics_simd.c'))
 
+  @wasm_simd
+  def test_wasm_simd_string(self):
+    # -msimd128 selects the libc variant with SIMD versions of the string
+    # functions.
+    self.do_runf(path_from_root('tests', 'test_wasm_simd_string.c'), 'Success!')
+
+  @wasm_simd
+  def test_wasm_simd_math_batch(self):
+    # With -msimd128 emscripten/math_batch.h uses polynomial kernels rather
+    # than the scalar libm functions.
+    self.do_run_in_out_file_test('tests', 'core', 'test_math_batch.c')
+
   # Tests invoking the NEON SIMD API via arm_neon.h header
   @wasm_simd
   def test_neon_wasm_simd(self):
@@ -8188,6 +8271,26 @@ NODEFS is no longer included by default; build with -lnodefs.js
     self.set_setting('EXIT_RUNTIME')
     self.do_run_in_out_file_test('tests', 'core', 'pthread', 'create.cpp')
 
+  def test_parallel_algorithms(self):
+    # Without pthreads the parallel overloads run serially.
+    self.emcc_args += ['-std=c++17']
+    self.do_run_in_out_file_test('tests', 'core', 'pthread', 'parallel_algorithms.cpp')
+
+  @node_pthreads
+  def test_pthread_parallel_algorithms(self):
+    self.set_setting('PROXY_TO_PTHREAD')
+    self.set_setting('EXIT_RUNTIME')
+    self.emcc_args += ['-std=c++17']
+    self.do_run_in_out_file_test('tests', 'core', 'pthread', 'parallel_algorithms.cpp')
+
+  @node_pthreads
+  def test_pthread_nativefs(self):
+    # The main thread never yields, so the workers must be ready up front.
+    self.set_setting('PTHREAD_POOL_SIZE', '4')
+    self.set_setting('NATIVEFS')
+    self.set_setting('EXIT_RUNTIME')
+    self.do_run_in_out_file_test('tests', 'core', 'pthread', 'nativefs.c')
+
   @node_pthreads
   def test_pthread_c11_threads(self):
     self.set_setting('PROXY_TO_PTHREAD')
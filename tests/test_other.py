@@ -17,6 +17,7 @@ import re
 import select
 import shlex
 import shutil
+import struct
 import subprocess
 import sys
 import time
@@ -513,6 +514,39 @@ f.close()
     self.run_process([EMCC, 'out.o'])
     self.assertContained('hello, world!', self.run_js('a.out.js'))
 
+  @no_windows('the compile server uses unix sockets')
+  def test_compile_server(self):
+    socket_path = os.path.abspath('server.sock')
+    server_py = path_from_root('tools', 'compile_server.py')
+    server = subprocess.Popen([PYTHON, server_py, '--verbose', socket_path], stderr=PIPE, universal_newlines=True)
+    try:
+      for _ in range(600):
+        if os.path.exists(socket_path):
+          break
+        time.sleep(0.1)
+      with env_modify({'EMCC_SERVER': socket_path}):
+        self.run_process([EMCC, path_from_root('tests', 'hello_world.c'), '-c', '-o', 'hello.o'])
+        self.run_process([EMXX, 'hello.o', '-o', 'hello.js'])
+        self.assertContained('hello, world!', self.run_js('hello.js'))
+
+        # Errors and the exit status are passed back to the client.
+        err = self.expect_fail([EMXX, 'nonexistent.c'])
+        self.assertContained('em++: error: nonexistent.c: No such file or directory', err)
+
+        # Clients that do not match the server run the invocation themselves.
+        with env_modify({'EMCC_TEST_UNUSED': '1'}):
+          self.run_process([EMCC, path_from_root('tests', 'hello_world.c'), '-c', '-o', 'local.o'])
+        self.assertExists('local.o')
+    finally:
+      self.run_process([PYTHON, server_py, '--stop', socket_path])
+      err = server.communicate()[1]
+    self.assertEqual(server.returncode, 0)
+    self.assertContained('running: %s -c -o hello.o' % shared.shlex_join([EMCC + '.py', path_from_root('tests', 'hello_world.c')]), err)
+    self.assertContained('running: %s hello.o -o hello.js' % (EMXX + '.py'), err)
+    self.assertNotContained('local.o', err)
+    # The server removes its socket when it stops.
+    self.assertNotExists(socket_path)
+
   def test_emcc_print_search_dirs(self):
     result = self.run_process([EMCC, '-print-search-dirs'], stdout=PIPE, stderr=PIPE)
     self.assertContained('programs: =', result.stdout)
@@ -2299,6 +2333,126 @@ int f() {
     # can only assert the uuid format is correct, the uuid's value is expected to differ in between invocation
     uuid.UUID(metadata['package_uuid'], version=4)
 
+  def test_file_packager_dedup(self):
+    create_test_file('a.txt', 'same contents')
+    create_test_file('b.txt', 'same contents')
+    create_test_file('c.txt', 'other contents')
+    self.run_process([FILE_PACKAGER, 'test.data', '--preload', 'a.txt', 'b.txt', 'c.txt', '--js-output=test.js', '--separate-metadata'])
+    with open('test.js.metadata') as f:
+      files = json.load(f)['files']
+    self.assertEqual([(f['start'], f['end']) for f in files], [(0, 13), (0, 13), (13, 27)])
+    # The second file gets a copy of the data, so that writing to one of them
+    # does not change the other.
+    self.assertEqual([f.get('copy') for f in files], [None, 1, None])
+    self.assertEqual(open('test.data').read(), 'same contentsother contents')
+
+  def test_file_packager_incremental(self):
+    def package(*args):
+      self.run_process([FILE_PACKAGER, 'test.data', '--preload', 'assets', '--js-output=test.js', '--separate-metadata', '--incremental'] + list(args),
+                       env=dict(os.environ, EMCC_DEBUG='1'), stderr=PIPE)
+      with open('test.js.metadata') as f:
+        files = {f['filename']: (f['start'], f['end']) for f in json.load(f)['files']}
+      with open('test.data', 'rb') as f:
+        data = f.read()
+      for name, (start, end) in files.items():
+        with open(name[1:], 'rb') as f:
+          self.assertEqual(data[start:end], f.read())
+      return files
+
+    ensure_dir('assets')
+    for i in range(10):
+      create_test_file('assets/%d.txt' % i, str(i) * 1000)
+    first = package()
+    self.assertExists('test.data.state.json')
+
+    # Changed and new files are added at the end, the rest stay where they are.
+    time.sleep(0.1)
+    create_test_file('assets/3.txt', 'changed')
+    create_test_file('assets/new.txt', 'new')
+    second = package()
+    self.assertEqual(first['/assets/5.txt'], second['/assets/5.txt'])
+    self.assertGreaterEqual(second['/assets/3.txt'][0], 10000)
+    self.assertGreaterEqual(second['/assets/new.txt'][0], 10000)
+    self.assertEqual(os.path.getsize('test.data'), 10000 + len('changed') + len('new'))
+
+    # Once most of the package is unused it is laid out again.
+    for i in range(6):
+      os.remove('assets/%d.txt' % i)
+    third = package()
+    self.assertEqual(os.path.getsize('test.data'), 4000 + len('new'))
+    self.assertEqual(len(third), 5)
+
+  @parameterized({
+    '': ([],),
+    'incremental': (['--incremental'],),
+  })
+  def test_file_packager_lz4_segments(self, args):
+    # The package is compressed in independent segments in parallel, which
+    # gives the same output as compressing it in one go.
+    create_test_file('data.txt', ''.join('line %d\n' % i for i in range(20000)))
+    create_test_file('random.bin', os.urandom(20000), binary=True)
+    cmd = [FILE_PACKAGER, 'test.data', '--preload', 'data.txt', 'random.bin', '--lz4', '--js-output=test.js'] + args
+
+    def package(segment_size):
+      self.run_process(cmd, env=dict(os.environ, EMCC_LZ4_SEGMENT_SIZE=segment_size), stderr=PIPE)
+      with open('test.data', 'rb') as f:
+        data = f.read()
+      with open('test.js') as f:
+        js = f.read()
+      return data, re.search(r'var compressedData = (.*);', js).group(1)
+
+    whole = package(str(1024 * 1024))
+    self.assertEqual(package('4096'), whole)
+    self.assertEqual(package('4096'), whole)
+
+  def test_file_packager_lazy(self):
+    create_test_file('a.txt', 'same contents')
+    create_test_file('b.txt', 'same contents')
+    create_test_file('c.txt', 'other contents')
+    self.run_process([FILE_PACKAGER, 'test.data', '--preload', 'a.txt', 'b.txt', 'c.txt', '--lazy', '--js-output=test.js'])
+    with open('test.data', 'rb') as f:
+      data = f.read()
+    # The package starts with a header and an index of the files.
+    magic, version, index_size = struct.unpack('<4sII', data[:12])
+    self.assertEqual(magic, b'EMPK')
+    self.assertEqual(version, 1)
+    index = json.loads(data[12:12 + index_size])
+    self.assertEqual(index['size'], 27)
+    self.assertEqual([(f['filename'], f['start'], f['end']) for f in index['files']],
+                     [('/a.txt', 0, 13), ('/b.txt', 0, 13), ('/c.txt', 13, 27)])
+    self.assertEqual(data[12 + index_size:], b'same contentsother contents')
+    self.assertContained('Module.LAZYPACKAGE.loadPackage', open('test.js').read())
+
+    err = self.expect_fail([FILE_PACKAGER, 'test.data', '--preload', 'a.txt', '--lazy', '--lz4'])
+    self.assertContained('--lazy cannot be used with --lz4', err)
+
+  def test_lazy_package(self):
+    # Only the index of the package, and the chunks of the files that are read,
+    # are read from the package.
+    create_test_file('small.txt', 'hello from a lazy package\n')
+    create_test_file('big.bin', os.urandom(4 * 1024 * 1024), binary=True)
+    create_test_file('main.c', r'''
+      #include <stdio.h>
+      #include <sys/stat.h>
+      int main() {
+        struct stat st;
+        stat("big.bin", &st);
+        printf("big.bin: %lld bytes\n", (long long)st.st_size);
+        char buf[100];
+        FILE* f = fopen("small.txt", "r");
+        fputs(fgets(buf, sizeof(buf), f), stdout);
+        fclose(f);
+        printf("can write: %d\n", fopen("small.txt", "w") != NULL);
+        return 0;
+      }
+    ''')
+    create_test_file('post.js', 'out("reads: " + Module.LAZYPACKAGE.reads);')
+    self.run_process([EMCC, 'main.c', '-s', 'LAZY_PACKAGE', '--preload-file', 'small.txt', '--preload-file', 'big.bin', '--post-js', 'post.js'])
+    self.assertContained('big.bin: 4194304 bytes\nhello from a lazy package\ncan write: 0\nreads: 2\n', self.run_js('a.out.js'))
+
+    err = self.expect_fail([EMCC, 'main.c', '-s', 'LAZY_PACKAGE', '-s', 'LZ4', '--preload-file', 'small.txt'])
+    self.assertContained('LAZY_PACKAGE and LZ4 cannot be used together', err)
+
   def test_file_packager_unicode(self):
     unicode_name = 'unicode…☃'
     try:
@@ -2960,6 +3114,75 @@ int main() {
     self.run_process([EMCC, 'src.cpp', '--js-library', 'lib.js', '-s', 'EXPORTED_FUNCTIONS=["_main", "_jslibfunc"]'])
     self.assertContained('c calling: 12\njs calling: 10.', self.run_js('a.out.js'))
 
+  @with_env_modify({'EMCC_DEBUG': '1'})
+  def test_js_compiler_cache(self):
+    # The cache outlives the test, so make the library unique to this run.
+    token = uuid.uuid4().hex
+
+    def create_lib(body):
+      create_test_file('lib.js', '// %s\nmergeInto(LibraryManager.library, {%s});\n' % (token, body))
+
+    create_lib('jslibfunc: function(x) { return 2 * x }')
+    create_test_file('src.c', r'''
+#include <stdio.h>
+int jslibfunc(int x);
+int main() {
+  printf("result: %d\n", jslibfunc(6));
+}
+''')
+    cmd = [EMCC, 'src.c', '--js-library', 'lib.js']
+    self.assertNotContained('using cached JS compiler output', self.run_process(cmd, stderr=PIPE).stderr)
+    self.assertContained('result: 12', self.run_js('a.out.js'))
+
+    # Linking again reuses the output of the JS compiler.
+    self.assertContained('using cached JS compiler output', self.run_process(cmd, stderr=PIPE).stderr)
+    self.assertContained('result: 12', self.run_js('a.out.js'))
+
+    # Changing a JS library, or the settings, does not.
+    create_lib('jslibfunc: function(x) { return 3 * x }')
+    self.assertNotContained('using cached JS compiler output', self.run_process(cmd, stderr=PIPE).stderr)
+    self.assertContained('result: 18', self.run_js('a.out.js'))
+    self.assertNotContained('using cached JS compiler output', self.run_process(cmd + ['-s', 'ASSERTIONS=0'], stderr=PIPE).stderr)
+
+    # Warnings from the JS compiler are shown on cached links too.
+    create_lib('jslibfunc: function(x) { return 4 * x }, jslibfunc__deps: ["nonexistent_dep"]')
+    for cached in (False, True):
+      err = self.run_process(cmd + ['-s', 'ERROR_ON_UNDEFINED_SYMBOLS=0'], stderr=PIPE).stderr
+      self.assertContained('undefined symbol: nonexistent_dep (referenced by jslibfunc)', err)
+      self.assertEqual(cached, 'using cached JS compiler output' in err)
+
+    with env_modify({'EMCC_SKIP_JS_COMPILER_CACHE': '1'}):
+      self.assertNotContained('using cached JS compiler output', self.run_process(cmd, stderr=PIPE).stderr)
+
+  def test_incremental_link(self):
+    def build(body, args=[]):
+      create_test_file('src.c', r'''
+#include <stdio.h>
+int main() {
+  %s
+}
+''' % body)
+      return self.run_process([EMCC, 'src.c', '-s', 'INCREMENTAL_LINK'] + args, stderr=PIPE).stderr
+
+    reused = 'incremental link: reused the JS of the previous link'
+    self.assertNotContained(reused, build('puts("first");'))
+    self.assertExists('a.out.link-state.json')
+    self.assertContained('first', self.run_js('a.out.js'))
+
+    # Only the body of a function changed, so the JS is reused.
+    self.assertContained(reused, build('puts("second");'))
+    self.assertContained('second', self.run_js('a.out.js'))
+
+    # A new import changes the metadata, and so does a change to the settings.
+    self.assertNotContained(reused, build('printf("%d\\n", emscripten_get_now() > 0);', ['-include', 'emscripten.h']))
+    self.assertContained('1', self.run_js('a.out.js'))
+    self.assertNotContained(reused, build('puts("third");', ['-s', 'EXIT_RUNTIME']))
+    self.assertContained(reused, build('puts("fourth");', ['-s', 'EXIT_RUNTIME']))
+    self.assertContained('fourth', self.run_js('a.out.js'))
+
+    err = build('puts("fifth");', ['-O2'])
+    self.assertContained('warning: INCREMENTAL_LINK has no effect with optimizations that change the JS and the wasm together', err)
+
   def test_js_lib_using_asm_lib(self):
     create_test_file('lib.js', r'''
 mergeInto(LibraryManager.library, {
@@ -7438,6 +7661,33 @@ end
     # replaced subprocess functions should not cause errors
     self.run_process([EMCC, path_from_root('tests', 'hello_world.c')], env=environ)
 
+  def test_toolchain_profiler_report(self):
+    # The profiler logs go to the temp directory, so use one of our own.
+    environ = dict(os.environ, EM_PROFILE_TOOLCHAIN='1', TMPDIR=self.get_dir(), TMP=self.get_dir(), TEMP=self.get_dir())
+    emprofile = [PYTHON, path_from_root('tools', 'emprofile.py')]
+    self.run_process(emprofile + ['--reset'], env=environ)
+    self.run_process([EMCC, '-c', path_from_root('tests', 'hello_world.c'), '-o', 'hello.o'], env=environ)
+    self.run_process([EMCC, 'hello.o', '-o', 'hello.js'], env=environ)
+    output = self.run_process(emprofile + ['--report', '--outfile=build'], env=environ, stdout=PIPE).stdout
+    self.assertContained('Wrote "build.trace.json"', output)
+
+    with open('build.summary.json') as f:
+      summary = json.load(f)
+    self.assertEqual(summary['processes'], 2)
+    for phase in ('compile inputs', 'link', 'emscript', 'binaryen'):
+      self.assertEqual(summary['phases'][phase]['count'], 1)
+    for tool in ('clang', 'wasm-ld', 'node'):
+      self.assertIn(tool, summary['tools'])
+    # The link can only start once the compile is done.
+    self.assertEqual([step['cmdLine'][1:] for step in summary['criticalPath']],
+                     [['-c', path_from_root('tests', 'hello_world.c'), '-o', 'hello.o'], ['hello.o', '-o', 'hello.js']])
+    self.assertIn('system', summary['caches'])
+
+    with open('build.trace.json') as f:
+      trace = json.load(f)['traceEvents']
+    self.assertIn('clang', [e['name'] for e in trace if e.get('cat') == 'subprocess'])
+    self.assertIn('link', [e['name'] for e in trace if e.get('cat') == 'block'])
+
   def test_noderawfs(self):
     fopen_write = open(path_from_root('tests', 'asmfs', 'fopen_write.cpp')).read()
     create_test_file('main.cpp', fopen_write)
@@ -7456,6 +7706,22 @@ end
     err = self.expect_fail(base + ['--embed-file', 'somefile'])
     self.assertContained(expected, err)
 
+  def test_nativefs_disables_embedding(self):
+    expected = '--preload-file and --embed-file cannot be used with NATIVEFS, which has no JS FS API'
+    base = [EMCC, path_from_root('tests', 'hello_world.c'), '-s', 'NATIVEFS']
+    create_test_file('somefile', 'foo')
+    err = self.expect_fail(base + ['--preload-file', 'somefile'])
+    self.assertContained(expected, err)
+    err = self.expect_fail(base + ['--embed-file', 'somefile'])
+    self.assertContained(expected, err)
+
+  def test_nativefs_errors(self):
+    base = [EMCC, path_from_root('tests', 'hello_world.c'), '-s', 'NATIVEFS']
+    err = self.expect_fail(base + ['-s', 'NODERAWFS'])
+    self.assertContained('NATIVEFS cannot be used with another filesystem (ASMFS or NODERAWFS)', err)
+    err = self.expect_fail(base + ['-s', 'FORCE_FILESYSTEM'])
+    self.assertContained('NATIVEFS has no JS FS API, so it cannot be used with FORCE_FILESYSTEM', err)
+
   @disabled('https://github.com/nodejs/node/issues/18265')
   def test_node_code_caching(self):
     self.run_process([EMCC, path_from_root('tests', 'hello_world.c'),
@@ -7578,6 +7844,25 @@ var ASM_CONSTS = [function() { var x = !<->5.; }];
     self.assertIdentical(normal, tiny)
     self.assertIdentical(normal, huge)
 
+  def test_acorn_optimizer_chunk_size_determinism(self):
+    # Function local acorn passes run on chunks of the JS in parallel, which
+    # must not change the output.
+    def build():
+      err = self.run_process([EMCC, path_from_root('tests', 'hello_world.c'), '-s', 'SAFE_HEAP', '-s', 'CAN_ADDRESS_2GB'], stderr=PIPE).stderr
+      with open('a.out.js') as f:
+        return f.read(), err
+
+    normal, _ = build()
+
+    with env_modify({
+      'EMCC_ACORN_MIN_CHUNK_SIZE': '10000',
+      'EMCC_CORES': '4',
+      'EMCC_DEBUG': '1'
+    }):
+      chunked, err = build()
+    self.assertContained('running acorn passes safeHeap on ', err)
+    self.assertIdentical(normal, chunked)
+
   def test_pthreads_growth_and_unsigned(self):
     create_test_file('src.cpp', r'''
 #include <emscripten.h>
@@ -9211,6 +9496,36 @@ Module.arguments has been replaced with plain arguments_ (the initial value can
     self.run_process([EMCC, 'empty.c', '-la', '-L.'])
     self.assertContained('success', self.run_js('a.out.js'))
 
+  @with_env_modify({'EMCC_DEBUG': '1'})
+  def test_archive_symbol_index(self):
+    def build_archive(value):
+      create_test_file('lib.c', 'int get_value() { return %d; }' % value)
+      self.run_process([EMCC, '-c', 'lib.c', '-o', 'lib.o'])
+      try_delete('liba.a')
+      self.run_process([EMAR, 'cr', 'liba.a', 'lib.o'])
+
+    create_test_file('main.c', r'''
+      #include <stdio.h>
+      int get_value();
+      int main() {
+        printf("value: %d\n", get_value());
+      }
+    ''')
+    scanning = 'scanning 1 archive(s) without an up to date symbol index'
+    build_archive(1)
+    self.assertContained(scanning, self.run_process([EMCC, 'main.c', 'liba.a'], stderr=PIPE).stderr)
+    self.assertExists('liba.a.nm-index.json')
+    self.assertContained('value: 1', self.run_js('a.out.js'))
+
+    # The next link reads the symbols from the index.
+    self.assertNotContained(scanning, self.run_process([EMCC, 'main.c', 'liba.a'], stderr=PIPE).stderr)
+
+    # Changing the archive invalidates the index.
+    time.sleep(0.1)
+    build_archive(2)
+    self.assertContained(scanning, self.run_process([EMCC, 'main.c', 'liba.a'], stderr=PIPE).stderr)
+    self.assertContained('value: 2', self.run_js('a.out.js'))
+
   def test_warning_flags(self):
     self.run_process([EMCC, '-c', '-o', 'hello.o', path_from_root('tests', 'hello_world.c')])
     cmd = [EMCC, 'hello.o', '-o', 'a.js', '-g', '--closure', '1']
@@ -10064,3 +10379,13 @@ exec "$@"
       return self.skipTest('no shell to test')
     self.run_process([EMCC, path_from_root('tests', 'hello_world.c'), '-Oz'])
     self.assertContained('hello, world!', self.run_js('a.out.js', engine=config.V8_ENGINE))
+
+  def test_bulk_memory_memcpy(self):
+    # With -mbulk-memory, memcpy uses memory.copy for large copies instead of
+    # calling out to JS.
+    self.node_args += ['--experimental-wasm-bulk-memory']
+    self.run_process([EMCC, path_from_root('tests', 'test_memcpy_alignment.cpp'), '-O2', '-mbulk-memory'])
+    self.assertNotContained('emscripten_memcpy_big', open('a.out.js').read())
+    self.assertContained('OK.', self.run_js('a.out.js'))
+    self.run_process([EMCC, path_from_root('tests', 'test_memcpy_alignment.cpp'), '-O2'])
+    self.assertContained('emscripten_memcpy_big', open('a.out.js').read())
@@ -10,12 +10,13 @@ import time
 import re
 import tempfile
 import zipfile
+import subprocess
 from subprocess import PIPE, STDOUT
 
 from runner import RunnerCore, path_from_root, env_modify
 from runner import create_test_file, ensure_dir, make_executable
 from tools.config import config_file, EM_CONFIG
-from tools.shared import EMCC
+from tools.shared import EMCC, PYTHON
 from tools.shared import CANONICAL_TEMP_DIR
 from tools.shared import try_delete, config
 from tools.shared import EXPECTED_LLVM_VERSION, Cache
@@ -395,8 +396,8 @@ fi
 
   def assertCacheEmpty(self):
     if os.path.exists(Cache.dirname):
-      # The cache is considered empty if it contains no files at all or just the cache.lock
-      self.assertIn(os.listdir(Cache.dirname), ([], ['cache.lock']))
+      # The cache is considered empty if it contains no files at all or just the lock files
+      self.assertEqual([f for f in os.listdir(Cache.dirname) if f not in ('cache.lock', 'locks')], [])
 
   def ensure_cache(self):
     self.do([EMCC, '-O2', path_from_root('tests', 'hello_world.c')])
@@ -489,6 +490,80 @@ fi
     # Exactly one child process should have triggered libc build!
     self.assertEqual(num_times_libc_was_built, 1)
 
+  # Test that different entries in the cache are created at the same time by
+  # different processes, while each entry is still only created once.
+  def test_cache_entry_locking(self):
+    restore_and_set_up()
+
+    create_test_file('create.py', r'''
+import sys
+import time
+sys.path.insert(0, sys.argv[1])
+from tools import shared
+
+def create(filename):
+  with open('created.txt', 'a') as f:
+    f.write(sys.argv[2] + '\n')
+  time.sleep(5)
+  with open(filename, 'w') as f:
+    f.write(sys.argv[2])
+
+print(shared.Cache.get(sys.argv[2], create))
+''')
+    cache_dir_name = self.in_dir('test_cache')
+    with env_modify({'EM_CACHE': cache_dir_name}):
+      start = time.time()
+      procs = [subprocess.Popen([PYTHON, 'create.py', path_from_root(), name])
+               for name in ('a.txt', 'b.txt', 'c.txt', 'a.txt')]
+      for p in procs:
+        self.assertEqual(p.wait(), 0)
+      elapsed = time.time() - start
+
+    # a.txt is created once, and the second process waits for it.
+    self.assertEqual(sorted(open('created.txt').read().split()), ['a.txt', 'b.txt', 'c.txt'])
+    for name in ('a.txt', 'b.txt', 'c.txt'):
+      self.assertEqual(open(os.path.join(cache_dir_name, name)).read(), name)
+    # Nothing is left behind under a temporary name.
+    self.assertEqual(sorted(f for f in os.listdir(cache_dir_name) if f.endswith('.txt')), ['a.txt', 'b.txt', 'c.txt'])
+    # With a single lock for the whole cache this would take 15 seconds.
+    self.assertLess(elapsed, 12)
+
+  def test_cache_erase_waits_for_entries(self):
+    restore_and_set_up()
+
+    create_test_file('create.py', r'''
+import os
+import sys
+import time
+sys.path.insert(0, sys.argv[1])
+from tools import shared
+
+def create(filename):
+  open('started.txt', 'w').close()
+  time.sleep(3)
+  with open(filename, 'w') as f:
+    f.write('a')
+
+if sys.argv[2] == 'erase':
+  shared.Cache.erase()
+  print('erased: %d' % os.path.exists(shared.Cache.get_path('a.txt')))
+else:
+  shared.Cache.get('a.txt', create)
+''')
+    cache_dir_name = self.in_dir('test_cache')
+    with env_modify({'EM_CACHE': cache_dir_name}):
+      creator = subprocess.Popen([PYTHON, 'create.py', path_from_root(), 'create'])
+      while not os.path.exists('started.txt'):
+        time.sleep(0.1)
+      # The erase only happens once the entry is complete, and removes it.
+      erase = self.run_process([PYTHON, 'create.py', path_from_root(), 'erase'], stdout=PIPE)
+      self.assertEqual(creator.wait(), 0)
+      self.assertEqual(erase.stdout, 'erased: 0\n')
+      self.assertFalse(os.path.exists(os.path.join(cache_dir_name, 'a.txt')))
+      # Entries can still be created after the erase.
+      self.run_process([PYTHON, 'create.py', path_from_root(), 'create'])
+      self.assertTrue(os.path.exists(os.path.join(cache_dir_name, 'a.txt')))
+
   def test_emconfig(self):
     restore_and_set_up()
 
@@ -685,6 +760,21 @@ fi
     # Unless --force is specified
     self.assertContained('generating port', self.do([EMBUILDER, 'build', 'zlib', '--force']))
 
+  def test_embuilder_parallel(self):
+    restore_and_set_up()
+    # Several libraries and ports are built at the same time, with their
+    # compile commands sharing one pool of cores.
+    tasks = ['libemmalloc', 'libdlmalloc', 'libcompiler_rt', 'zlib']
+    with env_modify({'EMCC_CORES': '4'}):
+      output = self.do([EMBUILDER, 'build'] + tasks)
+    self.assertContained('built 4 tasks in', output)
+    self.assertContained('one after another they would take about', output)
+    for lib in ('libemmalloc.a', 'libdlmalloc.a', 'libcompiler_rt.a', 'libz.a'):
+      self.assertExists(Cache.get_lib_name(lib))
+    # Nothing is rebuilt the second time.
+    with env_modify({'EMCC_CORES': '4'}):
+      self.assertNotContained('generating', self.do([EMBUILDER, 'build'] + tasks))
+
   def test_embuilder_wasm_backend(self):
     restore_and_set_up()
     # the --lto flag makes us build wasm-bc
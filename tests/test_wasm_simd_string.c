@@ -0,0 +1,137 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// Checks the libc string functions that have wasm SIMD128 versions against
+// simple byte-at-a-time versions, for every alignment of the inputs and for
+// matches in each position of the 16-byte blocks.
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SIZE 96
+
+static char buf[SIZE + 64] __attribute__((aligned(16)));
+static char buf2[SIZE + 64] __attribute__((aligned(16)));
+
+static size_t ref_strlen(const char *s) {
+  size_t i = 0;
+  while (s[i]) i++;
+  return i;
+}
+
+static const void *ref_memchr(const void *m, int c, size_t n) {
+  const unsigned char *s = m;
+  for (size_t i = 0; i < n; i++)
+    if (s[i] == (unsigned char)c) return s + i;
+  return NULL;
+}
+
+static const void *ref_memrchr(const void *m, int c, size_t n) {
+  const unsigned char *s = m;
+  while (n--)
+    if (s[n] == (unsigned char)c) return s + n;
+  return NULL;
+}
+
+static int sign(int x) {
+  return (x > 0) - (x < 0);
+}
+
+static int ref_memcmp(const void *a, const void *b, size_t n) {
+  const unsigned char *l = a, *r = b;
+  for (size_t i = 0; i < n; i++)
+    if (l[i] != r[i]) return l[i] - r[i];
+  return 0;
+}
+
+static int ref_strcmp(const char *a, const char *b) {
+  const unsigned char *l = (const unsigned char *)a, *r = (const unsigned char *)b;
+  while (*l && *l == *r) l++, r++;
+  return *l - *r;
+}
+
+static size_t ref_strspn(const char *s, const char *accept) {
+  size_t i = 0;
+  while (s[i] && strchr(accept, s[i])) i++;
+  return i;
+}
+
+int main() {
+  // The bytes around each input are non-zero and match the needles, so that
+  // anything read outside of the bounds would change the results.
+  for (int align = 0; align < 32; align++) {
+    for (int len = 0; len < SIZE - 32; len++) {
+      char *s = buf + align;
+
+      // strlen, strchr, strchrnul
+      memset(buf, 'x', sizeof(buf));
+      s[len] = 0;
+      assert(strlen(s) == ref_strlen(s));
+      assert(strchr(s, 'x') == (len ? s : NULL));
+      assert(strchr(s, 'y') == NULL);
+      assert(strchr(s, 0) == s + len);
+      assert(strchrnul(s, 'y') == s + len);
+      if (len) {
+        s[len - 1] = 'y';
+        assert(strchr(s, 'y') == s + len - 1);
+        assert(strrchr(s, 'x') == (len > 1 ? s + len - 2 : NULL));
+      }
+
+      // memchr, memrchr
+      memset(buf, 'z', sizeof(buf));
+      memset(s, 'a', len);
+      assert(memchr(s, 'z', len) == ref_memchr(s, 'z', len));
+      assert(memrchr(s, 'z', len) == ref_memrchr(s, 'z', len));
+      for (int i = 0; i < len; i += 7) {
+        s[i] = 'b';
+        assert(memchr(s, 'b', len) == ref_memchr(s, 'b', len));
+        assert(memrchr(s, 'b', len) == ref_memrchr(s, 'b', len));
+        assert(memchr(s, 0x100 + 'b', len) == ref_memchr(s, 'b', len));
+      }
+
+      // memcmp, strcmp, against every alignment of the other input.
+      for (int align2 = 0; align2 < 16; align2++) {
+        char *t = buf2 + align2;
+        memset(buf, 'q', sizeof(buf));
+        memset(buf2, 'r', sizeof(buf2));
+        for (int i = 0; i < len; i++) s[i] = t[i] = 'a' + i % 26;
+        s[len] = t[len] = 0;
+        assert(memcmp(s, t, len) == 0);
+        assert(strcmp(s, t) == 0);
+        for (int i = 0; i < len; i += 5) {
+          t[i] = (char)0xF0;
+          assert(sign(memcmp(s, t, len)) == sign(ref_memcmp(s, t, len)));
+          assert(sign(memcmp(t, s, len)) == sign(ref_memcmp(t, s, len)));
+          assert(sign(strcmp(s, t)) == sign(ref_strcmp(s, t)));
+          assert(sign(strcmp(t, s)) == sign(ref_strcmp(t, s)));
+          t[i] = s[i];
+        }
+        t[len] = 'a';
+        assert(sign(strcmp(s, t)) == sign(ref_strcmp(s, t)));
+      }
+
+      // strspn, with single character and larger accept sets, including
+      // characters above 127.
+      memset(buf, 'a', sizeof(buf));
+      s[len] = 0;
+      assert(strspn(s, "a") == ref_strspn(s, "a"));
+      assert(strspn(s, "b") == 0);
+      assert(strspn(s, "") == 0);
+      for (int i = 0; i < len; i += 3) {
+        s[i] = (char)(i & 1 ? 0xE9 : 'b');
+        assert(strspn(s, "a") == ref_strspn(s, "a"));
+        assert(strspn(s, "ab") == ref_strspn(s, "ab"));
+        assert(strspn(s, "ba\xE9") == ref_strspn(s, "ba\xE9"));
+        assert(strspn(s, "\xE9\x7F" "a") == ref_strspn(s, "\xE9\x7F" "a"));
+      }
+    }
+  }
+  printf("Success!\n");
+  return 0;
+}
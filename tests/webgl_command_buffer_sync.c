@@ -0,0 +1,46 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// With -s OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER, GL calls from a pthread are
+// recorded, and the synchronous calls of html5_webgl.h that are proxied to the
+// main thread must see all of them.
+
+#include <assert.h>
+#include <stdio.h>
+#include <GLES2/gl2.h>
+#include <emscripten/emscripten.h>
+#include <emscripten/html5.h>
+
+int main()
+{
+  EmscriptenWebGLContextAttributes attr;
+  emscripten_webgl_init_context_attributes(&attr);
+  attr.explicitSwapControl = EM_TRUE;
+  attr.proxyContextToMainThread = EMSCRIPTEN_WEBGL_CONTEXT_PROXY_ALWAYS;
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx = emscripten_webgl_create_context("#canvas", &attr);
+  assert(ctx);
+  emscripten_webgl_make_context_current(ctx);
+
+  glClearStencil(5);
+  assert(emscripten_webgl_get_parameter_d(GL_STENCIL_CLEAR_VALUE) == 5);
+  glSampleCoverage(0.5f, GL_FALSE);
+  assert(emscripten_webgl_get_parameter_d(GL_SAMPLE_COVERAGE_VALUE) == 0.5);
+
+  glEnableVertexAttribArray(1);
+  assert(emscripten_webgl_get_vertex_attrib_d(1, GL_VERTEX_ATTRIB_ARRAY_ENABLED) == 1);
+
+  // Calls that are still recorded when the context is destroyed run before it
+  // goes away, and so do not raise errors on the main thread.
+  glClearColor(0.25f, 0.5f, 0.75f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  emscripten_webgl_make_context_current(0);
+  emscripten_webgl_destroy_context(ctx);
+
+  printf("OK\n");
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+  return 0;
+}
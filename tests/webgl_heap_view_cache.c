@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 The Emscripten Authors.  All rights reserved.
+ * Emscripten is available under two separate licenses, the MIT license and the
+ * University of Illinois/NCSA Open Source License.  Both these licenses can be
+ * found in the LICENSE file.
+ */
+
+// Uploads texture data from many more distinct ranges of the heap than
+// GL_HEAP_VIEW_CACHE_SIZE holds, revisits some of them, and then grows memory
+// and uploads again, checking each upload by reading the pixel back.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emscripten/emscripten.h>
+#include <emscripten/html5.h>
+#include <emscripten/heap.h>
+#include <GLES2/gl2.h>
+
+#define NUM_RANGES (CACHE_SIZE * 4)
+
+static int result = 0;
+
+static void upload_and_check(unsigned char *data, int i, int salt)
+{
+  unsigned char *pixel = data + 4 * i;
+  pixel[0] = i + salt;
+  pixel[1] = i * 3 + salt;
+  pixel[2] = i * 7 + salt;
+  pixel[3] = 255;
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+
+  unsigned char read[4];
+  glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, read);
+  if (memcmp(read, pixel, 4)) {
+    printf("range %d: uploaded %d %d %d %d, read back %d %d %d %d\n", i,
+           pixel[0], pixel[1], pixel[2], pixel[3], read[0], read[1], read[2], read[3]);
+    result = 1;
+  }
+
+  int numHeapViews = EM_ASM_INT(return GL.numHeapViews);
+  if (numHeapViews > CACHE_SIZE) {
+    printf("range %d: %d heap views cached, more than %d\n", i, numHeapViews, CACHE_SIZE);
+    result = 1;
+  }
+}
+
+int main()
+{
+  EmscriptenWebGLContextAttributes attr;
+  emscripten_webgl_init_context_attributes(&attr);
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx = emscripten_webgl_create_context("#canvas", &attr);
+  emscripten_webgl_make_context_current(ctx);
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  GLuint fbo;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+  assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+  unsigned char *data = malloc(4 * NUM_RANGES);
+
+  // Fill the cache, and keep replacing its views.
+  for (int i = 0; i < NUM_RANGES; ++i) upload_and_check(data, i, 0);
+  // Ranges that were replaced, and ranges that were used most recently.
+  for (int i = 0; i < NUM_RANGES; i += 5) upload_and_check(data, i, 0);
+  for (int i = NUM_RANGES - 1; i >= NUM_RANGES - CACHE_SIZE; --i) upload_and_check(data, i, 0);
+
+  // Growing memory replaces the heap views, so views of the old buffer must
+  // not be used any more; new pixel values make sure of that.
+  size_t heapSize = emscripten_get_heap_size();
+  void *grow = malloc(heapSize);
+  assert(grow);
+  assert(emscripten_get_heap_size() > heapSize);
+  for (int i = 0; i < NUM_RANGES; ++i) upload_and_check(data, NUM_RANGES - 1 - i, 100);
+  free(grow);
+
+  free(data);
+  printf("result: %d\n", result);
+#ifdef REPORT_RESULT
+  REPORT_RESULT(result);
+#endif
+  return 0;
+}
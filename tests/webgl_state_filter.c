@@ -0,0 +1,148 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Checks that -s GL_STATE_FILTER drops exactly the calls that would not change
+// the state of the context, and that the state seen by WebGL stays the same.
+
+#include <assert.h>
+#include <stdio.h>
+#include <GLES2/gl2.h>
+#include <emscripten/emscripten.h>
+#include <emscripten/html5.h>
+#include <emscripten/threading.h>
+
+static EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx;
+
+static GLint GetInteger(GLenum pname)
+{
+  GLint value = -1;
+  glGetIntegerv(pname, &value);
+  return value;
+}
+
+static EmscriptenWebGLFilteredCallCounts GetCounts()
+{
+  EmscriptenWebGLFilteredCallCounts counts;
+  EMSCRIPTEN_RESULT res = emscripten_webgl_get_filtered_call_counts(ctx, &counts);
+  assert(res == EMSCRIPTEN_RESULT_SUCCESS);
+  return counts;
+}
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+static void UnbindArrayBuffer()
+{
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+#endif
+
+static GLuint CompileShader(GLenum type, const char *source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  return shader;
+}
+
+static GLuint CreateProgram()
+{
+  GLuint program = glCreateProgram();
+  glAttachShader(program, CompileShader(GL_VERTEX_SHADER, "attribute vec4 pos; void main() { gl_Position = pos; }"));
+  glAttachShader(program, CompileShader(GL_FRAGMENT_SHADER, "void main() { gl_FragColor = vec4(1.0); }"));
+  glLinkProgram(program);
+  return program;
+}
+
+int main()
+{
+  EmscriptenWebGLContextAttributes attr;
+  emscripten_webgl_init_context_attributes(&attr);
+  attr.explicitSwapControl = EM_TRUE;
+  attr.proxyContextToMainThread = EMSCRIPTEN_WEBGL_CONTEXT_PROXY_ALWAYS;
+  ctx = emscripten_webgl_create_context("#canvas", &attr);
+  assert(ctx);
+  emscripten_webgl_make_context_current(ctx);
+  emscripten_webgl_reset_filtered_call_counts(ctx);
+
+  GLuint buffers[2];
+  glGenBuffers(2, buffers);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+  assert(GetCounts().bindBuffer == 1);
+  assert(GetInteger(GL_ARRAY_BUFFER_BINDING) == buffers[0]);
+
+  // Deleting a bound buffer unbinds it, so binding 0 afterwards must go through.
+  glDeleteBuffers(1, &buffers[0]);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+  assert(GetCounts().bindBuffer == 1);
+  assert(GetInteger(GL_ARRAY_BUFFER_BINDING) == buffers[1]);
+
+  // Texture bindings are per texture unit.
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glActiveTexture(GL_TEXTURE1);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  assert(GetCounts().activeTexture == 1);
+  assert(GetCounts().bindTexture == 1);
+  assert(GetInteger(GL_TEXTURE_BINDING_2D) == texture);
+
+  glEnable(GL_BLEND);
+  glEnable(GL_BLEND);
+  glDisable(GL_BLEND);
+  glDisable(GL_BLEND);
+  glDisable(GL_BLEND);
+  assert(GetCounts().enable == 1);
+  assert(GetCounts().disable == 2);
+  assert(!glIsEnabled(GL_BLEND));
+
+  GLuint program = CreateProgram();
+  glUseProgram(program);
+  glUseProgram(program);
+  assert(GetCounts().useProgram == 1);
+  assert(GetInteger(GL_CURRENT_PROGRAM) == program);
+
+  GLuint framebuffer;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  assert(GetCounts().bindFramebuffer == 1);
+
+  // Function pointers handed out by emscripten_webgl_get_proc_address() are filtered too.
+  void (*bindBuffer)(GLenum, GLuint) = (void (*)(GLenum, GLuint))emscripten_webgl_get_proc_address("glBindBuffer");
+  bindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+  assert(GetCounts().bindBuffer == 2);
+
+  EmscriptenWebGLFilteredCallCounts counts = GetCounts();
+  assert(counts.totalFiltered == 9);
+  assert(counts.totalPassed > 0);
+  assert(glGetError() == GL_NO_ERROR);
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+  // The context is proxied to the main thread, which can use it too. After it
+  // does, calls on the context are no longer filtered.
+  emscripten_sync_run_in_main_runtime_thread(EM_FUNC_SIG_V, UnbindArrayBuffer);
+  assert(GetInteger(GL_ARRAY_BUFFER_BINDING) == 0);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+  assert(GetCounts().bindBuffer == 2);
+  assert(GetInteger(GL_ARRAY_BUFFER_BINDING) == buffers[1]);
+#endif
+
+  emscripten_webgl_reset_filtered_call_counts(ctx);
+  assert(GetCounts().totalFiltered == 0);
+
+  emscripten_webgl_make_context_current(0);
+  emscripten_webgl_destroy_context(ctx);
+  printf("OK\n");
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+  return 0;
+}
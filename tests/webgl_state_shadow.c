@@ -0,0 +1,161 @@
+// Copyright 2021 The Emscripten Authors.  All rights reserved.
+// Emscripten is available under two separate licenses, the MIT license and the
+// University of Illinois/NCSA Open Source License.  Both these licenses can be
+// found in the LICENSE file.
+
+// Renders to a context that is proxied from a pthread to the main thread, and
+// checks that state queries give the same answers with
+// -s OFFSCREEN_FRAMEBUFFER_STATE_SHADOW as without it.
+
+#include <assert.h>
+#include <stdio.h>
+#include <GLES2/gl2.h>
+#include <emscripten/emscripten.h>
+#include <emscripten/html5.h>
+
+static GLint GetInteger(GLenum pname)
+{
+  GLint value = -1;
+  glGetIntegerv(pname, &value);
+  return value;
+}
+
+static GLuint CompileShader(GLenum type, const char *source)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  return shader;
+}
+
+static GLuint CreateProgram()
+{
+  GLuint program = glCreateProgram();
+  glAttachShader(program, CompileShader(GL_VERTEX_SHADER,
+    "uniform vec4 offset;"
+    "attribute vec4 pos;"
+    "void main() { gl_Position = pos + offset; }"));
+  glAttachShader(program, CompileShader(GL_FRAGMENT_SHADER,
+    "precision mediump float;"
+    "uniform vec4 color;"
+    "void main() { gl_FragColor = color; }"));
+  glLinkProgram(program);
+  return program;
+}
+
+int main()
+{
+  EmscriptenWebGLContextAttributes attr;
+  emscripten_webgl_init_context_attributes(&attr);
+  attr.explicitSwapControl = EM_TRUE;
+  attr.proxyContextToMainThread = EMSCRIPTEN_WEBGL_CONTEXT_PROXY_ALWAYS;
+  EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx = emscripten_webgl_create_context("#canvas", &attr);
+  assert(ctx);
+  emscripten_webgl_make_context_current(ctx);
+
+  // Object existence follows glGen*, glBind* and glDelete*.
+  GLuint buffers[2];
+  glGenBuffers(2, buffers);
+  assert(!glIsBuffer(buffers[0]));
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+  assert(glIsBuffer(buffers[0]));
+  assert(GetInteger(GL_ARRAY_BUFFER_BINDING) == buffers[0]);
+  assert(GetInteger(GL_ELEMENT_ARRAY_BUFFER_BINDING) == buffers[1]);
+  glDeleteBuffers(1, &buffers[0]);
+  assert(!glIsBuffer(buffers[0]));
+  assert(GetInteger(GL_ARRAY_BUFFER_BINDING) == 0);
+  assert(!glIsBuffer(0));
+  // An element array buffer cannot be bound to another target, and the binding
+  // stays as it was.
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+  assert(glGetError() == GL_INVALID_OPERATION);
+  assert(GetInteger(GL_ARRAY_BUFFER_BINDING) == 0);
+
+  // Texture bindings are per texture unit.
+  GLuint textures[2];
+  glGenTextures(2, textures);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, textures[0]);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, textures[1]);
+  assert(GetInteger(GL_ACTIVE_TEXTURE) == GL_TEXTURE0);
+  assert(GetInteger(GL_TEXTURE_BINDING_2D) == 0);
+  assert(GetInteger(GL_TEXTURE_BINDING_CUBE_MAP) == textures[1]);
+  glActiveTexture(GL_TEXTURE1);
+  assert(GetInteger(GL_TEXTURE_BINDING_2D) == textures[0]);
+  assert(glIsTexture(textures[0]));
+  glDeleteTextures(1, &textures[0]);
+  assert(GetInteger(GL_TEXTURE_BINDING_2D) == 0);
+  assert(!glIsTexture(textures[0]));
+  // Neither can a cube map texture be bound as a 2D one.
+  glBindTexture(GL_TEXTURE_2D, textures[1]);
+  assert(glGetError() == GL_INVALID_OPERATION);
+  assert(GetInteger(GL_TEXTURE_BINDING_2D) == 0);
+  // A unit past the implementation limit leaves the active unit as it was.
+  glActiveTexture(GL_TEXTURE0 + GetInteger(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS));
+  assert(glGetError() == GL_INVALID_ENUM);
+  assert(GetInteger(GL_ACTIVE_TEXTURE) == GL_TEXTURE1);
+
+  GLuint renderbuffer;
+  glGenRenderbuffers(1, &renderbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+  assert(GetInteger(GL_RENDERBUFFER_BINDING) == renderbuffer);
+  assert(glIsRenderbuffer(renderbuffer));
+
+  GLuint framebuffer;
+  glGenFramebuffers(1, &framebuffer);
+  assert(!glIsFramebuffer(framebuffer));
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  assert(GetInteger(GL_FRAMEBUFFER_BINDING) == framebuffer);
+  assert(glIsFramebuffer(framebuffer));
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  // Enable caps, including ones that were never set by this thread.
+  assert(glIsEnabled(GL_DITHER));
+  assert(!glIsEnabled(GL_BLEND));
+  glEnable(GL_BLEND);
+  glEnable(GL_DEPTH_TEST);
+  glDisable(GL_DEPTH_TEST);
+  assert(glIsEnabled(GL_BLEND));
+  assert(!glIsEnabled(GL_DEPTH_TEST));
+  GLboolean enabled = GL_FALSE;
+  glGetBooleanv(GL_BLEND, &enabled);
+  assert(enabled);
+  assert(GetInteger(GL_BLEND) == 1);
+
+  glViewport(1, 2, 30, 40);
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  assert(viewport[0] == 1 && viewport[1] == 2 && viewport[2] == 30 && viewport[3] == 40);
+  glScissor(5, 6, 7, 8);
+  GLint scissor[4];
+  glGetIntegerv(GL_SCISSOR_BOX, scissor);
+  assert(scissor[0] == 5 && scissor[1] == 6 && scissor[2] == 7 && scissor[3] == 8);
+
+  // Uniform locations are cached per program, and stay the same on repeated
+  // queries and across relinking.
+  GLuint program = CreateProgram();
+  GLint color = glGetUniformLocation(program, "color");
+  GLint offset = glGetUniformLocation(program, "offset");
+  assert(color >= 0 && offset >= 0 && color != offset);
+  assert(glGetUniformLocation(program, "color") == color);
+  assert(glGetUniformLocation(program, "missing") == -1);
+  assert(glGetUniformLocation(program, "missing") == -1);
+  glUseProgram(program);
+  assert(GetInteger(GL_CURRENT_PROGRAM) == program);
+  glLinkProgram(program);
+  assert(glGetUniformLocation(program, "offset") >= 0);
+  glUseProgram(0);
+  assert(GetInteger(GL_CURRENT_PROGRAM) == 0);
+
+  assert(glGetError() == GL_NO_ERROR);
+
+  emscripten_webgl_make_context_current(0);
+  emscripten_webgl_destroy_context(ctx);
+  printf("OK\n");
+#ifdef REPORT_RESULT
+  REPORT_RESULT(0);
+#endif
+  return 0;
+}
@@ -1334,6 +1334,27 @@ function safeHeap(ast) {
   });
 }
 
+// Prints the offsets at which the input can be split into chunks that are
+// optimized separately, which is before each top level statement and the
+// comments right before it (so that --closureFriendly keeps them attached).
+function emitTopLevelOffsets(ast) {
+  var offsets = [];
+  var comment = 0;
+  var previousEnd = 0;
+  ast.body.forEach(function(node) {
+    var offset = node.start;
+    while (comment < sourceComments.length && sourceComments[comment].start < node.start) {
+      if (offset === node.start && sourceComments[comment].start >= previousEnd) {
+        offset = sourceComments[comment].start;
+      }
+      comment++;
+    }
+    offsets.push(offset);
+    previousEnd = node.end;
+  });
+  print(JSON.stringify(offsets));
+}
+
 function reattachComments(ast, comments) {
   var symbols = [];
 
@@ -1441,6 +1462,7 @@ var registry = {
   AJSDCE: AJSDCE,
   applyImportAndExportNameChanges: applyImportAndExportNameChanges,
   emitDCEGraph: emitDCEGraph,
+  emitTopLevelOffsets: emitTopLevelOffsets,
   applyDCEGraphRemovals: applyDCEGraphRemovals,
   minifyWhitespace: function() { minifyWhitespace = true },
   noPrint: function() { noPrint = true },
@@ -42,6 +42,8 @@ binaryen_checked = False
 EXPECTED_BINARYEN_VERSION = 100
 # cache results of nm - it can be slow to run
 nm_cache = {}
+# Bump this when the format of the symbol index files changes.
+NM_INDEX_VERSION = 1
 # Stores the object files contained in different archive files passed as input
 ar_contents = {}
 _is_ar_cache = {}
@@ -359,6 +361,89 @@ def make_paths_absolute(f):
     return os.path.abspath(f)
 
 
+# The symbols of an archive are stored in an index file next to it, so that
+# later links (for example against the system libraries in the cache) need not
+# run llvm-nm on it again. The index is valid as long as the path, size and
+# modification time of the archive are the same.
+def get_nm_index_file(archive):
+  return archive + '.nm-index.json'
+
+
+def get_nm_index_key(archive):
+  st = os.stat(archive)
+  return [NM_INDEX_VERSION, os.path.abspath(archive), st.st_size, st.st_mtime_ns]
+
+
+def read_nm_index(archive):
+  try:
+    key = get_nm_index_key(archive)
+    with open(get_nm_index_file(archive)) as f:
+      index = json.load(f)
+  except (OSError, ValueError):
+    return None
+  if index.get('key') != key:
+    return None
+  return ObjectFileInfo(0, None, set(index['defs']), set(index['undefs']), set(index['commons']))
+
+
+def write_nm_index(archive, key, symbols):
+  if config.FROZEN_CACHE and os.path.abspath(archive).startswith(shared.Cache.dirname):
+    return
+  index_file = get_nm_index_file(archive)
+  temp_file = index_file + '.tmp%d' % os.getpid()
+  try:
+    with open(temp_file, 'w') as f:
+      json.dump({
+        'key': key,
+        'defs': sorted(symbols.defs),
+        'undefs': sorted(symbols.undefs),
+        'commons': sorted(symbols.commons),
+      }, f)
+    os.replace(temp_file, index_file)
+  except OSError as e:
+    # The index is only an optimization, e.g. the directory may be read-only.
+    logger.debug('failed to write symbol index for %s: %s', archive, e)
+    try_delete(temp_file)
+
+
+# Runs llvm-nm on a single archive and updates its index. This runs in the
+# multiprocessing pool.
+def llvm_nm_archive(archive):
+  try:
+    key = get_nm_index_key(archive)
+  except OSError:
+    key = None
+  results = run_process([LLVM_NM, archive], stdout=PIPE, stderr=PIPE, check=False)
+  if results.returncode != 0:
+    logger.debug('llvm-nm failed on %s with return code %d' % (archive, results.returncode))
+  symbols = parse_symbols(results.stdout)
+  if key and results.returncode == 0:
+    write_nm_index(archive, key, symbols)
+  return symbols
+
+
+# Populates nm_cache for the given archives, from their index where possible,
+# and otherwise by running llvm-nm on them in parallel.
+def llvm_nm_archives(archives):
+  missing = []
+  for archive in archives:
+    symbols = read_nm_index(archive)
+    ToolchainProfiler.record_cache_access('nm_index', bool(symbols))
+    if symbols:
+      nm_cache[archive] = symbols
+    else:
+      missing.append(archive)
+  if not missing:
+    return
+  logger.debug('scanning %d archive(s) without an up to date symbol index' % len(missing))
+  if len(missing) == 1:
+    results = [llvm_nm_archive(os.path.abspath(missing[0]))]
+  else:
+    results = get_multiprocessing_pool().map(llvm_nm_archive, [os.path.abspath(a) for a in missing])
+  for archive, symbols in zip(missing, results):
+    nm_cache[archive] = symbols
+
+
 # Runs llvm-nm for the given list of files.
 # The results are populated in nm_cache
 def llvm_nm_multiple(files):
@@ -368,11 +453,15 @@ def llvm_nm_multiple(files):
     # Run llvm-nm on files that we haven't cached yet
     llvm_nm_files = [f for f in files if f not in nm_cache]
 
+    # Because of llvm-nm output format, we cannot llvm-nm multiple .a files in
+    # one call, so those are handled separately.
+    llvm_nm_archives(unique_ordered([f for f in llvm_nm_files if is_ar(f)]))
+    llvm_nm_files = [f for f in llvm_nm_files if f not in nm_cache]
+
     # We can issue multiple files in a single llvm-nm calls, but only if those
-    # files are all .o or .bc files. Because of llvm-nm output format, we cannot
-    # llvm-nm multiple .a files in one call, but those must be individually checked.
+    # files are all .o or .bc files.
     if len(llvm_nm_files) > 1:
-      llvm_nm_files = [f for f in files if f.endswith('.o') or f.endswith('.bc')]
+      llvm_nm_files = [f for f in llvm_nm_files if f.endswith('.o') or f.endswith('.bc')]
 
     if len(llvm_nm_files) > 0:
       cmd = [LLVM_NM] + llvm_nm_files
@@ -423,9 +512,8 @@ def llvm_nm_multiple(files):
         # to the output.
         nm_cache[filename] = parse_symbols(results)
 
-    # Any .a files that have multiple .o files will have hard time parsing. Scan those
-    # sequentially to confirm. TODO: Move this to use run_multiple_processes()
-    # when available.
+    # Scan any remaining files, that are neither archives nor .o or .bc files,
+    # one by one.
     for f in files:
       if f not in nm_cache:
         nm_cache[f] = llvm_nm(f)
@@ -880,10 +968,86 @@ def js_optimizer(filename, passes):
     exit_with_error("'%s' failed (%d)", ' '.join(e.cmd), e.returncode)
 
 
+# Passes of acorn-optimizer.js that transform each top level statement on its
+# own. When only these are run on a large file, it is split into chunks of top
+# level statements that are optimized in parallel.
+ACORN_LOCAL_PASSES = ('growableHeap', 'unsignPointers', 'asanify', 'safeHeap', 'minifyWhitespace')
+ACORN_MIN_CHUNK_SIZE = int(os.environ.get('EMCC_ACORN_MIN_CHUNK_SIZE') or 1024 * 1024) # configuring this is just for debugging purposes
+
+
+def get_acorn_optimizer_cmd(filename, passes):
+  cmd = config.NODE_JS + [path_from_root('tools', 'acorn-optimizer.js'), filename] + passes
+  # Keep JS code comments intact through the acorn optimization pass so that JSDoc comments
+  # will be carried over to a later Closure run.
+  if Settings.USE_CLOSURE_COMPILER:
+    cmd += ['--closureFriendly']
+  return cmd
+
+
+# Runs in the multiprocessing pool, so it must not exit on failure.
+def run_acorn_optimizer_chunk(cmd_and_output):
+  cmd, output = cmd_and_output
+  with open(output, 'w') as f:
+    return run_process(cmd, stdout=f, check=False).returncode
+
+
+def split_js_into_chunks(filename, chunk_size):
+  """Splits a JS file at top level statements into chunks of at least
+  chunk_size characters. Returns None if the file cannot be split."""
+  with open(filename, encoding='utf-8') as f:
+    js = f.read()
+  # acorn reports offsets in UTF-16 code units, which only match the offsets
+  # in `js` as long as there are no characters outside the BMP.
+  if re.search('[\U00010000-\U0010FFFF]', js):
+    return None
+  offsets = json.loads(check_call(get_acorn_optimizer_cmd(filename, ['emitTopLevelOffsets', 'noPrint']), stdout=PIPE).stdout)
+  chunks = []
+  start = 0
+  for offset in offsets[1:]:
+    if offset - start >= chunk_size:
+      chunks.append(js[start:offset])
+      start = offset
+  chunks.append(js[start:])
+  return chunks
+
+
+def acorn_optimizer_parallel(filename, passes, cores):
+  """Runs function local passes on chunks of the file in parallel, and returns
+  the merged output, or None if the file is not worth splitting."""
+  with ToolchainProfiler.profile_block('acorn_optimizer_parallel'):
+    chunk_size = max(ACORN_MIN_CHUNK_SIZE, os.path.getsize(filename) // cores)
+    chunks = split_js_into_chunks(filename, chunk_size)
+    if not chunks or len(chunks) == 1:
+      return None
+    logger.debug('running acorn passes %s on %d chunks in parallel' % (' '.join(passes), len(chunks)))
+    temp_files = configuration.get_temp_files()
+    commands = []
+    outputs = []
+    for chunk in chunks:
+      with temp_files.get('.js') as f:
+        f.write(chunk.encode('utf-8'))
+      output = temp_files.get('.jso.js').name
+      commands.append((get_acorn_optimizer_cmd(f.name, passes), output))
+      outputs.append(output)
+    returncodes = get_multiprocessing_pool().map(run_acorn_optimizer_chunk, commands, chunksize=1)
+    for (cmd, _), returncode in zip(commands, returncodes):
+      if returncode != 0:
+        exit_with_error("'%s' failed (%d)", shared.shlex_join(cmd), returncode)
+
+    # Merge the chunks the way the optimizer prints the statements of a single
+    # file, which separates them with an empty line unless minifying.
+    separator = '' if 'minifyWhitespace' in passes else '\n\n'
+    merged = []
+    for output in outputs:
+      with open(output) as f:
+        merged.append(f.read().rstrip('\n'))
+    return separator.join(merged) + '\n'
+
+
 # run JS optimizer on some JS, ignoring asm.js contents if any - just run on it all
 def acorn_optimizer(filename, passes, extra_info=None, return_output=False):
-  optimizer = path_from_root('tools', 'acorn-optimizer.js')
   original_filename = filename
+  output = None
   if extra_info is not None:
     temp_files = configuration.get_temp_files()
     temp = temp_files.get('.js').name
@@ -891,19 +1055,26 @@ def acorn_optimizer(filename, passes, extra_info=None, return_output=False):
     with open(temp, 'a') as f:
       f.write('// EXTRA_INFO: ' + extra_info)
     filename = temp
-  cmd = config.NODE_JS + [optimizer, filename] + passes
-  # Keep JS code comments intact through the acorn optimization pass so that JSDoc comments
-  # will be carried over to a later Closure run.
-  if Settings.USE_CLOSURE_COMPILER:
-    cmd += ['--closureFriendly']
-  if not return_output:
+  elif all(p in ACORN_LOCAL_PASSES for p in passes):
+    cores = get_num_cores()
+    if cores > 1 and os.path.getsize(filename) >= 2 * ACORN_MIN_CHUNK_SIZE:
+      output = acorn_optimizer_parallel(filename, passes, cores)
+  if output is None:
+    cmd = get_acorn_optimizer_cmd(filename, passes)
+    if return_output:
+      return check_call(cmd, stdout=PIPE).stdout
     next = original_filename + '.jso.js'
     configuration.get_temp_files().note(next)
     check_call(cmd, stdout=open(next, 'w'))
-    save_intermediate(next, '%s.js' % passes[0])
-    return next
-  output = check_call(cmd, stdout=PIPE).stdout
-  return output
+  else:
+    if return_output:
+      return output
+    next = original_filename + '.jso.js'
+    configuration.get_temp_files().note(next)
+    with open(next, 'w') as f:
+      f.write(output)
+  save_intermediate(next, '%s.js' % passes[0])
+  return next
 
 
 # evals ctors. if binaryen_bin is provided, it is the dir of the binaryen tool
@@ -6,7 +6,9 @@
 import contextlib
 import logging
 import os
+import threading
 from . import tempfiles, filelock, config, utils
+from .toolchain_profiler import ToolchainProfiler
 
 logger = logging.getLogger('cache')
 
@@ -34,6 +36,12 @@ class Cache:
     self.ensure()
     self.filelock_name = os.path.join(dirname, 'cache.lock')
     self.filelock = filelock.FileLock(self.filelock_name)
+    # Locks for single entries in the cache, see lock_entry().
+    self.entry_locks = {}
+    # Libraries can be built on several threads (see system_libs.BuildGraph),
+    # which share the locks of this process.
+    self.mutex = threading.RLock()
+    self.thread_state = threading.local()
 
   def acquire_cache_lock(self):
     if config.FROZEN_CACHE:
@@ -41,6 +49,10 @@ class Cache:
       # should never happen
       raise Exception('Attempt to lock the cache but FROZEN_CACHE is set')
 
+    with self.mutex:
+      self.acquire_cache_lock_locked()
+
+  def acquire_cache_lock_locked(self):
     if not self.EM_EXCLUSIVE_CACHE_ACCESS and self.acquired_count == 0:
       logger.debug('PID %s acquiring multiprocess file lock to Emscripten cache at %s' % (str(os.getpid()), self.dirname))
       try:
@@ -57,6 +69,10 @@ class Cache:
     self.acquired_count += 1
 
   def release_cache_lock(self):
+    with self.mutex:
+      self.release_cache_lock_locked()
+
+  def release_cache_lock_locked(self):
     self.acquired_count -= 1
     assert self.acquired_count >= 0, "Called release more times than acquire"
     if not self.EM_EXCLUSIVE_CACHE_ACCESS and self.acquired_count == 0:
@@ -76,14 +92,132 @@ class Cache:
     finally:
       self.release_cache_lock()
 
+  def get_entry_lock(self, name):
+    with self.mutex:
+      lock = self.entry_locks.get(name)
+      if not lock:
+        lock = self.entry_locks[name] = filelock.FileLock(os.path.join(self.dirname, 'locks', name + '.lock'))
+      return lock
+
+  @contextlib.contextmanager
+  def lock_entry(self, shortname):
+    """A context manager that locks a single entry in the cache.
+
+    Unlike lock(), which is for operations on the whole cache such as erase(),
+    this only waits for other processes working on the same entry, so that
+    independent libraries and ports can be built at the same time. Entries are
+    created under a temporary name and renamed into place (see get()), so
+    reading them does not need a lock. The lock can be taken again by the
+    process that holds it."""
+    if config.FROZEN_CACHE:
+      # Raise an exception here rather than exit_with_error since in practice this
+      # should never happen
+      raise Exception('Attempt to lock the cache but FROZEN_CACHE is set')
+
+    if self.EM_EXCLUSIVE_CACHE_ACCESS:
+      yield
+      return
+
+    lock = self.get_entry_lock(shortname.replace('\\', '/').replace('/', '_'))
+    logger.debug('PID %s acquiring multiprocess file lock for %s in Emscripten cache' % (str(os.getpid()), shortname))
+    held_entries = getattr(self.thread_state, 'held_entries', 0)
+    while True:
+      if held_entries:
+        # erase() cannot be running, as it waits for all entry locks, so
+        # there is no need for the global lock. (Taking it could deadlock
+        # with erase() waiting for the entry that we hold.)
+        self.acquire_entry_lock(lock, shortname)
+        break
+      # Otherwise, take the entry lock only while holding the global lock, so
+      # that erase(), which holds it while it waits for all the entries, does
+      # not miss one that is taken just now. Waiting for another process to be
+      # done with the entry is done without the global lock though, so that
+      # it does not hold up other users of the cache.
+      with self.lock():
+        utils.safe_ensure_dirs(os.path.dirname(lock.lock_file))
+        if self.try_entry_lock(lock):
+          break
+      self.wait_for_entry_lock(lock, shortname)
+    self.thread_state.held_entries = held_entries + 1
+    try:
+      yield
+    finally:
+      self.thread_state.held_entries = held_entries
+      lock.release()
+
+  def try_entry_lock(self, lock):
+    try:
+      lock.acquire(0)
+      return True
+    except filelock.Timeout:
+      return False
+
+  def acquire_entry_lock(self, lock, shortname):
+    try:
+      lock.acquire(60)
+    except filelock.Timeout:
+      logger.warning('Accessing "' + shortname + '" in the Emscripten cache is taking a long time, another process should be building it. If there are none and you suspect this process has deadlocked, try deleting the lock file "' + lock.lock_file + '" and try again.')
+      lock.acquire()
+
+  def wait_for_entry_lock(self, lock, shortname):
+    self.acquire_entry_lock(lock, shortname)
+    lock.release()
+
+  @contextlib.contextmanager
+  def lock_all_entries(self):
+    """Waits until no other process holds an entry lock, and then holds all of
+    them. Must be called with the global lock held, so that no new ones can be
+    taken meanwhile, see lock_entry()."""
+    if self.EM_EXCLUSIVE_CACHE_ACCESS:
+      yield
+      return
+
+    lock_dir = os.path.join(self.dirname, 'locks')
+    while True:
+      names = [f[:-len('.lock')] for f in os.listdir(lock_dir) if f.endswith('.lock')] if os.path.isdir(lock_dir) else []
+      acquired = []
+      busy = None
+      for name in names:
+        lock = self.get_entry_lock(name)
+        if not self.try_entry_lock(lock):
+          busy = lock
+          break
+        acquired.append(lock)
+      if not busy:
+        break
+      # Hold none of them while waiting, as the process that has the busy
+      # entry may need another one to finish.
+      for lock in acquired:
+        lock.release()
+      self.wait_for_entry_lock(busy, os.path.basename(busy.lock_file))
+    try:
+      yield
+    finally:
+      for lock in acquired:
+        lock.release()
+
+  @contextlib.contextmanager
+  def lock_while_creating(self, shortname):
+    """Makes get() on this thread also take the lock of the entry shortname,
+    but only while it creates a missing entry. Ports use this for their
+    sources and build directory, which all the libraries of a port share."""
+    prev = getattr(self.thread_state, 'creation_lock', None)
+    self.thread_state.creation_lock = shortname
+    try:
+      yield
+    finally:
+      self.thread_state.creation_lock = prev
+
   def ensure(self):
     utils.safe_ensure_dirs(self.dirname)
 
   def erase(self):
-    with self.lock():
+    with self.lock(), self.lock_all_entries():
       if os.path.exists(self.dirname):
         for f in os.listdir(self.dirname):
-          tempfiles.try_delete(os.path.join(self.dirname, f))
+          # Keep the lock files, which we and others may be waiting on.
+          if f not in ('cache.lock', 'locks'):
+            tempfiles.try_delete(os.path.join(self.dirname, f))
 
   def get_path(self, name):
     return os.path.join(self.dirname, name)
@@ -119,7 +253,7 @@ class Cache:
     self.erase_file(self.get_lib_name(name))
 
   def erase_file(self, shortname):
-    with self.lock():
+    with self.lock_entry(shortname):
       name = os.path.join(self.dirname, shortname)
       if os.path.exists(name):
         logger.info('deleting cached file: %s', name)
@@ -137,6 +271,7 @@ class Cache:
     # Check for existence before taking the lock in case we can avoid the
     # lock completely.
     if os.path.exists(cachename) and not force:
+      ToolchainProfiler.record_cache_access('system', True)
       return cachename
 
     if config.FROZEN_CACHE:
@@ -144,9 +279,14 @@ class Cache:
       # should never happen
       raise Exception('FROZEN_CACHE is set, but cache file is missing: %s' % shortname)
 
-    with self.lock():
+    creation_lock = getattr(self.thread_state, 'creation_lock', None)
+    with self.lock_entry(shortname), contextlib.ExitStack() as stack:
       if os.path.exists(cachename) and not force:
+        ToolchainProfiler.record_cache_access('system', True)
         return cachename
+      if creation_lock:
+        stack.enter_context(self.lock_entry(creation_lock))
+      ToolchainProfiler.record_cache_access('system', False)
       if what is None:
         if shortname.endswith(('.bc', '.so', '.a')):
           what = 'system library'
@@ -155,8 +295,16 @@ class Cache:
       message = 'generating ' + what + ': ' + shortname + '... (this will be cached in "' + cachename + '" for subsequent builds)'
       logger.info(message)
       utils.safe_ensure_dirs(os.path.dirname(cachename))
-      creator(cachename)
-      assert os.path.exists(cachename)
+      # Create the file under a temporary name, keeping the suffix which the
+      # creator may look at, and rename it into place once it is complete.
+      base, suffix = os.path.splitext(cachename)
+      tempname = '%s.tmp%d%s' % (base, os.getpid(), suffix)
+      try:
+        creator(tempname)
+        assert os.path.exists(tempname)
+        os.replace(tempname, cachename)
+      finally:
+        tempfiles.try_delete(tempname)
       logger.info(' - ok')
 
     return cachename
@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+# Copyright 2021 The Emscripten Authors.  All rights reserved.
+# Emscripten is available under two separate licenses, the MIT license and the
+# University of Illinois/NCSA Open Source License.  Both these licenses can be
+# found in the LICENSE file.
+
+"""Compile server for emcc and em++.
+
+Each emcc invocation spends a few hundred milliseconds before it starts clang:
+importing tools/shared.py, tools/building.py and tools/system_libs.py, reading
+the config file, and checking sanity and the sysroot. In builds with thousands
+of source files that adds up. The compile server does all of that once, and then
+runs each invocation in a forked copy of itself:
+
+  tools/compile_server.py /tmp/emcc.sock &
+  export EMCC_SERVER=/tmp/emcc.sock
+  make
+
+With EMCC_SERVER set, emcc and em++ connect to the server before doing their own
+imports, and pass it their arguments, working directory, environment and
+standard streams. They then exit with the status of the invocation.
+
+If the server is not running, or does not match the client, the client runs the
+invocation itself as usual. A server matches if it uses the same emscripten
+directory and config file, and was started with the same EM* environment
+variables (other than EMCC_SERVER and EMCC_CFLAGS) and temp directory
+variables, and the same PATH. The server exits when the config file changes. It
+must be restarted after updating emscripten itself.
+
+To stop the server:
+
+  tools/compile_server.py --stop /tmp/emcc.sock
+
+The server is not available on Windows, or with EMCC_DEBUG.
+"""
+
+import array
+import json
+import os
+import signal
+import socket
+import struct
+import sys
+
+# This module is imported by emcc.py and em++.py before anything else, to run
+# the invocation on the server. Only what that needs is imported at the top
+# level, and the server imports the rest.
+
+__rootpath__ = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Read per invocation, so they need not match between client and server.
+UNCHECKED_ENV_VARS = ('EMCC_SERVER', 'EMCC_CFLAGS', 'EMCC_SKIP_SANITY_CHECK')
+CHECKED_ENV_VARS = ('PATH', 'TMPDIR', 'TMP', 'TEMP')
+
+# The standard streams of the client.
+NUM_FDS = 3
+
+
+def get_fingerprint(env):
+  """Returns the environment variables that emscripten reads when its modules are
+  imported, and so must be the same for the server and its clients."""
+  return {k: v for k, v in env.items()
+          if (k.startswith('EM') and k not in UNCHECKED_ENV_VARS) or k in CHECKED_ENV_VARS}
+
+
+def send_message(sock, message, fds=()):
+  data = json.dumps(message).encode('utf-8')
+  data = struct.pack('!I', len(data)) + data
+  if fds:
+    sent = sock.sendmsg([data], [(socket.SOL_SOCKET, socket.SCM_RIGHTS, array.array('i', fds))])
+    data = data[sent:]
+  sock.sendall(data)
+
+
+def recv_exactly(sock, size):
+  data = b''
+  while len(data) < size:
+    chunk = sock.recv(size - len(data))
+    if not chunk:
+      raise EOFError('connection closed')
+    data += chunk
+  return data
+
+
+def recv_message(sock, max_fds=0):
+  """Returns the next message and the file descriptors sent along with it."""
+  fds = array.array('i')
+  header, ancdata, _, _ = sock.recvmsg(4, socket.CMSG_LEN(max_fds * fds.itemsize))
+  for level, kind, data in ancdata:
+    if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+      fds.frombytes(data[:len(data) - (len(data) % fds.itemsize)])
+  if not header:
+    raise EOFError('connection closed')
+  header += recv_exactly(sock, 4 - len(header))
+  size = struct.unpack('!I', header)[0]
+  return json.loads(recv_exactly(sock, size).decode('utf-8')), list(fds)
+
+
+# Client
+
+
+def run_on_server(argv, emxx):
+  """Runs emcc (or em++) on the server named by EMCC_SERVER, and exits with its
+  status. Returns if the server is not available, so that the caller can run
+  the invocation itself."""
+  if not hasattr(socket, 'AF_UNIX'):
+    return
+  sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+  with sock:
+    try:
+      sock.connect(os.environ['EMCC_SERVER'])
+      send_message(sock, {
+        'argv': argv,
+        'emxx': emxx,
+        'cwd': os.getcwd(),
+        'env': dict(os.environ),
+        'root': __rootpath__,
+      }, fds=range(NUM_FDS))
+      reply, _ = recv_message(sock)
+    except (OSError, EOFError, ValueError):
+      return
+    if 'pid' not in reply:
+      return
+
+    # The invocation now runs on the server, writing directly to our standard
+    # streams.
+    while True:
+      try:
+        reply, _ = recv_message(sock)
+        break
+      except KeyboardInterrupt:
+        os.kill(reply['pid'], signal.SIGINT)
+      except (OSError, EOFError, ValueError):
+        print('emcc: error: lost connection to compile server', file=sys.stderr)
+        sys.exit(1)
+  sys.exit(reply['returncode'])
+
+
+# Server
+
+
+def run_invocation(conn, request, fds):
+  """Runs a request in a forked child of the server. Does not return."""
+  import atexit
+  import traceback
+  from tools import colored_logger, diagnostics
+  import emcc
+
+  returncode = 1
+  try:
+    sys.stdout.flush()
+    sys.stderr.flush()
+    for i, fd in enumerate(fds):
+      os.dup2(fd, i)
+      os.close(fd)
+    os.chdir(request['cwd'])
+    os.environ.clear()
+    os.environ.update(request['env'])
+    # The server already did this.
+    os.environ['EMCC_SKIP_SANITY_CHECK'] = '1'
+    sys.argv = request['argv']
+    # These are set when the modules are imported, from the server's name and
+    # stderr.
+    diagnostics.tool_name = os.path.splitext(os.path.basename(sys.argv[0]))[0]
+    diagnostics.color_enabled = sys.stderr.isatty()
+    colored_logger.disable()
+    colored_logger.enable()
+
+    send_message(conn, {'pid': os.getpid()})
+
+    emcc.run_via_emxx = request['emxx']
+    try:
+      returncode = emcc.main(request['argv'])
+    except SystemExit as e:
+      returncode = e.code
+    except KeyboardInterrupt:
+      emcc.logger.warning('KeyboardInterrupt')
+      returncode = 1
+    except Exception:
+      traceback.print_exc()
+      returncode = 1
+    if returncode is None:
+      returncode = 0
+    elif not isinstance(returncode, int):
+      # Like sys.exit('message').
+      print(returncode, file=sys.stderr)
+      returncode = 1
+    atexit._run_exitfuncs()
+    sys.stdout.flush()
+    sys.stderr.flush()
+    send_message(conn, {'returncode': returncode})
+  except BaseException:
+    traceback.print_exc()
+  finally:
+    os._exit(returncode)
+
+
+def serve(socket_path, verbose):
+  # These imports, and the checks below, are the work the server saves.
+  import emcc # noqa
+  import logging
+  from tools import config, shared, system_libs
+  from tools.shared import exit_with_error
+
+  logger = logging.getLogger('compile_server')
+
+  if shared.DEBUG:
+    exit_with_error('the compile server does not support EMCC_DEBUG')
+  if not hasattr(socket, 'AF_UNIX'):
+    exit_with_error('the compile server is not supported on this platform')
+
+  fingerprint = get_fingerprint(os.environ)
+
+  def get_config_stamp():
+    if not config.config_file:
+      return None
+    try:
+      st = os.stat(config.config_file)
+      return (st.st_mtime, st.st_size)
+    except OSError:
+      return None
+
+  config_stamp = get_config_stamp()
+  shared.check_sanity()
+  system_libs.ensure_sysroot()
+
+  server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+  if os.path.exists(socket_path):
+    try:
+      server.connect(socket_path)
+      exit_with_error('a compile server is already running on %s' % socket_path)
+    except OSError:
+      # Left behind by a server that did not exit cleanly.
+      os.unlink(socket_path)
+    server.close()
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+  server.bind(socket_path)
+  server.listen(128)
+  logger.info('compile server listening on %s', socket_path)
+
+  try:
+    while True:
+      conn, _ = server.accept()
+      fds = []
+      with conn:
+        try:
+          request, fds = recv_message(conn, NUM_FDS)
+          if request.get('stop'):
+            return
+          if get_config_stamp() != config_stamp:
+            send_message(conn, {'error': 'config file changed'})
+            logger.info('config file changed, exiting')
+            return
+          if len(fds) != NUM_FDS or request['root'] != __rootpath__ or get_fingerprint(request['env']) != fingerprint:
+            send_message(conn, {'error': 'mismatch'})
+            continue
+          if verbose:
+            logger.info('running: %s', shared.shlex_join(request['argv']))
+
+          pid = os.fork()
+          if pid == 0:
+            # Fork again, so that the invocation is not a child of the server
+            # and need not be waited for by it.
+            try:
+              if os.fork() == 0:
+                server.close()
+                run_invocation(conn, request, fds)
+            finally:
+              os._exit(0)
+          os.waitpid(pid, 0)
+        except (OSError, EOFError, ValueError, KeyError) as e:
+          logger.warning('bad request: %s', e)
+        finally:
+          for fd in fds:
+            os.close(fd)
+  finally:
+    server.close()
+    os.unlink(socket_path)
+
+
+def stop(socket_path):
+  sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+  with sock:
+    try:
+      sock.connect(socket_path)
+    except OSError as e:
+      print('compile_server: no server running on %s: %s' % (socket_path, e), file=sys.stderr)
+      return 1
+    send_message(sock, {'stop': True})
+  return 0
+
+
+def main():
+  import argparse
+  sys.path.insert(0, __rootpath__)
+  parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--stop', action='store_true', help='stop the server running on SOCKET')
+  parser.add_argument('--verbose', action='store_true', help='log every invocation')
+  parser.add_argument('socket', metavar='SOCKET', help='path of the unix socket to listen on')
+  args = parser.parse_args()
+  if args.stop:
+    return stop(args.socket)
+  try:
+    serve(os.path.abspath(args.socket), args.verbose)
+  except KeyboardInterrupt:
+    pass
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -43,7 +43,7 @@ def list_files_in_directory(d):
     return []
 
 
-def create_profiling_graph():
+def load_profiler_logs():
   log_files = [f for f in list_files_in_directory(profiler_logs_path) if 'toolchain_profiler.pid_' in f]
 
   all_results = []
@@ -64,10 +64,13 @@ def create_profiling_graph():
       sys.exit(1)
   if len(all_results) == 0:
     print('No profiler logs were found in path "' + profiler_logs_path + '". Try setting the environment variable EM_PROFILE_TOOLCHAIN=1 and run some emcc commands, and then rerun "python emprofile.py --graph" again.')
-    return
+    return None
 
   all_results.sort(key=lambda x: x['time'])
+  return all_results
 
+
+def create_profiling_graph(all_results):
   json_file = OUTFILE + '.json'
   open(json_file, 'w').write(json.dumps(all_results, indent=2))
   print('Wrote "' + json_file + '"')
@@ -77,8 +80,177 @@ def create_profiling_graph():
   open(html_file, 'w').write(html_contents)
   print('Wrote "' + html_file + '"')
 
-  if not DEBUG_EMPROFILE_PY:
-    delete_profiler_logs()
+
+# Returns the tool that a subprocess command line runs, e.g. 'clang',
+# 'wasm-ld', 'wasm-opt', 'node' or 'closure'.
+def get_tool_name(cmd):
+  if not cmd:
+    return 'unknown'
+  name = os.path.basename(cmd[0]).lower()
+  if name.endswith(('.exe', '.bat', '.py')):
+    name = os.path.splitext(name)[0]
+  if name.startswith('python'):
+    # Name python scripts after the script.
+    args = cmd[1:]
+    while args and args[0].startswith('-'):
+      args = args[1:]
+    if args:
+      return get_tool_name(args)
+  if name.startswith('clang'):
+    return 'clang'
+  if name in ('node', 'nodejs', 'java') and any('closure' in arg for arg in cmd[1:]):
+    return 'closure'
+  return name
+
+
+# Matches up the events in the logs. Returns the processes, profile blocks and
+# subprocesses, as lists of dicts with a 'name', 'start', 'end', the 'pid' of
+# the process and the 'tid' of the (pool) process that recorded them, and the
+# cache accesses.
+def get_spans(all_results):
+  processes = {}
+  blocks = []
+  subprocesses = []
+  caches = []
+  open_blocks = {}
+  open_subprocesses = {}
+  for e in all_results:
+    pid = e['pid']
+    tid = e['subprocessPid']
+    if e['op'] == 'start':
+      processes[pid] = {'name': get_tool_name([sys.executable] + e['cmdLine']), 'cmdLine': e['cmdLine'],
+                        'pid': pid, 'tid': pid, 'start': e['time'], 'end': None}
+    elif e['op'] == 'exit':
+      if pid in processes:
+        processes[pid]['end'] = e['time']
+        processes[pid]['returncode'] = e['returncode']
+    elif e['op'] == 'enterBlock':
+      open_blocks.setdefault(tid, []).append({'name': e['name'], 'pid': pid, 'tid': tid, 'start': e['time']})
+    elif e['op'] == 'exitBlock':
+      stack = open_blocks.get(tid, [])
+      for i in reversed(range(len(stack))):
+        if stack[i]['name'] == e['name']:
+          block = stack.pop(i)
+          block['end'] = e['time']
+          blocks.append(block)
+          break
+    elif e['op'] == 'spawn':
+      open_subprocesses[(tid, e['targetPid'])] = {'name': get_tool_name(e['cmdLine']), 'cmdLine': e['cmdLine'],
+                                                  'pid': pid, 'tid': tid, 'start': e['time']}
+    elif e['op'] == 'finish':
+      subprocess = open_subprocesses.pop((tid, e['targetPid']), None)
+      if subprocess:
+        subprocess['end'] = e['time']
+        subprocess['returncode'] = e['returncode']
+        subprocesses.append(subprocess)
+    elif e['op'] == 'cache':
+      caches.append(e)
+
+  # Processes that crashed did not record their exit.
+  last_time = all_results[-1]['time']
+  for process in processes.values():
+    if process['end'] is None:
+      process['end'] = last_time
+
+  # Processes that are run by another profiled process are subprocesses of it,
+  # the rest were run by the build system.
+  spawned = set(e['targetPid'] for e in all_results if e['op'] == 'spawn')
+  for process in processes.values():
+    process['topLevel'] = process['pid'] not in spawned
+  return list(processes.values()), blocks, subprocesses, caches
+
+
+def get_totals(spans):
+  totals = {}
+  for span in spans:
+    total = totals.setdefault(span['name'], {'count': 0, 'time': 0})
+    total['count'] += 1
+    total['time'] += span['end'] - span['start']
+  for total in totals.values():
+    total['time'] = round(total['time'], 3)
+  return dict(sorted(totals.items(), key=lambda item: -item[1]['time']))
+
+
+# The logs have no dependencies between the processes that the build system
+# runs, so the critical path is approximated by starting from the process that
+# finished last, and going back to the process that finished last before the
+# current one started, and so on.
+def get_critical_path(processes):
+  processes = [p for p in processes if p['topLevel']]
+  if not processes:
+    return []
+  current = max(processes, key=lambda p: p['end'])
+  path = [current]
+  while True:
+    before = [p for p in processes if p['end'] <= current['start']]
+    if not before:
+      break
+    current = max(before, key=lambda p: p['end'])
+    path.append(current)
+  return path[::-1]
+
+
+# Writes an aggregate of the logs for a whole build: the total time of each
+# profile block (phase) and of each tool run as a subprocess, the critical path
+# and the hit rates of the caches. Also writes the logs in the Chrome trace
+# event format, which can be loaded in chrome://tracing or Perfetto.
+def create_report(all_results):
+  processes, blocks, subprocesses, caches = get_spans(all_results)
+  build_start = min(e['time'] for e in all_results)
+  build_end = max(e['time'] for e in all_results)
+
+  cache_totals = {}
+  for e in caches:
+    total = cache_totals.setdefault(e['name'], {'hits': 0, 'misses': 0})
+    total['hits' if e['hit'] else 'misses'] += 1
+  for total in cache_totals.values():
+    total['hitRate'] = round(total['hits'] / (total['hits'] + total['misses']), 3)
+
+  critical_path = get_critical_path(processes)
+  summary = {
+    'wallTime': round(build_end - build_start, 3),
+    'processes': len(processes),
+    'phases': get_totals(blocks),
+    'tools': get_totals(subprocesses),
+    'criticalPath': [{'name': p['name'], 'cmdLine': p['cmdLine'],
+                      'start': round(p['start'] - build_start, 3),
+                      'time': round(p['end'] - p['start'], 3)} for p in critical_path],
+    'criticalPathTime': round(sum(p['end'] - p['start'] for p in critical_path), 3),
+    'caches': cache_totals,
+  }
+  summary_file = OUTFILE + '.summary.json'
+  open(summary_file, 'w').write(json.dumps(summary, indent=2))
+  print('Wrote "' + summary_file + '"')
+
+  def to_us(t):
+    return int(round((t - build_start) * 1000000))
+
+  trace_events = []
+  for p in processes:
+    trace_events.append({'name': 'process_name', 'ph': 'M', 'pid': p['pid'], 'args': {'name': p['name']}})
+  for category, spans in (('process', processes), ('block', blocks), ('subprocess', subprocesses)):
+    for span in spans:
+      args = {}
+      if 'cmdLine' in span:
+        args['cmdLine'] = span['cmdLine']
+      if 'returncode' in span:
+        args['returncode'] = span['returncode']
+      trace_events.append({'name': span['name'], 'cat': category, 'ph': 'X', 'pid': span['pid'], 'tid': span['tid'],
+                           'ts': to_us(span['start']), 'dur': to_us(span['end']) - to_us(span['start']), 'args': args})
+  for e in caches:
+    trace_events.append({'name': '%s cache %s' % (e['name'], 'hit' if e['hit'] else 'miss'), 'cat': 'cache', 'ph': 'i', 's': 't',
+                         'pid': e['pid'], 'tid': e['subprocessPid'], 'ts': to_us(e['time'])})
+  trace_file = OUTFILE + '.trace.json'
+  open(trace_file, 'w').write(json.dumps({'traceEvents': trace_events, 'displayTimeUnit': 'ms'}))
+  print('Wrote "' + trace_file + '"')
+
+  print('Wall time %.2fs in %d processes, critical path %.2fs' % (summary['wallTime'], len(processes), summary['criticalPathTime']))
+  for title, totals in (('Phases', summary['phases']), ('Tools', summary['tools'])):
+    print(title + ':')
+    for name, total in list(totals.items())[:10]:
+      print('  %-40s %8.2fs %6d' % (name, total['time'], total['count']))
+  for name, total in cache_totals.items():
+    print('Cache %s: %d hits, %d misses' % (name, total['hits'], total['misses']))
 
 
 if len(sys.argv) < 2:
@@ -89,18 +261,31 @@ if len(sys.argv) < 2:
        emprofile.py --graph
          Draws a graph from all recorded profiling log files.
 
+       emprofile.py --report
+         Writes the totals of all recorded profiling log files, per profile
+         block and per subprocess tool, the critical path of the build and
+         the cache hit rates as JSON, and the logs as a Chrome trace.
+
 Optional parameters:
 
         --outfile=x.html
-          Specifies the name of the results file to generate.
+          Specifies the name of the results file to generate. --report
+          writes x.summary.json and x.trace.json.
 ''')
   sys.exit(1)
 
 
 if '--reset' in sys.argv:
   delete_profiler_logs()
-elif '--graph' in sys.argv:
-  create_profiling_graph()
+elif '--graph' in sys.argv or '--report' in sys.argv:
+  all_results = load_profiler_logs()
+  if all_results:
+    if '--graph' in sys.argv:
+      create_profiling_graph(all_results)
+    if '--report' in sys.argv:
+      create_report(all_results)
+    if not DEBUG_EMPROFILE_PY:
+      delete_profiler_logs()
 else:
   print('Unknown command "' + sys.argv[1] + '"!')
   sys.exit(1)
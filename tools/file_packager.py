@@ -21,7 +21,7 @@ data downloads.
 
 Usage:
 
-  file_packager TARGET [--preload A [B..]] [--embed C [D..]] [--exclude E [F..]]] [--js-output=OUTPUT.js] [--no-force] [--use-preload-cache] [--indexedDB-name=EM_PRELOAD_CACHE] [--separate-metadata] [--lz4] [--use-preload-plugins]
+  file_packager TARGET [--preload A [B..]] [--embed C [D..]] [--exclude E [F..]]] [--js-output=OUTPUT.js] [--no-force] [--use-preload-cache] [--indexedDB-name=EM_PRELOAD_CACHE] [--separate-metadata] [--lz4] [--use-preload-plugins] [--incremental] [--lazy]
 
   --preload  ,
   --embed    See emcc --help for more details on those options.
@@ -49,8 +49,22 @@ Usage:
   --use-preload-plugins Tells the file packager to run preload plugins on the files as they are loaded. This performs tasks like decoding images
                         and audio using the browser's codecs.
 
+  --incremental Keeps the layout of the package in TARGET.state.json, and when run again only reads the files that changed (by size and
+                modification time), adds new contents at the end of the package, and with --lz4 only compresses the segments of the
+                package that changed. The package is laid out from scratch when more than half of it is no longer used.
+
+  --lazy Writes the package with an index of its files at the start. The client only reads the index before running the program,
+         and reads the data of each file in chunks when the file is first read, with range requests on the web, and from the
+         local file in Node. See LAZY_PACKAGE in src/settings.js, you must build the main program with that flag. Files in
+         such a package are read-only. This cannot be used with --lz4, --use-preload-cache, --use-preload-plugins or
+         --incremental.
+
 Notes:
 
+  * Preloaded files with the same contents share one range of the package.
+
+  * With --lz4 the package is compressed in segments of LZ4_SEGMENT_SIZE bytes, on EMCC_CORES cores.
+
   * The file packager generates unix-style file paths. So if you are on windows and a file is accessed at
     subdir\file, in JS it will be subdir/file. For simplicity we treat the web platform as a *NIX.
 """
@@ -61,6 +75,9 @@ import shutil
 import random
 import uuid
 import ctypes
+import hashlib
+import struct
+from concurrent.futures import ThreadPoolExecutor
 
 sys.path.insert(1, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 
@@ -69,13 +86,13 @@ if __name__ == '__main__':
   ToolchainProfiler.record_process_start()
 
 import posixpath
-from tools import shared
+from tools import shared, building
 from subprocess import PIPE
 import fnmatch
 import json
 
 if len(sys.argv) == 1:
-  print('''Usage: file_packager TARGET [--preload A [B..]] [--embed C [D..]] [--exclude E [F..]]] [--js-output=OUTPUT.js] [--no-force] [--use-preload-cache] [--indexedDB-name=EM_PRELOAD_CACHE] [--separate-metadata] [--lz4] [--use-preload-plugins]
+  print('''Usage: file_packager TARGET [--preload A [B..]] [--embed C [D..]] [--exclude E [F..]]] [--js-output=OUTPUT.js] [--no-force] [--use-preload-cache] [--indexedDB-name=EM_PRELOAD_CACHE] [--separate-metadata] [--lz4] [--use-preload-plugins] [--incremental] [--lazy]
 See the source for more details.''')
   sys.exit(0)
 
@@ -89,6 +106,20 @@ AUDIO_MIMETYPES = {'ogg': 'audio/ogg', 'wav': 'audio/wav', 'mp3': 'audio/mpeg'}
 
 DDS_HEADER_SIZE = 128
 
+# With --lz4 the package is compressed in independent segments of this size, in
+# parallel. It must be a multiple of CHUNK_SIZE in third_party/mini-lz4.js.
+LZ4_SEGMENT_SIZE = int(os.environ.get('EMCC_LZ4_SEGMENT_SIZE') or 16 * 1024 * 1024) # configuring this is just for debugging purposes
+LZ4_CHUNK_SIZE = 2048
+assert LZ4_SEGMENT_SIZE % LZ4_CHUNK_SIZE == 0
+
+# Bump this when the format of the --incremental state file changes.
+STATE_VERSION = 1
+
+# The header of a --lazy package: the magic, the format version, and the size
+# of the index that follows it. See LAZYPACKAGE in src/library_lazy_package.js.
+LAZY_PACKAGE_MAGIC = b'EMPK'
+LAZY_PACKAGE_VERSION = 1
+
 # Set to 1 to randomize file order and add some padding,
 # to work around silly av false positives
 AV_WORKAROUND = 0
@@ -157,6 +188,185 @@ def add(mode, rootpathsrc, rootpathdst):
     dirnames.extend(new_dirnames)
 
 
+def hash_file(filename):
+  h = hashlib.sha256()
+  with open(filename, 'rb') as f:
+    for block in iter(lambda: f.read(1024 * 1024), b''):
+      h.update(block)
+  return h.hexdigest()
+
+
+def get_stamp(filename):
+  st = os.stat(filename)
+  return [st.st_size, st.st_mtime_ns]
+
+
+def load_state(state_file, data_target, lz4):
+  """Returns the state saved by the previous --incremental run, if it
+  describes the package that is on disk now."""
+  try:
+    with open(state_file) as f:
+      state = json.load(f)
+    package_stamp = get_stamp(data_target)
+  except (OSError, ValueError):
+    return None
+  if state.get('version') != STATE_VERSION or state['lz4'] != lz4 or state['segment_size'] != LZ4_SEGMENT_SIZE or state['package_stamp'] != package_stamp:
+    return None
+  return state
+
+
+def layout_data(data_files, state, incremental):
+  """Assigns each file its range in the package data. Files with the same
+  contents share a range. Contents that are in the data described by `state`
+  keep their range there, and new contents are added at the end.
+
+  Returns the size of the data, the ranges of the contents in use, by their
+  key, and the (start, srcpath) of the new contents, which need to be
+  written."""
+  if state:
+    ranges = dict(state['ranges'])
+    old_files = state['files']
+    size = state['size']
+  else:
+    ranges = {}
+    old_files = {}
+    size = 0
+
+  # Only files of the same size can have the same contents, so without
+  # --incremental other files need not be hashed.
+  sizes = {}
+  for file_ in data_files:
+    file_['stamp'] = get_stamp(file_['srcpath'])
+    sizes[file_['stamp'][0]] = sizes.get(file_['stamp'][0], 0) + 1
+
+  used = {}
+  new_contents = []
+  for file_ in data_files:
+    old = old_files.get(file_['srcpath'])
+    if old and old['stamp'] == file_['stamp']:
+      key = old['key']
+    elif incremental or sizes[file_['stamp'][0]] > 1:
+      key = hash_file(file_['srcpath'])
+    else:
+      key = 'file:' + file_['srcpath']
+    file_['key'] = key
+    if key not in ranges:
+      ranges[key] = [size, size + file_['stamp'][0]]
+      new_contents.append((size, file_['srcpath']))
+      size = ranges[key][1]
+      if AV_WORKAROUND:
+        size += 1
+    elif key in used:
+      # Writes to the file must not change the other files with these contents.
+      file_['copy'] = 1
+    used[key] = ranges[key]
+    file_['data_start'], file_['data_end'] = ranges[key]
+  return size, used, new_contents
+
+
+def write_data(data_target, size, new_contents, in_place, header=b''):
+  with open(data_target, 'r+b' if in_place else 'wb') as data:
+    data.write(header)
+    for start, srcpath in new_contents:
+      data.seek(len(header) + start)
+      with open(srcpath, 'rb') as f:
+        shutil.copyfileobj(f, data)
+      if AV_WORKAROUND:
+        data.write(b'\0')
+    data.truncate(len(header) + size)
+
+
+def get_lazy_package_header(data_files, size):
+  """Returns the header and index of a --lazy package."""
+  index = json.dumps({
+    'files': [{'filename': file_['dstpath'], 'start': file_['data_start'], 'end': file_['data_end']} for file_ in data_files],
+    'size': size,
+  }, separators=(',', ':')).encode('utf-8')
+  return struct.pack('<4sII', LAZY_PACKAGE_MAGIC, LAZY_PACKAGE_VERSION, len(index)) + index
+
+
+def read_data(sources, start, end):
+  """Returns the bytes [start, end) of the package data, given the sorted
+  (start, end, srcpath) of the contents in use. Unused bytes are zero."""
+  data = bytearray(end - start)
+  for source_start, source_end, srcpath in sources:
+    if source_end <= start or source_start >= end:
+      continue
+    offset = max(start, source_start)
+    with open(srcpath, 'rb') as f:
+      f.seek(offset - source_start)
+      chunk = f.read(min(end, source_end) - offset)
+    data[offset - start:offset - start + len(chunk)] = chunk
+  return data
+
+
+def compress_segment(sources, start, end):
+  """Compresses the bytes [start, end) of the package data with
+  tools/lz4-compress.js, and returns its metadata and compressed bytes."""
+  temp_files = shared.configuration.get_temp_files()
+  with temp_files.get('.lz4in') as f:
+    f.write(read_data(sources, start, end))
+  compressed = temp_files.get('.lz4').name
+  meta = json.loads(shared.run_js_tool(shared.path_from_root('tools', 'lz4-compress.js'),
+                                       [shared.path_from_root('third_party', 'mini-lz4.js'),
+                                        f.name, compressed], stdout=PIPE, stderr=None if DEBUG else PIPE))
+  with open(compressed, 'rb') as c:
+    # The output has room for two decompressed chunks at the end, which is
+    # only added once to the whole package.
+    data = c.read(meta['cachedOffset'])
+  shared.try_delete(f.name)
+  shared.try_delete(compressed)
+  return {'offsets': meta['offsets'], 'sizes': meta['sizes'], 'successes': meta['successes']}, data
+
+
+def compress_data(data_target, size, sources, state):
+  """Compresses the package data in segments, in parallel, and writes it to
+  data_target. Segments that are unchanged since the run that saved `state`
+  are copied from the existing package.
+
+  Returns the LZ4 metadata of the package, and that of its segments."""
+  num_segments = (size + LZ4_SEGMENT_SIZE - 1) // LZ4_SEGMENT_SIZE
+  old_segments = state['segments'] if state else []
+  # New contents are only ever added at the end.
+  first_dirty = len(old_segments)
+  if state and state['size'] != size:
+    first_dirty = min(first_dirty, state['size'] // LZ4_SEGMENT_SIZE)
+  dirty = [i for i in range(num_segments) if i >= first_dirty]
+
+  with ThreadPoolExecutor(building.get_num_cores()) as pool:
+    compressed = dict(zip(dirty, pool.map(lambda i: compress_segment(sources, i * LZ4_SEGMENT_SIZE, min(size, (i + 1) * LZ4_SEGMENT_SIZE)), dirty)))
+  if DEBUG:
+    print('compressed %d of %d segments' % (len(dirty), num_segments), file=sys.stderr)
+
+  segments = []
+  meta = {'data': None, 'cachedOffset': 0, 'cachedIndexes': [-1, -1], 'cachedChunks': [None, None],
+          'offsets': [], 'sizes': [], 'successes': []}
+  temp = data_target + '.tmp'
+  with open(temp, 'wb') as out:
+    old_package = open(data_target, 'rb') if state else None
+    try:
+      for i in range(num_segments):
+        if i in compressed:
+          segment, data = compressed[i]
+        else:
+          segment = old_segments[i]
+          old_package.seek(segment['offset'])
+          data = old_package.read(segment['size'])
+        segment = dict(segment, offset=out.tell(), size=len(data))
+        meta['offsets'] += [out.tell() + offset for offset in segment['offsets']]
+        meta['sizes'] += segment['sizes']
+        meta['successes'] += segment['successes']
+        out.write(data)
+        segments.append(segment)
+    finally:
+      if old_package:
+        old_package.close()
+    meta['cachedOffset'] = out.tell()
+    out.write(bytes(2 * LZ4_CHUNK_SIZE))
+  os.replace(temp, data_target)
+  return meta, segments
+
+
 def main():
   data_files = []
   export_name = 'Module'
@@ -178,6 +388,8 @@ def main():
   separate_metadata = False
   lz4 = False
   use_preload_plugins = False
+  incremental = False
+  lazy = False
 
   for arg in sys.argv[2:]:
     if arg == '--preload':
@@ -208,6 +420,12 @@ def main():
     elif arg == '--use-preload-plugins':
       use_preload_plugins = True
       leading = ''
+    elif arg == '--incremental':
+      incremental = True
+      leading = ''
+    elif arg == '--lazy':
+      lazy = True
+      leading = ''
     elif arg.startswith('--js-output'):
       jsoutput = arg.split('=', 1)[1] if '=' in arg else None
       leading = ''
@@ -262,6 +480,11 @@ def main():
           'so that it includes support for loading this file package',
           file=sys.stderr)
 
+  if lazy and (lz4 or use_preload_cache or use_preload_plugins or incremental):
+    print('error: --lazy cannot be used with --lz4, --use-preload-cache, --use-preload-plugins or --incremental',
+          file=sys.stderr)
+    return 1
+
   if jsoutput and os.path.abspath(jsoutput) == os.path.abspath(data_target):
     print('error: TARGET should not be the same value of --js-output',
           file=sys.stderr)
@@ -384,24 +607,32 @@ def main():
   if has_preloaded:
     # Bundle all datafiles into one archive. Avoids doing lots of simultaneous
     # XHRs which has overhead.
-    start = 0
-    with open(data_target, 'wb') as data:
-      for file_ in data_files:
-        file_['data_start'] = start
-        with open(file_['srcpath'], 'rb') as f:
-          curr = f.read()
-        file_['data_end'] = start + len(curr)
-        if AV_WORKAROUND:
-            curr += '\x00'
-        start += len(curr)
-        data.write(curr)
+    preloaded_files = [file_ for file_ in data_files if file_['mode'] == 'preload']
+    state_file = data_target + '.state.json'
+    state = load_state(state_file, data_target, lz4) if incremental else None
+    if incremental:
+      ToolchainProfiler.record_cache_access('file_packager', bool(state))
+    size, ranges, new_contents = layout_data(preloaded_files, state, incremental)
+    if state and 2 * sum(end - start for start, end in ranges.values()) < size:
+      if DEBUG:
+        print('most of the package is no longer used, laying it out again', file=sys.stderr)
+      state = None
+      size, ranges, new_contents = layout_data(preloaded_files, state, incremental)
+    if DEBUG:
+      print('writing %d of %d files to the package' % (len(new_contents), len(preloaded_files)), file=sys.stderr)
+
+    if lazy:
+      write_data(data_target, size, new_contents, in_place=False,
+                 header=get_lazy_package_header(preloaded_files, size))
+    elif not lz4:
+      write_data(data_target, size, new_contents, in_place=bool(state))
 
     # TODO: sha256sum on data_target
-    if start > 256 * 1024 * 1024:
+    if size > 256 * 1024 * 1024:
       print('warning: file packager is creating an asset bundle of %d MB. '
             'this is very large, and browsers might have trouble loading it. '
             'see https://hacks.mozilla.org/2015/02/synchronous-execution-and-filesystem-access-in-emscripten/'
-            % (start / (1024 * 1024)), file=sys.stderr)
+            % (size / (1024 * 1024)), file=sys.stderr)
 
     create_preloaded = '''
           Module['FS_createPreloadedFile'](this.name, null, byteArray, true, true, function() {
@@ -419,15 +650,16 @@ def main():
           Module['removeRunDependency']('fp ' + that.name);
   '''
 
-    if not lz4:
+    if not lz4 and not lazy:
         # Data requests - for getting a block of data out of the big archive - have
         # a similar API to XHRs
         code += '''
           /** @constructor */
-          function DataRequest(start, end, audio) {
+          function DataRequest(start, end, audio, copy) {
             this.start = start;
             this.end = end;
             this.audio = audio;
+            this.copy = copy;
           }
           DataRequest.prototype = {
             requests: {},
@@ -439,6 +671,8 @@ def main():
             send: function() {},
             onload: function() {
               var byteArray = this.byteArray.subarray(this.start, this.end);
+              // Files with the same contents share a range of the package.
+              if (this.copy) byteArray = byteArray.slice();
               this.finish(byteArray);
             },
             finish: function(byteArray) {
@@ -451,7 +685,7 @@ def main():
         ''' % (create_preloaded if use_preload_plugins else create_data, '''
               var files = metadata['files'];
               for (var i = 0; i < files.length; ++i) {
-                new DataRequest(files[i]['start'], files[i]['end'], files[i]['audio']).open('GET', files[i]['filename']);
+                new DataRequest(files[i]['start'], files[i]['end'], files[i]['audio'], files[i]['copy']).open('GET', files[i]['filename']);
               }
       ''')
 
@@ -479,17 +713,25 @@ def main():
     elif file_['mode'] == 'preload':
       # Preload
       counter += 1
-      metadata['files'].append({
+      if lazy:
+        # The files are listed in the index of the package.
+        continue
+      entry = {
         'filename': file_['dstpath'],
         'start': file_['data_start'],
         'end': file_['data_end'],
         'audio': 1 if filename[-4:] in AUDIO_SUFFIXES else 0,
-      })
+      }
+      if file_.get('copy'):
+        entry['copy'] = 1
+      metadata['files'].append(entry)
     else:
       assert 0
 
   if has_preloaded:
-    if not lz4:
+    if lazy:
+      use_data = None
+    elif not lz4:
       # Get the big archive and split it up
       use_data = '''
           // Reuse the bytearray from the XHR as the source for file reads.
@@ -506,12 +748,10 @@ def main():
 
     else:
       # LZ4FS usage
-      temp = data_target + '.orig'
-      shutil.move(data_target, temp)
-      meta = shared.run_js_tool(shared.path_from_root('tools', 'lz4-compress.js'),
-                                [shared.path_from_root('third_party', 'mini-lz4.js'),
-                                temp, data_target], stdout=PIPE)
-      os.unlink(temp)
+      sources = sorted((start, end, srcpath) for (start, end), srcpath in
+                       {(file_['data_start'], file_['data_end']): file_['srcpath'] for file_ in preloaded_files}.items())
+      meta, segments = compress_data(data_target, size, sources, state)
+      meta = json.dumps(meta, separators=(',', ':'))
       use_data = '''
             var compressedData = %s;
             compressedData['data'] = byteArray;
@@ -520,11 +760,26 @@ def main():
             Module['removeRunDependency']('datafile_%s');
       ''' % (meta, "true" if use_preload_plugins else "false", shared.JS.escape_for_js_string(data_target))
 
+    if incremental:
+      with open(state_file, 'w') as f:
+        json.dump({
+          'version': STATE_VERSION,
+          'lz4': lz4,
+          'segment_size': LZ4_SEGMENT_SIZE,
+          'size': size,
+          'ranges': ranges,
+          'files': {file_['srcpath']: {'stamp': file_['stamp'], 'key': file_['key']} for file_ in preloaded_files},
+          'segments': segments if lz4 else None,
+          'package_stamp': get_stamp(data_target),
+        }, f)
+
     package_uuid = uuid.uuid4()
     package_name = data_target
     remote_package_size = os.path.getsize(package_name)
     remote_package_name = os.path.basename(package_name)
-    ret += r'''
+    if not lazy:
+      # The package path is only used as a key of the IndexedDB cache.
+      ret += r'''
       var PACKAGE_PATH;
       if (typeof window === 'object') {
         PACKAGE_PATH = window['encodeURIComponent'](window.location.pathname.toString().substring(0, window.location.pathname.toString().lastIndexOf('/')) + '/');
@@ -534,6 +789,8 @@ def main():
       } else {
         throw 'using preloaded data can only be done on a web page or in a web worker';
       }
+    '''
+    ret += r'''
       var PACKAGE_NAME = '%s';
       var REMOTE_PACKAGE_BASE = '%s';
       if (typeof Module['locateFilePackage'] === 'function' && !Module['locateFile']) {
@@ -714,7 +971,8 @@ def main():
         }
       '''
 
-    ret += r'''
+    if not lazy:
+      ret += r'''
       function fetchRemotePackage(packageName, packageSize, callback, errback) {
         var xhr = new XMLHttpRequest();
         xhr.open('GET', packageName, true);
@@ -762,13 +1020,15 @@ def main():
         };
         xhr.send(null);
       };
-
+    '''
+    ret += r'''
       function handleError(error) {
         console.error('package error:', error);
       };
     '''
 
-    code += r'''
+    if not lazy:
+      code += r'''
       function processPackageData(arrayBuffer) {
         assert(arrayBuffer, 'Loading data file failed.');
         assert(arrayBuffer instanceof ArrayBuffer, 'bad input to processPackageData');
@@ -776,8 +1036,10 @@ def main():
         var curr;
         %s
       };
+      ''' % use_data
+    code += r'''
       Module['addRunDependency']('datafile_%s');
-    ''' % (use_data, shared.JS.escape_for_js_string(data_target))
+    ''' % shared.JS.escape_for_js_string(data_target)
     # use basename because from the browser's point of view,
     # we need to find the datafile in the same dir as the html file
 
@@ -785,7 +1047,17 @@ def main():
       if (!Module.preloadResults) Module.preloadResults = {};
     '''
 
-    if use_preload_cache:
+    if lazy:
+      # Only the index is read before running, the data of the files is read
+      # when they are first read from.
+      code += r'''
+        Module.preloadResults[PACKAGE_NAME] = {fromCache: false};
+        assert(typeof Module.LAZYPACKAGE === 'object', 'LAZYPACKAGE not present - was your app built with  -s LAZY_PACKAGE=1  ?');
+        Module.LAZYPACKAGE.loadPackage(REMOTE_PACKAGE_NAME, function() {
+          Module['removeRunDependency']('datafile_%s');
+        }, handleError);
+      ''' % shared.JS.escape_for_js_string(data_target)
+    elif use_preload_cache:
       code += r'''
         function preloadFallback(error) {
           console.error(error);
@@ -3,6 +3,7 @@
 # University of Illinois/NCSA Open Source License.  Both these licenses can be
 # found in the LICENSE file.
 
+import contextlib
 import glob
 import hashlib
 import itertools
@@ -13,7 +14,10 @@ import shutil
 import subprocess
 import sys
 import tarfile
+import threading
+import time
 import zipfile
+from concurrent.futures import ThreadPoolExecutor, wait, FIRST_EXCEPTION
 from glob import iglob
 
 from . import shared, building, ports, config, utils
@@ -93,6 +97,9 @@ def run_build_commands(commands):
   # headers are installed.  This prevents each sub-process from attempting
   # to setup the sysroot itself.
   ensure_sysroot()
+  if build_graph:
+    build_graph.run_commands(commands)
+    return
   cores = min(len(commands), building.get_num_cores())
   if cores <= 1 or shared.DEBUG:
     for command in commands:
@@ -106,6 +113,102 @@ def run_build_commands(commands):
     pool.map_async(run_one_command, commands, chunksize=1).get(999999)
 
 
+# The BuildGraph that is running, if any.
+build_graph = None
+
+
+class BuildGraph(object):
+  """Builds several libraries and ports at the same time, with the compile
+  commands of all of them running on one pool of `EMCC_CORES` workers.
+
+  Building one library after another leaves cores idle while each library is
+  archived, and while the last few files of each library compile. Here each
+  library is built on a thread of its own, and run_build_commands() only adds
+  its commands to the shared pool, so that the commands of the next libraries
+  keep the cores busy meanwhile.
+
+  Libraries are built in parallel with each other. Other tasks, such as ports,
+  change shared.Settings while they are built, and so run one after another
+  (in parallel with the libraries)."""
+
+  def __init__(self):
+    self.cores = building.get_num_cores()
+    self.pool = ThreadPoolExecutor(self.cores)
+    self.futures = []
+    self.failed = False
+    self.current = threading.local()
+    # The name, command durations, time spent waiting for commands, and total
+    # time of each task, for the estimate in report().
+    self.stats = []
+
+  def run_commands(self, commands):
+    def run_timed(cmd):
+      start = time.time()
+      run_one_command(cmd)
+      return time.time() - start
+
+    if self.failed:
+      raise Exception('another task failed')
+    start = time.time()
+    futures = [self.pool.submit(run_timed, cmd) for cmd in commands]
+    self.futures += futures
+    durations = [f.result() for f in futures]
+    if hasattr(self.current, 'durations'):
+      self.current.durations += durations
+      self.current.waited += time.time() - start
+
+  def run_task(self, name, task):
+    self.current.durations = []
+    self.current.waited = 0
+    start = time.time()
+    task()
+    self.stats.append((name, self.current.durations, self.current.waited, time.time() - start))
+    del self.current.durations
+
+  def run(self, parallel_tasks, serial_tasks):
+    """Runs the (name, function) pairs in `parallel_tasks` at the same time,
+    starting in order (so the largest should come first), and those in
+    `serial_tasks` one after another."""
+    global build_graph
+    # Install the sysroot before any of the tasks need it.
+    ensure_sysroot()
+    start = time.time()
+    build_graph = self
+    try:
+      with ThreadPoolExecutor(self.cores + 1) as tasks:
+        futures = []
+        if serial_tasks:
+          futures.append(tasks.submit(lambda: [self.run_task(name, task) for name, task in serial_tasks]))
+        futures += [tasks.submit(self.run_task, name, task) for name, task in parallel_tasks]
+        done, _ = wait(futures, return_when=FIRST_EXCEPTION)
+        for f in done:
+          if f.exception():
+            # Stop the other tasks as soon as possible.
+            self.failed = True
+            for other in futures + self.futures:
+              other.cancel()
+            raise f.exception()
+    finally:
+      build_graph = None
+      self.pool.shutdown()
+    self.report(time.time() - start)
+
+  def report(self, elapsed):
+    # Estimate how long building the tasks one after another would take: the
+    # commands of each task on all cores (as run_build_commands does without a
+    # graph), and then the rest of the task (archiving, fetching ports, etc.).
+    # The commands are timed while they share the cores, so this is only
+    # accurate if EMCC_CORES is not more than the number of cores.
+    serial = 0
+    for name, durations, waited, total in self.stats:
+      workers = [0] * self.cores
+      for duration in durations:
+        workers[workers.index(min(workers))] += duration
+      serial += max(workers) + total - waited
+    logger.info('built %d tasks in %.2fs on %d cores, one after another they would take about %.2fs (%.2fs saved)',
+                len(self.stats), elapsed, self.cores, serial, serial - elapsed)
+
+
 def create_lib(libname, inputs):
   """Create a library from a set of input objects."""
   suffix = shared.suffix(libname)
@@ -626,6 +729,43 @@ class AsanInstrumentedLibrary(Library):
     return super(AsanInstrumentedLibrary, cls).get_default_variation(is_asan=shared.Settings.USE_ASAN, **kwargs)
 
 
+class SIMDLibrary(Library):
+  """A library that has a variant built with -msimd128."""
+  def __init__(self, **kwargs):
+    self.is_simd = kwargs.pop('is_simd', False)
+    super(SIMDLibrary, self).__init__(**kwargs)
+
+  def get_cflags(self):
+    cflags = super(SIMDLibrary, self).get_cflags()
+    if self.is_simd:
+      cflags += ['-msimd128']
+    return cflags
+
+  def get_base_name(self):
+    name = super(SIMDLibrary, self).get_base_name()
+    if self.is_simd:
+      name += '-simd'
+    return name
+
+  @classmethod
+  def vary_on(cls):
+    return super(SIMDLibrary, cls).vary_on() + ['is_simd']
+
+  @classmethod
+  def variations(cls):
+    # The SIMD string functions read past the end of strings (within aligned
+    # blocks), which ASan would report, so the two are never combined.
+    return [combo for combo in super(SIMDLibrary, cls).variations()
+            if not (combo['is_simd'] and combo.get('is_asan'))]
+
+  @classmethod
+  def get_default_variation(cls, **kwargs):
+    return super(SIMDLibrary, cls).get_default_variation(
+      is_simd=shared.Settings.WASM_SIMD and not shared.Settings.USE_ASAN,
+      **kwargs
+    )
+
+
 class libcompiler_rt(MTLibrary):
   name = 'libcompiler_rt'
   # compiler_rt files can't currently be part of LTO although we are hoping to remove this
@@ -641,7 +781,7 @@ class libcompiler_rt(MTLibrary):
   src_files.append(shared.path_from_root('system', 'lib', 'compiler-rt', 'emscripten_exception_builtins.c'))
 
 
-class libc(AsanInstrumentedLibrary, MuslInternalLibrary, MTLibrary):
+class libc(AsanInstrumentedLibrary, SIMDLibrary, MuslInternalLibrary, MTLibrary):
   name = 'libc'
 
   # Without -fno-builtin, LLVM can optimize away or convert calls to library
@@ -699,6 +839,17 @@ class libc(AsanInstrumentedLibrary, MuslInternalLibrary, MTLibrary):
         shared.path_from_root('system', 'lib', 'libc', 'emscripten_asan_fcntl.c'),
       ]
 
+    if self.is_simd:
+      # wasm SIMD128 versions of the hot string functions, which handle 16 bytes
+      # per iteration. strchr and strrchr are built on __strchrnul and
+      # __memrchr, so they use these too. strlen is in libc_rt_wasm.
+      simd_files = ['memchr.c', 'memrchr.c', 'strchrnul.c', 'memcmp.c',
+                    'strcmp.c', 'strspn.c']
+      ignore += simd_files
+      libc_files += files_in_path(
+        path_components=['system', 'lib', 'libc'],
+        filenames=['emscripten_simd_' + f for f in simd_files])
+
     # These are included in wasm_libc_rt instead
     ignore += [os.path.basename(f) for f in get_wasm_libc_rt_files()]
 
@@ -732,7 +883,8 @@ class libc(AsanInstrumentedLibrary, MuslInternalLibrary, MTLibrary):
 
     libc_files += files_in_path(
         path_components=['system', 'lib', 'libc'],
-        filenames=['extras.c', 'wasi-helpers.c', 'emscripten_pthread.c'])
+        filenames=['extras.c', 'wasi-helpers.c', 'emscripten_pthread.c',
+                   'emscripten_unicode.c', 'emscripten_math_batch.c'])
 
     libc_files += files_in_path(
         path_components=['system', 'lib', 'pthread'],
@@ -967,11 +1119,12 @@ class libmalloc(MTLibrary):
 
   def __init__(self, **kwargs):
     self.malloc = kwargs.pop('malloc')
-    if self.malloc not in ('dlmalloc', 'emmalloc', 'emmalloc-debug', 'emmalloc-memvalidate', 'emmalloc-verbose', 'emmalloc-memvalidate-verbose', 'none'):
-      raise Exception('malloc must be one of "emmalloc[-debug|-memvalidate][-verbose]", "dlmalloc" or "none", see settings.js')
+    if self.malloc not in ('dlmalloc', 'dlmalloc-mt', 'emmalloc', 'emmalloc-debug', 'emmalloc-memvalidate', 'emmalloc-verbose', 'emmalloc-memvalidate-verbose', 'none'):
+      raise Exception('malloc must be one of "emmalloc[-debug|-memvalidate][-verbose]", "dlmalloc[-mt]" or "none", see settings.js')
 
     self.use_errno = kwargs.pop('use_errno')
     self.is_tracing = kwargs.pop('is_tracing')
+    self.is_profiling = kwargs.pop('is_profiling')
     self.memvalidate = kwargs.pop('memvalidate')
     self.verbose = kwargs.pop('verbose')
     self.is_debug = kwargs.pop('is_debug') or self.memvalidate or self.verbose
@@ -981,10 +1134,13 @@ class libmalloc(MTLibrary):
   def get_files(self):
     malloc_base = self.malloc.replace('-memvalidate', '').replace('-verbose', '').replace('-debug', '')
     malloc = shared.path_from_root('system', 'lib', {
-      'dlmalloc': 'dlmalloc.c', 'emmalloc': 'emmalloc.cpp',
+      'dlmalloc': 'dlmalloc.c', 'dlmalloc-mt': 'dlmalloc_mt.c', 'emmalloc': 'emmalloc.cpp',
     }[malloc_base])
     sbrk = shared.path_from_root('system', 'lib', 'sbrk.c')
-    return [malloc, sbrk]
+    files = [malloc, sbrk]
+    if self.is_profiling:
+      files.append(shared.path_from_root('system', 'lib', 'malloc_profiler.c'))
+    return files
 
   def get_cflags(self):
     cflags = super(libmalloc, self).get_cflags()
@@ -1000,6 +1156,8 @@ class libmalloc(MTLibrary):
       cflags += ['-DMALLOC_FAILURE_ACTION=', '-DEMSCRIPTEN_NO_ERRNO']
     if self.is_tracing:
       cflags += ['--tracing']
+    if self.is_profiling:
+      cflags += ['-DEMSCRIPTEN_MALLOC_PROFILER']
     return cflags
 
   def get_base_name_prefix(self):
@@ -1014,6 +1172,8 @@ class libmalloc(MTLibrary):
       name += '-noerrno'
     if self.is_tracing:
       name += '-tracing'
+    if self.is_profiling:
+      name += '-profiling'
     return name
 
   def can_use(self):
@@ -1021,7 +1181,7 @@ class libmalloc(MTLibrary):
 
   @classmethod
   def vary_on(cls):
-    return super(libmalloc, cls).vary_on() + ['is_debug', 'use_errno', 'is_tracing', 'memvalidate', 'verbose']
+    return super(libmalloc, cls).vary_on() + ['is_debug', 'use_errno', 'is_tracing', 'is_profiling', 'memvalidate', 'verbose']
 
   @classmethod
   def get_default_variation(cls, **kwargs):
@@ -1030,6 +1190,7 @@ class libmalloc(MTLibrary):
       is_debug=shared.Settings.ASSERTIONS >= 2,
       use_errno=shared.Settings.SUPPORT_ERRNO,
       is_tracing=shared.Settings.EMSCRIPTEN_TRACING,
+      is_profiling=shared.Settings.MALLOC_PROFILER,
       memvalidate='memvalidate' in shared.Settings.MALLOC,
       verbose='verbose' in shared.Settings.MALLOC,
       **kwargs
@@ -1039,6 +1200,7 @@ class libmalloc(MTLibrary):
   def variations(cls):
     combos = super(libmalloc, cls).variations()
     return ([dict(malloc='dlmalloc', **combo) for combo in combos if not combo['memvalidate'] and not combo['verbose']] +
+            [dict(malloc='dlmalloc-mt', **combo) for combo in combos if combo['is_mt'] and not combo['memvalidate'] and not combo['verbose']] +
             [dict(malloc='emmalloc', **combo) for combo in combos if not combo['memvalidate'] and not combo['verbose']] +
             [dict(malloc='emmalloc-memvalidate-verbose', **combo) for combo in combos if combo['memvalidate'] and combo['verbose']] +
             [dict(malloc='emmalloc-memvalidate', **combo) for combo in combos if combo['memvalidate'] and not combo['verbose']] +
@@ -1057,7 +1219,7 @@ class libgl(MTLibrary):
   name = 'libgl'
 
   src_dir = ['system', 'lib', 'gl']
-  src_files = ['gl.c', 'webgl1.c', 'libprocaddr.c']
+  src_files = ['gl.c', 'webgl1.c', 'webgl_command_buffer.c', 'webgl_state_shadow.c', 'webgl_state_filter.c', 'libprocaddr.c']
 
   cflags = ['-Oz']
 
@@ -1066,6 +1228,9 @@ class libgl(MTLibrary):
     self.is_webgl2 = kwargs.pop('is_webgl2')
     self.is_ofb = kwargs.pop('is_ofb')
     self.is_full_es3 = kwargs.pop('is_full_es3')
+    self.is_cmdbuf = kwargs.pop('is_cmdbuf')
+    self.state_shadow = kwargs.pop('state_shadow')
+    self.is_filter = kwargs.pop('is_filter')
     if self.is_webgl2 or self.is_full_es3:
       # Don't use append or += here, otherwise we end up adding to
       # the class member.
@@ -1082,6 +1247,14 @@ class libgl(MTLibrary):
       name += '-ofb'
     if self.is_full_es3:
       name += '-full_es3'
+    if self.is_cmdbuf:
+      name += '-cmdbuf'
+    if self.state_shadow == 1:
+      name += '-shadow'
+    elif self.state_shadow == 2:
+      name += '-shadow-check'
+    if self.is_filter:
+      name += '-filter'
     return name
 
   def get_cflags(self):
@@ -1094,11 +1267,29 @@ class libgl(MTLibrary):
       cflags += ['-D__EMSCRIPTEN_OFFSCREEN_FRAMEBUFFER__']
     if self.is_full_es3:
       cflags += ['-D__EMSCRIPTEN_FULL_ES3__']
+    if self.is_cmdbuf:
+      cflags += ['-D__EMSCRIPTEN_GL_COMMAND_BUFFER__']
+    if self.state_shadow:
+      cflags += ['-D__EMSCRIPTEN_GL_STATE_SHADOW__=%d' % self.state_shadow]
+    if self.is_filter:
+      cflags += ['-D__EMSCRIPTEN_GL_STATE_FILTER__']
     return cflags
 
   @classmethod
   def vary_on(cls):
-    return super(libgl, cls).vary_on() + ['is_legacy', 'is_webgl2', 'is_ofb', 'is_full_es3']
+    return super(libgl, cls).vary_on() + ['is_legacy', 'is_webgl2', 'is_ofb', 'is_full_es3', 'is_cmdbuf', 'is_filter']
+
+  @classmethod
+  def variations(cls):
+    # The command buffer and the state shadow only exist on the pthread -> main
+    # thread proxying path. The state filter works on top of the JS library
+    # functions, which legacy GL emulation replaces.
+    combos = [combo for combo in super(libgl, cls).variations()
+              if (not combo['is_cmdbuf'] or (combo['is_mt'] and combo['is_ofb'])) and
+              not (combo['is_filter'] and combo['is_legacy'])]
+    return [dict(state_shadow=state_shadow, **combo)
+            for state_shadow, combo in itertools.product([0, 1, 2], combos)
+            if not state_shadow or (combo['is_mt'] and combo['is_ofb'])]
 
   @classmethod
   def get_default_variation(cls, **kwargs):
@@ -1107,6 +1298,9 @@ class libgl(MTLibrary):
       is_webgl2=shared.Settings.MAX_WEBGL_VERSION >= 2,
       is_ofb=shared.Settings.OFFSCREEN_FRAMEBUFFER,
       is_full_es3=shared.Settings.FULL_ES3,
+      is_cmdbuf=shared.Settings.OFFSCREEN_FRAMEBUFFER_COMMAND_BUFFER,
+      state_shadow=shared.Settings.OFFSCREEN_FRAMEBUFFER_STATE_SHADOW,
+      is_filter=shared.Settings.GL_STATE_FILTER,
       **kwargs
     )
 
@@ -1172,6 +1366,16 @@ class libasmfs(MTLibrary):
     return True
 
 
+class libnativefs(MTLibrary):
+  name = 'libnativefs'
+  never_force = True
+
+  # Written without libc++ so that it can be linked into C programs.
+  cflags = ['-O2', '-fno-exceptions', '-fno-rtti']
+  src_dir = ['system', 'lib', 'nativefs']
+  src_glob = '*.cpp'
+
+
 class libhtml5(Library):
   name = 'libhtml5'
 
@@ -1187,11 +1391,54 @@ class CompilerRTLibrary(Library):
   force_object_files = True
 
 
-class libc_rt_wasm(AsanInstrumentedLibrary, CompilerRTLibrary, MuslInternalLibrary):
+class libc_rt_wasm(AsanInstrumentedLibrary, SIMDLibrary, CompilerRTLibrary, MuslInternalLibrary):
   name = 'libc_rt_wasm'
 
+  def __init__(self, **kwargs):
+    self.is_bulk_memory = kwargs.pop('is_bulk_memory')
+    super(libc_rt_wasm, self).__init__(**kwargs)
+
+  def get_cflags(self):
+    cflags = super(libc_rt_wasm, self).get_cflags()
+    if self.is_bulk_memory:
+      # memcpy, memmove and memset use memory.copy and memory.fill, see
+      # emscripten_bulkmem.h
+      cflags += ['-mbulk-memory']
+    return cflags
+
+  def get_base_name(self):
+    name = super(libc_rt_wasm, self).get_base_name()
+    if self.is_bulk_memory:
+      name += '-bulkmem'
+    return name
+
+  @classmethod
+  def vary_on(cls):
+    return super(libc_rt_wasm, cls).vary_on() + ['is_bulk_memory']
+
+  @classmethod
+  def variations(cls):
+    # ASan builds keep the uninstrumented memcpy and friends from the default
+    # variant.
+    return [combo for combo in super(libc_rt_wasm, cls).variations()
+            if not (combo['is_bulk_memory'] and combo['is_asan'])]
+
+  @classmethod
+  def get_default_variation(cls, **kwargs):
+    return super(libc_rt_wasm, cls).get_default_variation(
+      is_bulk_memory=shared.Settings.BULK_MEMORY and not shared.Settings.USE_ASAN,
+      **kwargs
+    )
+
   def get_files(self):
-    return get_wasm_libc_rt_files()
+    files = get_wasm_libc_rt_files()
+    if self.is_simd:
+      # strlen lives here rather than in libc, see get_wasm_libc_rt_files.
+      files = [f for f in files if os.path.basename(f) != 'strlen.c']
+      files += files_in_path(
+        path_components=['system', 'lib', 'libc'],
+        filenames=['emscripten_simd_strlen.c'])
+    return files
 
 
 class libubsan_minimal_rt_wasm(CompilerRTLibrary, MTLibrary):
@@ -1667,7 +1914,7 @@ class Ports(object):
     if local_ports:
       logger.warning('using local ports: %s' % local_ports)
       local_ports = [pair.split('=', 1) for pair in local_ports.split(',')]
-      with shared.Cache.lock():
+      with Ports.lock(name):
         for local in local_ports:
           if name == local[0]:
             path = local[1]
@@ -1740,9 +1987,9 @@ class Ports(object):
     if os.path.exists(fullpath) and check_tag():
       return
 
-    # main logic. do this under a cache lock, since we don't want multiple jobs to
-    # retrieve the same port at once
-    with shared.Cache.lock():
+    # main logic. do this under the port's lock, since we don't want multiple jobs
+    # to retrieve the same port at once
+    with Ports.lock(name):
       if os.path.exists(fullpath):
         # Another early out in case another process build the library while we were
         # waiting for the lock
@@ -1759,6 +2006,26 @@ class Ports(object):
       # we unpacked a new version, clear the build in the cache
       Ports.clear_project_build(name)
 
+  @staticmethod
+  @contextlib.contextmanager
+  def lock(name):
+    """Locks a port, including its sources and build directory, which are shared
+    by all the libraries it builds."""
+    if config.FROZEN_CACHE:
+      # Nothing can be built, so there is nothing to wait for.
+      yield
+      return
+    with shared.Cache.lock_entry(os.path.join('ports', name)):
+      yield
+
+  @staticmethod
+  def get(port, settings):
+    """Gets the files of a port. The port is only locked while it is fetched
+    (see fetch_project()) or one of its libraries is built, so that using
+    ports that are already built does not wait for other processes."""
+    with shared.Cache.lock_while_creating(os.path.join('ports', port.name)):
+      return port.get(Ports, settings, shared)
+
   @staticmethod
   def clear_project_build(name):
     port = ports.ports_by_name[name]
@@ -1775,7 +2042,7 @@ def get_ports(settings):
     if port.needed(settings):
       try:
         # ports return their output files, which will be linked, or a txt file
-        ret += [f for f in port.get(Ports, settings, shared) if not f.endswith('.txt')]
+        ret += [f for f in Ports.get(port, settings) if not f.endswith('.txt')]
       except Exception:
         logger.error('a problem occurred when using an emscripten-ports library.  try to run `emcc --clear-ports` and then run this command again')
         raise
@@ -1832,7 +2099,7 @@ def build_port(port_name, settings):
   port_set = set((port,))
   resolve_dependencies(port_set, settings)
   for port in dependency_order(port_set):
-    port.get(Ports, settings, shared)
+    Ports.get(port, settings)
 
 
 def add_ports_cflags(args, settings):
@@ -1845,7 +2112,7 @@ def add_ports_cflags(args, settings):
   # Now get (i.e. build) the ports independency order.  This is important because the
   # headers from one ports might be needed before we can build the next.
   for port in dependency_order(needed):
-    port.get(Ports, settings, shared)
+    Ports.get(port, settings)
     args += port.process_args(Ports)
 
   return args
@@ -161,6 +161,14 @@ if EM_PROFILE_TOOLCHAIN:
       with ToolchainProfiler.log_access() as f:
         f.write(',\n{"pid":' + ToolchainProfiler.mypid_str + ',"subprocessPid":' + str(os.getpid()) + ',"op":"finish","targetPid":' + str(process_pid) + ',"time":' + ToolchainProfiler.timestamp() + ',"returncode":' + str(returncode) + '}')
 
+    # Records a lookup in one of the caches of the toolchain (e.g. 'system' for
+    # the system library cache), so that emprofile.py --report can compute hit
+    # rates.
+    @staticmethod
+    def record_cache_access(cache_name, hit):
+      with ToolchainProfiler.log_access() as f:
+        f.write(',\n{"pid":' + ToolchainProfiler.mypid_str + ',"subprocessPid":' + str(os.getpid()) + ',"op":"cache","name":"' + cache_name + '","hit":' + ('true' if hit else 'false') + ',"time":' + ToolchainProfiler.timestamp() + '}')
+
     @staticmethod
     def enter_block(block_name):
       with ToolchainProfiler.log_access() as f:
@@ -228,6 +236,10 @@ else:
     def record_subprocess_finish(process_pid, returncode):
       pass
 
+    @staticmethod
+    def record_cache_access(cache_name, hit):
+      pass
+
     @staticmethod
     def enter_block(block_name):
       pass